@@ -19,6 +19,7 @@
 #include <getopt.h>
 
 #include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <functional>
 #include <iomanip>
@@ -205,6 +206,11 @@ VintfInfo ListCommand::getVintfInfo(const std::string& fqInstanceName,
 
 bool ListCommand::getPidInfo(
         pid_t serverPid, BinderPidInfo *pidInfo) const {
+    // Servers that started after the snapshot was taken are looked up on their own.
+    if (mBinderSnapshot.updateIfOlderThan(std::chrono::seconds(1)) == OK &&
+        mBinderSnapshot.getPidInfo(BinderDebugContext::HWBINDER, serverPid, pidInfo) == OK) {
+        return true;
+    }
     const auto& status = getBinderPidInfo(BinderDebugContext::HWBINDER, serverPid, pidInfo);
     return status == OK;
 }
@@ -188,6 +188,9 @@ protected:
     // Cache for getPidInfo.
     std::map<pid_t, BinderPidInfo> mCachedPidInfos;
 
+    // State of all processes, parsed once for the getPidInfo of every server.
+    mutable BinderDebugSnapshot mBinderSnapshot;
+
     // Cache for getPartition.
     std::map<pid_t, Partition> mPartitions;
 
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "BufferPool"
+
+#include "BufferPool.h"
+
+#include <utils/Log.h>
+
+using namespace android;
+
+BufferPool::BufferPool(const HSV& color, int buffersPerSize)
+      : mColor(color), mBuffersPerSize(buffersPerSize > 0 ? buffersPerSize : 1) {}
+
+void BufferPool::prepare(const Dimensions& dimensions) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    prepareLocked(dimensions);
+}
+
+sp<GraphicBuffer> BufferPool::next(const Dimensions& dimensions) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Buffers& buffers = prepareLocked(dimensions);
+    if (buffers.buffers.empty()) {
+        return nullptr;
+    }
+
+    sp<GraphicBuffer> buffer = buffers.buffers[buffers.next];
+    buffers.next = (buffers.next + 1) % buffers.buffers.size();
+    return buffer;
+}
+
+size_t BufferPool::bufferCount() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    size_t count = 0;
+    for (const auto& [size, buffers] : mBuffers) {
+        count += buffers.buffers.size();
+    }
+    return count;
+}
+
+BufferPool::Buffers& BufferPool::prepareLocked(const Dimensions& dimensions) {
+    auto [it, inserted] =
+            mBuffers.try_emplace(std::make_pair(dimensions.width, dimensions.height));
+    Buffers& buffers = it->second;
+    if (!inserted) {
+        return buffers;
+    }
+
+    buffers.buffers.reserve(mBuffersPerSize);
+    for (int i = 0; i < mBuffersPerSize; i++) {
+        sp<GraphicBuffer> buffer = generateBuffer(dimensions);
+        if (buffer == nullptr) {
+            break;
+        }
+        buffers.buffers.push_back(buffer);
+        mColor.modulate();
+    }
+    return buffers;
+}
+
+sp<GraphicBuffer> BufferPool::generateBuffer(const Dimensions& dimensions) {
+    if (dimensions.width <= 0 || dimensions.height <= 0) {
+        ALOGE("generateBuffer: invalid dimensions %dx%d", dimensions.width, dimensions.height);
+        return nullptr;
+    }
+
+    sp<GraphicBuffer> buffer = new GraphicBuffer(dimensions.width, dimensions.height,
+            PIXEL_FORMAT_RGBA_8888, 1,
+            GraphicBuffer::USAGE_SW_WRITE_OFTEN | GraphicBuffer::USAGE_HW_TEXTURE |
+                    GraphicBuffer::USAGE_HW_COMPOSER,
+            "surfacereplayer");
+    status_t status = buffer->initCheck();
+    if (status != NO_ERROR) {
+        ALOGE("generateBuffer: failed to allocate %dx%d buffer, (%d)", dimensions.width,
+                dimensions.height, status);
+        return nullptr;
+    }
+
+    void* bits = nullptr;
+    status = buffer->lock(GraphicBuffer::USAGE_SW_WRITE_OFTEN, &bits);
+    if (status != NO_ERROR) {
+        ALOGE("generateBuffer: failed to lock buffer, (%d)", status);
+        return nullptr;
+    }
+
+    auto color = mColor.getRGB();
+
+    auto img = reinterpret_cast<uint8_t*>(bits);
+    for (uint32_t y = 0; y < buffer->getHeight(); y++) {
+        for (uint32_t x = 0; x < buffer->getWidth(); x++) {
+            uint8_t* pixel = img + (4 * (y * buffer->getStride() + x));
+            pixel[0] = color.r;
+            pixel[1] = color.g;
+            pixel[2] = color.b;
+            pixel[3] = LAYER_ALPHA;
+        }
+    }
+
+    status = buffer->unlock();
+    ALOGE_IF(status != NO_ERROR, "generateBuffer: failed to unlock buffer, (%d)", status);
+
+    return buffer;
+}
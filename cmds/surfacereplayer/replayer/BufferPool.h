@@ -0,0 +1,77 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_SURFACEREPLAYER_BUFFERPOOL_H
+#define ANDROID_SURFACEREPLAYER_BUFFERPOOL_H
+
+#include "Color.h"
+
+#include <ui/GraphicBuffer.h>
+
+#include <utils/StrongPointer.h>
+
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace android {
+
+struct Dimensions {
+    Dimensions() = default;
+    Dimensions(int w, int h) : width(w), height(h) {}
+
+    int width = 0;
+    int height = 0;
+};
+
+/*
+ * Buffers of one layer, filled with its color ahead of the replay.
+ *
+ * Each size the layer is updated with gets its own set of buffers, whose colors follow the same
+ * modulation as buffers filled on demand. The contents are never written again once generated, so
+ * buffers are handed out round-robin without waiting for SurfaceFlinger to release them.
+ */
+class BufferPool {
+  public:
+    BufferPool(const HSV& color, int buffersPerSize);
+
+    // Generates the buffers for the given size, if it has not been done already.
+    void prepare(const Dimensions& dimensions);
+
+    // Returns the next buffer of the given size, generating the set on first use.
+    sp<GraphicBuffer> next(const Dimensions& dimensions);
+
+    size_t bufferCount() const;
+
+  private:
+    struct Buffers {
+        std::vector<sp<GraphicBuffer>> buffers;
+        size_t next = 0;
+    };
+
+    Buffers& prepareLocked(const Dimensions& dimensions);
+    sp<GraphicBuffer> generateBuffer(const Dimensions& dimensions);
+
+    HSV mColor;
+    const int mBuffersPerSize;
+
+    mutable std::mutex mMutex;
+    std::map<std::pair<int, int>, Buffers> mBuffers;
+};
+
+}  // namespace android
+#endif
@@ -19,12 +19,17 @@
 
 #include <android/native_window.h>
 #include <gui/Surface.h>
+#include <gui/SurfaceComposerClient.h>
 
 using namespace android;
 
-BufferQueueScheduler::BufferQueueScheduler(
-        const sp<SurfaceControl>& surfaceControl, const HSV& color, int id)
-      : mSurfaceControl(surfaceControl), mColor(color), mSurfaceId(id), mContinueScheduling(true) {}
+BufferQueueScheduler::BufferQueueScheduler(const sp<SurfaceControl>& surfaceControl,
+        const HSV& color, int id, const std::shared_ptr<BufferPool>& bufferPool)
+      : mSurfaceControl(surfaceControl),
+        mColor(color),
+        mSurfaceId(id),
+        mBufferPool(bufferPool),
+        mContinueScheduling(true) {}
 
 void BufferQueueScheduler::startScheduling() {
     ALOGV("Starting Scheduler for %d Layer", mSurfaceId);
@@ -42,9 +47,13 @@ void BufferQueueScheduler::startScheduling() {
             BufferEvent event = mBufferEvents.front();
             lock.unlock();
 
-            bufferUpdate(event.dimensions);
-            fillSurface(event.event);
-            mColor.modulate();
+            if (mBufferPool != nullptr) {
+                postPooledBuffer(event);
+            } else {
+                bufferUpdate(event.dimensions);
+                fillSurface(event.event);
+                mColor.modulate();
+            }
             lock.lock();
             mBufferEvents.pop();
         }
@@ -107,3 +116,21 @@ void BufferQueueScheduler::fillSurface(const std::shared_ptr<Event>& event) {
 
     ALOGE_IF(status != NO_ERROR, "fillSurface: failed to unlock and post buffer, (%d)", status);
 }
+
+void BufferQueueScheduler::postPooledBuffer(const BufferEvent& event) {
+    sp<GraphicBuffer> buffer = mBufferPool->next(event.dimensions);
+
+    SurfaceComposerClient::Transaction transaction;
+    if (buffer != nullptr) {
+        transaction.setBuffer(mSurfaceControl, buffer);
+    } else {
+        ALOGE("postPooledBuffer: no %dx%d buffer for layer %d", event.dimensions.width,
+                event.dimensions.height, mSurfaceId);
+    }
+
+    event.event->readyToExecute();
+
+    if (buffer != nullptr) {
+        transaction.apply();
+    }
+}
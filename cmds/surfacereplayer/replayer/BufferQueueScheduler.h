@@ -17,6 +17,7 @@
 #ifndef ANDROID_SURFACEREPLAYER_BUFFERQUEUESCHEDULER_H
 #define ANDROID_SURFACEREPLAYER_BUFFERQUEUESCHEDULER_H
 
+#include "BufferPool.h"
 #include "Color.h"
 #include "Event.h"
 
@@ -26,22 +27,13 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <utility>
 
 namespace android {
 
-auto constexpr LAYER_ALPHA = 190;
-
-struct Dimensions {
-    Dimensions() = default;
-    Dimensions(int w, int h) : width(w), height(h) {}
-
-    int width = 0;
-    int height = 0;
-};
-
 struct BufferEvent {
     BufferEvent() = default;
     BufferEvent(std::shared_ptr<Event> e, Dimensions d) : event(e), dimensions(d) {}
@@ -52,7 +44,10 @@ struct BufferEvent {
 
 class BufferQueueScheduler {
   public:
-    BufferQueueScheduler(const sp<SurfaceControl>& surfaceControl, const HSV& color, int id);
+    // When a pool is given, buffer updates post its pre-generated buffers instead of filling the
+    // surface's buffers.
+    BufferQueueScheduler(const sp<SurfaceControl>& surfaceControl, const HSV& color, int id,
+            const std::shared_ptr<BufferPool>& bufferPool = nullptr);
 
     void startScheduling();
     void addEvent(const BufferEvent&);
@@ -67,9 +62,14 @@ class BufferQueueScheduler {
     // then unlock and post the buffer.
     void fillSurface(const std::shared_ptr<Event>& event);
 
+    // Set the next pooled buffer of the event's size on the layer, block until the event is
+    // signaled by the main loop, then apply the transaction.
+    void postPooledBuffer(const BufferEvent& event);
+
     sp<SurfaceControl> mSurfaceControl;
     HSV mColor;
     const int mSurfaceId;
+    const std::shared_ptr<BufferPool> mBufferPool;
 
     bool mContinueScheduling;
 
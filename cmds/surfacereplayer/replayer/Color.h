@@ -25,6 +25,8 @@ namespace android {
 constexpr double modulateFactor = .0001;
 constexpr double modulateLimit = .80;
 
+auto constexpr LAYER_ALPHA = 190;
+
 struct RGB {
     RGB(uint8_t rIn, uint8_t gIn, uint8_t bIn) : r(rIn), g(gIn), b(bIn) {}
 
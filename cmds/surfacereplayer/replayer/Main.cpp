@@ -49,6 +49,12 @@ void printHelpMenu() {
 
     std::cout << "  -n  Ignore timestamps and run through trace as fast as possible\n";
 
+    std::cout << "\n  -x [Time Scale]  Replays the trace this many times faster than it was "
+                 "recorded (default is " << android::DEFAULT_TIME_SCALE << ")\n";
+
+    std::cout << "\n  -p [Number of Buffers]  Generates this many buffers per layer size before "
+                 "replaying, and posts them at buffer updates instead of filling buffers\n";
+
     std::cout << "  -l  Indefinitely loop the replayer\n";
 
     std::cout << "  -h  Display help menu\n";
@@ -63,9 +69,11 @@ int main(int argc, char** argv) {
     bool pauseBeginning = false;
     int numThreads = DEFAULT_THREADS;
     long stopHere = -1;
+    double timeScale = DEFAULT_TIME_SCALE;
+    int pooledBuffers = 0;
 
     int opt = 0;
-    while ((opt = getopt(argc, argv, "mt:s:nlh?")) != -1) {
+    while ((opt = getopt(argc, argv, "mt:s:nx:p:lh?")) != -1) {
         switch (opt) {
             case 'm':
                 pauseBeginning = true;
@@ -79,6 +87,16 @@ int main(int argc, char** argv) {
             case 'n':
                 wait = false;
                 break;
+            case 'x':
+                timeScale = atof(optarg);
+                if (timeScale <= 0) {
+                    std::cerr << "Time scale must be positive...exiting" << std::endl;
+                    exit(0);
+                }
+                break;
+            case 'p':
+                pooledBuffers = atoi(optarg);
+                break;
             case 'l':
                 loop = true;
                 break;
@@ -102,8 +120,10 @@ int main(int argc, char** argv) {
 
     status_t status = NO_ERROR;
     do {
-        android::Replayer r(filename, pauseBeginning, numThreads, wait, stopHere);
+        android::Replayer r(filename, pauseBeginning, numThreads, wait, stopHere, timeScale,
+                pooledBuffers);
         status = r.replay();
+        std::cout << r.getStats().toString();
     } while(loop);
 
     if (status == NO_ERROR) {
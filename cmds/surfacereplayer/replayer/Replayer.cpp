@@ -32,6 +32,8 @@
 #include <utils/String8.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
 #include <cmath>
 #include <condition_variable>
@@ -45,17 +47,24 @@
 #include <thread>
 #include <vector>
 
+#include <time.h>
+
 using namespace android;
 
+// How long before an increment is due the replayer stops sleeping and starts spinning.
+static constexpr nsecs_t PACING_SPIN_TIME = us2ns(200);
+
 std::atomic_bool Replayer::sReplayingManually(false);
 
 Replayer::Replayer(const std::string& filename, bool replayManually, int numThreads, bool wait,
-        nsecs_t stopHere)
+        nsecs_t stopHere, double timeScale, int pooledBuffers)
       : mTrace(),
         mLoaded(false),
         mIncrementIndex(0),
         mCurrentTime(0),
         mNumThreads(numThreads),
+        mTimeScale(timeScale > 0 ? timeScale : DEFAULT_TIME_SCALE),
+        mPooledBuffers(pooledBuffers),
         mWaitForTimeStamps(wait),
         mStopTimeStamp(stopHere) {
     srand(RAND_COLOR_SEED);
@@ -73,6 +82,7 @@ Replayer::Replayer(const std::string& filename, bool replayManually, int numThre
     }
 
     mCurrentTime = mTrace.increment(0).time_stamp();
+    mTraceStartTime = mCurrentTime;
 
     sReplayingManually.store(replayManually);
 
@@ -81,16 +91,20 @@ Replayer::Replayer(const std::string& filename, bool replayManually, int numThre
     }
 }
 
-Replayer::Replayer(const Trace& t, bool replayManually, int numThreads, bool wait, nsecs_t stopHere)
+Replayer::Replayer(const Trace& t, bool replayManually, int numThreads, bool wait, nsecs_t stopHere,
+        double timeScale, int pooledBuffers)
       : mTrace(t),
         mLoaded(true),
         mIncrementIndex(0),
         mCurrentTime(0),
         mNumThreads(numThreads),
+        mTimeScale(timeScale > 0 ? timeScale : DEFAULT_TIME_SCALE),
+        mPooledBuffers(pooledBuffers),
         mWaitForTimeStamps(wait),
         mStopTimeStamp(stopHere) {
     srand(RAND_COLOR_SEED);
     mCurrentTime = mTrace.increment(0).time_stamp();
+    mTraceStartTime = mCurrentTime;
 
     sReplayingManually.store(replayManually);
 
@@ -111,11 +125,19 @@ status_t Replayer::replay() {
         return status;
     }
 
+    if (mPooledBuffers > 0) {
+        prepareBufferPools();
+    }
+
     SurfaceComposerClient::enableVSyncInjections(true);
 
     initReplay();
 
     ALOGV("Starting actual Replay!");
+    mStats = ReplayStats();
+    mReplayStartTime = systemTime();
+    mPacingDelay = 0;
+    mPausedTime = 0;
     while (!mPendingIncrements.empty()) {
         mCurrentIncrement = mTrace.increment(mIncrementIndex);
 
@@ -124,7 +146,18 @@ status_t Replayer::replay() {
             sReplayingManually.store(true);
         }
 
-        waitForConsoleCommmand();
+        if (sReplayingManually) {
+            const nsecs_t pauseStart = systemTime();
+            waitForConsoleCommmand();
+
+            // Pick up the pace from the current increment rather than catching up on the time
+            // spent paused.
+            const nsecs_t pauseEnd = systemTime();
+            const nsecs_t behind = std::max<nsecs_t>(
+                    pauseEnd - getDeadline(mCurrentIncrement.time_stamp()), 0);
+            mPacingDelay += behind;
+            mPausedTime += pauseEnd - pauseStart;
+        }
 
         if (mWaitForTimeStamps) {
             waitUntilTimestamp(mCurrentIncrement.time_stamp());
@@ -134,6 +167,7 @@ status_t Replayer::replay() {
         mPendingIncrements.pop();
 
         event->complete();
+        updateStats(mCurrentIncrement, systemTime());
 
         if (event->getIncrementType() == Increment::kVsyncEvent) {
             mWaitingForNextVSync = false;
@@ -154,9 +188,43 @@ status_t Replayer::replay() {
 
     SurfaceComposerClient::enableVSyncInjections(false);
 
+    ALOGI("%s", mStats.toString().c_str());
+
     return status;
 }
 
+void Replayer::prepareBufferPools() {
+    ALOGV("Generating %d buffers per layer size", mPooledBuffers);
+    const nsecs_t start = systemTime();
+
+    // Colors are assigned here rather than on surface creation, so that the buffers can be
+    // filled before the surfaces exist.
+    for (const Increment& increment : mTrace.increment()) {
+        if (increment.increment_case() == Increment::kSurfaceCreation) {
+            const layer_id id = increment.surface_creation().id();
+            if (mBufferPools.count(id) == 0) {
+                mColors[id] = HSV(rand() % 360, 1, 1);
+                mBufferPools[id] = std::make_shared<BufferPool>(mColors[id], mPooledBuffers);
+            }
+        } else if (increment.increment_case() == Increment::kBufferUpdate) {
+            const BufferUpdate& update = increment.buffer_update();
+            auto it = mBufferPools.find(update.id());
+            if (it == mBufferPools.end()) {
+                ALOGE("Buffer update for layer %d before its creation", update.id());
+                continue;
+            }
+            it->second->prepare(Dimensions(update.w(), update.h()));
+        }
+    }
+
+    size_t bufferCount = 0;
+    for (const auto& [id, pool] : mBufferPools) {
+        bufferCount += pool->bufferCount();
+    }
+    std::cout << "Generated " << bufferCount << " buffers for " << mBufferPools.size()
+              << " layers in " << ns2ms(systemTime() - start) << "ms" << std::endl;
+}
+
 status_t Replayer::initReplay() {
     for (int i = 0; i < mNumThreads && i < mTrace.increment_size(); i++) {
         status_t status = dispatchEvent(i);
@@ -294,8 +362,10 @@ status_t Replayer::dispatchEvent(int index) {
 
             auto layerId = increment.buffer_update().id();
             if (mBufferQueueSchedulers.count(layerId) == 0) {
+                auto pool = mBufferPools.find(layerId);
                 mBufferQueueSchedulers[layerId] = std::make_shared<BufferQueueScheduler>(
-                        mLayers[layerId], mColors[layerId], layerId);
+                        mLayers[layerId], mColors[layerId], layerId,
+                        pool != mBufferPools.end() ? pool->second : nullptr);
                 mBufferQueueSchedulers[layerId]->addEvent(bufferEvent);
 
                 std::thread(&BufferQueueScheduler::startScheduling,
@@ -600,7 +670,9 @@ status_t Replayer::createSurfaceControl(
     auto& layer = mLayers[create.id()];
     layer = surfaceControl;
 
-    mColors[create.id()] = HSV(rand() % 360, 1, 1);
+    if (mBufferPools.count(create.id()) == 0) {
+        mColors[create.id()] = HSV(rand() % 360, 1, 1);
+    }
 
     mLayerCond.notify_all();
 
@@ -653,9 +725,78 @@ void Replayer::updatePowerMode(const PowerModeUpdate& pmu, const std::shared_ptr
     SurfaceComposerClient::setDisplayPowerMode(mDisplays[pmu.id()], pmu.mode());
 }
 
+nsecs_t Replayer::getScaledTime(int64_t timestamp) const {
+    return static_cast<nsecs_t>(static_cast<double>(timestamp - mTraceStartTime) / mTimeScale);
+}
+
+nsecs_t Replayer::getDeadline(int64_t timestamp) const {
+    return mReplayStartTime + mPacingDelay + getScaledTime(timestamp);
+}
+
 void Replayer::waitUntilTimestamp(int64_t timestamp) {
-    ALOGV("Waiting for %lld nanoseconds...", static_cast<int64_t>(timestamp - mCurrentTime));
-    std::this_thread::sleep_for(std::chrono::nanoseconds(timestamp - mCurrentTime));
+    const nsecs_t deadline = getDeadline(timestamp);
+    ALOGV("Waiting for %lld nanoseconds...", static_cast<int64_t>(deadline - systemTime()));
+
+    // Sleeping overshoots by up to the timer slack, so sleep until shortly before the deadline
+    // and spin for the rest.
+    const nsecs_t wakeup = deadline - PACING_SPIN_TIME;
+    if (wakeup > systemTime()) {
+        struct timespec ts;
+        ts.tv_sec = wakeup / 1000000000;
+        ts.tv_nsec = wakeup % 1000000000;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR &&
+                !sReplayingManually) {
+        }
+    }
+
+    while (systemTime() < deadline && !sReplayingManually) {
+    }
+}
+
+void Replayer::updateStats(const Increment& increment, nsecs_t completedAt) {
+    mStats.increments++;
+    if (increment.increment_case() == Increment::kTransaction) {
+        mStats.transactions++;
+    } else if (increment.increment_case() == Increment::kBufferUpdate) {
+        mStats.bufferUpdates++;
+    }
+
+    mStats.achievedDuration = completedAt - mReplayStartTime - mPausedTime;
+    if (mWaitForTimeStamps) {
+        const nsecs_t deadline = getDeadline(increment.time_stamp());
+        mStats.requestedDuration = getScaledTime(increment.time_stamp());
+
+        const nsecs_t lateness = std::max<nsecs_t>(completedAt - deadline, 0);
+        mStats.totalLateness += lateness;
+        mStats.maxLateness = std::max(mStats.maxLateness, lateness);
+    }
+}
+
+double ReplayStats::requestedRate() const {
+    return requestedDuration > 0 ? increments * 1e9 / requestedDuration : 0;
+}
+
+double ReplayStats::achievedRate() const {
+    return achievedDuration > 0 ? increments * 1e9 / achievedDuration : 0;
+}
+
+std::string ReplayStats::toString() const {
+    std::stringstream ss;
+    ss << "Replayed " << increments << " increments (" << transactions << " transactions, "
+       << bufferUpdates << " buffer updates)\n";
+    if (requestedDuration > 0) {
+        ss << "  requested: " << ns2ms(requestedDuration) << "ms, " << requestedRate()
+           << " increments/s\n";
+    } else {
+        ss << "  requested: unpaced\n";
+    }
+    ss << "  achieved:  " << ns2ms(achievedDuration) << "ms, " << achievedRate()
+       << " increments/s\n";
+    if (requestedDuration > 0 && increments > 0) {
+        ss << "  lateness:  mean " << ns2us(totalLateness / increments) << "us, max "
+           << ns2us(maxLateness) << "us\n";
+    }
+    return ss.str();
 }
 
 status_t Replayer::loadSurfaceComposerClient() {
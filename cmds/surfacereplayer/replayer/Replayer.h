@@ -17,6 +17,7 @@
 #ifndef ANDROID_SURFACEREPLAYER_H
 #define ANDROID_SURFACEREPLAYER_H
 
+#include "BufferPool.h"
 #include "BufferQueueScheduler.h"
 #include "Color.h"
 #include "Event.h"
@@ -28,12 +29,14 @@
 
 #include <utils/Errors.h>
 #include <utils/StrongPointer.h>
+#include <utils/Timers.h>
 
 #include <stdatomic.h>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <string>
 #include <thread>
 #include <unordered_map>
 #include <utility>
@@ -45,6 +48,7 @@ namespace android {
 const auto DEFAULT_PATH = "/data/local/tmp/SurfaceTrace.dat";
 const auto RAND_COLOR_SEED = 700;
 const auto DEFAULT_THREADS = 3;
+const auto DEFAULT_TIME_SCALE = 1.0;
 
 typedef int32_t layer_id;
 typedef int32_t display_id;
@@ -52,17 +56,48 @@ typedef int32_t display_id;
 typedef google::protobuf::RepeatedPtrField<SurfaceChange> SurfaceChanges;
 typedef google::protobuf::RepeatedPtrField<DisplayChange> DisplayChanges;
 
+// How closely a replay kept up with the pace of the trace. Time spent in manual replay is not
+// accounted for.
+struct ReplayStats {
+    int32_t increments = 0;
+    int32_t transactions = 0;
+    int32_t bufferUpdates = 0;
+
+    // Time span of the replayed increments in the trace, divided by the time scale. Zero if
+    // timestamps were ignored.
+    nsecs_t requestedDuration = 0;
+    nsecs_t achievedDuration = 0;
+
+    // How long after its deadline each increment was executed.
+    nsecs_t totalLateness = 0;
+    nsecs_t maxLateness = 0;
+
+    // Increments per second.
+    double requestedRate() const;
+    double achievedRate() const;
+
+    std::string toString() const;
+};
+
 class Replayer {
   public:
+    // A time scale above 1 replays the trace faster than it was recorded. If pooledBuffers is
+    // positive, that many buffers are generated ahead of the replay for each size of each layer,
+    // and buffer updates post them instead of filling buffers on demand.
     Replayer(const std::string& filename, bool replayManually = false,
-            int numThreads = DEFAULT_THREADS, bool wait = true, nsecs_t stopHere = -1);
+            int numThreads = DEFAULT_THREADS, bool wait = true, nsecs_t stopHere = -1,
+            double timeScale = DEFAULT_TIME_SCALE, int pooledBuffers = 0);
     Replayer(const Trace& trace, bool replayManually = false, int numThreads = DEFAULT_THREADS,
-            bool wait = true, nsecs_t stopHere = -1);
+            bool wait = true, nsecs_t stopHere = -1, double timeScale = DEFAULT_TIME_SCALE,
+            int pooledBuffers = 0);
 
     status_t replay();
 
+    const ReplayStats& getStats() const { return mStats; }
+
   private:
     status_t initReplay();
+    void prepareBufferPools();
 
     void waitForConsoleCommmand();
     static void stopAutoReplayHandler(int signal);
@@ -128,7 +163,10 @@ class Replayer {
     void setDisplayProjection(SurfaceComposerClient::Transaction& t,
             display_id id, const ProjectionChange& pc);
 
+    nsecs_t getScaledTime(int64_t timestamp) const;
+    nsecs_t getDeadline(int64_t timestamp) const;
     void waitUntilTimestamp(int64_t timestamp);
+    void updateStats(const Increment& increment, nsecs_t completedAt);
     status_t loadSurfaceComposerClient();
 
     Trace mTrace;
@@ -136,6 +174,17 @@ class Replayer {
     int32_t mIncrementIndex = 0;
     int64_t mCurrentTime = 0;
     int32_t mNumThreads = DEFAULT_THREADS;
+    double mTimeScale = DEFAULT_TIME_SCALE;
+    int32_t mPooledBuffers = 0;
+
+    // Increments are due at the replay start time, offset by the time since the trace start
+    // divided by the time scale, so that delays in executing one are not carried over. Manual
+    // replay pushes the deadlines back by the pacing delay.
+    int64_t mTraceStartTime = 0;
+    nsecs_t mReplayStartTime = 0;
+    nsecs_t mPacingDelay = 0;
+    nsecs_t mPausedTime = 0;
+    ReplayStats mStats;
 
     Increment mCurrentIncrement;
 
@@ -157,6 +206,7 @@ class Replayer {
 
     std::mutex mBufferQueueSchedulerLock;
     std::unordered_map<layer_id, std::shared_ptr<BufferQueueScheduler>> mBufferQueueSchedulers;
+    std::unordered_map<layer_id, std::shared_ptr<BufferPool>> mBufferPools;
 
     std::mutex mDisplayLock;
     std::condition_variable mDisplayCond;
@@ -0,0 +1,385 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <ftl/initializer_list.h>
+#include <ftl/small_vector.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace android::ftl {
+namespace details {
+
+// Returns the smallest power of two that is not less than n.
+constexpr std::size_t hash_table_capacity(std::size_t n) {
+  std::size_t capacity = 1;
+  while (capacity < n) capacity <<= 1;
+  return capacity;
+}
+
+}  // namespace details
+
+// Associative container with unique, unordered keys, and the same API as ftl::SmallMap. Key-value
+// pairs are stored in contiguous storage like in SmallMap, but are indexed by an open-addressing
+// hash table, so lookup runs in constant rather than linear time. This makes FlatHashMap preferable
+// to SmallMap once the map holds more than a dozen or so mappings, while keeping cache-friendly
+// iteration. Both the mappings and the hash table are allocated statically until the size exceeds
+// N, at which point they are relocated to dynamic memory.
+//
+// Iteration order is insertion order, except that erasing a mapping moves the last mapping into its
+// place (see SmallVector::unstable_erase).
+//
+// FlatHashMap<K, V, 0> unconditionally allocates on the heap.
+//
+// Example usage:
+//
+//   ftl::FlatHashMap<int, std::string, 3> map;
+//   assert(map.empty());
+//   assert(!map.dynamic());
+//
+//   map = ftl::init::map<int, std::string>(123, "abc")(-1)(42, 3u, '?');
+//   assert(map.size() == 3u);
+//   assert(!map.dynamic());
+//
+//   assert(map.contains(123));
+//   assert(map.get(42, [](const std::string& s) { return s.size(); }) == 3u);
+//
+//   const auto opt = map.get(-1);
+//   assert(opt);
+//
+//   std::string& ref = *opt;
+//   assert(ref.empty());
+//   ref = "xyz";
+//
+//   map.emplace_or_replace(0, "vanilla", 2u, 3u);
+//   assert(map.dynamic());
+//
+//   assert(map == FlatHashMap(ftl::init::map(-1, "xyz")(0, "nil")(42, "???")(123, "abc")));
+//
+template <typename K, typename V, std::size_t N, typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K>>
+class FlatHashMap final {
+  using Map = SmallVector<std::pair<const K, V>, N>;
+
+  // A slot of the hash table refers to a mapping by its position in Map, and caches the upper bits
+  // of the hash of its key to skip most key comparisons.
+  struct Slot {
+    std::uint32_t index;
+    std::uint32_t hash;
+  };
+
+  static constexpr std::uint32_t kEmpty = std::numeric_limits<std::uint32_t>::max();
+
+  // The hash table is at most 3/4 full, so N mappings fit into the static slots.
+  static constexpr std::size_t kStaticSlots =
+      N == 0 ? 0 : details::hash_table_capacity((N * 4 + 2) / 3);
+  static constexpr std::size_t kMinDynamicSlots = 8;
+
+  using Slots = SmallVector<Slot, kStaticSlots>;
+
+  template <typename, typename, std::size_t, typename, typename>
+  friend class FlatHashMap;
+
+ public:
+  using key_type = K;
+  using mapped_type = V;
+
+  using value_type = typename Map::value_type;
+  using size_type = typename Map::size_type;
+  using difference_type = typename Map::difference_type;
+
+  using reference = typename Map::reference;
+  using iterator = typename Map::iterator;
+
+  using const_reference = typename Map::const_reference;
+  using const_iterator = typename Map::const_iterator;
+
+  // Creates an empty map.
+  FlatHashMap() { reset_slots(kStaticSlots); }
+
+  // Constructs at most N key-value pairs in place by forwarding per-pair constructor arguments.
+  // The template arguments K, V, and N are inferred using the deduction guide defined below.
+  // Duplicate mappings are discarded. See SmallMap for the syntax.
+  template <typename U, std::size_t... Sizes, typename... Types>
+  FlatHashMap(InitializerList<U, std::index_sequence<Sizes...>, Types...>&& list)
+      : map_(std::move(list)) {
+    rehash(kStaticSlots);
+  }
+
+  // Copies or moves key-value pairs from a convertible map.
+  template <typename Q, typename W, std::size_t M, typename H, typename E>
+  FlatHashMap(FlatHashMap<Q, W, M, H, E> other) : map_(std::move(other.map_)) {
+    rehash(kStaticSlots);
+  }
+
+  size_type max_size() const { return map_.max_size(); }
+  size_type size() const { return map_.size(); }
+  bool empty() const { return map_.empty(); }
+
+  // Returns whether the map is backed by static or dynamic storage.
+  bool dynamic() const { return map_.dynamic(); }
+
+  iterator begin() { return map_.begin(); }
+  const_iterator begin() const { return cbegin(); }
+  const_iterator cbegin() const { return map_.cbegin(); }
+
+  iterator end() { return map_.end(); }
+  const_iterator end() const { return cend(); }
+  const_iterator cend() const { return map_.cend(); }
+
+  // Returns whether a mapping exists for the given key.
+  bool contains(const key_type& key) const { return find(key) != end(); }
+
+  // Returns a reference to the value for the given key, or std::nullopt if the key was not found.
+  auto get(const key_type& key) const -> std::optional<std::reference_wrapper<const mapped_type>> {
+    return get(key, [](const mapped_type& v) { return std::cref(v); });
+  }
+
+  auto get(const key_type& key) -> std::optional<std::reference_wrapper<mapped_type>> {
+    return get(key, [](mapped_type& v) { return std::ref(v); });
+  }
+
+  // Returns the result R of a unary operation F on (a constant or mutable reference to) the value
+  // for the given key, or std::nullopt if the key was not found. If F has a return type of void,
+  // then the Boolean result indicates whether the key was found.
+  template <typename F, typename R = std::invoke_result_t<F, const mapped_type&>>
+  auto get(const key_type& key, F f) const
+      -> std::conditional_t<std::is_void_v<R>, bool, std::optional<R>> {
+    if (const auto it = find(key); it != end()) {
+      if constexpr (std::is_void_v<R>) {
+        f(it->second);
+        return true;
+      } else {
+        return f(it->second);
+      }
+    }
+
+    return {};
+  }
+
+  template <typename F>
+  auto get(const key_type& key, F f) {
+    return std::as_const(*this).get(
+        key, [&f](const mapped_type& v) { return f(const_cast<mapped_type&>(v)); });
+  }
+
+  // Returns an iterator to an existing mapping for the given key, or the end() iterator otherwise.
+  const_iterator find(const key_type& key) const {
+    return const_cast<FlatHashMap&>(*this).find(key);
+  }
+
+  iterator find(const key_type& key) {
+    const std::uint32_t index = slots_[probe(key, hash(key))].index;
+    return index == kEmpty ? end() : begin() + index;
+  }
+
+  // Inserts a mapping unless it exists. Returns an iterator to the inserted or existing mapping,
+  // and whether the mapping was inserted.
+  //
+  // On emplace, if the map reaches its static or dynamic capacity, then all iterators are
+  // invalidated. Otherwise, only the end() iterator is invalidated.
+  //
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) {
+    const std::uint32_t h = hash(key);
+    size_type i = probe(key, h);
+    if (const std::uint32_t index = slots_[i].index; index != kEmpty) {
+      return {begin() + index, false};
+    }
+
+    if ((size() + 1) * 4 > slots_.size() * 3) {
+      rehash(std::max(slots_.size() * 2, kMinDynamicSlots));
+      i = probe(key, h);
+    }
+
+    slots_[i] = {static_cast<std::uint32_t>(size()), h};
+    auto& ref = map_.emplace_back(std::piecewise_construct, std::forward_as_tuple(key),
+                                  std::forward_as_tuple(std::forward<Args>(args)...));
+    return {&ref, true};
+  }
+
+  // Replaces a mapping if it exists, and returns an iterator to it. Returns the end() iterator
+  // otherwise.
+  //
+  // The value is replaced via move constructor, so type V does not need to define copy/move
+  // assignment, e.g. its data members may be const.
+  //
+  // The arguments may directly or indirectly refer to the mapping being replaced.
+  //
+  // Iterators to the replaced mapping point to its replacement, and others remain valid.
+  //
+  template <typename... Args>
+  iterator try_replace(const key_type& key, Args&&... args) {
+    const auto it = find(key);
+    if (it == end()) return it;
+    map_.replace(it, std::piecewise_construct, std::forward_as_tuple(key),
+                 std::forward_as_tuple(std::forward<Args>(args)...));
+    return it;
+  }
+
+  // In-place counterpart of std::unordered_map's insert_or_assign. Returns true on emplace, or
+  // false on replace.
+  //
+  // The value is emplaced and replaced via move constructor, so type V does not need to define
+  // copy/move assignment, e.g. its data members may be const.
+  //
+  // On emplace, if the map reaches its static or dynamic capacity, then all iterators are
+  // invalidated. Otherwise, only the end() iterator is invalidated. On replace, iterators
+  // to the replaced mapping point to its replacement, and others remain valid.
+  //
+  template <typename... Args>
+  std::pair<iterator, bool> emplace_or_replace(const key_type& key, Args&&... args) {
+    const auto [it, ok] = try_emplace(key, std::forward<Args>(args)...);
+    if (ok) return {it, ok};
+    map_.replace(it, std::piecewise_construct, std::forward_as_tuple(key),
+                 std::forward_as_tuple(std::forward<Args>(args)...));
+    return {it, ok};
+  }
+
+  // Removes a mapping if it exists, and returns whether it did.
+  //
+  // The last() and end() iterators, as well as those to the erased mapping, are invalidated.
+  //
+  bool erase(const key_type& key) {
+    const size_type i = probe(key, hash(key));
+    const std::uint32_t index = slots_[i].index;
+    if (index == kEmpty) return false;
+
+    remove_slot(i);
+
+    // The last mapping is moved into the place of the erased one, so repoint its slot.
+    if (const size_type last = size() - 1; index != last) {
+      const K& last_key = map_[last].first;
+      slots_[probe(last_key, hash(last_key))].index = index;
+    }
+
+    map_.unstable_erase(begin() + index);
+    return true;
+  }
+
+  // Removes all mappings.
+  //
+  // All iterators are invalidated.
+  //
+  void clear() {
+    map_.clear();
+    for (Slot& slot : slots_) slot.index = kEmpty;
+  }
+
+ private:
+  static std::uint32_t hash(const key_type& key) {
+    // Fibonacci hashing spreads the entropy of weak hashes like std::hash<int>, which is the
+    // identity, across the upper bits.
+    const auto h = static_cast<std::uint64_t>(Hash{}(key)) * 0x9e3779b97f4a7c15ull;
+    return static_cast<std::uint32_t>(h >> 32);
+  }
+
+  // Returns the slot of the mapping for the given key, or the empty slot where it would be
+  // inserted. The hash table is never full, so linear probing terminates.
+  size_type probe(const key_type& key, std::uint32_t h) const {
+    const size_type mask = slots_.size() - 1;
+    for (size_type i = h & mask;; i = (i + 1) & mask) {
+      const Slot& slot = slots_[i];
+      if (slot.index == kEmpty) return i;
+      if (slot.hash == h && KeyEqual{}(map_[slot.index].first, key)) return i;
+    }
+  }
+
+  // Empties a slot by shifting back subsequent slots of its cluster that would otherwise become
+  // unreachable, which avoids the need for tombstones.
+  void remove_slot(size_type hole) {
+    const size_type mask = slots_.size() - 1;
+    for (size_type i = (hole + 1) & mask; slots_[i].index != kEmpty; i = (i + 1) & mask) {
+      const size_type home = slots_[i].hash & mask;
+      if (((i - home) & mask) >= ((i - hole) & mask)) {
+        slots_[hole] = slots_[i];
+        hole = i;
+      }
+    }
+    slots_[hole].index = kEmpty;
+  }
+
+  // An empty table still has one slot, so that probing needs no special case.
+  void reset_slots(size_type capacity) {
+    capacity = std::max<size_type>(capacity, 1);
+
+    slots_.clear();
+    for (size_type i = 0; i < capacity; ++i) {
+      slots_.push_back({kEmpty, 0});
+    }
+  }
+
+  // Rebuilds the hash table with at least the given capacity. Duplicate mappings are discarded,
+  // keeping the first.
+  void rehash(size_type capacity) {
+    capacity = std::max<size_type>(capacity, 1);
+    while (size() * 4 > capacity * 3) capacity *= 2;
+    reset_slots(capacity);
+
+    for (size_type index = 0; index < size();) {
+      const K& key = map_[index].first;
+      const std::uint32_t h = hash(key);
+      Slot& slot = slots_[probe(key, h)];
+      if (slot.index == kEmpty) {
+        slot = {static_cast<std::uint32_t>(index++), h};
+      } else {
+        // The last mapping is not indexed yet, so it can be moved here without repointing.
+        map_.unstable_erase(begin() + index);
+      }
+    }
+  }
+
+  Map map_;
+  Slots slots_;
+};
+
+// Deduction guide for in-place constructor.
+template <typename K, typename V, typename E, std::size_t... Sizes, typename... Types>
+FlatHashMap(InitializerList<KeyValue<K, V, E>, std::index_sequence<Sizes...>, Types...>&&)
+    -> FlatHashMap<K, V, sizeof...(Sizes), std::hash<K>, E>;
+
+// Returns whether the key-value pairs of two maps are equal.
+template <typename K, typename V, std::size_t N, typename Q, typename W, std::size_t M,
+          typename H, typename E>
+bool operator==(const FlatHashMap<K, V, N, H, E>& lhs, const FlatHashMap<Q, W, M, H, E>& rhs) {
+  if (lhs.size() != rhs.size()) return false;
+
+  for (const auto& [k, v] : lhs) {
+    const auto& lv = v;
+    if (!rhs.get(k, [&lv](const auto& rv) { return lv == rv; }).value_or(false)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// TODO: Remove in C++20.
+template <typename K, typename V, std::size_t N, typename Q, typename W, std::size_t M,
+          typename H, typename E>
+inline bool operator!=(const FlatHashMap<K, V, N, H, E>& lhs,
+                       const FlatHashMap<Q, W, M, H, E>& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace android::ftl
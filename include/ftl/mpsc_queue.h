@@ -0,0 +1,143 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <ftl/details/cache.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace android::ftl {
+
+// Bounded lock-free FIFO queue for any number of producer threads and one consumer thread. Unlike a
+// linked stack or queue, it does not allocate per element: elements are stored in a ring buffer of
+// Capacity slots, which must be a power of two.
+//
+// Producers claim a slot by incrementing the tail with compare-and-swap, and publish the element by
+// bumping the sequence number of the slot, so the consumer never observes a partially constructed
+// element. Elements pushed by the same producer are popped in the order they were pushed.
+//
+// Example usage:
+//
+//   ftl::MpscQueue<int, 8> queue;
+//
+//   // Producer threads.
+//   std::thread([&] { assert(queue.try_push(1)); }).join();
+//   std::thread([&] { assert(queue.try_push(2)); }).join();
+//
+//   // Consumer thread.
+//   assert(queue.try_pop() == 1);
+//   assert(queue.try_pop() == 2);
+//   assert(!queue.try_pop());
+//
+template <typename T, std::size_t Capacity>
+class MpscQueue final {
+  static_assert(details::is_power_of_two(Capacity), "Capacity must be a power of two");
+
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+
+  MpscQueue() {
+    for (size_type i = 0; i < Capacity; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  ~MpscQueue() {
+    while (try_pop());
+  }
+
+  static constexpr size_type capacity() { return Capacity; }
+
+  // Returns the number of elements that have been pushed but not popped, including elements whose
+  // producers are still constructing them. The result may be stale under concurrent access.
+  size_type size() const {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+
+  bool empty() const { return size() == 0; }
+
+  // Producer side: constructs an element at the back of the queue from the arguments. Returns false
+  // if the queue is full, in which case the arguments are not consumed.
+  template <typename... Args>
+  bool try_push(Args&&... args) {
+    size_type tail = tail_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[tail & (Capacity - 1)];
+      const size_type sequence = cell->sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::ptrdiff_t>(sequence - tail);
+      if (diff == 0) {
+        // The slot is free for this lap, so try to claim it.
+        if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        // The slot still holds the element from the previous lap.
+        return false;
+      } else {
+        // Another producer claimed the slot.
+        tail = tail_.load(std::memory_order_relaxed);
+      }
+    }
+
+    new (static_cast<void*>(&cell->storage)) T(std::forward<Args>(args)...);
+    cell->sequence.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side: removes the element at the front of the queue, or returns std::nullopt if the
+  // queue is empty or the producer of the front element has not finished pushing it.
+  std::optional<T> try_pop() {
+    const size_type head = head_.load(std::memory_order_relaxed);
+    Cell& cell = cells_[head & (Capacity - 1)];
+    if (cell.sequence.load(std::memory_order_acquire) != head + 1) return std::nullopt;
+
+    T* const element = std::launder(reinterpret_cast<T*>(&cell.storage));
+    std::optional<T> value(std::move(*element));
+    std::destroy_at(element);
+
+    // Release the slot to the producer of the next lap.
+    cell.sequence.store(head + Capacity, std::memory_order_release);
+    head_.store(head + 1, std::memory_order_release);
+    return value;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_type> sequence;
+    std::aligned_storage_t<sizeof(T), alignof(T)> storage;
+  };
+
+  // Written by the producers.
+  alignas(details::kCacheLineSize) std::atomic<size_type> tail_ = 0;
+
+  // Written by the consumer.
+  alignas(details::kCacheLineSize) std::atomic<size_type> head_ = 0;
+
+  alignas(details::kCacheLineSize) Cell cells_[Capacity];
+};
+
+}  // namespace android::ftl
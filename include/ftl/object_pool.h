@@ -0,0 +1,150 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <ftl/details/cache.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace android::ftl {
+
+// Fixed-capacity pool of objects of type T, stored inline. Objects are constructed on acquire and
+// destroyed on release, but their storage is recycled rather than allocated, which makes ObjectPool
+// suitable for objects that are created at a high rate, e.g. per frame or per event.
+//
+// Acquiring and releasing are lock-free, and may happen on any thread. Free slots are kept in a
+// Treiber stack whose head is tagged with a counter to prevent ABA. The pool must outlive the
+// objects acquired from it.
+//
+// Example usage:
+//
+//   ftl::ObjectPool<std::string, 2> pool;
+//
+//   auto abc = pool.acquire("abc");
+//   auto qqq = pool.acquire(3u, '?');
+//   assert(*abc == "abc");
+//   assert(*qqq == "???");
+//
+//   // The pool is exhausted.
+//   assert(!pool.acquire());
+//
+//   abc.reset();
+//   assert(pool.acquire("xyz"));
+//
+template <typename T, std::size_t Capacity>
+class ObjectPool final {
+  static_assert(Capacity > 0 && Capacity < std::numeric_limits<std::uint32_t>::max(),
+                "Capacity is out of range");
+
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+
+  // Destroys an object and returns its storage to the pool.
+  class Deleter {
+   public:
+    Deleter() = default;
+    void operator()(T* object) const { pool_->release(object); }
+
+   private:
+    friend ObjectPool;
+    explicit Deleter(ObjectPool* pool) : pool_(pool) {}
+
+    ObjectPool* pool_ = nullptr;
+  };
+
+  using Ptr = std::unique_ptr<T, Deleter>;
+
+  ObjectPool() {
+    for (size_type i = 0; i < Capacity; ++i) {
+      next_[i].store(static_cast<std::uint32_t>(i + 1), std::memory_order_relaxed);
+    }
+    next_[Capacity - 1].store(kNone, std::memory_order_relaxed);
+    head_.store(pack(0, 0), std::memory_order_release);
+  }
+
+  ObjectPool(const ObjectPool&) = delete;
+  ObjectPool& operator=(const ObjectPool&) = delete;
+
+  static constexpr size_type capacity() { return Capacity; }
+
+  // Constructs an object from the arguments, or returns nullptr if the pool is exhausted.
+  template <typename... Args>
+  Ptr acquire(Args&&... args) {
+    std::uint64_t head = head_.load(std::memory_order_acquire);
+    std::uint32_t index;
+    while (true) {
+      index = index_of(head);
+      if (index == kNone) return nullptr;
+
+      // If another thread pops this slot first, the value read here may be stale, but then the
+      // tag has changed too, so the exchange fails and the loop retries.
+      const std::uint32_t next = next_[index].load(std::memory_order_relaxed);
+      if (head_.compare_exchange_weak(head, pack(next, tag_of(head) + 1),
+                                      std::memory_order_acquire, std::memory_order_acquire)) {
+        break;
+      }
+    }
+
+    T* const object = new (&slots_[index]) T(std::forward<Args>(args)...);
+    return Ptr(object, Deleter(this));
+  }
+
+ private:
+  static constexpr std::uint32_t kNone = std::numeric_limits<std::uint32_t>::max();
+
+  static constexpr std::uint64_t pack(std::uint32_t index, std::uint32_t tag) {
+    return static_cast<std::uint64_t>(tag) << 32 | index;
+  }
+
+  static constexpr std::uint32_t index_of(std::uint64_t head) {
+    return static_cast<std::uint32_t>(head);
+  }
+
+  static constexpr std::uint32_t tag_of(std::uint64_t head) {
+    return static_cast<std::uint32_t>(head >> 32);
+  }
+
+  void release(T* object) {
+    const auto index = static_cast<std::uint32_t>(reinterpret_cast<Storage*>(object) - slots_);
+    std::destroy_at(object);
+
+    std::uint64_t head = head_.load(std::memory_order_relaxed);
+    do {
+      next_[index].store(index_of(head), std::memory_order_relaxed);
+    } while (!head_.compare_exchange_weak(head, pack(index, tag_of(head) + 1),
+                                          std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  using Storage = std::aligned_storage_t<sizeof(T), alignof(T)>;
+
+  alignas(details::kCacheLineSize) std::atomic<std::uint64_t> head_;
+
+  // Links of the free list, indexed by slot.
+  std::atomic<std::uint32_t> next_[Capacity];
+
+  Storage slots_[Capacity];
+};
+
+}  // namespace android::ftl
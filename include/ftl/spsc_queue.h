@@ -0,0 +1,129 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <ftl/details/cache.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace android::ftl {
+
+// Bounded lock-free FIFO queue for exactly one producer thread and one consumer thread. Elements
+// are stored in a ring buffer of Capacity slots, which must be a power of two. Neither operation
+// allocates, blocks, or waits for the other thread, so both sides may be real-time threads.
+//
+// The producer and consumer indices are on separate cache lines, and each side caches the index of
+// the other so that the shared line is only read when the queue looks full or empty, respectively.
+//
+// Example usage:
+//
+//   ftl::SpscQueue<std::string, 4> queue;
+//   assert(queue.empty());
+//
+//   // Producer thread.
+//   assert(queue.try_push("abc"));
+//   assert(queue.try_push(3u, '?'));
+//
+//   // Consumer thread.
+//   assert(queue.try_pop() == "abc");
+//   assert(queue.try_pop() == "???");
+//   assert(!queue.try_pop());
+//
+template <typename T, std::size_t Capacity>
+class SpscQueue final {
+  static_assert(details::is_power_of_two(Capacity), "Capacity must be a power of two");
+
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+
+  SpscQueue() = default;
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  ~SpscQueue() {
+    const size_type tail = tail_.load(std::memory_order_relaxed);
+    for (size_type head = head_.load(std::memory_order_relaxed); head != tail; ++head) {
+      std::destroy_at(slot(head));
+    }
+  }
+
+  static constexpr size_type capacity() { return Capacity; }
+
+  // Returns the number of elements. The result may be stale unless called by either side while the
+  // other is not concurrently operating on the queue.
+  size_type size() const {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+
+  bool empty() const { return size() == 0; }
+
+  // Producer side: constructs an element at the back of the queue from the arguments. Returns false
+  // if the queue is full, in which case the arguments are not consumed.
+  template <typename... Args>
+  bool try_push(Args&&... args) {
+    const size_type tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == Capacity) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == Capacity) return false;
+    }
+
+    new (&slots_[tail & (Capacity - 1)]) T(std::forward<Args>(args)...);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side: removes the element at the front of the queue, or returns std::nullopt if the
+  // queue is empty.
+  std::optional<T> try_pop() {
+    const size_type head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) return std::nullopt;
+    }
+
+    T* const element = slot(head);
+    std::optional<T> value(std::move(*element));
+    std::destroy_at(element);
+    head_.store(head + 1, std::memory_order_release);
+    return value;
+  }
+
+ private:
+  T* slot(size_type index) {
+    return std::launder(reinterpret_cast<T*>(&slots_[index & (Capacity - 1)]));
+  }
+
+  // Written by the consumer.
+  alignas(details::kCacheLineSize) std::atomic<size_type> head_ = 0;
+  size_type cached_tail_ = 0;
+
+  // Written by the producer.
+  alignas(details::kCacheLineSize) std::atomic<size_type> tail_ = 0;
+  size_type cached_head_ = 0;
+
+  alignas(details::kCacheLineSize) std::aligned_storage_t<sizeof(T), alignof(T)> slots_[Capacity];
+};
+
+}  // namespace android::ftl
@@ -24,12 +24,15 @@
 #endif
 
 #include <android-base/result.h>
+#include <android-base/unique_fd.h>
 #include <input/Input.h>
 #include <utils/Errors.h>
 #include <utils/KeyedVector.h>
 #include <utils/Tokenizer.h>
 #include <utils/Unicode.h>
 
+#include <vector>
+
 // Maximum number of keys supported by KeyCharacterMaps
 #define MAX_KEYS 8192
 
@@ -135,11 +138,19 @@ public:
             int32_t* outKeyCode, int32_t* outMetaState) const;
 
 #ifdef __linux__
-    /* Reads a key map from a parcel. */
+    /* Reads a key map from a parcel.
+     * Maps written with writeSharedToParcel() are read once per process: the same instance is
+     * returned for every parcel of the same map while it is in use, so it must not be modified. */
     static std::shared_ptr<KeyCharacterMap> readFromParcel(Parcel* parcel);
 
-    /* Writes a key map to a parcel. */
+    /* Writes a key map to a parcel.
+     * Uses writeSharedToParcel() when the ro.input.share_key_character_maps property is set. */
     void writeToParcel(Parcel* parcel) const;
+
+    /* Writes a key map to a parcel as a sealed memfd holding the compiled map, instead of all its
+     * keys. The memfd is created once for all the parcels of maps with the same contents.
+     * Writes the whole map if the parcel does not allow file descriptors. */
+    void writeSharedToParcel(Parcel* parcel) const;
 #endif
 
     bool operator==(const KeyCharacterMap& other) const;
@@ -274,6 +285,26 @@ private:
 
     /* Reloads the data from mLoadFileName and unapplies any overlay. */
     status_t reloadBaseFromFile();
+
+    /* Serializes the map in the compiled format. */
+    std::vector<uint8_t> compile() const;
+
+    /* Loads the compiled map from its contents into this instance. */
+    status_t loadCompiled(const void* data, size_t size, Format format);
+
+    /* Loads the file of this map into this instance, from its cache entry when there is one. */
+    status_t loadFile(Format format);
+
+#ifdef __linux__
+    /* Reads the map of a shared parcel into map, unless the process already has it. */
+    static std::shared_ptr<KeyCharacterMap> readShared(std::shared_ptr<KeyCharacterMap> map,
+                                                       int fd);
+
+    /* Returns a new descriptor of the sealed memfd holding this map, creating it if needed. */
+    base::unique_fd publishShared() const;
+
+    void writeFullToParcel(Parcel* parcel) const;
+#endif
 };
 
 } // namespace android
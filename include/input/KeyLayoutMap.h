@@ -23,6 +23,7 @@
 #include <utils/KeyedVector.h>
 #include <utils/Tokenizer.h>
 #include <set>
+#include <vector>
 
 #include <input/InputDevice.h>
 
@@ -85,6 +86,9 @@ public:
 
 private:
     static base::Result<std::shared_ptr<KeyLayoutMap>> load(Tokenizer* tokenizer);
+    static base::Result<std::shared_ptr<KeyLayoutMap>> loadCompiled(const void* data, size_t size);
+    // Returns this map in the compiled format read by loadCompiled().
+    std::vector<uint8_t> compile() const;
 
     struct Key {
         int32_t keyCode;
@@ -64,6 +64,13 @@ private:
                                  const std::string& name);
 };
 
+/**
+ * Sets the directory where KeyLayoutMap and KeyCharacterMap cache the files they load in a compiled
+ * form. The next loads of an unchanged file read the compiled form instead of parsing the file.
+ * Caching is disabled while the directory is empty, which is the default.
+ */
+extern void setKeyMapCacheDirectory(const std::string& directory);
+
 /**
  * Returns true if the keyboard is eligible for use as a built-in keyboard.
  */
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *                        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_POWERHINTQUEUE_H
+#define ANDROID_POWERHINTQUEUE_H
+
+#include <android-base/thread_annotations.h>
+#include <android/hardware/power/Boost.h>
+#include <android/hardware/power/IPowerHintSession.h>
+#include <android/hardware/power/Mode.h>
+#include <android/hardware/power/WorkDuration.h>
+#include <powermanager/PowerHalWrapper.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace android {
+
+namespace power {
+
+// -------------------------------------------------------------------------------------------------
+
+// Sends hints to the Power HAL from a thread of its own, so that callers never wait on a binder
+// call. Hints are sent in the order they are queued. A hint is coalesced with the last queued hint
+// if that one is still waiting and is of the same kind:
+// - a boost absorbs a later boost of the same type, keeping the longest duration;
+// - a mode change takes the state of a later change of the same mode;
+// - a session target work duration takes the value of a later target of the session;
+// - a session work duration report absorbs the later reports of the session, which are all sent
+//   with a single call. Only the latest kMaxBatchedWorkDurations durations are kept.
+// Queued calls cannot report the HAL result, so they always return ok. PowerHalController logs
+// the failures and reconnects as usual.
+class PowerHintQueue : public HalWrapper {
+public:
+    // Sends the hints to hal, usually a PowerHalController.
+    explicit PowerHintQueue(std::shared_ptr<HalWrapper> hal);
+    // Sends the hints still queued before returning.
+    virtual ~PowerHintQueue();
+
+    virtual HalResult<void> setBoost(hardware::power::Boost boost, int32_t durationMs) override;
+    virtual HalResult<void> setMode(hardware::power::Mode mode, bool enabled) override;
+    // Not queued, since the caller needs the result.
+    virtual HalResult<sp<hardware::power::IPowerHintSession>> createHintSession(
+            int32_t tgid, int32_t uid, const std::vector<int32_t>& threadIds,
+            int64_t durationNanos) override;
+    virtual HalResult<int64_t> getHintSessionPreferredRate() override;
+
+    void updateTargetWorkDuration(const sp<hardware::power::IPowerHintSession>& session,
+                                  int64_t targetDurationNanos);
+    void reportActualWorkDuration(const sp<hardware::power::IPowerHintSession>& session,
+                                  const std::vector<hardware::power::WorkDuration>& durations);
+
+    // Blocks until the hints queued so far have been sent.
+    void flush();
+
+private:
+    struct BoostHint {
+        hardware::power::Boost boost;
+        int32_t durationMs;
+    };
+    struct ModeHint {
+        hardware::power::Mode mode;
+        bool enabled;
+    };
+    struct TargetWorkDurationHint {
+        sp<hardware::power::IPowerHintSession> session;
+        int64_t targetDurationNanos;
+    };
+    struct ActualWorkDurationHint {
+        sp<hardware::power::IPowerHintSession> session;
+        std::vector<hardware::power::WorkDuration> durations;
+    };
+    using Hint = std::variant<BoostHint, ModeHint, TargetWorkDurationHint, ActualWorkDurationHint>;
+
+    static constexpr size_t kMaxBatchedWorkDurations = 100;
+
+    const std::shared_ptr<HalWrapper> mHal;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<Hint> mHints GUARDED_BY(mMutex);
+    // Set while the thread sends hints taken from mHints.
+    bool mSending GUARDED_BY(mMutex) = false;
+    bool mStopping GUARDED_BY(mMutex) = false;
+
+    std::thread mThread;
+
+    // Calls merge on the last queued hint if it is of type T and matches, or queues hint.
+    template <typename T, typename Matches, typename Merge>
+    void queue(T hint, Matches matches, Merge merge);
+    void threadMain();
+    void send(Hint& hint);
+};
+
+// -------------------------------------------------------------------------------------------------
+
+}; // namespace power
+
+}; // namespace android
+
+#endif // ANDROID_POWERHINTQUEUE_H
@@ -14,13 +14,13 @@
  * limitations under the License.
  */
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
-#include <android-base/parseint.h>
-#include <android-base/strings.h>
 #include <binder/Binder.h>
 #include <sys/types.h>
-#include <fstream>
-#include <regex>
+#include <algorithm>
+#include <charconv>
+#include <tuple>
 
 #include <binderdebug/BinderDebug.h>
 
@@ -39,138 +39,314 @@ static std::string contextToString(BinderDebugContext context) {
     }
 }
 
-static status_t scanBinderContext(pid_t pid, const std::string& contextName,
-                                  std::function<void(const std::string&)> eachLine) {
-    std::ifstream ifs("/dev/binderfs/binder_logs/proc/" + std::to_string(pid));
-    if (!ifs.is_open()) {
-        ifs.open("/d/binder/proc/" + std::to_string(pid));
-        if (!ifs.is_open()) {
-            return -errno;
+static constexpr uint8_t kNoContext = UINT8_MAX;
+
+static uint8_t contextIndex(BinderDebugContext context) {
+    return static_cast<uint8_t>(context);
+}
+
+static uint8_t parseContext(std::string_view name) {
+    for (auto context : {BinderDebugContext::BINDER, BinderDebugContext::HWBINDER,
+                         BinderDebugContext::VNDBINDER}) {
+        if (name == contextToString(context)) {
+            return contextIndex(context);
         }
     }
-    static const std::regex kContextLine("^context (\\w+)$");
+    return kNoContext;
+}
+
+// Returns the next whitespace separated token of line, and removes it from line.
+static std::string_view nextToken(std::string_view* line) {
+    size_t begin = line->find_first_not_of(" \t");
+    if (begin == std::string_view::npos) {
+        *line = std::string_view();
+        return std::string_view();
+    }
+    size_t end = line->find_first_of(" \t", begin);
+    if (end == std::string_view::npos) {
+        end = line->size();
+    }
+    std::string_view token = line->substr(begin, end - begin);
+    line->remove_prefix(end);
+    return token;
+}
+
+template <typename T>
+static bool parseNumber(std::string_view token, T* value, int base = 10) {
+    const char* end = token.data() + token.size();
+    auto [ptr, error] = std::from_chars(token.data(), end, *value, base);
+    return !token.empty() && error == std::errc() && ptr == end;
+}
+
+// Parses the "<id>:" token following "node", "ref" or "thread".
+static bool parseId(std::string_view token, int32_t* id) {
+    if (token.empty() || token.back() != ':') {
+        return false;
+    }
+    token.remove_suffix(1);
+    return parseNumber(token, id);
+}
 
-    bool isDesiredContext = false;
-    std::string line;
-    std::smatch match;
-    while (getline(ifs, line)) {
-        if (std::regex_search(line, match, kContextLine)) {
-            isDesiredContext = match.str(1) == contextName;
+static bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+void BinderDebugSnapshot::clear() {
+    mProcesses.clear();
+    mNodes.clear();
+    mRefs.clear();
+    mClientPids.clear();
+    mPids.clear();
+    mTimestamp = std::chrono::steady_clock::time_point();
+}
+
+// Parses the lines of a state or proc file. Only the lines of the known
+// contexts are indexed; the rest (transactions, buffers, dead nodes) is skipped.
+//
+//   proc 1234
+//   context binder
+//     thread 1234: l 12 need_return 0 tr 0
+//     node 5: u0000007b2ca1e0 c0000007b2ca1e8 pri 0:139 hs 1 hw 1 ls 0 lw 0 is 2 iw 2 tr 1 proc 567 890
+//     ref 6: desc 0 node 1 s 1 w 1 d 0000000000000000
+void BinderDebugSnapshot::parseLines(std::string_view state) {
+    pid_t pid = 0;
+    bool inProcess = false;
+    uint8_t context = kNoContext;
+    Process* process = nullptr;
+
+    while (!state.empty()) {
+        size_t newline = state.find('\n');
+        std::string_view line = state.substr(0, newline);
+        state.remove_prefix(newline == std::string_view::npos ? state.size() : newline + 1);
+
+        std::string_view keyword = nextToken(&line);
+        if (keyword == "proc") {
+            inProcess = parseNumber(nextToken(&line), &pid);
+            if (inProcess) {
+                mPids.push_back(pid);
+            }
+            context = kNoContext;
             continue;
         }
-        if (!isDesiredContext) {
+        if (keyword == "context") {
+            context = inProcess ? parseContext(nextToken(&line)) : kNoContext;
+            if (context != kNoContext) {
+                process = &mProcesses.emplace_back(Process{pid, context, 0, 0});
+            }
+            continue;
+        }
+        if (context == kNoContext) {
             continue;
         }
-        eachLine(line);
-    }
-    return OK;
-}
 
-status_t getBinderPidInfo(BinderDebugContext context, pid_t pid, BinderPidInfo* pidInfo) {
-    std::smatch match;
-    static const std::regex kReferencePrefix("^\\s*node \\d+:\\s+u([0-9a-f]+)\\s+c([0-9a-f]+)\\s+");
-    static const std::regex kThreadPrefix("^\\s*thread \\d+:\\s+l\\s+(\\d)(\\d)");
-    std::string contextStr = contextToString(context);
-    status_t ret = scanBinderContext(pid, contextStr, [&](const std::string& line) {
-        if (std::regex_search(line, match, kReferencePrefix)) {
-            const std::string& ptrString = "0x" + match.str(2); // use number after c
-            uint64_t ptr;
-            if (!::android::base::ParseUint(ptrString.c_str(), &ptr)) {
-                // Should not reach here, but just be tolerant.
-                return;
+        int32_t id;
+        if (keyword == "thread") {
+            if (!parseId(nextToken(&line), &id) || nextToken(&line) != "l") {
+                continue;
             }
-            const std::string proc = " proc ";
-            auto pos = line.rfind(proc);
-            if (pos != std::string::npos) {
-                for (const std::string& pidStr : base::Split(line.substr(pos + proc.size()), " ")) {
-                    int32_t pid;
-                    if (!::android::base::ParseInt(pidStr, &pid)) {
-                        return;
-                    }
-                    pidInfo->refPids[ptr].push_back(pid);
-                }
+            std::string_view looper = nextToken(&line);
+            if (looper.size() < 2 || !isDigit(looper[0]) || !isDigit(looper[1])) {
+                continue;
             }
-
-            return;
-        }
-        if (std::regex_search(line, match, kThreadPrefix)) {
-            // "1" is waiting in binder driver
-            // "2" is poll. It's impossible to tell if these are in use.
-            //     and HIDL default code doesn't use it.
-            bool isInUse = match.str(1) != "1";
             // "0" is a thread that has called into binder
             // "1" is looper thread
             // "2" is main looper thread
-            bool isBinderThread = match.str(2) != "0";
-            if (!isBinderThread) {
-                return;
+            if (looper[1] == '0') {
+                continue;
             }
-            if (isInUse) {
-                pidInfo->threadUsage++;
+            // "1" is waiting in binder driver
+            // "2" is poll. It's impossible to tell if these are in use.
+            //     and HIDL default code doesn't use it.
+            if (looper[0] != '1') {
+                process->threadUsage++;
             }
-
-            pidInfo->threadCount++;
-            return;
-        }
-        return;
-    });
-    return ret;
-}
-
-status_t getBinderClientPids(BinderDebugContext context, pid_t pid, pid_t servicePid,
-                             int32_t handle, std::vector<pid_t>* pids) {
-    std::smatch match;
-    static const std::regex kNodeNumber("^\\s+ref \\d+:\\s+desc\\s+(\\d+)\\s+node\\s+(\\d+).*");
-    std::string contextStr = contextToString(context);
-    int32_t node;
-    status_t ret = scanBinderContext(pid, contextStr, [&](const std::string& line) {
-        if (std::regex_search(line, match, kNodeNumber)) {
-            const std::string& descString = match.str(1);
-            int32_t desc;
-            if (!::android::base::ParseInt(descString.c_str(), &desc)) {
-                LOG(ERROR) << "Failed to parse desc int: " << descString;
-                return;
+            process->threadCount++;
+        } else if (keyword == "node") {
+            std::string_view ptr;
+            std::string_view cookie;
+            uint64_t cookieValue;
+            if (!parseId(nextToken(&line), &id) || (ptr = nextToken(&line)).size() < 2 ||
+                ptr[0] != 'u' || (cookie = nextToken(&line)).size() < 2 || cookie[0] != 'c' ||
+                !parseNumber(cookie.substr(1), &cookieValue, 16)) {
+                continue;
             }
-            if (handle != desc) {
-                return;
+            Node node{pid, context, id, cookieValue, static_cast<uint32_t>(mClientPids.size()),
+                      static_cast<uint32_t>(mClientPids.size())};
+            // The client pids follow the last token of the line that is "proc".
+            bool inClients = false;
+            for (std::string_view token = nextToken(&line); !token.empty();
+                 token = nextToken(&line)) {
+                pid_t clientPid;
+                if (token == "proc") {
+                    mClientPids.resize(node.clientsBegin);
+                    inClients = true;
+                } else if (inClients && parseNumber(token, &clientPid)) {
+                    mClientPids.push_back(clientPid);
+                } else {
+                    inClients = false;
+                }
             }
-            const std::string& nodeString = match.str(2);
-            if (!::android::base::ParseInt(nodeString.c_str(), &node)) {
-                LOG(ERROR) << "Failed to parse node int: " << nodeString;
-                return;
+            node.clientsEnd = static_cast<uint32_t>(mClientPids.size());
+            mNodes.push_back(node);
+        } else if (keyword == "ref") {
+            int32_t desc;
+            int32_t node;
+            if (!parseId(nextToken(&line), &id) || nextToken(&line) != "desc" ||
+                !parseNumber(nextToken(&line), &desc) || nextToken(&line) != "node" ||
+                !parseNumber(nextToken(&line), &node)) {
+                // Refs to dead nodes read "desc <desc> dead node <node>".
+                continue;
             }
-            return;
+            mRefs.push_back(Ref{pid, context, desc, node});
         }
-        return;
+    }
+}
+
+void BinderDebugSnapshot::sortIndex() {
+    std::sort(mProcesses.begin(), mProcesses.end(), [](const Process& a, const Process& b) {
+        return std::tie(a.pid, a.context) < std::tie(b.pid, b.context);
     });
+    std::sort(mNodes.begin(), mNodes.end(), [](const Node& a, const Node& b) {
+        return std::tie(a.pid, a.context, a.id) < std::tie(b.pid, b.context, b.id);
+    });
+    std::sort(mRefs.begin(), mRefs.end(), [](const Ref& a, const Ref& b) {
+        return std::tie(a.pid, a.context, a.desc) < std::tie(b.pid, b.context, b.desc);
+    });
+    std::sort(mPids.begin(), mPids.end());
+    mPids.erase(std::unique(mPids.begin(), mPids.end()), mPids.end());
+}
+
+status_t BinderDebugSnapshot::readFile(const std::string& path, const std::string& fallbackPath) {
+    if (!base::ReadFileToString(path, &mBuffer) &&
+        !base::ReadFileToString(fallbackPath, &mBuffer)) {
+        return -errno;
+    }
+    return OK;
+}
+
+void BinderDebugSnapshot::parse(std::string_view state) {
+    clear();
+    parseLines(state);
+    sortIndex();
+    mTimestamp = std::chrono::steady_clock::now();
+}
+
+status_t BinderDebugSnapshot::update() {
+    status_t ret = readFile("/dev/binderfs/binder_logs/state", "/d/binder/state");
     if (ret != OK) {
         return ret;
     }
-    static const std::regex kClients("^\\s+node\\s+(\\d+).*proc\\s+([\\d+\\s*]*)");
-    ret = scanBinderContext(servicePid, contextStr, [&](const std::string& line) {
-        if (std::regex_search(line, match, kClients)) {
-            const std::string nodeString = match.str(1);
-            int32_t matchedNode;
-            if (!::android::base::ParseInt(nodeString.c_str(), &matchedNode)) {
-                LOG(ERROR) << "Failed to parse node int: " << nodeString;
-                return;
-            }
-            if (node != matchedNode) {
-                return;
-            }
-            const std::string clients = match.str(2);
-            for (const std::string& pidStr : base::Split(clients, " ")) {
-                int32_t pid;
-                if (!::android::base::ParseInt(pidStr, &pid)) {
-                    return;
-                }
-                pids->push_back(pid);
-            }
-            return;
+    parse(mBuffer);
+    return OK;
+}
+
+status_t BinderDebugSnapshot::update(std::initializer_list<pid_t> pids) {
+    clear();
+    for (auto it = pids.begin(); it != pids.end(); ++it) {
+        if (std::find(pids.begin(), it, *it) != it) {
+            continue;
+        }
+        const std::string pidStr = std::to_string(*it);
+        status_t ret = readFile("/dev/binderfs/binder_logs/proc/" + pidStr,
+                                "/d/binder/proc/" + pidStr);
+        if (ret != OK) {
+            clear();
+            return ret;
+        }
+        // Known as soon as its file could be read, as getBinderPidInfo() has
+        // always answered for a process with no state in the given context.
+        mPids.push_back(*it);
+        parseLines(mBuffer);
+    }
+    sortIndex();
+    mTimestamp = std::chrono::steady_clock::now();
+    return OK;
+}
+
+status_t BinderDebugSnapshot::updateIfOlderThan(std::chrono::steady_clock::duration maxAge) {
+    if (mTimestamp != std::chrono::steady_clock::time_point() &&
+        std::chrono::steady_clock::now() - mTimestamp < maxAge) {
+        return OK;
+    }
+    return update();
+}
+
+bool BinderDebugSnapshot::hasPid(pid_t pid) const {
+    return std::binary_search(mPids.begin(), mPids.end(), pid);
+}
+
+status_t BinderDebugSnapshot::getPidInfo(BinderDebugContext context, pid_t pid,
+                                         BinderPidInfo* pidInfo) const {
+    if (!hasPid(pid)) {
+        return NAME_NOT_FOUND;
+    }
+    const uint8_t index = contextIndex(context);
+    auto process = std::partition_point(mProcesses.begin(), mProcesses.end(),
+                                        [&](const Process& p) {
+                                            return std::tie(p.pid, p.context) <
+                                                    std::tie(pid, index);
+                                        });
+    if (process != mProcesses.end() && process->pid == pid && process->context == index) {
+        pidInfo->threadUsage += process->threadUsage;
+        pidInfo->threadCount += process->threadCount;
+    }
+    auto node = std::partition_point(mNodes.begin(), mNodes.end(), [&](const Node& n) {
+        return std::tie(n.pid, n.context) < std::tie(pid, index);
+    });
+    for (; node != mNodes.end() && node->pid == pid && node->context == index; ++node) {
+        if (node->clientsBegin == node->clientsEnd) {
+            continue;
         }
-        return;
+        std::vector<pid_t>& refPids = pidInfo->refPids[node->cookie];
+        refPids.insert(refPids.end(), mClientPids.begin() + node->clientsBegin,
+                       mClientPids.begin() + node->clientsEnd);
+    }
+    return OK;
+}
+
+status_t BinderDebugSnapshot::getClientPids(BinderDebugContext context, pid_t pid,
+                                            pid_t servicePid, int32_t handle,
+                                            std::vector<pid_t>* pids) const {
+    if (!hasPid(pid) || !hasPid(servicePid)) {
+        return NAME_NOT_FOUND;
+    }
+    const uint8_t index = contextIndex(context);
+    auto ref = std::partition_point(mRefs.begin(), mRefs.end(), [&](const Ref& r) {
+        return std::tie(r.pid, r.context, r.desc) < std::tie(pid, index, handle);
+    });
+    if (ref == mRefs.end() || ref->pid != pid || ref->context != index || ref->desc != handle) {
+        return OK;
+    }
+    const int32_t nodeId = ref->node;
+    auto node = std::partition_point(mNodes.begin(), mNodes.end(), [&](const Node& n) {
+        return std::tie(n.pid, n.context, n.id) < std::tie(servicePid, index, nodeId);
     });
-    return ret;
+    if (node == mNodes.end() || node->pid != servicePid || node->context != index ||
+        node->id != nodeId) {
+        return OK;
+    }
+    pids->insert(pids->end(), mClientPids.begin() + node->clientsBegin,
+                 mClientPids.begin() + node->clientsEnd);
+    return OK;
+}
+
+status_t getBinderPidInfo(BinderDebugContext context, pid_t pid, BinderPidInfo* pidInfo) {
+    BinderDebugSnapshot snapshot;
+    status_t ret = snapshot.update({pid});
+    if (ret != OK) {
+        return ret;
+    }
+    return snapshot.getPidInfo(context, pid, pidInfo);
+}
+
+status_t getBinderClientPids(BinderDebugContext context, pid_t pid, pid_t servicePid,
+                             int32_t handle, std::vector<pid_t>* pids) {
+    BinderDebugSnapshot snapshot;
+    status_t ret = snapshot.update({pid, servicePid});
+    if (ret != OK) {
+        return ret;
+    }
+    return snapshot.getClientPids(context, pid, servicePid, handle, pids);
 }
 
 } // namespace  android
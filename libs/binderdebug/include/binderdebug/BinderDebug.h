@@ -15,15 +15,21 @@
  */
 #pragma once
 
+#include <sys/types.h>
+
+#include <chrono>
+#include <initializer_list>
 #include <map>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace android {
 
 struct BinderPidInfo {
     std::map<uint64_t, std::vector<pid_t>> refPids; // cookie -> processes which hold binder
-    uint32_t threadUsage;                           // number of threads in use
-    uint32_t threadCount;                           // number of threads total
+    uint32_t threadUsage = 0;                       // number of threads in use
+    uint32_t threadCount = 0;                       // number of threads total
 };
 
 enum class BinderDebugContext {
@@ -42,4 +48,88 @@ status_t getBinderPidInfo(BinderDebugContext context, pid_t pid, BinderPidInfo*
 status_t getBinderClientPids(BinderDebugContext context, pid_t pid, pid_t servicePid,
                              int32_t handle, std::vector<pid_t>* pids);
 
+/**
+ * Nodes, refs and threads of many processes, parsed in a single pass and kept
+ * to answer any number of queries. Use this instead of the functions above when
+ * querying more than a couple of services.
+ *
+ * Queries about a process that is not in the snapshot return NAME_NOT_FOUND,
+ * which callers can take as a hint that the snapshot is stale.
+ */
+class BinderDebugSnapshot {
+public:
+    /**
+     * Replaces the snapshot with the state of all processes, read from
+     * /dev/binderfs/binder_logs/state or /d/binder/state.
+     */
+    status_t update();
+    /**
+     * Replaces the snapshot with the state of the given processes only, read
+     * from their files under /dev/binderfs/binder_logs/proc or /d/binder/proc.
+     */
+    status_t update(std::initializer_list<pid_t> pids);
+    /**
+     * Calls update() unless the snapshot was taken less than maxAge ago.
+     */
+    status_t updateIfOlderThan(std::chrono::steady_clock::duration maxAge);
+    /**
+     * Replaces the snapshot with the contents of a state or proc file.
+     */
+    void parse(std::string_view state);
+
+    /**
+     * Time at which the snapshot was taken, or the epoch if it is empty.
+     */
+    std::chrono::steady_clock::time_point timestamp() const { return mTimestamp; }
+    bool hasPid(pid_t pid) const;
+
+    /**
+     * Same as getBinderPidInfo().
+     */
+    status_t getPidInfo(BinderDebugContext context, pid_t pid, BinderPidInfo* pidInfo) const;
+    /**
+     * Same as getBinderClientPids(). Leaves pids untouched if pid holds no ref
+     * with the given handle.
+     */
+    status_t getClientPids(BinderDebugContext context, pid_t pid, pid_t servicePid,
+                           int32_t handle, std::vector<pid_t>* pids) const;
+
+private:
+    struct Process {
+        pid_t pid;
+        uint8_t context;
+        uint32_t threadUsage;
+        uint32_t threadCount;
+    };
+    struct Node {
+        pid_t pid;
+        uint8_t context;
+        int32_t id;
+        uint64_t cookie;
+        uint32_t clientsBegin; // range of mClientPids
+        uint32_t clientsEnd;
+    };
+    struct Ref {
+        pid_t pid;
+        uint8_t context;
+        int32_t desc;
+        int32_t node;
+    };
+
+    void clear();
+    void parseLines(std::string_view state);
+    void sortIndex();
+    status_t readFile(const std::string& path, const std::string& fallbackPath);
+
+    // Sorted by (pid, context) and (pid, context, id or desc) once parsed, and
+    // cleared without releasing their memory between updates.
+    std::vector<Process> mProcesses;
+    std::vector<Node> mNodes;
+    std::vector<Ref> mRefs;
+    std::vector<pid_t> mClientPids;
+    std::vector<pid_t> mPids;
+    std::string mBuffer;
+    std::chrono::steady_clock::time_point mTimestamp;
+};
+
 } // namespace  android
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/file.h>
+#include <binderdebug/BinderDebug.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <utils/Errors.h>
+
+namespace android {
+namespace binderdebug {
+namespace test {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::Pair;
+
+static std::string readFixture(const std::string& name) {
+    std::string content;
+    EXPECT_TRUE(base::ReadFileToString(base::GetExecutableDirectory() + "/testdata/" + name,
+                                       &content));
+    return content;
+}
+
+class BinderDebugSnapshotTest : public ::testing::Test {
+protected:
+    void SetUp() override { mSnapshot.parse(readFixture("binder_state.txt")); }
+
+    BinderDebugSnapshot mSnapshot;
+};
+
+TEST_F(BinderDebugSnapshotTest, Pids) {
+    EXPECT_TRUE(mSnapshot.hasPid(500));
+    EXPECT_TRUE(mSnapshot.hasPid(1000));
+    EXPECT_TRUE(mSnapshot.hasPid(2000));
+    EXPECT_TRUE(mSnapshot.hasPid(3000));
+    EXPECT_FALSE(mSnapshot.hasPid(4000));
+    EXPECT_NE(mSnapshot.timestamp(), std::chrono::steady_clock::time_point());
+}
+
+TEST_F(BinderDebugSnapshotTest, PidInfo) {
+    BinderPidInfo pidInfo;
+    ASSERT_EQ(OK, mSnapshot.getPidInfo(BinderDebugContext::BINDER, 1000, &pidInfo));
+    EXPECT_THAT(pidInfo.refPids,
+                ElementsAre(Pair(0x7f8e1c4020a8, ElementsAre(3000, 2000)),
+                            Pair(0x7f8e1c4030c8, ElementsAre(2000))));
+    EXPECT_EQ(2u, pidInfo.threadUsage);
+    EXPECT_EQ(4u, pidInfo.threadCount);
+}
+
+TEST_F(BinderDebugSnapshotTest, PidInfoPerContext) {
+    BinderPidInfo binderInfo;
+    ASSERT_EQ(OK, mSnapshot.getPidInfo(BinderDebugContext::BINDER, 2000, &binderInfo));
+    EXPECT_THAT(binderInfo.refPids, IsEmpty());
+    EXPECT_EQ(1u, binderInfo.threadUsage);
+    EXPECT_EQ(2u, binderInfo.threadCount);
+
+    BinderPidInfo hwbinderInfo;
+    ASSERT_EQ(OK, mSnapshot.getPidInfo(BinderDebugContext::HWBINDER, 2000, &hwbinderInfo));
+    EXPECT_THAT(hwbinderInfo.refPids, ElementsAre(Pair(0x7a1c80012348, ElementsAre(1000))));
+    EXPECT_EQ(0u, hwbinderInfo.threadUsage);
+    EXPECT_EQ(2u, hwbinderInfo.threadCount);
+
+    BinderPidInfo vndbinderInfo;
+    ASSERT_EQ(OK, mSnapshot.getPidInfo(BinderDebugContext::VNDBINDER, 2000, &vndbinderInfo));
+    EXPECT_THAT(vndbinderInfo.refPids, IsEmpty());
+    EXPECT_EQ(0u, vndbinderInfo.threadCount);
+}
+
+TEST_F(BinderDebugSnapshotTest, PidInfoUnknownPid) {
+    BinderPidInfo pidInfo;
+    EXPECT_EQ(NAME_NOT_FOUND, mSnapshot.getPidInfo(BinderDebugContext::BINDER, 4000, &pidInfo));
+}
+
+TEST_F(BinderDebugSnapshotTest, ClientPids) {
+    std::vector<pid_t> pids;
+    ASSERT_EQ(OK, mSnapshot.getClientPids(BinderDebugContext::BINDER, 2000, 1000, 1, &pids));
+    EXPECT_THAT(pids, ElementsAre(3000, 2000));
+
+    pids.clear();
+    ASSERT_EQ(OK, mSnapshot.getClientPids(BinderDebugContext::BINDER, 2000, 1000, 3, &pids));
+    EXPECT_THAT(pids, ElementsAre(2000));
+
+    pids.clear();
+    ASSERT_EQ(OK, mSnapshot.getClientPids(BinderDebugContext::BINDER, 1000, 500, 0, &pids));
+    EXPECT_THAT(pids, ElementsAre(3000, 2000, 1000));
+}
+
+TEST_F(BinderDebugSnapshotTest, ClientPidsAfterLastProc) {
+    mSnapshot.parse("proc 1000\n"
+                    "context binder\n"
+                    "  node 1: u0000000000001000 c0000000000001008 pri 0:139 hs 1 hw 1 ls 0 lw 0 "
+                    "is 2 iw 2 tr 1 proc 3000 proc 2000\n"
+                    "proc 2000\n"
+                    "context binder\n"
+                    "  ref 6: desc 1 node 1 s 1 w 1 d 0000000000000000\n");
+
+    std::vector<pid_t> pids;
+    ASSERT_EQ(OK, mSnapshot.getClientPids(BinderDebugContext::BINDER, 2000, 1000, 1, &pids));
+    EXPECT_THAT(pids, ElementsAre(2000));
+}
+
+TEST_F(BinderDebugSnapshotTest, ClientPidsWithoutRef) {
+    std::vector<pid_t> pids;
+    // Handle 2 of 3000 refers to a dead node, and 1000 has no handle 7.
+    ASSERT_EQ(OK, mSnapshot.getClientPids(BinderDebugContext::BINDER, 3000, 1000, 2, &pids));
+    ASSERT_EQ(OK, mSnapshot.getClientPids(BinderDebugContext::BINDER, 1000, 500, 7, &pids));
+    // The ref of 2000 is in the binder context, not in hwbinder.
+    ASSERT_EQ(OK, mSnapshot.getClientPids(BinderDebugContext::HWBINDER, 2000, 1000, 1, &pids));
+    EXPECT_THAT(pids, IsEmpty());
+}
+
+TEST_F(BinderDebugSnapshotTest, ClientPidsUnknownPid) {
+    std::vector<pid_t> pids;
+    EXPECT_EQ(NAME_NOT_FOUND,
+              mSnapshot.getClientPids(BinderDebugContext::BINDER, 4000, 1000, 1, &pids));
+    EXPECT_EQ(NAME_NOT_FOUND,
+              mSnapshot.getClientPids(BinderDebugContext::BINDER, 2000, 4000, 1, &pids));
+}
+
+TEST_F(BinderDebugSnapshotTest, ProcFileMatchesState) {
+    BinderDebugSnapshot procSnapshot;
+    procSnapshot.parse(readFixture("binder_proc_1000.txt"));
+
+    BinderPidInfo fromState;
+    BinderPidInfo fromProc;
+    ASSERT_EQ(OK, mSnapshot.getPidInfo(BinderDebugContext::BINDER, 1000, &fromState));
+    ASSERT_EQ(OK, procSnapshot.getPidInfo(BinderDebugContext::BINDER, 1000, &fromProc));
+    EXPECT_EQ(fromState.refPids, fromProc.refPids);
+    EXPECT_EQ(fromState.threadUsage, fromProc.threadUsage);
+    EXPECT_EQ(fromState.threadCount, fromProc.threadCount);
+}
+
+TEST_F(BinderDebugSnapshotTest, ParseReplacesSnapshot) {
+    mSnapshot.parse(readFixture("binder_proc_1000.txt"));
+    EXPECT_TRUE(mSnapshot.hasPid(1000));
+    EXPECT_FALSE(mSnapshot.hasPid(2000));
+
+    mSnapshot.parse("");
+    EXPECT_FALSE(mSnapshot.hasPid(1000));
+}
+
+} // namespace  test
+} // namespace  binderdebug
+} // namespace  android
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <ftl/mpsc_queue.h>
+#include <ftl/object_pool.h>
+#include <ftl/spsc_queue.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace android::test {
+namespace {
+
+constexpr std::size_t kQueueCapacity = 1024;
+constexpr std::int64_t kItemsPerProducer = 1 << 16;
+
+// Baseline: a std::deque guarded by a mutex.
+template <typename T>
+class LockedQueue {
+ public:
+  bool try_push(T value) {
+    std::lock_guard lock(mutex_);
+    if (queue_.size() == kQueueCapacity) return false;
+    queue_.push_back(std::move(value));
+    return true;
+  }
+
+  std::optional<T> try_pop() {
+    std::lock_guard lock(mutex_);
+    if (queue_.empty()) return std::nullopt;
+    T value = std::move(queue_.front());
+    queue_.pop_front();
+    return value;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::deque<T> queue_;
+};
+
+// Measures the throughput of producers pushing to one consumer. The argument is the number of
+// producers.
+template <typename Queue>
+void BM_Throughput(benchmark::State& state) {
+  const auto producer_count = static_cast<int>(state.range(0));
+
+  for (auto _ : state) {
+    Queue queue;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < producer_count; ++p) {
+      producers.emplace_back([&queue] {
+        for (std::int64_t i = 0; i < kItemsPerProducer;) {
+          if (queue.try_push(i)) {
+            ++i;
+          } else {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+
+    std::int64_t sum = 0;
+    for (std::int64_t count = 0; count < producer_count * kItemsPerProducer;) {
+      if (const auto opt = queue.try_pop()) {
+        sum += *opt;
+        ++count;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+
+    for (auto& producer : producers) producer.join();
+    benchmark::DoNotOptimize(sum);
+  }
+
+  state.SetItemsProcessed(state.iterations() * producer_count * kItemsPerProducer);
+}
+
+using SpscQueue = ftl::SpscQueue<std::int64_t, kQueueCapacity>;
+using MpscQueue = ftl::MpscQueue<std::int64_t, kQueueCapacity>;
+
+BENCHMARK_TEMPLATE(BM_Throughput, SpscQueue)->Arg(1)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Throughput, MpscQueue)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Throughput, LockedQueue<std::int64_t>)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+struct Object {
+  std::int64_t data[8];
+};
+
+void BM_ObjectPool(benchmark::State& state) {
+  static ftl::ObjectPool<Object, 64> pool;
+  for (auto _ : state) {
+    auto object = pool.acquire();
+    benchmark::DoNotOptimize(object.get());
+  }
+}
+BENCHMARK(BM_ObjectPool)->ThreadRange(1, 4);
+
+void BM_MakeUnique(benchmark::State& state) {
+  for (auto _ : state) {
+    auto object = std::make_unique<Object>();
+    benchmark::DoNotOptimize(object.get());
+  }
+}
+BENCHMARK(BM_MakeUnique)->ThreadRange(1, 4);
+
+}  // namespace
+}  // namespace android::test
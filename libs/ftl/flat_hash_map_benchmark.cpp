@@ -0,0 +1,89 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <ftl/flat_hash_map.h>
+#include <ftl/small_map.h>
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace android::test {
+namespace {
+
+// Keys are sparse, like layer IDs or input channel tokens.
+std::vector<std::int64_t> make_keys(std::size_t count) {
+  std::mt19937_64 generator(count);
+  std::vector<std::int64_t> keys(count);
+  for (auto& key : keys) key = static_cast<std::int64_t>(generator() >> 8);
+  return keys;
+}
+
+template <typename Map>
+void BM_Lookup(benchmark::State& state) {
+  const auto keys = make_keys(static_cast<std::size_t>(state.range(0)));
+
+  Map map;
+  for (const auto key : keys) map.try_emplace(key, key);
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(keys[i]) != map.end());
+    if (++i == keys.size()) i = 0;
+  }
+}
+
+template <typename Map>
+void BM_InsertErase(benchmark::State& state) {
+  const auto keys = make_keys(static_cast<std::size_t>(state.range(0)));
+
+  for (auto _ : state) {
+    Map map;
+    for (const auto key : keys) map.try_emplace(key, key);
+    for (const auto key : keys) map.erase(key);
+    benchmark::DoNotOptimize(map);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+constexpr std::size_t kStaticSize = 16;
+
+using SmallMap = ftl::SmallMap<std::int64_t, std::int64_t, kStaticSize>;
+using FlatHashMap = ftl::FlatHashMap<std::int64_t, std::int64_t, kStaticSize>;
+using UnorderedMap = std::unordered_map<std::int64_t, std::int64_t>;
+using OrderedMap = std::map<std::int64_t, std::int64_t>;
+
+#define FTL_MAP_BENCHMARK(benchmark, map) \
+  BENCHMARK_TEMPLATE(benchmark, map)->RangeMultiplier(4)->Range(4, 1024)
+
+FTL_MAP_BENCHMARK(BM_Lookup, SmallMap);
+FTL_MAP_BENCHMARK(BM_Lookup, FlatHashMap);
+FTL_MAP_BENCHMARK(BM_Lookup, UnorderedMap);
+FTL_MAP_BENCHMARK(BM_Lookup, OrderedMap);
+
+FTL_MAP_BENCHMARK(BM_InsertErase, SmallMap);
+FTL_MAP_BENCHMARK(BM_InsertErase, FlatHashMap);
+FTL_MAP_BENCHMARK(BM_InsertErase, UnorderedMap);
+FTL_MAP_BENCHMARK(BM_InsertErase, OrderedMap);
+
+#undef FTL_MAP_BENCHMARK
+
+}  // namespace
+}  // namespace android::test
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ftl/mpsc_queue.h>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace android::test {
+
+// Keep in sync with example usage in header file.
+TEST(MpscQueue, Example) {
+  ftl::MpscQueue<int, 8> queue;
+
+  std::thread([&] { EXPECT_TRUE(queue.try_push(1)); }).join();
+  std::thread([&] { EXPECT_TRUE(queue.try_push(2)); }).join();
+
+  EXPECT_EQ(queue.try_pop(), 1);
+  EXPECT_EQ(queue.try_pop(), 2);
+  EXPECT_FALSE(queue.try_pop());
+}
+
+TEST(MpscQueue, Full) {
+  ftl::MpscQueue<int, 4> queue;
+
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.try_push(i));
+  }
+  EXPECT_EQ(queue.size(), 4u);
+  EXPECT_FALSE(queue.try_push(4));
+
+  // Wrap around a few times.
+  for (int i = 4; i < 20; ++i) {
+    EXPECT_EQ(queue.try_pop(), i - 4);
+    EXPECT_TRUE(queue.try_push(i));
+  }
+
+  for (int i = 16; i < 20; ++i) {
+    EXPECT_EQ(queue.try_pop(), i);
+  }
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(MpscQueue, Destroy) {
+  const auto ptr = std::make_shared<char>('!');
+  {
+    ftl::MpscQueue<std::shared_ptr<char>, 8> queue;
+    for (int i = 0; i < 5; ++i) {
+      EXPECT_TRUE(queue.try_push(ptr));
+    }
+    EXPECT_EQ(ptr.use_count(), 6);
+  }
+
+  EXPECT_EQ(ptr.use_count(), 1);
+}
+
+TEST(MpscQueue, Concurrent) {
+  constexpr int kProducers = 4;
+  constexpr int kCountPerProducer = 25'000;
+
+  // Pairs of producer ID and sequence number.
+  ftl::MpscQueue<std::pair<int, int>, 32> queue;
+
+  std::vector<std::thread> producers;
+  for (int id = 0; id < kProducers; ++id) {
+    producers.emplace_back([&queue, id] {
+      for (int i = 0; i < kCountPerProducer;) {
+        if (queue.try_push(id, i)) ++i;
+      }
+    });
+  }
+
+  // Elements of each producer are popped in order.
+  std::array<int, kProducers> expected{};
+  for (int count = 0; count < kProducers * kCountPerProducer;) {
+    if (const auto opt = queue.try_pop()) {
+      const auto [id, i] = *opt;
+      ASSERT_EQ(i, expected[id]++);
+      ++count;
+    }
+  }
+
+  for (auto& producer : producers) producer.join();
+  EXPECT_TRUE(queue.empty());
+}
+
+}  // namespace android::test
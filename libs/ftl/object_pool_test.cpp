@@ -0,0 +1,104 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ftl/object_pool.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android::test {
+
+// Keep in sync with example usage in header file.
+TEST(ObjectPool, Example) {
+  ftl::ObjectPool<std::string, 2> pool;
+
+  auto abc = pool.acquire("abc");
+  auto qqq = pool.acquire(3u, '?');
+  EXPECT_EQ(*abc, "abc");
+  EXPECT_EQ(*qqq, "???");
+
+  EXPECT_FALSE(pool.acquire());
+
+  abc.reset();
+  EXPECT_TRUE(pool.acquire("xyz"));
+}
+
+TEST(ObjectPool, Recycle) {
+  ftl::ObjectPool<int, 3> pool;
+
+  auto a = pool.acquire(1);
+  auto b = pool.acquire(2);
+  auto c = pool.acquire(3);
+  EXPECT_FALSE(pool.acquire(4));
+
+  int* const address = b.get();
+  b.reset();
+
+  // The most recently released slot is reused first.
+  auto d = pool.acquire(4);
+  EXPECT_EQ(d.get(), address);
+  EXPECT_EQ(*a, 1);
+  EXPECT_EQ(*c, 3);
+  EXPECT_EQ(*d, 4);
+}
+
+TEST(ObjectPool, Destroy) {
+  const auto ptr = std::make_shared<char>('!');
+  ftl::ObjectPool<std::shared_ptr<char>, 4> pool;
+
+  auto object = pool.acquire(ptr);
+  EXPECT_EQ(ptr.use_count(), 2);
+
+  object.reset();
+  EXPECT_EQ(ptr.use_count(), 1);
+}
+
+TEST(ObjectPool, Concurrent) {
+  constexpr int kThreads = 4;
+  constexpr int kIterations = 20'000;
+
+  ftl::ObjectPool<int, 8> pool;
+
+  std::vector<std::thread> threads;
+  for (int id = 0; id < kThreads; ++id) {
+    threads.emplace_back([&pool, id] {
+      for (int i = 0; i < kIterations; ++i) {
+        // An object shared between threads would be overwritten by one of them, and is also a data
+        // race that TSAN reports.
+        auto first = pool.acquire(id);
+        auto second = pool.acquire(id);
+        std::this_thread::yield();
+        for (const auto* object : {first.get(), second.get()}) {
+          if (object) {
+            EXPECT_EQ(*object, id);
+          }
+        }
+      }
+    });
+  }
+
+  for (auto& thread : threads) thread.join();
+
+  // Every object was returned to the pool.
+  std::vector<ftl::ObjectPool<int, 8>::Ptr> objects;
+  while (auto object = pool.acquire()) objects.push_back(std::move(object));
+  EXPECT_EQ(objects.size(), pool.capacity());
+}
+
+}  // namespace android::test
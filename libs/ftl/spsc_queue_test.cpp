@@ -0,0 +1,105 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ftl/spsc_queue.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace std::string_literals;
+
+namespace android::test {
+
+// Keep in sync with example usage in header file.
+TEST(SpscQueue, Example) {
+  ftl::SpscQueue<std::string, 4> queue;
+  EXPECT_TRUE(queue.empty());
+
+  EXPECT_TRUE(queue.try_push("abc"));
+  EXPECT_TRUE(queue.try_push(3u, '?'));
+
+  EXPECT_EQ(queue.try_pop(), "abc"s);
+  EXPECT_EQ(queue.try_pop(), "???"s);
+  EXPECT_FALSE(queue.try_pop());
+}
+
+TEST(SpscQueue, Full) {
+  ftl::SpscQueue<int, 2> queue;
+
+  EXPECT_TRUE(queue.try_push(1));
+  EXPECT_TRUE(queue.try_push(2));
+  EXPECT_EQ(queue.size(), 2u);
+
+  EXPECT_FALSE(queue.try_push(3));
+  EXPECT_EQ(queue.try_pop(), 1);
+
+  EXPECT_TRUE(queue.try_push(3));
+  EXPECT_EQ(queue.try_pop(), 2);
+  EXPECT_EQ(queue.try_pop(), 3);
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(SpscQueue, MoveOnly) {
+  ftl::SpscQueue<std::unique_ptr<int>, 4> queue;
+
+  auto ptr = std::make_unique<int>(42);
+  EXPECT_TRUE(queue.try_push(std::move(ptr)));
+  EXPECT_FALSE(ptr);
+
+  const auto opt = queue.try_pop();
+  ASSERT_TRUE(opt);
+  EXPECT_EQ(**opt, 42);
+}
+
+TEST(SpscQueue, Destroy) {
+  const auto ptr = std::make_shared<char>('!');
+  {
+    ftl::SpscQueue<std::shared_ptr<char>, 8> queue;
+    for (int i = 0; i < 5; ++i) {
+      EXPECT_TRUE(queue.try_push(ptr));
+    }
+    EXPECT_TRUE(queue.try_pop());
+    EXPECT_EQ(ptr.use_count(), 5);
+  }
+
+  // Elements left in the queue are destroyed with it.
+  EXPECT_EQ(ptr.use_count(), 1);
+}
+
+TEST(SpscQueue, Concurrent) {
+  constexpr int kCount = 100'000;
+  ftl::SpscQueue<int, 64> queue;
+
+  std::thread producer([&queue] {
+    for (int i = 0; i < kCount;) {
+      if (queue.try_push(i)) ++i;
+    }
+  });
+
+  for (int expected = 0; expected < kCount;) {
+    if (const auto opt = queue.try_pop()) {
+      ASSERT_EQ(*opt, expected);
+      ++expected;
+    }
+  }
+
+  producer.join();
+  EXPECT_TRUE(queue.empty());
+}
+
+}  // namespace android::test
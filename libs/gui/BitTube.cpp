@@ -17,12 +17,15 @@
 #include <private/gui/BitTube.h>
 
 #include <stdint.h>
+#include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include <utils/Errors.h>
 
 #include <binder/Parcel.h>
@@ -34,6 +37,9 @@ namespace gui {
 // need. So we make it smaller.
 static const size_t DEFAULT_SOCKET_BUFFER_SIZE = 4 * 1024;
 
+// Most messages recvObjectBatch reads with a single recvmmsg.
+static constexpr size_t MAX_MESSAGES_PER_BATCH = 128;
+
 BitTube::BitTube(size_t bufsize) {
     init(bufsize, bufsize);
 }
@@ -173,5 +179,60 @@ ssize_t BitTube::recvObjects(BitTube* tube, void* events, size_t count, size_t o
     return size < 0 ? size : size / static_cast<ssize_t>(objSize);
 }
 
+ssize_t BitTube::recvObjectBatch(BitTube* tube, void* events, size_t count, size_t objSize,
+                                 size_t objectsPerMessage) {
+    if (count == 0) {
+        return 0;
+    }
+    objectsPerMessage = std::clamp<size_t>(objectsPerMessage, 1, count);
+    const size_t messageCount = std::min(count / objectsPerMessage, MAX_MESSAGES_PER_BATCH);
+
+    char* vaddr = reinterpret_cast<char*>(events);
+    const size_t messageSize = objectsPerMessage * objSize;
+    std::vector<mmsghdr>& messages = tube->mBatchMessages;
+    std::vector<iovec>& iovecs = tube->mBatchIovecs;
+    if (iovecs.size() != messageCount || iovecs[0].iov_base != vaddr ||
+        iovecs[0].iov_len != messageSize) {
+        messages.assign(messageCount, mmsghdr{});
+        iovecs.resize(messageCount);
+        for (size_t i = 0; i < messageCount; i++) {
+            iovecs[i] = {vaddr + i * messageSize, messageSize};
+            messages[i].msg_hdr.msg_iov = &iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    int received, err;
+    do {
+        received = ::recvmmsg(tube->mReceiveFd, messages.data(), messageCount, MSG_DONTWAIT,
+                              nullptr);
+        err = received < 0 ? errno : 0;
+    } while (err == EINTR);
+    if (err == EAGAIN || err == EWOULDBLOCK) {
+        return 0;
+    }
+    if (err != 0) {
+        return -err;
+    }
+
+    size_t size = 0;
+    for (int i = 0; i < received; i++) {
+        const size_t length = messages[i].msg_len;
+
+        // should never happen because of SOCK_SEQPACKET
+        LOG_ALWAYS_FATAL_IF(length % objSize,
+                            "BitTube::recvObjectBatch(count=%zu, size=%zu), res=%zu (partial events "
+                            "were received!)",
+                            count, objSize, length);
+
+        // Only messages after a short one need to move.
+        if (i * messageSize != size) {
+            memmove(vaddr + size, vaddr + i * messageSize, length);
+        }
+        size += length;
+    }
+    return static_cast<ssize_t>(size / objSize);
+}
+
 } // namespace gui
 } // namespace android
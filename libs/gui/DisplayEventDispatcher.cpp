@@ -38,8 +38,16 @@ static constexpr nsecs_t WAITING_FOR_VSYNC_TIMEOUT = ms2ns(300);
 DisplayEventDispatcher::DisplayEventDispatcher(
         const sp<Looper>& looper, ISurfaceComposer::VsyncSource vsyncSource,
         ISurfaceComposer::EventRegistrationFlags eventRegistration)
-      : mLooper(looper), mReceiver(vsyncSource, eventRegistration), mWaitingForVsync(false),
-        mLastVsyncCount(0), mLastScheduleVsyncTime(0) {
+      : mLooper(looper),
+        mReceiver(vsyncSource, eventRegistration),
+        // Frame rate overrides are the only events sent together.
+        mEventsPerMessage(
+                eventRegistration.test(ISurfaceComposer::EventRegistration::frameRateOverride)
+                        ? EVENT_BUFFER_SIZE
+                        : 1),
+        mWaitingForVsync(false),
+        mLastVsyncCount(0),
+        mLastScheduleVsyncTime(0) {
     ALOGV("dispatcher %p ~ Initializing display event dispatcher.", this);
 }
 
@@ -73,13 +81,9 @@ status_t DisplayEventDispatcher::scheduleVsync() {
         ALOGV("dispatcher %p ~ Scheduling vsync.", this);
 
         // Drain all pending events.
-        nsecs_t vsyncTimestamp;
-        PhysicalDisplayId vsyncDisplayId;
-        uint32_t vsyncCount;
-        VsyncEventData vsyncEventData;
-        if (processPendingEvents(&vsyncTimestamp, &vsyncDisplayId, &vsyncCount, &vsyncEventData)) {
+        if (const DisplayEventReceiver::Event* vsync = processPendingEvents()) {
             ALOGE("dispatcher %p ~ last event processed while scheduling was for %" PRId64 "", this,
-                  ns2ms(static_cast<nsecs_t>(vsyncTimestamp)));
+                  ns2ms(static_cast<nsecs_t>(vsync->header.timestamp)));
         }
 
         status_t status = mReceiver.requestNextVsync();
@@ -118,18 +122,15 @@ int DisplayEventDispatcher::handleEvent(int, int events, void*) {
     }
 
     // Drain all pending events, keep the last vsync.
-    nsecs_t vsyncTimestamp;
-    PhysicalDisplayId vsyncDisplayId;
-    uint32_t vsyncCount;
-    VsyncEventData vsyncEventData;
-    if (processPendingEvents(&vsyncTimestamp, &vsyncDisplayId, &vsyncCount, &vsyncEventData)) {
+    if (const DisplayEventReceiver::Event* vsync = processPendingEvents()) {
         ALOGV("dispatcher %p ~ Vsync pulse: timestamp=%" PRId64
               ", displayId=%s, count=%d, vsyncId=%" PRId64,
-              this, ns2ms(vsyncTimestamp), to_string(vsyncDisplayId).c_str(), vsyncCount,
-              vsyncEventData.preferredVsyncId());
+              this, ns2ms(vsync->header.timestamp), to_string(vsync->header.displayId).c_str(),
+              vsync->vsync.count, vsync->vsync.vsyncData.preferredVsyncId());
         mWaitingForVsync = false;
-        mLastVsyncCount = vsyncCount;
-        dispatchVsync(vsyncTimestamp, vsyncDisplayId, vsyncCount, vsyncEventData);
+        mLastVsyncCount = vsync->vsync.count;
+        dispatchVsync(vsync->header.timestamp, vsync->header.displayId, vsync->vsync.count,
+                      vsync->vsync.vsyncData);
     }
 
     if (mWaitingForVsync) {
@@ -138,35 +139,35 @@ int DisplayEventDispatcher::handleEvent(int, int events, void*) {
         if (vsyncScheduleDelay > WAITING_FOR_VSYNC_TIMEOUT) {
             ALOGW("Vsync time out! vsyncScheduleDelay=%" PRId64 "ms", ns2ms(vsyncScheduleDelay));
             mWaitingForVsync = false;
-            dispatchVsync(currentTime, vsyncDisplayId /* displayId is not used */,
-                          ++mLastVsyncCount, vsyncEventData /* empty data */);
+            dispatchVsync(currentTime, PhysicalDisplayId() /* displayId is not used */,
+                          ++mLastVsyncCount, VsyncEventData() /* empty data */);
         }
     }
 
     return 1; // keep the callback
 }
 
-bool DisplayEventDispatcher::processPendingEvents(nsecs_t* outTimestamp,
-                                                  PhysicalDisplayId* outDisplayId,
-                                                  uint32_t* outCount,
-                                                  VsyncEventData* outVsyncEventData) {
-    bool gotVsync = false;
-    DisplayEventReceiver::Event buf[EVENT_BUFFER_SIZE];
+const DisplayEventReceiver::Event* DisplayEventDispatcher::processPendingEvents() {
+    if (mEventBuffers.size() == mProcessingDepth) {
+        mEventBuffers.push_back(std::make_unique<EventBuffer>());
+        mEventBuffers.back()->events.resize(EVENT_BUFFER_SIZE);
+    }
+    EventBuffer& buffer = *mEventBuffers[mProcessingDepth++];
+
+    // The latest vsync event, left where it was read until another read could overwrite it.
+    const DisplayEventReceiver::Event* vsync = nullptr;
     ssize_t n;
-    while ((n = mReceiver.getEvents(buf, EVENT_BUFFER_SIZE)) > 0) {
+    while ((n = mReceiver.getEvents(buffer.events.data(), buffer.events.size(),
+                                    mEventsPerMessage)) > 0) {
         ALOGV("dispatcher %p ~ Read %d events.", this, int(n));
         mFrameRateOverrides.reserve(n);
         for (ssize_t i = 0; i < n; i++) {
-            const DisplayEventReceiver::Event& ev = buf[i];
+            const DisplayEventReceiver::Event& ev = buffer.events[i];
             switch (ev.header.type) {
                 case DisplayEventReceiver::DISPLAY_EVENT_VSYNC:
                     // Later vsync events will just overwrite the info from earlier
                     // ones. That's fine, we only care about the most recent.
-                    gotVsync = true;
-                    *outTimestamp = ev.header.timestamp;
-                    *outDisplayId = ev.header.displayId;
-                    *outCount = ev.vsync.count;
-                    *outVsyncEventData = ev.vsync.vsyncData;
+                    vsync = &ev;
                     break;
                 case DisplayEventReceiver::DISPLAY_EVENT_HOTPLUG:
                     dispatchHotplug(ev.header.timestamp, ev.header.displayId, ev.hotplug.connected);
@@ -190,11 +191,21 @@ bool DisplayEventDispatcher::processPendingEvents(nsecs_t* outTimestamp,
                     break;
             }
         }
+
+        // With one event per message, a read that did not fill the buffer drained the queue.
+        if (mEventsPerMessage == 1 && static_cast<size_t>(n) < buffer.events.size()) {
+            break;
+        }
+        if (vsync != nullptr && vsync != &buffer.latestVsync) {
+            buffer.latestVsync = *vsync;
+            vsync = &buffer.latestVsync;
+        }
     }
     if (n < 0) {
         ALOGW("Failed to get events from display event dispatcher, status=%d", status_t(n));
     }
-    return gotVsync;
+    mProcessingDepth--;
+    return vsync;
 }
 
 status_t DisplayEventDispatcher::getLatestVsyncEventData(
@@ -109,6 +109,11 @@ ssize_t DisplayEventReceiver::getEvents(gui::BitTube* dataChannel,
     return gui::BitTube::recvObjects(dataChannel, events, count);
 }
 
+ssize_t DisplayEventReceiver::getEvents(DisplayEventReceiver::Event* events, size_t count,
+                                        size_t eventsPerMessage) {
+    return gui::BitTube::recvObjectBatch(mDataChannel.get(), events, count, eventsPerMessage);
+}
+
 ssize_t DisplayEventReceiver::sendEvents(Event const* events, size_t count) {
     return DisplayEventReceiver::sendEvents(mDataChannel.get(), events, count);
 }
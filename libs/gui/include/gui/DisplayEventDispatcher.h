@@ -18,6 +18,9 @@
 #include <utils/Log.h>
 #include <utils/Looper.h>
 
+#include <memory>
+#include <vector>
+
 namespace android {
 using FrameRateOverride = DisplayEventReceiver::Event::FrameRateOverride;
 
@@ -42,6 +45,18 @@ protected:
 private:
     sp<Looper> mLooper;
     DisplayEventReceiver mReceiver;
+    const size_t mEventsPerMessage;
+
+    // Events read by processPendingEvents(), reused across calls.
+    struct EventBuffer {
+        std::vector<DisplayEventReceiver::Event> events;
+        // Latest vsync event, kept when more events had to be read after it.
+        DisplayEventReceiver::Event latestVsync;
+    };
+    // One per level of processPendingEvents() calls, since dispatching an event can schedule a
+    // vsync, which drains the events again.
+    std::vector<std::unique_ptr<EventBuffer>> mEventBuffers;
+    size_t mProcessingDepth = 0;
     bool mWaitingForVsync;
     uint32_t mLastVsyncCount;
     nsecs_t mLastScheduleVsyncTime;
@@ -61,8 +76,9 @@ private:
     virtual void dispatchFrameRateOverrides(nsecs_t timestamp, PhysicalDisplayId displayId,
                                             std::vector<FrameRateOverride> overrides) = 0;
 
-    bool processPendingEvents(nsecs_t* outTimestamp, PhysicalDisplayId* outDisplayId,
-                              uint32_t* outCount, VsyncEventData* outVsyncEventData);
+    // Drains the pending events, dispatches all but vsync events, and returns the latest vsync
+    // event, or nullptr if there was none. The event remains valid until the next call.
+    const DisplayEventReceiver::Event* processPendingEvents();
 
     void populateFrameTimelines(const DisplayEventReceiver::Event& event,
                                 VsyncEventData* outVsyncEventData) const;
@@ -143,6 +143,14 @@ public:
     ssize_t getEvents(Event* events, size_t count);
     static ssize_t getEvents(gui::BitTube* dataChannel, Event* events, size_t count);
 
+    /*
+     * getEvents reads the events of all the messages in the queue, up to count,
+     * with a single system call. Events sent together must number at most
+     * eventsPerMessage, and vsync, hotplug and mode change events are always sent
+     * on their own. Returns like getEvents above.
+     */
+    ssize_t getEvents(Event* events, size_t count, size_t eventsPerMessage);
+
     /*
      * sendEvents write events to the queue and returns how many events were
      * written.
@@ -18,8 +18,11 @@
 
 #include <android-base/unique_fd.h>
 #include <binder/Parcelable.h>
+#include <sys/socket.h>
 #include <utils/Errors.h>
 
+#include <vector>
+
 namespace android {
 
 class Parcel;
@@ -74,6 +77,16 @@ public:
         return recvObjects(tube, events, count, sizeof(T));
     }
 
+    // receive objects (sized blobs) from all the pending messages, up to count objects, with a
+    // single system call. Each message is read into room for objectsPerMessage objects, the excess
+    // of larger messages is silently discarded. The objects received are packed at the start of
+    // the buffer, and their number is returned. Must not be called concurrently on a BitTube.
+    template <typename T>
+    static ssize_t recvObjectBatch(BitTube* tube, T* events, size_t count,
+                                   size_t objectsPerMessage) {
+        return recvObjectBatch(tube, events, count, sizeof(T), objectsPerMessage);
+    }
+
     // implement the Parcelable protocol. Only parcels the receive file descriptor
     status_t writeToParcel(Parcel* reply) const;
     status_t readFromParcel(const Parcel* parcel);
@@ -91,9 +104,17 @@ private:
     mutable base::unique_fd mSendFd;
     mutable base::unique_fd mReceiveFd;
 
+    // Headers of the messages read by recvObjectBatch, kept for as long as it is called with the
+    // same buffer, since setting them up can cost more than the system call saves.
+    std::vector<mmsghdr> mBatchMessages;
+    std::vector<iovec> mBatchIovecs;
+
     static ssize_t sendObjects(BitTube* tube, void const* events, size_t count, size_t objSize);
 
     static ssize_t recvObjects(BitTube* tube, void* events, size_t count, size_t objSize);
+
+    static ssize_t recvObjectBatch(BitTube* tube, void* events, size_t count, size_t objSize,
+                                   size_t objectsPerMessage);
 };
 
 } // namespace gui
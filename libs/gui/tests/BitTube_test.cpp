@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <private/gui/BitTube.h>
+
+#include <vector>
+
+namespace android::test {
+
+using gui::BitTube;
+using Values = std::vector<int64_t>;
+
+class BitTubeTest : public ::testing::Test {
+protected:
+    // Sends the given values as a single message.
+    void send(std::vector<int64_t> values) {
+        ASSERT_EQ(static_cast<ssize_t>(values.size()),
+                  BitTube::sendObjects(&mTube, values.data(), values.size()));
+    }
+
+    std::vector<int64_t> receive(size_t count, size_t objectsPerMessage) {
+        std::vector<int64_t> values(count);
+        ssize_t n = BitTube::recvObjectBatch(&mTube, values.data(), count, objectsPerMessage);
+        EXPECT_GE(n, 0);
+        values.resize(std::max<ssize_t>(n, 0));
+        return values;
+    }
+
+    BitTube mTube{BitTube::DefaultSize};
+};
+
+TEST_F(BitTubeTest, recvObjectBatchReadsAllMessages) {
+    for (int64_t i = 1; i <= 5; i++) {
+        send({i});
+    }
+    EXPECT_EQ((Values{1, 2, 3, 4, 5}), receive(16, 1));
+    EXPECT_TRUE(receive(16, 1).empty());
+}
+
+TEST_F(BitTubeTest, recvObjectBatchPacksMessages) {
+    send({1, 2, 3});
+    send({4});
+    send({5, 6});
+    EXPECT_EQ((Values{1, 2, 3, 4, 5, 6}), receive(16, 4));
+}
+
+TEST_F(BitTubeTest, recvObjectBatchStopsAtCount) {
+    for (int64_t i = 1; i <= 5; i++) {
+        send({i});
+    }
+    EXPECT_EQ((Values{1, 2, 3}), receive(3, 1));
+    EXPECT_EQ((Values{4, 5}), receive(3, 1));
+}
+
+TEST_F(BitTubeTest, recvObjectBatchDiscardsExcessObjects) {
+    send({1, 2, 3});
+    send({4});
+    EXPECT_EQ((Values{1, 2, 4}), receive(4, 2));
+}
+
+TEST_F(BitTubeTest, recvObjectBatchWithoutMessages) {
+    EXPECT_TRUE(receive(16, 1).empty());
+    EXPECT_TRUE(receive(0, 1).empty());
+}
+
+} // namespace android::test
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <gui/DisplayEventReceiver.h>
+#include <private/gui/BitTube.h>
+
+#include <vector>
+
+namespace android {
+namespace {
+
+using gui::BitTube;
+using Event = DisplayEventReceiver::Event;
+
+// Size of the buffer DisplayEventDispatcher reads events into.
+constexpr size_t kEventBufferSize = 100;
+
+// Large enough for the socket to queue all the events of a benchmark.
+constexpr size_t kSocketBufferSize = 512 * 1024;
+
+// Queues state.range(0) vsync events, sent one per message like EventThread does.
+void sendVsyncs(BitTube* tube, benchmark::State& state) {
+    Event event{};
+    event.header.type = DisplayEventReceiver::DISPLAY_EVENT_VSYNC;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        event.vsync.count = static_cast<uint32_t>(i);
+        if (DisplayEventReceiver::sendEvents(tube, &event, 1) != 1) {
+            state.SkipWithError("Failed to queue the events");
+            return;
+        }
+    }
+}
+
+// Drains the queue one message per system call.
+void BM_DrainEvents_recv(benchmark::State& state) {
+    BitTube tube(kSocketBufferSize);
+    std::vector<Event> events(kEventBufferSize);
+    for (auto _ : state) {
+        state.PauseTiming();
+        sendVsyncs(&tube, state);
+        state.ResumeTiming();
+        ssize_t received = 0;
+        ssize_t n;
+        while ((n = DisplayEventReceiver::getEvents(&tube, events.data(), events.size())) > 0) {
+            received += n;
+        }
+        benchmark::DoNotOptimize(received);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DrainEvents_recv)->RangeMultiplier(4)->Range(1, 64);
+
+// Drains the queue with recvmmsg, as DisplayEventDispatcher does.
+void BM_DrainEvents_recvmmsg(benchmark::State& state) {
+    BitTube tube(kSocketBufferSize);
+    std::vector<Event> events(kEventBufferSize);
+    for (auto _ : state) {
+        state.PauseTiming();
+        sendVsyncs(&tube, state);
+        state.ResumeTiming();
+        ssize_t received = 0;
+        ssize_t n;
+        do {
+            n = BitTube::recvObjectBatch(&tube, events.data(), events.size(), 1);
+            received += std::max<ssize_t>(n, 0);
+        } while (n == static_cast<ssize_t>(events.size()));
+        benchmark::DoNotOptimize(received);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DrainEvents_recvmmsg)->RangeMultiplier(4)->Range(1, 64);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "CompiledMap"
+
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
+#include <fcntl.h>
+#include <input/Keyboard.h>
+#include <log/log.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#include "CompiledMap.h"
+
+namespace android {
+
+namespace {
+
+std::mutex gCacheDirectoryLock;
+std::string gCacheDirectory;
+
+std::string getCacheDirectory() {
+    std::scoped_lock lock(gCacheDirectoryLock);
+    return gCacheDirectory;
+}
+
+// 64-bit FNV-1a, which is enough to tell apart versions of a map file and does not depend on the
+// standard library of the build.
+uint64_t hashContent(const std::string& content) {
+    uint64_t hash = 0xcbf29ce484222325;
+    for (const char c : content) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3;
+    }
+    return hash;
+}
+
+CompiledMapStamp toStamp(const struct stat& st, const std::string& content) {
+#if defined(__APPLE__)
+    const timespec& modificationTime = st.st_mtimespec;
+#else
+    const timespec& modificationTime = st.st_mtim;
+#endif
+    return {.device = static_cast<uint64_t>(st.st_dev),
+            .inode = static_cast<uint64_t>(st.st_ino),
+            .size = static_cast<uint64_t>(st.st_size),
+            .modificationTimeNs =
+                    modificationTime.tv_sec * 1000000000LL + modificationTime.tv_nsec,
+            .contentHash = hashContent(content)};
+}
+
+// Entries are named after the path of their text file, like /system/usr/keylayout/Generic.kl
+// gives system@usr@keylayout@Generic.kl.
+std::string getCachePath(const std::string& directory, const std::string& filename) {
+    std::string name = filename;
+    std::replace(name.begin(), name.end(), '/', '@');
+    return directory + "/" + (name.front() == '@' ? name.substr(1) : name);
+}
+
+} // namespace
+
+void setKeyMapCacheDirectory(const std::string& directory) {
+    std::scoped_lock lock(gCacheDirectoryLock);
+    gCacheDirectory = directory;
+}
+
+std::unique_ptr<base::MappedFile> mapCompiledMap(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        return nullptr;
+    }
+    return base::MappedFile::FromFd(fd, 0, st.st_size, PROT_READ);
+}
+
+std::optional<CompiledMapStamp> getCompiledMapStamp(const std::string& filename) {
+    if (filename.empty() || getCacheDirectory().empty()) {
+        return {};
+    }
+    base::unique_fd fd(open(filename.c_str(), O_RDONLY | O_CLOEXEC));
+    struct stat st;
+    std::string content;
+    if (!fd.ok() || fstat(fd, &st) != 0 || !base::ReadFdToString(fd, &content)) {
+        return {};
+    }
+    return toStamp(st, content);
+}
+
+std::optional<CachedCompiledMap> openCachedCompiledMap(const std::string& filename,
+                                                       const CompiledMapStamp& stamp) {
+    const std::string directory = getCacheDirectory();
+    if (directory.empty()) {
+        return {};
+    }
+    base::unique_fd fd(open(getCachePath(directory, filename).c_str(), O_RDONLY | O_CLOEXEC));
+    if (!fd.ok()) {
+        return {};
+    }
+    std::optional<CachedCompiledMap> cached(std::in_place);
+    cached->file = mapCompiledMap(fd);
+    if (cached->file == nullptr || cached->file->size() <= sizeof(CompiledMapStamp) ||
+        memcmp(cached->file->data(), &stamp, sizeof(CompiledMapStamp)) != 0) {
+        return {};
+    }
+    cached->data = cached->file->data() + sizeof(CompiledMapStamp);
+    cached->size = cached->file->size() - sizeof(CompiledMapStamp);
+    return cached;
+}
+
+void storeCachedCompiledMap(const std::string& filename, const CompiledMapStamp& stamp,
+                            const std::vector<uint8_t>& data) {
+    const std::string directory = getCacheDirectory();
+    if (directory.empty()) {
+        return;
+    }
+    if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+        ALOGW("Error %d creating key map cache directory %s.", errno, directory.c_str());
+        return;
+    }
+
+    // The entry is renamed into place, so that a concurrent load never sees it partially written.
+    // An entry torn by a crash is rejected by the checks of the loaders, then written again.
+    const std::string path = getCachePath(directory, filename);
+    std::string tmpPath = path + ".XXXXXX";
+    base::unique_fd fd(mkstemp(tmpPath.data()));
+    if (!fd.ok()) {
+        ALOGW("Error %d creating key map cache entry %s.", errno, tmpPath.c_str());
+        return;
+    }
+    if (!base::WriteFully(fd, &stamp, sizeof(stamp)) ||
+        !base::WriteFully(fd, data.data(), data.size()) ||
+        rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ALOGW("Error %d writing key map cache entry %s.", errno, path.c_str());
+        unlink(tmpPath.c_str());
+    }
+}
+
+} // namespace android
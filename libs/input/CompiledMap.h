@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/mapped_file.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace android {
+
+/**
+ * Helpers for the compiled formats of the key layout and key character maps.
+ *
+ * A compiled map is a flat sequence of fixed size records, starting with a 4 byte magic and a
+ * version, followed by the sorted lookup tables of the map. Records are written in host byte
+ * order and padded to 4 bytes, so that they can be read straight from a memory-mapped file.
+ *
+ * Compiled maps are not shipped. They are written on the first load of a text map file into the
+ * cache directory set with setKeyMapCacheDirectory, and read from there on the next loads of the
+ * unchanged file. The loaders copy the tables out of the mapping into their lookup tables.
+ */
+using CompiledMapMagic = char[4];
+
+class CompiledMapWriter {
+public:
+    template <typename T>
+    void write(const T& record) {
+        static_assert(std::is_trivially_copyable_v<T> && sizeof(T) % 4 == 0);
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+        mData.insert(mData.end(), bytes, bytes + sizeof(T));
+    }
+
+    void writeString(std::string_view string) {
+        write(static_cast<uint32_t>(string.size()));
+        mData.insert(mData.end(), string.begin(), string.end());
+        mData.resize((mData.size() + 3) & ~size_t(3));
+    }
+
+    std::vector<uint8_t> takeData() { return std::move(mData); }
+
+private:
+    std::vector<uint8_t> mData;
+};
+
+class CompiledMapReader {
+public:
+    CompiledMapReader(const void* data, size_t size)
+          : mData(static_cast<const uint8_t*>(data)), mSize(size) {}
+
+    // Copies the next record, returns false if the data is too short.
+    template <typename T>
+    bool read(T* outRecord) {
+        static_assert(std::is_trivially_copyable_v<T> && sizeof(T) % 4 == 0);
+        if (mSize - mPosition < sizeof(T)) {
+            return false;
+        }
+        memcpy(outRecord, mData + mPosition, sizeof(T));
+        mPosition += sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string* outString) {
+        uint32_t length;
+        if (!read(&length) || mSize - mPosition < length) {
+            return false;
+        }
+        outString->assign(reinterpret_cast<const char*>(mData + mPosition), length);
+        mPosition += (length + 3) & ~size_t(3);
+        mPosition = std::min(mPosition, mSize);
+        return true;
+    }
+
+    // Returns true when the whole data has been read.
+    bool isEnd() const { return mPosition == mSize; }
+
+    // Returns true if at least count records of type T remain, so that a corrupted count does
+    // not cause large allocations.
+    template <typename T>
+    bool hasRecords(size_t count) const {
+        return count <= (mSize - mPosition) / sizeof(T);
+    }
+
+private:
+    const uint8_t* mData;
+    size_t mSize;
+    size_t mPosition = 0;
+};
+
+/**
+ * Identifies the version of the text map file that a cache entry was compiled from. An entry is
+ * only used while the text file has the same stamp.
+ *
+ * The files of the system images and APEXes keep the same fixed modification time across
+ * updates, so the stamp includes a hash of the text as well.
+ */
+struct CompiledMapStamp {
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    int64_t modificationTimeNs;
+    uint64_t contentHash;
+};
+
+/**
+ * A cache entry, mapped read only. The loaders copy the compiled map out of the mapping, so it
+ * only lives while the map is loaded.
+ */
+struct CachedCompiledMap {
+    std::unique_ptr<base::MappedFile> file;
+    const void* data = nullptr;
+    size_t size = 0;
+};
+
+/**
+ * Maps a whole compiled map file, like a cache entry or the memfd of a shared map, read only.
+ * Returns null if the file is empty or cannot be mapped.
+ */
+std::unique_ptr<base::MappedFile> mapCompiledMap(int fd);
+
+/**
+ * Returns the stamp of a text map file, or nothing if caching is disabled (see
+ * setKeyMapCacheDirectory) or the file cannot be read.
+ */
+std::optional<CompiledMapStamp> getCompiledMapStamp(const std::string& filename);
+
+/**
+ * Returns the cache entry of a text map file, or nothing if there is none or it was compiled from
+ * another version of the file.
+ */
+std::optional<CachedCompiledMap> openCachedCompiledMap(const std::string& filename,
+                                                       const CompiledMapStamp& stamp);
+
+/**
+ * Stores the compiled map as the cache entry of a text map file. Errors are only logged, since
+ * the text file can still be loaded.
+ */
+void storeCachedCompiledMap(const std::string& filename, const CompiledMapStamp& stamp,
+                            const std::vector<uint8_t>& data);
+
+} // namespace android
@@ -16,12 +16,17 @@
 
 #define LOG_TAG "KeyCharacterMap"
 
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
 
 #ifdef __linux__
 #include <binder/Parcel.h>
+#include <cutils/properties.h>
+#include <sys/mman.h>
 #endif
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
 #include <android/keycodes.h>
 #include <attestation/HmacKeyManager.h>
 #include <input/InputEventLabels.h>
@@ -34,6 +39,14 @@
 #include <utils/Timers.h>
 #include <utils/Tokenizer.h>
 
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+
+#include "CompiledMap.h"
+
 // Enables debug output for the parser.
 #define DEBUG_PARSER 0
 
@@ -73,6 +86,90 @@ static const Modifier modifiers[] = {
         { "scrolllock", AMETA_SCROLL_LOCK_ON },
 };
 
+// Compiled format, see CompiledMap.h. The header is followed by the keys sorted by key code,
+// their behaviors in the same order, then the scan code and usage code mappings sorted by code.
+static constexpr CompiledMapMagic COMPILED_MAGIC = {'K', 'C', 'M', 'C'};
+static constexpr uint32_t COMPILED_VERSION = 1;
+
+struct CompiledHeader {
+    char magic[sizeof(CompiledMapMagic)];
+    uint32_t version;
+    int32_t type;
+    uint32_t keyCount;
+    uint32_t behaviorCount;
+    uint32_t keysByScanCodeCount;
+    uint32_t keysByUsageCodeCount;
+};
+
+struct CompiledKey {
+    int32_t keyCode;
+    uint16_t label;
+    uint16_t number;
+    uint32_t behaviorCount;
+};
+
+struct CompiledBehavior {
+    int32_t metaState;
+    uint32_t character;
+    int32_t fallbackKeyCode;
+    int32_t replacementKeyCode;
+};
+
+struct CompiledKeyMapping {
+    int32_t code;
+    int32_t keyCode;
+};
+
+#ifdef __linux__
+// Key count written in place of the keys by writeSharedToParcel(), followed by a sealed memfd
+// holding the compiled map.
+static constexpr int32_t SHARED_MAP_KEY_COUNT = -1;
+
+#ifdef __BIONIC__
+static constexpr int SHARED_MAP_SEALS = F_SEAL_SEAL | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE;
+
+// The memfds published by writeSharedToParcel() are kept for the next parcels of the same map.
+// Maps rarely change, so the oldest ones are only dropped past this count.
+static constexpr size_t MAX_PUBLISHED_SHARED_MAPS = 64;
+
+// A sealed memfd and its mapping, used to compare the contents of maps of the same hash.
+struct SharedMapData {
+    base::unique_fd fd;
+    std::unique_ptr<base::MappedFile> data;
+
+    bool contains(const std::vector<uint8_t>& compiled) const {
+        return data->size() == compiled.size() &&
+                memcmp(data->data(), compiled.data(), compiled.size()) == 0;
+    }
+};
+
+// Shared maps by hash of their compiled contents. The writer side keeps the published memfds, in
+// the order they were published, the reader side the maps read from them, which are shared by all
+// the parcels of the same map.
+struct SharedMaps {
+    std::mutex lock;
+    std::deque<std::pair<size_t, SharedMapData>> published;
+    std::unordered_multimap<size_t, std::pair<std::unique_ptr<base::MappedFile>,
+                                              std::weak_ptr<KeyCharacterMap>>>
+            read;
+};
+
+static SharedMaps& getSharedMaps() {
+    static SharedMaps& sharedMaps = *new SharedMaps();
+    return sharedMaps;
+}
+
+static size_t hashSharedMap(const void* data, size_t size) {
+    return std::hash<std::string_view>()(std::string_view(static_cast<const char*>(data), size));
+}
+#endif // __BIONIC__
+
+static bool shouldShareMapsByDefault() {
+    static const bool share = property_get_bool("ro.input.share_key_character_maps", false);
+    return share;
+}
+#endif // __linux__
+
 #if DEBUG_MAPPING
 static String8 toString(const char16_t* chars, size_t numChars) {
     String8 result;
@@ -158,19 +255,13 @@ bool KeyCharacterMap::operator!=(const KeyCharacterMap& other) const {
 
 base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::load(const std::string& filename,
                                                                      Format format) {
-    Tokenizer* tokenizer;
-    status_t status = Tokenizer::open(String8(filename.c_str()), &tokenizer);
-    if (status) {
-        return Errorf("Error {} opening key character map file {}.", status, filename.c_str());
-    }
     std::shared_ptr<KeyCharacterMap> map =
             std::shared_ptr<KeyCharacterMap>(new KeyCharacterMap(filename));
     if (!map.get()) {
         ALOGE("Error allocating key character map.");
         return Errorf("Error allocating key character map.");
     }
-    std::unique_ptr<Tokenizer> t(tokenizer);
-    status = map->load(t.get(), format);
+    status_t status = map->loadFile(format);
     if (status == OK) {
         return map;
     }
@@ -217,6 +308,177 @@ status_t KeyCharacterMap::load(Tokenizer* tokenizer, Format format) {
     return status;
 }
 
+status_t KeyCharacterMap::loadFile(Format format) {
+    std::optional<CompiledMapStamp> stamp = getCompiledMapStamp(mLoadFileName);
+    if (stamp) {
+        std::optional<CachedCompiledMap> cached = openCachedCompiledMap(mLoadFileName, *stamp);
+        if (cached && loadCompiled(cached->data, cached->size, format) == OK) {
+            return OK;
+        }
+        if (cached) {
+            ALOGW("Ignoring the cached key character map of %s.", mLoadFileName.c_str());
+            clear();
+        }
+    }
+
+    Tokenizer* tokenizer;
+    status_t status = Tokenizer::open(String8(mLoadFileName.c_str()), &tokenizer);
+    if (status) {
+        ALOGE("Error %s opening key character map file %s.", statusToString(status).c_str(),
+              mLoadFileName.c_str());
+        return status;
+    }
+    std::unique_ptr<Tokenizer> t(tokenizer);
+    status = load(t.get(), format);
+    if (status == OK && stamp) {
+        storeCachedCompiledMap(mLoadFileName, *stamp, compile());
+    }
+    return status;
+}
+
+std::vector<uint8_t> KeyCharacterMap::compile() const {
+    CompiledHeader header{};
+    memcpy(header.magic, COMPILED_MAGIC, sizeof(header.magic));
+    header.version = COMPILED_VERSION;
+    header.type = static_cast<int32_t>(mType);
+    header.keyCount = mKeys.size();
+    for (size_t i = 0; i < mKeys.size(); i++) {
+        for (const Behavior* behavior = mKeys.valueAt(i)->firstBehavior; behavior != nullptr;
+             behavior = behavior->next) {
+            header.behaviorCount++;
+        }
+    }
+    header.keysByScanCodeCount = mKeysByScanCode.size();
+    header.keysByUsageCodeCount = mKeysByUsageCode.size();
+
+    CompiledMapWriter writer;
+    writer.write(header);
+    for (size_t i = 0; i < mKeys.size(); i++) {
+        const Key* key = mKeys.valueAt(i);
+        CompiledKey compiledKey{mKeys.keyAt(i), key->label, key->number, 0};
+        for (const Behavior* behavior = key->firstBehavior; behavior != nullptr;
+             behavior = behavior->next) {
+            compiledKey.behaviorCount++;
+        }
+        writer.write(compiledKey);
+    }
+    for (size_t i = 0; i < mKeys.size(); i++) {
+        for (const Behavior* behavior = mKeys.valueAt(i)->firstBehavior; behavior != nullptr;
+             behavior = behavior->next) {
+            writer.write(CompiledBehavior{behavior->metaState, behavior->character,
+                                          behavior->fallbackKeyCode,
+                                          behavior->replacementKeyCode});
+        }
+    }
+    for (size_t i = 0; i < mKeysByScanCode.size(); i++) {
+        writer.write(CompiledKeyMapping{mKeysByScanCode.keyAt(i), mKeysByScanCode.valueAt(i)});
+    }
+    for (size_t i = 0; i < mKeysByUsageCode.size(); i++) {
+        writer.write(CompiledKeyMapping{mKeysByUsageCode.keyAt(i), mKeysByUsageCode.valueAt(i)});
+    }
+    return writer.takeData();
+}
+
+status_t KeyCharacterMap::loadCompiled(const void* data, size_t size, Format format) {
+#if DEBUG_PARSER_PERFORMANCE
+    nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+#endif
+    CompiledMapReader reader(data, size);
+    CompiledHeader header;
+    if (!reader.read(&header) || memcmp(header.magic, COMPILED_MAGIC, sizeof(header.magic))) {
+        ALOGE("%s: Not a compiled key character map.", mLoadFileName.c_str());
+        return BAD_VALUE;
+    }
+    if (header.version != COMPILED_VERSION) {
+        ALOGE("%s: Unsupported compiled key character map version %u, expected %u.",
+              mLoadFileName.c_str(), header.version, COMPILED_VERSION);
+        return BAD_VALUE;
+    }
+    if (header.keyCount > MAX_KEYS || !reader.hasRecords<CompiledKey>(header.keyCount) ||
+        !reader.hasRecords<CompiledBehavior>(header.behaviorCount)) {
+        ALOGE("%s: Corrupted compiled key character map.", mLoadFileName.c_str());
+        return BAD_VALUE;
+    }
+
+    mType = static_cast<KeyboardType>(header.type);
+    if (format == Format::BASE && mType == KeyboardType::OVERLAY) {
+        ALOGE("%s: Base keyboard layout must specify a keyboard 'type' other than 'OVERLAY'.",
+              mLoadFileName.c_str());
+        return BAD_VALUE;
+    }
+    if (format == Format::OVERLAY && mType != KeyboardType::OVERLAY) {
+        ALOGE("%s: Overlay keyboard layout missing required keyboard 'type OVERLAY' declaration.",
+              mLoadFileName.c_str());
+        return BAD_VALUE;
+    }
+
+    // The keys are read first, then linked to their behaviors that follow.
+    std::vector<CompiledKey> compiledKeys(header.keyCount);
+    uint64_t behaviorCount = 0;
+    mKeys.setCapacity(header.keyCount);
+    for (CompiledKey& compiledKey : compiledKeys) {
+        if (!reader.read(&compiledKey) || compiledKey.behaviorCount > header.behaviorCount ||
+            (!mKeys.isEmpty() && compiledKey.keyCode <= mKeys.keyAt(mKeys.size() - 1))) {
+            ALOGE("%s: Corrupted compiled key character map key.", mLoadFileName.c_str());
+            return BAD_VALUE;
+        }
+        behaviorCount += compiledKey.behaviorCount;
+        Key* key = new Key();
+        key->label = compiledKey.label;
+        key->number = compiledKey.number;
+        mKeys.add(compiledKey.keyCode, key);
+    }
+    if (behaviorCount != header.behaviorCount) {
+        ALOGE("%s: Corrupted compiled key character map behaviors.", mLoadFileName.c_str());
+        return BAD_VALUE;
+    }
+    for (size_t i = 0; i < compiledKeys.size(); i++) {
+        Behavior** nextBehavior = &mKeys.editValueAt(i)->firstBehavior;
+        for (uint32_t j = 0; j < compiledKeys[i].behaviorCount; j++) {
+            CompiledBehavior compiledBehavior;
+            reader.read(&compiledBehavior);
+            Behavior* behavior = new Behavior();
+            behavior->metaState = compiledBehavior.metaState;
+            behavior->character = compiledBehavior.character;
+            behavior->fallbackKeyCode = compiledBehavior.fallbackKeyCode;
+            behavior->replacementKeyCode = compiledBehavior.replacementKeyCode;
+            *nextBehavior = behavior;
+            nextBehavior = &behavior->next;
+        }
+    }
+
+    auto readKeysByCode = [&](KeyedVector<int32_t, int32_t>& keysByCode, uint32_t count) {
+        if (!reader.hasRecords<CompiledKeyMapping>(count)) {
+            return false;
+        }
+        keysByCode.setCapacity(count);
+        for (uint32_t i = 0; i < count; i++) {
+            CompiledKeyMapping mapping;
+            reader.read(&mapping);
+            if (!keysByCode.isEmpty() && mapping.code <= keysByCode.keyAt(keysByCode.size() - 1)) {
+                return false;
+            }
+            keysByCode.add(mapping.code, mapping.keyCode);
+        }
+        return true;
+    };
+    if (!readKeysByCode(mKeysByScanCode, header.keysByScanCodeCount) ||
+        !readKeysByCode(mKeysByUsageCode, header.keysByUsageCodeCount)) {
+        ALOGE("%s: Corrupted compiled key character map mappings.", mLoadFileName.c_str());
+        return BAD_VALUE;
+    }
+    if (!reader.isEnd()) {
+        ALOGE("%s: Unexpected data after compiled key character map.", mLoadFileName.c_str());
+        return BAD_VALUE;
+    }
+#if DEBUG_PARSER_PERFORMANCE
+    nsecs_t elapsedTime = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+    ALOGD("Loaded compiled key character map file '%s' in %0.3fms.", mLoadFileName.c_str(),
+          elapsedTime / 1000000.0);
+#endif
+    return OK;
+}
+
 void KeyCharacterMap::clear() {
     mKeysByScanCode.clear();
     mKeysByUsageCode.clear();
@@ -231,15 +493,7 @@ void KeyCharacterMap::clear() {
 
 status_t KeyCharacterMap::reloadBaseFromFile() {
     clear();
-    Tokenizer* tokenizer;
-    status_t status = Tokenizer::open(String8(mLoadFileName.c_str()), &tokenizer);
-    if (status) {
-        ALOGE("Error %s opening key character map file %s.", statusToString(status).c_str(),
-              mLoadFileName.c_str());
-        return status;
-    }
-    std::unique_ptr<Tokenizer> t(tokenizer);
-    return load(t.get(), KeyCharacterMap::Format::BASE);
+    return loadFile(KeyCharacterMap::Format::BASE);
 }
 
 void KeyCharacterMap::combine(const KeyCharacterMap& overlay) {
@@ -684,16 +938,19 @@ std::shared_ptr<KeyCharacterMap> KeyCharacterMap::readFromParcel(Parcel* parcel)
             std::shared_ptr<KeyCharacterMap>(new KeyCharacterMap(loadFileName));
     map->mType = static_cast<KeyCharacterMap::KeyboardType>(parcel->readInt32());
     map->mLayoutOverlayApplied = parcel->readBool();
-    size_t numKeys = parcel->readInt32();
+    int32_t numKeys = parcel->readInt32();
     if (parcel->errorCheck()) {
         return nullptr;
     }
-    if (numKeys > MAX_KEYS) {
-        ALOGE("Too many keys in KeyCharacterMap (%zu > %d)", numKeys, MAX_KEYS);
+    if (numKeys == SHARED_MAP_KEY_COUNT) {
+        return readShared(std::move(map), parcel->readFileDescriptor());
+    }
+    if (numKeys < 0 || numKeys > MAX_KEYS) {
+        ALOGE("Invalid number of keys in KeyCharacterMap (%d, max %d)", numKeys, MAX_KEYS);
         return nullptr;
     }
 
-    for (size_t i = 0; i < numKeys; i++) {
+    for (int32_t i = 0; i < numKeys; i++) {
         int32_t keyCode = parcel->readInt32();
         char16_t label = parcel->readInt32();
         char16_t number = parcel->readInt32();
@@ -760,7 +1017,116 @@ std::shared_ptr<KeyCharacterMap> KeyCharacterMap::readFromParcel(Parcel* parcel)
     return map;
 }
 
+std::shared_ptr<KeyCharacterMap> KeyCharacterMap::readShared(std::shared_ptr<KeyCharacterMap> map,
+                                                             int fd) {
+#ifdef __BIONIC__
+    // The contents must not change once checked against the maps already read.
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals == -1 || (seals & SHARED_MAP_SEALS) != SHARED_MAP_SEALS) {
+        ALOGE("%s: Shared KeyCharacterMap is not a sealed memfd", __func__);
+        return nullptr;
+    }
+    std::unique_ptr<base::MappedFile> data = mapCompiledMap(fd);
+    if (data == nullptr) {
+        ALOGE("%s: Error %d mapping shared KeyCharacterMap", __func__, errno);
+        return nullptr;
+    }
+    const size_t hash = hashSharedMap(data->data(), data->size());
+
+    SharedMaps& sharedMaps = getSharedMaps();
+    std::scoped_lock lock(sharedMaps.lock);
+    for (auto it = sharedMaps.read.begin(); it != sharedMaps.read.end();) {
+        std::shared_ptr<KeyCharacterMap> readMap = it->second.second.lock();
+        if (readMap == nullptr) {
+            it = sharedMaps.read.erase(it);
+            continue;
+        }
+        const base::MappedFile& readData = *it->second.first;
+        if (it->first == hash && readData.size() == data->size() &&
+            memcmp(readData.data(), data->data(), data->size()) == 0 &&
+            readMap->mLoadFileName == map->mLoadFileName &&
+            readMap->mLayoutOverlayApplied == map->mLayoutOverlayApplied) {
+            return readMap;
+        }
+        ++it;
+    }
+    if (map->loadCompiled(data->data(), data->size(), Format::ANY) != OK) {
+        return nullptr;
+    }
+    sharedMaps.read.emplace(hash, std::make_pair(std::move(data), map));
+    return map;
+#else
+    (void)map;
+    (void)fd;
+    ALOGE("%s: Shared KeyCharacterMaps are not supported", __func__);
+    return nullptr;
+#endif
+}
+
 void KeyCharacterMap::writeToParcel(Parcel* parcel) const {
+    if (shouldShareMapsByDefault()) {
+        writeSharedToParcel(parcel);
+    } else {
+        writeFullToParcel(parcel);
+    }
+}
+
+void KeyCharacterMap::writeSharedToParcel(Parcel* parcel) const {
+    if (parcel == nullptr) {
+        ALOGE("%s: Null parcel", __func__);
+        return;
+    }
+    base::unique_fd fd;
+    if (parcel->allowFds()) {
+        fd = publishShared();
+    }
+    if (!fd.ok()) {
+        writeFullToParcel(parcel);
+        return;
+    }
+    parcel->writeCString(mLoadFileName.c_str());
+    parcel->writeInt32(static_cast<int32_t>(mType));
+    parcel->writeBool(mLayoutOverlayApplied);
+    parcel->writeInt32(SHARED_MAP_KEY_COUNT);
+    parcel->writeFileDescriptor(fd.release(), true /* takeOwnership */);
+}
+
+base::unique_fd KeyCharacterMap::publishShared() const {
+#ifdef __BIONIC__
+    std::vector<uint8_t> compiled = compile();
+    const size_t hash = hashSharedMap(compiled.data(), compiled.size());
+
+    SharedMaps& sharedMaps = getSharedMaps();
+    std::scoped_lock lock(sharedMaps.lock);
+    for (const auto& [publishedHash, published] : sharedMaps.published) {
+        if (publishedHash == hash && published.contains(compiled)) {
+            return base::unique_fd(fcntl(published.fd, F_DUPFD_CLOEXEC, 0));
+        }
+    }
+
+    SharedMapData published;
+    published.fd.reset(memfd_create("KeyCharacterMap", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    if (published.fd.ok() && base::WriteFully(published.fd, compiled.data(), compiled.size()) &&
+        fcntl(published.fd, F_ADD_SEALS, SHARED_MAP_SEALS) == 0) {
+        published.data = mapCompiledMap(published.fd);
+    }
+    if (published.data == nullptr) {
+        ALOGE("%s: Error %d publishing shared KeyCharacterMap %s", __func__, errno,
+              mLoadFileName.c_str());
+        return {};
+    }
+    if (sharedMaps.published.size() >= MAX_PUBLISHED_SHARED_MAPS) {
+        sharedMaps.published.pop_front();
+    }
+    const SharedMapData& newPublished =
+            sharedMaps.published.emplace_back(hash, std::move(published)).second;
+    return base::unique_fd(fcntl(newPublished.fd, F_DUPFD_CLOEXEC, 0));
+#else
+    return {};
+#endif
+}
+
+void KeyCharacterMap::writeFullToParcel(Parcel* parcel) const {
     if (parcel == nullptr) {
         ALOGE("%s: Null parcel", __func__);
         return;
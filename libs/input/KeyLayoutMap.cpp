@@ -28,10 +28,14 @@
 #include <vintf/RuntimeInfo.h>
 #include <vintf/VintfObject.h>
 
+#include <algorithm>
 #include <cstdlib>
+#include <optional>
 #include <string_view>
 #include <unordered_map>
 
+#include "CompiledMap.h"
+
 /**
  * Log debug output for the parser.
  * Enable this via "adb shell setprop log.tag.KeyLayoutMapParser DEBUG" (requires restart)
@@ -78,6 +82,68 @@ static const std::unordered_map<std::string_view, InputDeviceSensorType> SENSOR_
          sensorPair<InputDeviceSensorType::GYROSCOPE_UNCALIBRATED>(),
          sensorPair<InputDeviceSensorType::SIGNIFICANT_MOTION>()};
 
+// Compiled format, see CompiledMap.h. The header is followed by the tables of the map, each
+// sorted by code, then by the required kernel configs.
+constexpr CompiledMapMagic COMPILED_MAGIC = {'K', 'L', 'M', 'C'};
+constexpr uint32_t COMPILED_VERSION = 1;
+
+struct CompiledHeader {
+    char magic[sizeof(CompiledMapMagic)];
+    uint32_t version;
+    uint32_t keysByScanCodeCount;
+    uint32_t keysByUsageCodeCount;
+    uint32_t axisCount;
+    uint32_t ledsByScanCodeCount;
+    uint32_t ledsByUsageCodeCount;
+    uint32_t sensorCount;
+    uint32_t requiredKernelConfigCount;
+};
+
+struct CompiledKey {
+    int32_t code;
+    int32_t keyCode;
+    uint32_t flags;
+};
+
+struct CompiledAxis {
+    int32_t scanCode;
+    int32_t mode;
+    int32_t axis;
+    int32_t highAxis;
+    int32_t splitValue;
+    int32_t flatOverride;
+};
+
+struct CompiledLed {
+    int32_t code;
+    int32_t ledCode;
+};
+
+struct CompiledSensor {
+    int32_t absCode;
+    int32_t sensorType;
+    int32_t sensorDataIndex;
+};
+
+// Reads count records into a table sorted by code, checking that the codes are increasing.
+template <typename T, typename V, typename Convert>
+bool readCompiledTable(CompiledMapReader& reader, uint32_t count, KeyedVector<int32_t, V>& table,
+                       Convert convert) {
+    if (!reader.hasRecords<T>(count)) {
+        return false;
+    }
+    table.setCapacity(count);
+    for (uint32_t i = 0; i < count; i++) {
+        T record;
+        reader.read(&record);
+        if (!table.isEmpty() && record.code <= table.keyAt(table.size() - 1)) {
+            return false;
+        }
+        table.add(record.code, convert(record));
+    }
+    return true;
+}
+
 bool kernelConfigsArePresent(const std::set<std::string>& configs) {
     std::shared_ptr<const android::vintf::RuntimeInfo> runtimeInfo =
             android::vintf::VintfObject::GetInstance()->getRuntimeInfo(
@@ -113,19 +179,36 @@ base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::loadContents(const std
 
 base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::load(const std::string& filename,
                                                                const char* contents) {
-    Tokenizer* tokenizer;
-    status_t status;
-    if (contents == nullptr) {
-        status = Tokenizer::open(String8(filename.c_str()), &tokenizer);
-    } else {
-        status = Tokenizer::fromContents(String8(filename.c_str()), contents, &tokenizer);
+    base::Result<std::shared_ptr<KeyLayoutMap>> ret;
+    std::optional<CompiledMapStamp> stamp =
+            contents == nullptr ? getCompiledMapStamp(filename) : std::nullopt;
+    std::optional<CachedCompiledMap> cached =
+            stamp ? openCachedCompiledMap(filename, *stamp) : std::nullopt;
+    if (cached) {
+        ret = loadCompiled(cached->data, cached->size);
+        if (!ret.ok()) {
+            ALOGW("Ignoring the cached key layout map of %s: %s", filename.c_str(),
+                  ret.error().message().c_str());
+        }
     }
-    if (status) {
-        ALOGE("Error %d opening key layout map file %s.", status, filename.c_str());
-        return Errorf("Error {} opening key layout map file {}.", status, filename.c_str());
+    if (!cached || !ret.ok()) {
+        Tokenizer* tokenizer;
+        status_t status;
+        if (contents == nullptr) {
+            status = Tokenizer::open(String8(filename.c_str()), &tokenizer);
+        } else {
+            status = Tokenizer::fromContents(String8(filename.c_str()), contents, &tokenizer);
+        }
+        if (status) {
+            ALOGE("Error %d opening key layout map file %s.", status, filename.c_str());
+            return Errorf("Error {} opening key layout map file {}.", status, filename.c_str());
+        }
+        std::unique_ptr<Tokenizer> t(tokenizer);
+        ret = load(t.get());
+        if (ret.ok() && stamp) {
+            storeCachedCompiledMap(filename, *stamp, (*ret)->compile());
+        }
     }
-    std::unique_ptr<Tokenizer> t(tokenizer);
-    auto ret = load(t.get());
     if (!ret.ok()) {
         return ret;
     }
@@ -164,6 +247,123 @@ base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::load(Tokenizer* tokeni
     return Errorf("Load KeyLayoutMap failed {}.", status);
 }
 
+base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::loadCompiled(const void* data,
+                                                                       size_t size) {
+#if DEBUG_PARSER_PERFORMANCE
+    nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+#endif
+    CompiledMapReader reader(data, size);
+    CompiledHeader header;
+    if (!reader.read(&header) || memcmp(header.magic, COMPILED_MAGIC, sizeof(header.magic))) {
+        return Errorf("Not a compiled key layout map.");
+    }
+    if (header.version != COMPILED_VERSION) {
+        return Errorf("Unsupported compiled key layout map version {}, expected {}.",
+                      header.version, COMPILED_VERSION);
+    }
+
+    std::shared_ptr<KeyLayoutMap> map = std::shared_ptr<KeyLayoutMap>(new KeyLayoutMap());
+    auto toKey = [](const CompiledKey& key) { return Key{key.keyCode, key.flags}; };
+    auto toLed = [](const CompiledLed& led) { return Led{led.ledCode}; };
+    bool ok = readCompiledTable<CompiledKey>(reader, header.keysByScanCodeCount,
+                                             map->mKeysByScanCode, toKey) &&
+            readCompiledTable<CompiledKey>(reader, header.keysByUsageCodeCount,
+                                           map->mKeysByUsageCode, toKey);
+    if (ok && reader.hasRecords<CompiledAxis>(header.axisCount)) {
+        map->mAxes.setCapacity(header.axisCount);
+        for (uint32_t i = 0; ok && i < header.axisCount; i++) {
+            CompiledAxis compiledAxis;
+            reader.read(&compiledAxis);
+            AxisInfo axis;
+            axis.mode = static_cast<AxisInfo::Mode>(compiledAxis.mode);
+            axis.axis = compiledAxis.axis;
+            axis.highAxis = compiledAxis.highAxis;
+            axis.splitValue = compiledAxis.splitValue;
+            axis.flatOverride = compiledAxis.flatOverride;
+            ok = map->mAxes.add(compiledAxis.scanCode, axis) == ssize_t(i);
+        }
+    } else {
+        ok = false;
+    }
+    ok = ok &&
+            readCompiledTable<CompiledLed>(reader, header.ledsByScanCodeCount,
+                                           map->mLedsByScanCode, toLed) &&
+            readCompiledTable<CompiledLed>(reader, header.ledsByUsageCodeCount,
+                                           map->mLedsByUsageCode, toLed) &&
+            reader.hasRecords<CompiledSensor>(header.sensorCount);
+    for (uint32_t i = 0; ok && i < header.sensorCount; i++) {
+        CompiledSensor sensor;
+        reader.read(&sensor);
+        map->mSensorsByAbsCode.emplace(sensor.absCode,
+                                       Sensor{static_cast<InputDeviceSensorType>(
+                                                      sensor.sensorType),
+                                              sensor.sensorDataIndex});
+    }
+    for (uint32_t i = 0; ok && i < header.requiredKernelConfigCount; i++) {
+        std::string config;
+        ok = reader.readString(&config);
+        map->mRequiredKernelConfigs.insert(std::move(config));
+    }
+    if (!ok || !reader.isEnd()) {
+        return Errorf("Corrupted compiled key layout map.");
+    }
+#if DEBUG_PARSER_PERFORMANCE
+    nsecs_t elapsedTime = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+    ALOGD("Loaded compiled key layout map in %0.3fms.", elapsedTime / 1000000.0);
+#endif
+    return std::move(map);
+}
+
+std::vector<uint8_t> KeyLayoutMap::compile() const {
+    CompiledHeader header{};
+    memcpy(header.magic, COMPILED_MAGIC, sizeof(header.magic));
+    header.version = COMPILED_VERSION;
+    header.keysByScanCodeCount = mKeysByScanCode.size();
+    header.keysByUsageCodeCount = mKeysByUsageCode.size();
+    header.axisCount = mAxes.size();
+    header.ledsByScanCodeCount = mLedsByScanCode.size();
+    header.ledsByUsageCodeCount = mLedsByUsageCode.size();
+    header.sensorCount = mSensorsByAbsCode.size();
+    header.requiredKernelConfigCount = mRequiredKernelConfigs.size();
+
+    CompiledMapWriter writer;
+    writer.write(header);
+    for (const KeyedVector<int32_t, Key>* keys : {&mKeysByScanCode, &mKeysByUsageCode}) {
+        for (size_t i = 0; i < keys->size(); i++) {
+            const Key& key = keys->valueAt(i);
+            writer.write(CompiledKey{keys->keyAt(i), key.keyCode, key.flags});
+        }
+    }
+    for (size_t i = 0; i < mAxes.size(); i++) {
+        const AxisInfo& axis = mAxes.valueAt(i);
+        writer.write(CompiledAxis{mAxes.keyAt(i), static_cast<int32_t>(axis.mode), axis.axis,
+                                  axis.highAxis, axis.splitValue, axis.flatOverride});
+    }
+    for (const KeyedVector<int32_t, Led>* leds : {&mLedsByScanCode, &mLedsByUsageCode}) {
+        for (size_t i = 0; i < leds->size(); i++) {
+            writer.write(CompiledLed{leds->keyAt(i), leds->valueAt(i).ledCode});
+        }
+    }
+    // Sorted, so that compiling a map always gives the same file.
+    std::vector<CompiledSensor> sensors;
+    for (const auto& [absCode, sensor] : mSensorsByAbsCode) {
+        sensors.push_back({absCode, static_cast<int32_t>(sensor.sensorType),
+                           sensor.sensorDataIndex});
+    }
+    std::sort(sensors.begin(), sensors.end(),
+              [](const CompiledSensor& a, const CompiledSensor& b) {
+                  return a.absCode < b.absCode;
+              });
+    for (const CompiledSensor& sensor : sensors) {
+        writer.write(sensor);
+    }
+    for (const std::string& config : mRequiredKernelConfigs) {
+        writer.writeString(config);
+    }
+
+    return writer.takeData();
+}
+
 status_t KeyLayoutMap::mapKey(int32_t scanCode, int32_t usageCode,
         int32_t* outKeyCode, uint32_t* outFlags) const {
     const Key* key = getKey(scanCode, usageCode);
@@ -21,6 +21,14 @@
 #include <input/KeyLayoutMap.h>
 #include <input/Keyboard.h>
 #include "android-base/file.h"
+#include "android-base/stringprintf.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
 
 namespace android {
 
@@ -146,4 +154,373 @@ TEST(InputDeviceKeyLayoutTest, LoadsWhenRequiredKernelConfigIsPresent) {
     ASSERT_NE(nullptr, map) << "Map should be valid because CONFIG_UHID should always be present";
 }
 
+// --- KeyMapCacheTest ---
+
+static constexpr int32_t MAX_CODE = 1024;
+
+static constexpr int32_t META_STATES[] = {
+        0,
+        AMETA_SHIFT_ON,
+        AMETA_ALT_ON,
+        AMETA_CTRL_ON,
+        AMETA_META_ON,
+        AMETA_CAPS_LOCK_ON,
+        AMETA_NUM_LOCK_ON,
+        AMETA_SHIFT_ON | AMETA_ALT_ON,
+        AMETA_SHIFT_ON | AMETA_CAPS_LOCK_ON,
+        AMETA_CTRL_ON | AMETA_ALT_ON,
+};
+
+// Caches the compiled maps in a temporary directory while in scope.
+class ScopedKeyMapCache {
+public:
+    ScopedKeyMapCache() { setKeyMapCacheDirectory(mDir.path); }
+    ~ScopedKeyMapCache() { setKeyMapCacheDirectory(""); }
+
+    // Returns the path of the cache entry of a text map file.
+    std::string getEntryPath(const std::string& filename) const {
+        std::string name = filename;
+        std::replace(name.begin(), name.end(), '/', '@');
+        return std::string(mDir.path) + "/" + (name.front() == '@' ? name.substr(1) : name);
+    }
+
+private:
+    TemporaryDir mDir;
+};
+
+static void assertSameLookups(const KeyCharacterMap& expected, const KeyCharacterMap& actual) {
+    ASSERT_EQ(expected.getKeyboardType(), actual.getKeyboardType());
+    for (int32_t scanCode = 0; scanCode < MAX_CODE; scanCode++) {
+        int32_t expectedKeyCode = 0;
+        int32_t actualKeyCode = 0;
+        ASSERT_EQ(expected.mapKey(scanCode, 0, &expectedKeyCode),
+                  actual.mapKey(scanCode, 0, &actualKeyCode));
+        ASSERT_EQ(expectedKeyCode, actualKeyCode) << "scanCode=" << scanCode;
+    }
+    for (int32_t keyCode = 0; keyCode < MAX_CODE; keyCode++) {
+        ASSERT_EQ(expected.getDisplayLabel(keyCode), actual.getDisplayLabel(keyCode));
+        ASSERT_EQ(expected.getNumber(keyCode), actual.getNumber(keyCode));
+        for (int32_t metaState : META_STATES) {
+            ASSERT_EQ(expected.getCharacter(keyCode, metaState),
+                      actual.getCharacter(keyCode, metaState))
+                    << "keyCode=" << keyCode << " metaState=" << metaState;
+            KeyCharacterMap::FallbackAction expectedAction;
+            KeyCharacterMap::FallbackAction actualAction;
+            bool hasAction = expected.getFallbackAction(keyCode, metaState, &expectedAction);
+            ASSERT_EQ(hasAction, actual.getFallbackAction(keyCode, metaState, &actualAction))
+                    << "keyCode=" << keyCode << " metaState=" << metaState;
+            if (hasAction) {
+                ASSERT_EQ(expectedAction.keyCode, actualAction.keyCode);
+                ASSERT_EQ(expectedAction.metaState, actualAction.metaState);
+            }
+        }
+    }
+}
+
+static void assertSameLookups(const KeyLayoutMap& expected, const KeyLayoutMap& actual) {
+    for (int32_t scanCode = 0; scanCode < MAX_CODE; scanCode++) {
+        int32_t expectedKeyCode = 0, actualKeyCode = 0;
+        uint32_t expectedFlags = 0, actualFlags = 0;
+        ASSERT_EQ(expected.mapKey(scanCode, 0, &expectedKeyCode, &expectedFlags),
+                  actual.mapKey(scanCode, 0, &actualKeyCode, &actualFlags));
+        ASSERT_EQ(expectedKeyCode, actualKeyCode) << "scanCode=" << scanCode;
+        ASSERT_EQ(expectedFlags, actualFlags) << "scanCode=" << scanCode;
+
+        AxisInfo expectedAxis, actualAxis;
+        ASSERT_EQ(expected.mapAxis(scanCode, &expectedAxis), actual.mapAxis(scanCode, &actualAxis));
+        ASSERT_EQ(expectedAxis.mode, actualAxis.mode);
+        ASSERT_EQ(expectedAxis.axis, actualAxis.axis);
+        ASSERT_EQ(expectedAxis.highAxis, actualAxis.highAxis);
+        ASSERT_EQ(expectedAxis.splitValue, actualAxis.splitValue);
+        ASSERT_EQ(expectedAxis.flatOverride, actualAxis.flatOverride);
+    }
+    for (int32_t keyCode = 0; keyCode < MAX_CODE; keyCode++) {
+        std::vector<int32_t> expectedScanCodes, actualScanCodes;
+        ASSERT_EQ(expected.findScanCodesForKey(keyCode, &expectedScanCodes),
+                  actual.findScanCodesForKey(keyCode, &actualScanCodes));
+        ASSERT_EQ(expectedScanCodes, actualScanCodes) << "keyCode=" << keyCode;
+    }
+}
+
+TEST_F(InputDeviceKeyMapTest, CachedKeyCharacterMapMatchesTextMap) {
+    ScopedKeyMapCache cache;
+    const std::string& path = mKeyMap.keyCharacterMapFile;
+    ASSERT_TRUE(KeyCharacterMap::load(path, KeyCharacterMap::Format::BASE).ok());
+    std::string entry;
+    ASSERT_TRUE(base::ReadFileToString(cache.getEntryPath(path), &entry));
+
+    base::Result<std::shared_ptr<KeyCharacterMap>> cached =
+            KeyCharacterMap::load(path, KeyCharacterMap::Format::BASE);
+    ASSERT_TRUE(cached.ok()) << cached.error().message();
+    ASSERT_EQ(path, (*cached)->getLoadFileName());
+    ASSERT_EQ(*mKeyMap.keyCharacterMap, **cached);
+    assertSameLookups(*mKeyMap.keyCharacterMap, **cached);
+
+    // Loading from the entry does not write it again.
+    std::string reloadedEntry;
+    ASSERT_TRUE(base::ReadFileToString(cache.getEntryPath(path), &reloadedEntry));
+    ASSERT_EQ(entry, reloadedEntry);
+}
+
+TEST_F(InputDeviceKeyMapTest, CachedKeyCharacterMapOverlaysMatchTextOverlays) {
+    ScopedKeyMapCache cache;
+    for (const char* name : {"english_us.kcm", "french.kcm", "german.kcm"}) {
+        std::string overlayPath = base::GetExecutableDirectory() + "/data/" + name;
+        base::Result<std::shared_ptr<KeyCharacterMap>> overlay =
+                KeyCharacterMap::load(overlayPath, KeyCharacterMap::Format::OVERLAY);
+        ASSERT_TRUE(overlay.ok()) << "Cannot load KeyCharacterMap at " << overlayPath;
+        ASSERT_EQ(0, access(cache.getEntryPath(overlayPath).c_str(), F_OK)) << name;
+        base::Result<std::shared_ptr<KeyCharacterMap>> cached =
+                KeyCharacterMap::load(overlayPath, KeyCharacterMap::Format::OVERLAY);
+        ASSERT_TRUE(cached.ok()) << cached.error().message();
+        ASSERT_FALSE(KeyCharacterMap::load(overlayPath, KeyCharacterMap::Format::BASE).ok())
+                << "An overlay should not load as a base map";
+
+        KeyCharacterMap expected(*mKeyMap.keyCharacterMap);
+        expected.combine(**overlay);
+        KeyCharacterMap actual(*mKeyMap.keyCharacterMap);
+        actual.combine(**cached);
+        ASSERT_EQ(expected, actual) << name;
+        assertSameLookups(expected, actual);
+    }
+}
+
+TEST_F(InputDeviceKeyMapTest, CachedKeyLayoutMapMatchesTextMap) {
+    ScopedKeyMapCache cache;
+    const std::string& path = mKeyMap.keyLayoutFile;
+    ASSERT_TRUE(KeyLayoutMap::load(path).ok());
+    ASSERT_EQ(0, access(cache.getEntryPath(path).c_str(), F_OK));
+
+    base::Result<std::shared_ptr<KeyLayoutMap>> cached = KeyLayoutMap::load(path);
+    ASSERT_TRUE(cached.ok()) << cached.error().message();
+    ASSERT_EQ(path, (*cached)->getLoadFileName());
+    assertSameLookups(*mKeyMap.keyLayoutMap, **cached);
+}
+
+TEST_F(InputDeviceKeyMapTest, CorruptedCacheEntriesAreReplaced) {
+    ScopedKeyMapCache cache;
+    const std::string& kcmPath = mKeyMap.keyCharacterMapFile;
+    const std::string& klPath = mKeyMap.keyLayoutFile;
+    ASSERT_TRUE(KeyCharacterMap::load(kcmPath, KeyCharacterMap::Format::BASE).ok());
+    ASSERT_TRUE(KeyLayoutMap::load(klPath).ok());
+
+    for (const std::string& path : {kcmPath, klPath}) {
+        const std::string entryPath = cache.getEntryPath(path);
+        std::string entry;
+        ASSERT_TRUE(base::ReadFileToString(entryPath, &entry));
+        const bool isKcm = path == kcmPath;
+        // Truncated in the middle of a record, missing its last table, with trailing data, with
+        // an unknown version, and with the stamp of another file.
+        std::string version = entry;
+        version[version.find(isKcm ? "KCMC" : "KLMC") + 4]++;
+        std::string stamp = entry;
+        stamp[0]++;
+        for (const std::string& corrupted :
+             {entry.substr(0, entry.size() / 2 + 1), entry.substr(0, entry.size() - 4),
+              entry + "KCMC", version, stamp}) {
+            ASSERT_TRUE(base::WriteStringToFile(corrupted, entryPath));
+            if (isKcm) {
+                base::Result<std::shared_ptr<KeyCharacterMap>> map =
+                        KeyCharacterMap::load(path, KeyCharacterMap::Format::BASE);
+                ASSERT_TRUE(map.ok()) << map.error().message();
+                assertSameLookups(*mKeyMap.keyCharacterMap, **map);
+            } else {
+                base::Result<std::shared_ptr<KeyLayoutMap>> map = KeyLayoutMap::load(path);
+                ASSERT_TRUE(map.ok()) << map.error().message();
+                assertSameLookups(*mKeyMap.keyLayoutMap, **map);
+            }
+            // The text file was parsed and the entry written again.
+            std::string rewritten;
+            ASSERT_TRUE(base::ReadFileToString(entryPath, &rewritten));
+            ASSERT_EQ(entry, rewritten);
+        }
+    }
+}
+
+TEST(InputDeviceKeyLayoutTest, ChangedTextMapIsNotLoadedFromCache) {
+    ScopedKeyMapCache cache;
+    TemporaryFile klFile;
+    ASSERT_TRUE(base::WriteStringToFile("key 1 ESCAPE\n", klFile.path));
+    ASSERT_TRUE(KeyLayoutMap::load(klFile.path).ok());
+    ASSERT_TRUE(base::WriteStringToFile("key 1 ENTER\n", klFile.path));
+
+    base::Result<std::shared_ptr<KeyLayoutMap>> map = KeyLayoutMap::load(klFile.path);
+    ASSERT_TRUE(map.ok()) << map.error().message();
+    int32_t keyCode = 0;
+    uint32_t flags = 0;
+    ASSERT_EQ(OK, (*map)->mapKey(1, 0, &keyCode, &flags));
+    ASSERT_EQ(AKEYCODE_ENTER, keyCode);
+}
+
+TEST(InputDeviceKeyLayoutTest, ChangedTextMapWithSameStatIsNotLoadedFromCache) {
+    ScopedKeyMapCache cache;
+    TemporaryFile klFile;
+    ASSERT_TRUE(base::WriteStringToFile("key 1 SPACE\n", klFile.path));
+    ASSERT_TRUE(KeyLayoutMap::load(klFile.path).ok());
+    struct stat st;
+    ASSERT_EQ(0, stat(klFile.path, &st));
+
+    // Like the files of an updated system image, the new text has the same size and
+    // modification time.
+    ASSERT_TRUE(base::WriteStringToFile("key 1 ENTER\n", klFile.path));
+    const timespec times[] = {st.st_atim, st.st_mtim};
+    ASSERT_EQ(0, utimensat(AT_FDCWD, klFile.path, times, 0));
+
+    base::Result<std::shared_ptr<KeyLayoutMap>> map = KeyLayoutMap::load(klFile.path);
+    ASSERT_TRUE(map.ok()) << map.error().message();
+    int32_t keyCode = 0;
+    uint32_t flags = 0;
+    ASSERT_EQ(OK, (*map)->mapKey(1, 0, &keyCode, &flags));
+    ASSERT_EQ(AKEYCODE_ENTER, keyCode);
+}
+
+TEST(InputDeviceKeyLayoutTest, CachedMapDoesNotLoadWhenRequiredKernelConfigIsMissing) {
+    ScopedKeyMapCache cache;
+    std::string klPath = base::GetExecutableDirectory() + "/data/kl_with_required_real_config.kl";
+    ASSERT_TRUE(KeyLayoutMap::load(klPath).ok()) << "Cannot load KeyLayout at " << klPath;
+
+    // The required kernel configs are compiled with the map, so they are still checked when the
+    // map is loaded from its cache entry.
+    std::string entry;
+    ASSERT_TRUE(base::ReadFileToString(cache.getEntryPath(klPath), &entry));
+    const std::string uhid = "CONFIG_UHID";
+    size_t config = entry.rfind(uhid);
+    ASSERT_NE(std::string::npos, config);
+    entry.replace(config, uhid.size(), "CONFIG_FAKE");
+    ASSERT_TRUE(base::WriteStringToFile(entry, cache.getEntryPath(klPath)));
+    base::Result<std::shared_ptr<KeyLayoutMap>> ret = KeyLayoutMap::load(klPath);
+    ASSERT_FALSE(ret.ok());
+    ASSERT_EQ("Missing kernel config", ret.error().message());
+}
+
+// --- SharedKeyCharacterMapTest ---
+
+static std::shared_ptr<KeyCharacterMap> parcelShared(const KeyCharacterMap& map, Parcel* parcel) {
+    map.writeSharedToParcel(parcel);
+    parcel->setDataPosition(0);
+    return KeyCharacterMap::readFromParcel(parcel);
+}
+
+// Returns the memfd of a map written with writeSharedToParcel().
+static int readSharedFd(Parcel* parcel) {
+    parcel->setDataPosition(0);
+    parcel->readCString();
+    parcel->readInt32();
+    parcel->readBool();
+    parcel->readInt32();
+    return parcel->readFileDescriptor();
+}
+
+TEST_F(InputDeviceKeyMapTest, SharedParcelMatchesMap) {
+    Parcel fullParcel;
+    mKeyMap.keyCharacterMap->writeToParcel(&fullParcel);
+    Parcel parcel;
+    std::shared_ptr<KeyCharacterMap> map = parcelShared(*mKeyMap.keyCharacterMap, &parcel);
+    ASSERT_NE(nullptr, map);
+    ASSERT_EQ(*mKeyMap.keyCharacterMap, *map);
+    assertSameLookups(*mKeyMap.keyCharacterMap, *map);
+    ASSERT_EQ(1u, parcel.objectsCount());
+    ASSERT_LT(parcel.dataSize(), fullParcel.dataSize());
+}
+
+TEST_F(InputDeviceKeyMapTest, SharedParcelsOfSameMapShareMemfdAndInstance) {
+    // A copy, so that the maps are only equal by contents.
+    KeyCharacterMap copy(*mKeyMap.keyCharacterMap);
+    Parcel parcel1, parcel2;
+    std::shared_ptr<KeyCharacterMap> map1 = parcelShared(*mKeyMap.keyCharacterMap, &parcel1);
+    std::shared_ptr<KeyCharacterMap> map2 = parcelShared(copy, &parcel2);
+    ASSERT_NE(nullptr, map1);
+    ASSERT_EQ(map1, map2);
+
+    struct stat stat1, stat2;
+    ASSERT_EQ(0, fstat(readSharedFd(&parcel1), &stat1));
+    ASSERT_EQ(0, fstat(readSharedFd(&parcel2), &stat2));
+    ASSERT_EQ(stat1.st_ino, stat2.st_ino);
+}
+
+TEST_F(InputDeviceKeyMapTest, SharedParcelsOfDifferentMapsDoNotShareInstance) {
+    std::string overlayPath = base::GetExecutableDirectory() + "/data/german.kcm";
+    base::Result<std::shared_ptr<KeyCharacterMap>> overlay =
+            KeyCharacterMap::load(overlayPath, KeyCharacterMap::Format::OVERLAY);
+    ASSERT_TRUE(overlay.ok()) << "Cannot load KeyCharacterMap at " << overlayPath;
+    KeyCharacterMap german(*mKeyMap.keyCharacterMap);
+    german.combine(**overlay);
+
+    Parcel parcel1, parcel2;
+    std::shared_ptr<KeyCharacterMap> map = parcelShared(*mKeyMap.keyCharacterMap, &parcel1);
+    std::shared_ptr<KeyCharacterMap> germanMap = parcelShared(german, &parcel2);
+    ASSERT_NE(nullptr, map);
+    ASSERT_NE(nullptr, germanMap);
+    ASSERT_NE(map, germanMap);
+    ASSERT_EQ(german, *germanMap);
+    assertSameLookups(german, *germanMap);
+}
+
+TEST_F(InputDeviceKeyMapTest, SharedParcelWithoutFdsWritesWholeMap) {
+    Parcel parcel;
+    parcel.pushAllowFds(false);
+    std::shared_ptr<KeyCharacterMap> map = parcelShared(*mKeyMap.keyCharacterMap, &parcel);
+    ASSERT_NE(nullptr, map);
+    ASSERT_EQ(*mKeyMap.keyCharacterMap, *map);
+    ASSERT_EQ(0u, parcel.objectsCount());
+}
+
+TEST(SharedKeyCharacterMapTest, OldestPublishedMapIsDroppedFirst) {
+    // One more map than the 64 published maps that are kept, each with its own character.
+    std::vector<std::shared_ptr<KeyCharacterMap>> maps;
+    for (int i = 0; i <= 64; i++) {
+        const std::string contents =
+                base::StringPrintf("type OVERLAY\nkey A {\n    base: '\\u%04x'\n}\n", 0x100 + i);
+        base::Result<std::shared_ptr<KeyCharacterMap>> map =
+                KeyCharacterMap::loadContents("overlay.kcm", contents.c_str(),
+                                              KeyCharacterMap::Format::OVERLAY);
+        ASSERT_TRUE(map.ok()) << map.error().message();
+        maps.push_back(*map);
+    }
+    const auto getInode = [](const KeyCharacterMap& map, Parcel* parcel) {
+        map.writeSharedToParcel(parcel);
+        struct stat st;
+        return fstat(readSharedFd(parcel), &st) == 0 ? st.st_ino : 0;
+    };
+
+    // The parcels keep the memfds open, so that their inodes are not reused.
+    std::vector<Parcel> parcels(maps.size() + 2);
+    const ino_t firstInode = getInode(*maps[0], &parcels[0]);
+    ASSERT_NE(0u, firstInode);
+    for (size_t i = 1; i < 64; i++) {
+        getInode(*maps[i], &parcels[i]);
+    }
+    // Publishing a map again does not make it newer.
+    ASSERT_EQ(firstInode, getInode(*maps[0], &parcels[64]));
+
+    // The 64th map published after the first one drops it.
+    getInode(*maps[64], &parcels[65]);
+    const ino_t republishedInode = getInode(*maps[0], &parcels[66]);
+    ASSERT_NE(0u, republishedInode);
+    ASSERT_NE(firstInode, republishedInode);
+}
+
+TEST_F(InputDeviceKeyMapTest, SharedParcelWithUnsealedMemfdIsRejected) {
+    // The contents of a sealed memfd, copied to one that is not sealed.
+    Parcel sharedParcel;
+    mKeyMap.keyCharacterMap->writeSharedToParcel(&sharedParcel);
+    int sharedFd = readSharedFd(&sharedParcel);
+    struct stat st;
+    ASSERT_EQ(0, fstat(sharedFd, &st));
+    std::string compiled(st.st_size, '\0');
+    ASSERT_TRUE(base::ReadFullyAtOffset(sharedFd, compiled.data(), compiled.size(), 0));
+    base::unique_fd fd(memfd_create("KeyCharacterMap", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    ASSERT_TRUE(fd.ok());
+    ASSERT_TRUE(base::WriteStringToFd(compiled, fd));
+
+    Parcel parcel;
+    parcel.writeCString(mKeyMap.keyCharacterMap->getLoadFileName().c_str());
+    parcel.writeInt32(static_cast<int32_t>(mKeyMap.keyCharacterMap->getKeyboardType()));
+    parcel.writeBool(false);
+    parcel.writeInt32(-1);
+    parcel.writeDupFileDescriptor(fd);
+    parcel.setDataPosition(0);
+    ASSERT_EQ(nullptr, KeyCharacterMap::readFromParcel(&parcel));
+}
+
 } // namespace android
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/file.h>
+#include <benchmark/benchmark.h>
+#include <binder/Parcel.h>
+#include <dirent.h>
+#include <input/KeyCharacterMap.h>
+#include <input/KeyLayoutMap.h>
+#include <input/Keyboard.h>
+#include <malloc.h>
+
+#include <string>
+#include <vector>
+
+namespace android {
+
+namespace {
+
+constexpr const char* KEY_LAYOUT_DIR = "/system/usr/keylayout";
+constexpr const char* KEY_CHARACTER_MAP_DIR = "/system/usr/keychars";
+
+std::vector<std::string> listFiles(const char* dir, const std::string& extension) {
+    std::vector<std::string> files;
+    std::unique_ptr<DIR, decltype(&closedir)> d(opendir(dir), closedir);
+    if (d == nullptr) {
+        return files;
+    }
+    while (dirent* entry = readdir(d.get())) {
+        std::string name = entry->d_name;
+        if (name.size() > extension.size() &&
+            name.compare(name.size() - extension.size(), extension.size(), extension) == 0) {
+            files.push_back(std::string(dir) + "/" + name);
+        }
+    }
+    return files;
+}
+
+base::Result<std::shared_ptr<KeyLayoutMap>> loadKeyLayout(const std::string& path) {
+    return KeyLayoutMap::load(path);
+}
+
+base::Result<std::shared_ptr<KeyCharacterMap>> loadKeyCharacterMap(const std::string& path) {
+    return KeyCharacterMap::load(path, KeyCharacterMap::Format::BASE);
+}
+
+// Returns the stock maps that load, so that the text and cached loads are run on the same maps.
+template <typename Load>
+std::vector<std::string> listStockMaps(const char* dir, const std::string& extension, Load load) {
+    std::vector<std::string> maps;
+    for (const std::string& path : listFiles(dir, extension)) {
+        if (load(path).ok()) {
+            maps.push_back(path);
+        }
+    }
+    return maps;
+}
+
+const std::vector<std::string>& getKeyLayouts() {
+    static std::vector<std::string> maps = listStockMaps(KEY_LAYOUT_DIR, ".kl", loadKeyLayout);
+    return maps;
+}
+
+const std::vector<std::string>& getKeyCharacterMaps() {
+    static std::vector<std::string> maps =
+            listStockMaps(KEY_CHARACTER_MAP_DIR, ".kcm", loadKeyCharacterMap);
+    return maps;
+}
+
+// Loads all the stock maps of the device once per iteration, parsing the text files when cached
+// is 0, or from a cache directory written before the first iteration.
+template <const std::vector<std::string>& (*getMaps)(), typename Load>
+void loadAll(benchmark::State& state, Load load) {
+    const std::vector<std::string>& maps = getMaps();
+    if (maps.empty()) {
+        state.SkipWithError("No stock maps found");
+        return;
+    }
+    TemporaryDir cacheDir;
+    if (state.range(0)) {
+        setKeyMapCacheDirectory(cacheDir.path);
+        for (const std::string& path : maps) {
+            load(path);
+        }
+    }
+    for (auto _ : state) {
+        for (const std::string& path : maps) {
+            benchmark::DoNotOptimize(load(path));
+        }
+    }
+    setKeyMapCacheDirectory("");
+    state.SetItemsProcessed(state.iterations() * maps.size());
+}
+
+void BM_KeyLayoutMapLoad(benchmark::State& state) {
+    loadAll<getKeyLayouts>(state, loadKeyLayout);
+}
+BENCHMARK(BM_KeyLayoutMapLoad)->ArgName("cached")->Arg(0)->Arg(1);
+
+void BM_KeyCharacterMapLoad(benchmark::State& state) {
+    loadAll<getKeyCharacterMaps>(state, loadKeyCharacterMap);
+}
+BENCHMARK(BM_KeyCharacterMapLoad)->ArgName("cached")->Arg(0)->Arg(1);
+
+// Reads a stock map from a parcel written with writeToParcel() when shared is 0, or with
+// writeSharedToParcel(), as an app does for each InputDevice it gets. Also reports the heap used
+// by the maps read, for an app holding MAPS_PER_PROCESS devices of the same keyboard.
+void BM_KeyCharacterMapReadFromParcel(benchmark::State& state) {
+    constexpr size_t MAPS_PER_PROCESS = 16;
+    const std::vector<std::string>& maps = getKeyCharacterMaps();
+    if (maps.empty()) {
+        state.SkipWithError("No stock maps found");
+        return;
+    }
+    base::Result<std::shared_ptr<KeyCharacterMap>> map = loadKeyCharacterMap(maps[0]);
+    const bool shared = state.range(0);
+    Parcel parcel;
+    if (shared) {
+        (*map)->writeSharedToParcel(&parcel);
+    } else {
+        (*map)->writeToParcel(&parcel);
+    }
+
+    std::vector<std::shared_ptr<KeyCharacterMap>> readMaps;
+    const size_t heapBefore = mallinfo().uordblks;
+    for (size_t i = 0; i < MAPS_PER_PROCESS; i++) {
+        parcel.setDataPosition(0);
+        readMaps.push_back(KeyCharacterMap::readFromParcel(&parcel));
+    }
+    const size_t heapAfter = mallinfo().uordblks;
+    readMaps.clear();
+
+    for (auto _ : state) {
+        parcel.setDataPosition(0);
+        benchmark::DoNotOptimize(KeyCharacterMap::readFromParcel(&parcel));
+    }
+    state.counters["parcel_bytes"] = parcel.dataSize();
+    state.counters["heap_bytes"] = heapAfter - heapBefore;
+}
+BENCHMARK(BM_KeyCharacterMapReadFromParcel)->ArgName("shared")->Arg(0)->Arg(1);
+
+} // namespace
+
+} // namespace android
+
+BENCHMARK_MAIN();
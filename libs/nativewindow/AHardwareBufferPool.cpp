@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "AHardwareBufferPool"
+
+#include <vndk/hardware_buffer.h>
+
+#include <algorithm>
+
+#include <ui/GraphicBuffer.h>
+
+#include <private/android/AHardwareBufferHelpers.h>
+#include <private/android/AHardwareBufferPool.h>
+
+using namespace android;
+
+namespace {
+
+bool isSameDescription(const AHardwareBuffer_Desc& a, const AHardwareBuffer_Desc& b) {
+    return a.width == b.width && a.height == b.height && a.layers == b.layers &&
+            a.format == b.format && a.usage == b.usage;
+}
+
+status_t allocateGraphicBuffer(const AHardwareBuffer_Desc& desc, sp<GraphicBuffer>* outBuffer) {
+    AHardwareBuffer* buffer = nullptr;
+    int err = AHardwareBuffer_allocate(&desc, &buffer);
+    if (err != NO_ERROR) {
+        return err;
+    }
+    *outBuffer = AHardwareBuffer_to_GraphicBuffer(buffer);
+    AHardwareBuffer_release(buffer);
+    return NO_ERROR;
+}
+
+} // namespace
+
+// ----------------------------------------------------------------------------
+// Public functions
+// ----------------------------------------------------------------------------
+
+AHardwareBuffer_Pool* AHardwareBuffer_Pool_create(uint64_t maxFreeBytes) {
+    return reinterpret_cast<AHardwareBuffer_Pool*>(new AHardwareBufferPool(maxFreeBytes));
+}
+
+void AHardwareBuffer_Pool_destroy(AHardwareBuffer_Pool* pool) {
+    delete reinterpret_cast<AHardwareBufferPool*>(pool);
+}
+
+int AHardwareBuffer_Pool_allocate(AHardwareBuffer_Pool* pool, const AHardwareBuffer_Desc* desc,
+                                  AHardwareBuffer** outBuffer) {
+    if (!pool) return BAD_VALUE;
+    return reinterpret_cast<AHardwareBufferPool*>(pool)->allocate(desc, outBuffer);
+}
+
+void AHardwareBuffer_Pool_recycle(AHardwareBuffer_Pool* pool, AHardwareBuffer* buffer) {
+    if (!pool) {
+        if (buffer) AHardwareBuffer_release(buffer);
+        return;
+    }
+    reinterpret_cast<AHardwareBufferPool*>(pool)->recycle(buffer);
+}
+
+void AHardwareBuffer_Pool_trim(AHardwareBuffer_Pool* pool, uint64_t maxFreeBytes) {
+    if (!pool) return;
+    reinterpret_cast<AHardwareBufferPool*>(pool)->trim(maxFreeBytes);
+}
+
+// ----------------------------------------------------------------------------
+// Helpers
+// ----------------------------------------------------------------------------
+
+namespace android {
+
+AHardwareBufferPool::AHardwareBufferPool(uint64_t maxFreeBytes, Allocator allocator)
+      : mMaxFreeBytes(maxFreeBytes),
+        mAllocator(allocator ? std::move(allocator) : allocateGraphicBuffer) {}
+
+AHardwareBufferPool::~AHardwareBufferPool() = default;
+
+int AHardwareBufferPool::allocate(const AHardwareBuffer_Desc* desc, AHardwareBuffer** outBuffer) {
+    if (!outBuffer || !desc) return BAD_VALUE;
+    if (!AHardwareBuffer_isValidDescription(desc, /*log=*/true)) return BAD_VALUE;
+
+    sp<GraphicBuffer> buffer;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        // The most recently recycled buffer is the most likely to still be in the caches.
+        for (auto it = mFreeBuffers.rbegin(); it != mFreeBuffers.rend(); ++it) {
+            if (isSameDescription(it->desc, *desc)) {
+                buffer = std::move(it->buffer);
+                mFreeBytes -= it->bytes;
+                mFreeBuffers.erase(std::next(it).base());
+                break;
+            }
+        }
+        if (buffer != nullptr) {
+            mHitCount++;
+        } else {
+            mMissCount++;
+        }
+    }
+
+    if (buffer == nullptr) {
+        status_t err = mAllocator(*desc, &buffer);
+        if (err != NO_ERROR) return err;
+    }
+    *outBuffer = AHardwareBuffer_from_GraphicBuffer(buffer.get());
+    // Ensure the buffer doesn't get destroyed when the sp<> goes away.
+    AHardwareBuffer_acquire(*outBuffer);
+    return NO_ERROR;
+}
+
+void AHardwareBufferPool::recycle(AHardwareBuffer* buffer) {
+    if (!buffer) return;
+
+    FreeBuffer freeBuffer;
+    AHardwareBuffer_describe(buffer, &freeBuffer.desc);
+    sp<GraphicBuffer> graphicBuffer = AHardwareBuffer_to_GraphicBuffer(buffer);
+    AHardwareBuffer_release(buffer);
+    // A buffer still referenced elsewhere could be written while it is reused.
+    if (graphicBuffer->getStrongCount() != 1) return;
+
+    freeBuffer.bytes = getBufferBytes(*graphicBuffer);
+    freeBuffer.buffer = std::move(graphicBuffer);
+
+    std::list<FreeBuffer> freed;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFreeBytes += freeBuffer.bytes;
+        mFreeBuffers.push_back(std::move(freeBuffer));
+        trimLocked(mMaxFreeBytes, &freed);
+    }
+    // The freed buffers are destroyed once unlocked.
+}
+
+void AHardwareBufferPool::trim(uint64_t maxFreeBytes) {
+    // Declared before the lock, so that the freed buffers are destroyed once unlocked.
+    std::list<FreeBuffer> freed;
+    std::lock_guard<std::mutex> lock(mMutex);
+    trimLocked(maxFreeBytes, &freed);
+}
+
+void AHardwareBufferPool::trimLocked(uint64_t maxFreeBytes, std::list<FreeBuffer>* outFreed) {
+    while (mFreeBytes > maxFreeBytes) {
+        mFreeBytes -= mFreeBuffers.front().bytes;
+        outFreed->splice(outFreed->end(), mFreeBuffers, mFreeBuffers.begin());
+    }
+}
+
+size_t AHardwareBufferPool::getFreeBufferCount() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mFreeBuffers.size();
+}
+
+uint64_t AHardwareBufferPool::getFreeBytes() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mFreeBytes;
+}
+
+uint64_t AHardwareBufferPool::getHitCount() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHitCount;
+}
+
+uint64_t AHardwareBufferPool::getMissCount() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMissCount;
+}
+
+uint64_t AHardwareBufferPool::getBufferBytes(const GraphicBuffer& buffer) {
+    const uint32_t format =
+            AHardwareBuffer_convertFromPixelFormat(uint32_t(buffer.getPixelFormat()));
+    const uint64_t stride = std::max(buffer.getStride(), buffer.getWidth());
+    const uint64_t pixels = stride * buffer.getHeight() * buffer.getLayerCount();
+    if (format == AHARDWAREBUFFER_FORMAT_BLOB) {
+        return buffer.getWidth();
+    }
+    if (AHardwareBuffer_formatIsYuv(format)) {
+        // 4:2:0 subsampling, with 16 bit samples for P010.
+        return pixels * 3 / 2 * (format == AHARDWAREBUFFER_FORMAT_YCbCr_P010 ? 2 : 1);
+    }
+    const uint32_t bytesPerPixel = AHardwareBuffer_bytesPerPixel(format);
+    // Assume 4 bytes for the formats of unknown size, such as the implementation defined one.
+    return pixels * (bytesPerPixel != 0 ? bytesPerPixel : 4);
+}
+
+} // namespace android
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_PRIVATE_NATIVE_AHARDWARE_BUFFER_POOL_H
+#define ANDROID_PRIVATE_NATIVE_AHARDWARE_BUFFER_POOL_H
+
+/*
+ * This file contains the implementation of AHardwareBuffer_Pool.
+ *
+ * These are PRIVATE methods, so this file can NEVER appear in a public NDK
+ * header. The allocator can be replaced by tests.
+ */
+
+#include <android/hardware_buffer.h>
+#include <utils/Errors.h>
+#include <utils/StrongPointer.h>
+
+#include <functional>
+#include <list>
+#include <mutex>
+
+namespace android {
+
+class GraphicBuffer;
+
+// Recycles the buffers of the same description, so that pipelines that keep allocating and
+// releasing the same kind of buffers only go to the allocator when the pool has none left.
+class AHardwareBufferPool {
+public:
+    using Allocator =
+            std::function<status_t(const AHardwareBuffer_Desc& desc, sp<GraphicBuffer>* outBuffer)>;
+
+    // Keeps at most maxFreeBytes of recycled buffers. Uses AHardwareBuffer_allocate() when no
+    // allocator is given.
+    explicit AHardwareBufferPool(uint64_t maxFreeBytes, Allocator allocator = nullptr);
+    ~AHardwareBufferPool();
+
+    // Returns a recycled buffer of the same description, or a new one.
+    int allocate(const AHardwareBuffer_Desc* desc, AHardwareBuffer** outBuffer);
+    // Releases the reference of the caller to a buffer allocated from this pool, and keeps the
+    // buffer for the next allocation if nothing else references it.
+    void recycle(AHardwareBuffer* buffer);
+    // Frees the least recently recycled buffers until at most maxFreeBytes are kept.
+    void trim(uint64_t maxFreeBytes);
+
+    size_t getFreeBufferCount() const;
+    uint64_t getFreeBytes() const;
+    // The number of allocations that were given a recycled buffer, and the other ones.
+    uint64_t getHitCount() const;
+    uint64_t getMissCount() const;
+
+    // Estimated memory used by a buffer, used to apply the byte limit.
+    static uint64_t getBufferBytes(const GraphicBuffer& buffer);
+
+private:
+    struct FreeBuffer {
+        AHardwareBuffer_Desc desc;
+        sp<GraphicBuffer> buffer;
+        uint64_t bytes;
+    };
+
+    const uint64_t mMaxFreeBytes;
+    const Allocator mAllocator;
+
+    mutable std::mutex mMutex;
+    // Least recently recycled first.
+    std::list<FreeBuffer> mFreeBuffers;
+    uint64_t mFreeBytes = 0;
+    uint64_t mHitCount = 0;
+    uint64_t mMissCount = 0;
+
+    void trimLocked(uint64_t maxFreeBytes, std::list<FreeBuffer>* outFreed);
+};
+
+} // namespace android
+
+#endif // ANDROID_PRIVATE_NATIVE_AHARDWARE_BUFFER_POOL_H
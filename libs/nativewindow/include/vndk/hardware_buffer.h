@@ -59,6 +59,61 @@ int AHardwareBuffer_createFromHandle(const AHardwareBuffer_Desc* _Nonnull desc,
                                      const native_handle_t* _Nonnull handle, int32_t method,
                                      AHardwareBuffer* _Nullable* _Nonnull outBuffer);
 
+/**
+ * A pool of hardware buffers, recycled by description.
+ */
+typedef struct AHardwareBuffer_Pool AHardwareBuffer_Pool;
+
+/**
+ * Create a pool that recycles the buffers of the same description.
+ *
+ * Pipelines that keep allocating and releasing buffers of the same width, height, layers, format
+ * and usage can allocate them from a pool and recycle them into it instead of releasing them, so
+ * that only the first allocations go to the allocator.
+ *
+ * The pool keeps up to \a maxFreeBytes of recycled buffers, freeing the least recently recycled
+ * ones first. The pool is thread safe.
+ *
+ * \return the new pool, to be destroyed with AHardwareBuffer_Pool_destroy().
+ */
+AHardwareBuffer_Pool* _Nonnull AHardwareBuffer_Pool_create(uint64_t maxFreeBytes);
+
+/**
+ * Destroy a pool and free its recycled buffers.
+ *
+ * The buffers allocated from the pool remain valid, and must then be released with
+ * AHardwareBuffer_release().
+ */
+void AHardwareBuffer_Pool_destroy(AHardwareBuffer_Pool* _Nullable pool);
+
+/**
+ * Allocate a buffer from a pool.
+ *
+ * Returns a recycled buffer that matches \a desc if the pool has one, and allocates a new one
+ * like AHardwareBuffer_allocate() otherwise. The contents of recycled buffers are undefined.
+ *
+ * \return 0 on success, or an error number if the allocation fails for any reason.
+ */
+int AHardwareBuffer_Pool_allocate(AHardwareBuffer_Pool* _Nonnull pool,
+                                  const AHardwareBuffer_Desc* _Nonnull desc,
+                                  AHardwareBuffer* _Nullable* _Nonnull outBuffer);
+
+/**
+ * Give a buffer allocated from a pool back to it.
+ *
+ * Releases the reference of the caller to \a buffer. The pool keeps the buffer for the next
+ * allocations only if it is not referenced anywhere else in the process. Buffers that were shared
+ * with other processes must not be recycled while those still use them.
+ */
+void AHardwareBuffer_Pool_recycle(AHardwareBuffer_Pool* _Nonnull pool,
+                                  AHardwareBuffer* _Nonnull buffer);
+
+/**
+ * Free the least recently recycled buffers of a pool until it keeps at most \a maxFreeBytes,
+ * for instance with 0 when the process is asked to trim its memory.
+ */
+void AHardwareBuffer_Pool_trim(AHardwareBuffer_Pool* _Nonnull pool, uint64_t maxFreeBytes);
+
 /**
  * Buffer pixel formats.
  */
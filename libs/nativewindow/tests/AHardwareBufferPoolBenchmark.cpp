@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android/hardware_buffer.h>
+#include <benchmark/benchmark.h>
+#include <vndk/hardware_buffer.h>
+
+#include <vector>
+
+namespace {
+
+// Buffers of state.range(0) x state.range(0) pixels, state.range(1) of which are in flight at
+// the same time, like the frames of a media or ML pipeline.
+AHardwareBuffer_Desc getDesc(const benchmark::State& state) {
+    AHardwareBuffer_Desc desc = {};
+    desc.width = state.range(0);
+    desc.height = state.range(0);
+    desc.layers = 1;
+    desc.format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM;
+    desc.usage = AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN;
+    return desc;
+}
+
+void BM_Allocate(benchmark::State& state) {
+    const AHardwareBuffer_Desc desc = getDesc(state);
+    std::vector<AHardwareBuffer*> buffers(state.range(1));
+    for (auto _ : state) {
+        for (AHardwareBuffer*& buffer : buffers) {
+            if (AHardwareBuffer_allocate(&desc, &buffer) != 0) {
+                state.SkipWithError("AHardwareBuffer_allocate failed");
+                return;
+            }
+        }
+        for (AHardwareBuffer* buffer : buffers) {
+            AHardwareBuffer_release(buffer);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * buffers.size());
+}
+BENCHMARK(BM_Allocate)->Args({256, 1})->Args({1920, 1})->Args({1920, 4});
+
+void BM_PoolAllocate(benchmark::State& state) {
+    const AHardwareBuffer_Desc desc = getDesc(state);
+    AHardwareBuffer_Pool* pool = AHardwareBuffer_Pool_create(256 * 1024 * 1024);
+    std::vector<AHardwareBuffer*> buffers(state.range(1));
+    for (auto _ : state) {
+        for (AHardwareBuffer*& buffer : buffers) {
+            if (AHardwareBuffer_Pool_allocate(pool, &desc, &buffer) != 0) {
+                state.SkipWithError("AHardwareBuffer_Pool_allocate failed");
+                AHardwareBuffer_Pool_destroy(pool);
+                return;
+            }
+        }
+        for (AHardwareBuffer* buffer : buffers) {
+            AHardwareBuffer_Pool_recycle(pool, buffer);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * buffers.size());
+    AHardwareBuffer_Pool_destroy(pool);
+}
+BENCHMARK(BM_PoolAllocate)->Args({256, 1})->Args({1920, 1})->Args({1920, 4});
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "AHardwareBufferPool_test"
+//#define LOG_NDEBUG 0
+
+#include <gtest/gtest.h>
+#include <private/android/AHardwareBufferHelpers.h>
+#include <private/android/AHardwareBufferPool.h>
+#include <ui/GraphicBuffer.h>
+#include <vndk/hardware_buffer.h>
+
+using namespace android;
+
+// Makes buffers without gralloc, so that the pool can be tested on any device.
+class FakeAllocator {
+public:
+    AHardwareBufferPool::Allocator get() {
+        return [this](const AHardwareBuffer_Desc& desc, sp<GraphicBuffer>* outBuffer) {
+            if (fail) return NO_MEMORY;
+            sp<GraphicBuffer> buffer = new GraphicBuffer();
+            buffer->width = desc.width;
+            buffer->height = desc.height;
+            buffer->stride = desc.width;
+            buffer->format = desc.format;
+            buffer->layerCount = desc.layers;
+            buffer->usage = desc.usage;
+            *outBuffer = buffer;
+            allocations++;
+            return NO_ERROR;
+        };
+    }
+
+    size_t allocations = 0;
+    bool fail = false;
+};
+
+static AHardwareBuffer_Desc rgbaDesc(uint32_t width, uint32_t height) {
+    AHardwareBuffer_Desc desc = {};
+    desc.width = width;
+    desc.height = height;
+    desc.layers = 1;
+    desc.format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM;
+    desc.usage = AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN;
+    return desc;
+}
+
+class AHardwareBufferPoolTest : public testing::Test {
+protected:
+    static constexpr uint64_t MAX_FREE_BYTES = 4 * 64 * 64 * 4;
+
+    FakeAllocator mAllocator;
+    AHardwareBufferPool mPool{MAX_FREE_BYTES, mAllocator.get()};
+
+    AHardwareBuffer* allocate(const AHardwareBuffer_Desc& desc) {
+        AHardwareBuffer* buffer = nullptr;
+        EXPECT_EQ(NO_ERROR, mPool.allocate(&desc, &buffer));
+        return buffer;
+    }
+};
+
+TEST_F(AHardwareBufferPoolTest, RecycledBufferIsReused) {
+    const AHardwareBuffer_Desc desc = rgbaDesc(64, 64);
+    AHardwareBuffer* buffer = allocate(desc);
+    ASSERT_NE(nullptr, buffer);
+    uint64_t id;
+    ASSERT_EQ(NO_ERROR, AHardwareBuffer_getId(buffer, &id));
+    mPool.recycle(buffer);
+    ASSERT_EQ(1u, mPool.getFreeBufferCount());
+    ASSERT_EQ(64u * 64 * 4, mPool.getFreeBytes());
+
+    AHardwareBuffer* reused = allocate(desc);
+    uint64_t reusedId;
+    ASSERT_EQ(NO_ERROR, AHardwareBuffer_getId(reused, &reusedId));
+    EXPECT_EQ(id, reusedId);
+    EXPECT_EQ(1u, mAllocator.allocations);
+    EXPECT_EQ(1u, mPool.getHitCount());
+    EXPECT_EQ(1u, mPool.getMissCount());
+    EXPECT_EQ(0u, mPool.getFreeBufferCount());
+    EXPECT_EQ(0u, mPool.getFreeBytes());
+    AHardwareBuffer_release(reused);
+}
+
+TEST_F(AHardwareBufferPoolTest, DifferentDescriptionsAreNotReused) {
+    AHardwareBuffer_Desc other = rgbaDesc(64, 64);
+    other.usage |= AHARDWAREBUFFER_USAGE_GPU_COLOR_OUTPUT;
+    mPool.recycle(allocate(rgbaDesc(64, 64)));
+    mPool.recycle(allocate(rgbaDesc(32, 64)));
+
+    AHardwareBuffer* buffer = allocate(other);
+    EXPECT_EQ(3u, mAllocator.allocations);
+    AHardwareBuffer_Desc desc;
+    AHardwareBuffer_describe(buffer, &desc);
+    EXPECT_EQ(other.usage, desc.usage);
+    EXPECT_EQ(2u, mPool.getFreeBufferCount());
+    AHardwareBuffer_release(buffer);
+}
+
+TEST_F(AHardwareBufferPoolTest, BufferStillReferencedIsNotKept) {
+    AHardwareBuffer* buffer = allocate(rgbaDesc(64, 64));
+    AHardwareBuffer_acquire(buffer);
+    mPool.recycle(buffer);
+    EXPECT_EQ(0u, mPool.getFreeBufferCount());
+
+    // The other reference is still valid.
+    AHardwareBuffer_Desc desc;
+    AHardwareBuffer_describe(buffer, &desc);
+    EXPECT_EQ(64u, desc.width);
+    AHardwareBuffer_release(buffer);
+}
+
+TEST_F(AHardwareBufferPoolTest, ByteCapFreesLeastRecentlyRecycled) {
+    std::vector<AHardwareBuffer*> buffers;
+    std::vector<uint64_t> ids;
+    for (int i = 0; i < 6; i++) {
+        buffers.push_back(allocate(rgbaDesc(64, 64)));
+        uint64_t id;
+        ASSERT_EQ(NO_ERROR, AHardwareBuffer_getId(buffers.back(), &id));
+        ids.push_back(id);
+    }
+    for (AHardwareBuffer* buffer : buffers) {
+        mPool.recycle(buffer);
+        ASSERT_LE(mPool.getFreeBytes(), MAX_FREE_BYTES);
+    }
+    ASSERT_EQ(4u, mPool.getFreeBufferCount());
+
+    // The most recently recycled buffers are kept, and reused first.
+    for (int i = 5; i >= 2; i--) {
+        AHardwareBuffer* buffer = allocate(rgbaDesc(64, 64));
+        uint64_t id;
+        ASSERT_EQ(NO_ERROR, AHardwareBuffer_getId(buffer, &id));
+        EXPECT_EQ(ids[i], id);
+        AHardwareBuffer_release(buffer);
+    }
+    EXPECT_EQ(6u, mAllocator.allocations);
+}
+
+TEST_F(AHardwareBufferPoolTest, BufferLargerThanCapIsNotKept) {
+    mPool.recycle(allocate(rgbaDesc(256, 256)));
+    EXPECT_EQ(0u, mPool.getFreeBufferCount());
+    EXPECT_EQ(0u, mPool.getFreeBytes());
+}
+
+TEST_F(AHardwareBufferPoolTest, Trim) {
+    mPool.recycle(allocate(rgbaDesc(64, 64)));
+    mPool.recycle(allocate(rgbaDesc(32, 32)));
+    mPool.trim(32 * 32 * 4);
+    EXPECT_EQ(1u, mPool.getFreeBufferCount());
+    EXPECT_EQ(32u * 32 * 4, mPool.getFreeBytes());
+
+    mPool.trim(0);
+    EXPECT_EQ(0u, mPool.getFreeBufferCount());
+    EXPECT_EQ(0u, mPool.getFreeBytes());
+}
+
+TEST_F(AHardwareBufferPoolTest, InvalidArgumentsAndAllocationFailures) {
+    AHardwareBuffer_Desc desc = rgbaDesc(64, 64);
+    AHardwareBuffer* buffer = nullptr;
+    EXPECT_EQ(BAD_VALUE, mPool.allocate(nullptr, &buffer));
+    EXPECT_EQ(BAD_VALUE, mPool.allocate(&desc, nullptr));
+    desc.rfu0 = 1;
+    EXPECT_EQ(BAD_VALUE, mPool.allocate(&desc, &buffer));
+
+    desc.rfu0 = 0;
+    mAllocator.fail = true;
+    EXPECT_EQ(NO_MEMORY, mPool.allocate(&desc, &buffer));
+    EXPECT_EQ(nullptr, buffer);
+}
+
+TEST(AHardwareBufferPoolBytesTest, EstimatesBufferBytes) {
+    sp<GraphicBuffer> buffer = new GraphicBuffer();
+    buffer->width = 100;
+    buffer->height = 10;
+    buffer->stride = 128;
+    buffer->layerCount = 2;
+    buffer->format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM;
+    EXPECT_EQ(128u * 10 * 2 * 4, AHardwareBufferPool::getBufferBytes(*buffer));
+    buffer->format = AHARDWAREBUFFER_FORMAT_R16G16B16A16_FLOAT;
+    EXPECT_EQ(128u * 10 * 2 * 8, AHardwareBufferPool::getBufferBytes(*buffer));
+
+    buffer->layerCount = 1;
+    buffer->format = AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420;
+    EXPECT_EQ(128u * 10 * 3 / 2, AHardwareBufferPool::getBufferBytes(*buffer));
+
+    buffer->width = 4096;
+    buffer->height = 1;
+    buffer->stride = 4096;
+    buffer->format = AHARDWAREBUFFER_FORMAT_BLOB;
+    EXPECT_EQ(4096u, AHardwareBufferPool::getBufferBytes(*buffer));
+}
+
+TEST(AHardwareBufferPoolApiTest, AllocateRecycleAndTrim) {
+    AHardwareBuffer_Desc desc = rgbaDesc(64, 64);
+    if (!AHardwareBuffer_isSupported(&desc)) {
+        GTEST_SKIP() << "RGBA_8888 GPU buffers are not supported";
+    }
+    AHardwareBuffer_Pool* pool = AHardwareBuffer_Pool_create(1024 * 1024);
+    ASSERT_NE(nullptr, pool);
+    AHardwareBuffer* buffer = nullptr;
+    ASSERT_EQ(NO_ERROR, AHardwareBuffer_Pool_allocate(pool, &desc, &buffer));
+    uint64_t id;
+    ASSERT_EQ(NO_ERROR, AHardwareBuffer_getId(buffer, &id));
+    AHardwareBuffer_Pool_recycle(pool, buffer);
+
+    ASSERT_EQ(NO_ERROR, AHardwareBuffer_Pool_allocate(pool, &desc, &buffer));
+    uint64_t reusedId;
+    ASSERT_EQ(NO_ERROR, AHardwareBuffer_getId(buffer, &reusedId));
+    EXPECT_EQ(id, reusedId);
+    AHardwareBuffer_Pool_recycle(pool, buffer);
+
+    AHardwareBuffer_Pool_trim(pool, 0);
+    ASSERT_EQ(NO_ERROR, AHardwareBuffer_Pool_allocate(pool, &desc, &buffer));
+    ASSERT_EQ(NO_ERROR, AHardwareBuffer_getId(buffer, &reusedId));
+    EXPECT_NE(id, reusedId);
+    AHardwareBuffer_Pool_destroy(pool);
+    AHardwareBuffer_release(buffer);
+}
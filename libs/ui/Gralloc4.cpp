@@ -150,6 +150,85 @@ static inline status_t sBufferDescriptorInfo(std::string name, uint32_t width, u
     return validateBufferDescriptorInfo(outDescriptorInfo);
 }
 
+// Gets metadata from the mapper and decodes it within the callback, instead of copying the encoded
+// metadata out of it first.
+template <class T>
+Error getAndDecode(IMapper& mapper, buffer_handle_t bufferHandle, const MetadataType& metadataType,
+                   status_t (*decodeFunction)(const hidl_vec<uint8_t>&, T*), T* outMetadata,
+                   status_t* outDecodeStatus) {
+    Error error = kTransactionError;
+    auto ret = mapper.get(const_cast<native_handle_t*>(bufferHandle), metadataType,
+                          [&](const auto& tmpError, const hidl_vec<uint8_t>& tmpVec) {
+                              error = tmpError;
+                              if (error == Error::NONE) {
+                                  *outDecodeStatus = decodeFunction(tmpVec, outMetadata);
+                              }
+                          });
+
+    return ret.isOk() ? error : kTransactionError;
+}
+
+const MetadataDump* findMetadataDump(const BufferDump& bufferDump,
+                                     StandardMetadataType metadataType) {
+    const auto& metadataDump = bufferDump.metadataDump;
+    const auto itr = std::find_if(metadataDump.begin(), metadataDump.end(),
+                                  [&](const MetadataDump& tmpMetadataDump) {
+                                      if (!gralloc4::isStandardMetadataType(
+                                                  tmpMetadataDump.metadataType)) {
+                                          return false;
+                                      }
+                                      return metadataType ==
+                                              gralloc4::getStandardMetadataTypeValue(
+                                                      tmpMetadataDump.metadataType);
+                                  });
+    return itr == metadataDump.end() ? nullptr : &*itr;
+}
+
+// Decodes metadata from a buffer dump, leaving outMetadata unchanged if the buffer does not have it.
+template <class T>
+status_t decodeDumpIfPresent(const BufferDump& bufferDump, StandardMetadataType metadataType,
+                             status_t (*decodeFunction)(const hidl_vec<uint8_t>&, T*),
+                             T* outMetadata) {
+    const MetadataDump* metadataDump = findMetadataDump(bufferDump, metadataType);
+    return metadataDump ? decodeFunction(metadataDump->metadata, outMetadata) : NO_ERROR;
+}
+
+// Decodes the metadata of a buffer dump which its producer may change from frame to frame.
+status_t decodeFrameMetadata(const BufferDump& bufferDump, ui::FrameMetadata* outFrameMetadata) {
+    ui::FrameMetadata metadata;
+    AidlDataspace dataspace = AidlDataspace::UNKNOWN;
+    if (status_t error = decodeDumpIfPresent(bufferDump, StandardMetadataType::DATASPACE,
+                                             gralloc4::decodeDataspace, &dataspace);
+        error != NO_ERROR) {
+        return error;
+    }
+    metadata.dataspace = static_cast<ui::Dataspace>(dataspace);
+
+    if (status_t error = decodeDumpIfPresent(bufferDump, StandardMetadataType::CROP,
+                                             gralloc4::decodeCrop, &metadata.crop);
+        error != NO_ERROR) {
+        return error;
+    }
+    if (status_t error = decodeDumpIfPresent(bufferDump, StandardMetadataType::BLEND_MODE,
+                                             gralloc4::decodeBlendMode, &metadata.blendMode);
+        error != NO_ERROR) {
+        return error;
+    }
+    if (status_t error = decodeDumpIfPresent(bufferDump, StandardMetadataType::SMPTE2086,
+                                             gralloc4::decodeSmpte2086, &metadata.smpte2086);
+        error != NO_ERROR) {
+        return error;
+    }
+    if (status_t error = decodeDumpIfPresent(bufferDump, StandardMetadataType::CTA861_3,
+                                             gralloc4::decodeCta861_3, &metadata.cta861_3);
+        error != NO_ERROR) {
+        return error;
+    }
+
+    *outFrameMetadata = std::move(metadata);
+    return NO_ERROR;
+}
+
 } // anonymous namespace
 
 void Gralloc4Mapper::preload() {
@@ -167,6 +246,8 @@ Gralloc4Mapper::Gralloc4Mapper() {
     }
 }
 
+Gralloc4Mapper::Gralloc4Mapper(sp<IMapper> mapper) : mMapper(std::move(mapper)) {}
+
 bool Gralloc4Mapper::isLoaded() const {
     return mMapper != nullptr;
 }
@@ -207,10 +288,17 @@ status_t Gralloc4Mapper::importBuffer(const hardware::hidl_handle& rawHandle,
         *outBufferHandle = static_cast<buffer_handle_t>(tmpBuffer);
     });
 
+    if (ret.isOk() && error == Error::NONE) {
+        // Drop any entry left by a buffer that was freed without freeBuffer at the same address.
+        invalidateCache(*outBufferHandle);
+    }
+
     return static_cast<status_t>((ret.isOk()) ? error : kTransactionError);
 }
 
 void Gralloc4Mapper::freeBuffer(buffer_handle_t bufferHandle) const {
+    invalidateCache(bufferHandle);
+
     auto buffer = const_cast<native_handle_t*>(bufferHandle);
     auto ret = mMapper->freeBuffer(buffer);
 
@@ -504,17 +592,10 @@ status_t Gralloc4Mapper::get(buffer_handle_t bufferHandle, const MetadataType& m
         return BAD_VALUE;
     }
 
-    hidl_vec<uint8_t> vec;
-    Error error;
-    auto ret = mMapper->get(const_cast<native_handle_t*>(bufferHandle), metadataType,
-                            [&](const auto& tmpError, const hidl_vec<uint8_t>& tmpVec) {
-                                error = tmpError;
-                                vec = tmpVec;
-                            });
-
-    if (!ret.isOk()) {
-        error = kTransactionError;
-    }
+    status_t decodeStatus = NO_ERROR;
+    const Error error =
+            getAndDecode(*mMapper, bufferHandle, metadataType, decodeFunction, outMetadata,
+                         &decodeStatus);
 
     if (error != Error::NONE) {
         ALOGE("get(%s, %" PRIu64 ", ...) failed with %d", metadataType.name.c_str(),
@@ -522,7 +603,78 @@ status_t Gralloc4Mapper::get(buffer_handle_t bufferHandle, const MetadataType& m
         return static_cast<status_t>(error);
     }
 
-    return decodeFunction(vec, outMetadata);
+    return decodeStatus;
+}
+
+template <class T>
+status_t Gralloc4Mapper::getIfSupported(buffer_handle_t bufferHandle,
+                                        const MetadataType& metadataType,
+                                        DecodeFunction<T> decodeFunction, T* outMetadata) const {
+    status_t decodeStatus = NO_ERROR;
+    const Error error =
+            getAndDecode(*mMapper, bufferHandle, metadataType, decodeFunction, outMetadata,
+                         &decodeStatus);
+
+    switch (error) {
+        case Error::NONE:
+            return decodeStatus;
+        case Error::UNSUPPORTED:
+            return NO_ERROR;
+        default:
+            ALOGE("get(%s, %" PRIu64 ", ...) failed with %d", metadataType.name.c_str(),
+                  metadataType.value, error);
+            return static_cast<status_t>(error);
+    }
+}
+
+template <class T>
+status_t Gralloc4Mapper::getImmutable(buffer_handle_t bufferHandle,
+                                      const MetadataType& metadataType,
+                                      DecodeFunction<T> decodeFunction,
+                                      std::optional<T> ImmutableMetadata::*field,
+                                      T* outMetadata) const {
+    if (!outMetadata) {
+        return BAD_VALUE;
+    }
+
+    {
+        std::lock_guard lock(mCacheMutex);
+        if (const auto it = mCache.find(bufferHandle); it != mCache.end()) {
+            mCacheEntries.splice(mCacheEntries.begin(), mCacheEntries, it->second);
+            if (const auto& metadata = it->second->second.*field; metadata.has_value()) {
+                *outMetadata = *metadata;
+                return NO_ERROR;
+            }
+        }
+    }
+
+    if (const status_t error = get(bufferHandle, metadataType, decodeFunction, outMetadata);
+        error != NO_ERROR) {
+        return error;
+    }
+
+    std::lock_guard lock(mCacheMutex);
+    auto it = mCache.find(bufferHandle);
+    if (it == mCache.end()) {
+        if (mCache.size() >= kMaxCachedBuffers) {
+            // Entries of buffers freed without freeBuffer are never dropped, so bound the cache by
+            // evicting the least recently used buffer.
+            mCache.erase(mCacheEntries.back().first);
+            mCacheEntries.pop_back();
+        }
+        mCacheEntries.emplace_front(bufferHandle, ImmutableMetadata{});
+        it = mCache.emplace(bufferHandle, mCacheEntries.begin()).first;
+    }
+    it->second->second.*field = *outMetadata;
+    return NO_ERROR;
+}
+
+void Gralloc4Mapper::invalidateCache(buffer_handle_t bufferHandle) const {
+    std::lock_guard lock(mCacheMutex);
+    if (const auto it = mCache.find(bufferHandle); it != mCache.end()) {
+        mCacheEntries.erase(it->second);
+        mCache.erase(it);
+    }
 }
 
 template <class T>
@@ -533,7 +685,7 @@ status_t Gralloc4Mapper::set(buffer_handle_t bufferHandle, const MetadataType& m
         ALOGE("Encoding metadata(%s) failed with %d", metadataType.name.c_str(), status);
         return status;
     }
-    hidl_vec<uint8_t> vec;
+    invalidateCache(bufferHandle);
     auto ret =
             mMapper->set(const_cast<native_handle_t*>(bufferHandle), metadataType, encodedMetadata);
 
@@ -557,54 +709,62 @@ status_t Gralloc4Mapper::set(buffer_handle_t bufferHandle, const MetadataType& m
 }
 
 status_t Gralloc4Mapper::getBufferId(buffer_handle_t bufferHandle, uint64_t* outBufferId) const {
-    return get(bufferHandle, gralloc4::MetadataType_BufferId, gralloc4::decodeBufferId,
-               outBufferId);
+    return getImmutable(bufferHandle, gralloc4::MetadataType_BufferId, gralloc4::decodeBufferId,
+                        &ImmutableMetadata::bufferId, outBufferId);
 }
 
 status_t Gralloc4Mapper::getName(buffer_handle_t bufferHandle, std::string* outName) const {
-    return get(bufferHandle, gralloc4::MetadataType_Name, gralloc4::decodeName, outName);
+    return getImmutable(bufferHandle, gralloc4::MetadataType_Name, gralloc4::decodeName,
+                        &ImmutableMetadata::name, outName);
 }
 
 status_t Gralloc4Mapper::getWidth(buffer_handle_t bufferHandle, uint64_t* outWidth) const {
-    return get(bufferHandle, gralloc4::MetadataType_Width, gralloc4::decodeWidth, outWidth);
+    return getImmutable(bufferHandle, gralloc4::MetadataType_Width, gralloc4::decodeWidth,
+                        &ImmutableMetadata::width, outWidth);
 }
 
 status_t Gralloc4Mapper::getHeight(buffer_handle_t bufferHandle, uint64_t* outHeight) const {
-    return get(bufferHandle, gralloc4::MetadataType_Height, gralloc4::decodeHeight, outHeight);
+    return getImmutable(bufferHandle, gralloc4::MetadataType_Height, gralloc4::decodeHeight,
+                        &ImmutableMetadata::height, outHeight);
 }
 
 status_t Gralloc4Mapper::getLayerCount(buffer_handle_t bufferHandle,
                                        uint64_t* outLayerCount) const {
-    return get(bufferHandle, gralloc4::MetadataType_LayerCount, gralloc4::decodeLayerCount,
-               outLayerCount);
+    return getImmutable(bufferHandle, gralloc4::MetadataType_LayerCount,
+                        gralloc4::decodeLayerCount, &ImmutableMetadata::layerCount, outLayerCount);
 }
 
 status_t Gralloc4Mapper::getPixelFormatRequested(buffer_handle_t bufferHandle,
                                                  ui::PixelFormat* outPixelFormatRequested) const {
-    return get(bufferHandle, gralloc4::MetadataType_PixelFormatRequested,
-               gralloc4::decodePixelFormatRequested, outPixelFormatRequested);
+    return getImmutable(bufferHandle, gralloc4::MetadataType_PixelFormatRequested,
+                        gralloc4::decodePixelFormatRequested,
+                        &ImmutableMetadata::pixelFormatRequested, outPixelFormatRequested);
 }
 
 status_t Gralloc4Mapper::getPixelFormatFourCC(buffer_handle_t bufferHandle,
                                               uint32_t* outPixelFormatFourCC) const {
-    return get(bufferHandle, gralloc4::MetadataType_PixelFormatFourCC,
-               gralloc4::decodePixelFormatFourCC, outPixelFormatFourCC);
+    return getImmutable(bufferHandle, gralloc4::MetadataType_PixelFormatFourCC,
+                        gralloc4::decodePixelFormatFourCC, &ImmutableMetadata::pixelFormatFourCC,
+                        outPixelFormatFourCC);
 }
 
 status_t Gralloc4Mapper::getPixelFormatModifier(buffer_handle_t bufferHandle,
                                                 uint64_t* outPixelFormatModifier) const {
-    return get(bufferHandle, gralloc4::MetadataType_PixelFormatModifier,
-               gralloc4::decodePixelFormatModifier, outPixelFormatModifier);
+    return getImmutable(bufferHandle, gralloc4::MetadataType_PixelFormatModifier,
+                        gralloc4::decodePixelFormatModifier,
+                        &ImmutableMetadata::pixelFormatModifier, outPixelFormatModifier);
 }
 
 status_t Gralloc4Mapper::getUsage(buffer_handle_t bufferHandle, uint64_t* outUsage) const {
-    return get(bufferHandle, gralloc4::MetadataType_Usage, gralloc4::decodeUsage, outUsage);
+    return getImmutable(bufferHandle, gralloc4::MetadataType_Usage, gralloc4::decodeUsage,
+                        &ImmutableMetadata::usage, outUsage);
 }
 
 status_t Gralloc4Mapper::getAllocationSize(buffer_handle_t bufferHandle,
                                            uint64_t* outAllocationSize) const {
-    return get(bufferHandle, gralloc4::MetadataType_AllocationSize, gralloc4::decodeAllocationSize,
-               outAllocationSize);
+    return getImmutable(bufferHandle, gralloc4::MetadataType_AllocationSize,
+                        gralloc4::decodeAllocationSize, &ImmutableMetadata::allocationSize,
+                        outAllocationSize);
 }
 
 status_t Gralloc4Mapper::getProtectedContent(buffer_handle_t bufferHandle,
@@ -717,6 +877,75 @@ status_t Gralloc4Mapper::getBlendMode(buffer_handle_t bufferHandle,
                outBlendMode);
 }
 
+status_t Gralloc4Mapper::getFrameMetadata(buffer_handle_t bufferHandle,
+                                          ui::FrameMetadata* outFrameMetadata) const {
+    if (!outFrameMetadata) {
+        return BAD_VALUE;
+    }
+
+    // dumpBuffer returns all the metadata of the buffer in a single call, where getting each type
+    // would take a call apiece. Fall back to the latter for mappers which do not implement it.
+    Error error = kTransactionError;
+    status_t decodeStatus = NO_ERROR;
+    auto ret = mMapper->dumpBuffer(const_cast<native_handle_t*>(bufferHandle),
+                                   [&](const auto& tmpError, const BufferDump& tmpBufferDump) {
+                                       error = tmpError;
+                                       if (error == Error::NONE) {
+                                           decodeStatus = decodeFrameMetadata(tmpBufferDump,
+                                                                              outFrameMetadata);
+                                       }
+                                   });
+    if (!ret.isOk()) {
+        error = kTransactionError;
+    }
+
+    switch (error) {
+        case Error::NONE:
+            return decodeStatus;
+        case Error::UNSUPPORTED:
+            return getFrameMetadataSeparately(bufferHandle, outFrameMetadata);
+        default:
+            ALOGE("dumpBuffer() failed with %d", error);
+            return static_cast<status_t>(error);
+    }
+}
+
+status_t Gralloc4Mapper::getFrameMetadataSeparately(buffer_handle_t bufferHandle,
+                                                    ui::FrameMetadata* outFrameMetadata) const {
+    ui::FrameMetadata metadata;
+    AidlDataspace dataspace = AidlDataspace::UNKNOWN;
+    if (status_t error = getIfSupported(bufferHandle, gralloc4::MetadataType_Dataspace,
+                                        gralloc4::decodeDataspace, &dataspace);
+        error != NO_ERROR) {
+        return error;
+    }
+    metadata.dataspace = static_cast<ui::Dataspace>(dataspace);
+
+    if (status_t error = getIfSupported(bufferHandle, gralloc4::MetadataType_Crop,
+                                        gralloc4::decodeCrop, &metadata.crop);
+        error != NO_ERROR) {
+        return error;
+    }
+    if (status_t error = getIfSupported(bufferHandle, gralloc4::MetadataType_BlendMode,
+                                        gralloc4::decodeBlendMode, &metadata.blendMode);
+        error != NO_ERROR) {
+        return error;
+    }
+    if (status_t error = getIfSupported(bufferHandle, gralloc4::MetadataType_Smpte2086,
+                                        gralloc4::decodeSmpte2086, &metadata.smpte2086);
+        error != NO_ERROR) {
+        return error;
+    }
+    if (status_t error = getIfSupported(bufferHandle, gralloc4::MetadataType_Cta861_3,
+                                        gralloc4::decodeCta861_3, &metadata.cta861_3);
+        error != NO_ERROR) {
+        return error;
+    }
+
+    *outFrameMetadata = std::move(metadata);
+    return NO_ERROR;
+}
+
 status_t Gralloc4Mapper::getSmpte2086(buffer_handle_t bufferHandle,
                                       std::optional<ui::Smpte2086>* outSmpte2086) const {
     return get(bufferHandle, gralloc4::MetadataType_Smpte2086, gralloc4::decodeSmpte2086,
@@ -945,23 +1174,12 @@ template <class T>
 status_t Gralloc4Mapper::metadataDumpHelper(const BufferDump& bufferDump,
                                             StandardMetadataType metadataType,
                                             DecodeFunction<T> decodeFunction, T* outT) const {
-    const auto& metadataDump = bufferDump.metadataDump;
-
-    auto itr =
-            std::find_if(metadataDump.begin(), metadataDump.end(),
-                         [&](const MetadataDump& tmpMetadataDump) {
-                             if (!gralloc4::isStandardMetadataType(tmpMetadataDump.metadataType)) {
-                                 return false;
-                             }
-                             return metadataType ==
-                                     gralloc4::getStandardMetadataTypeValue(
-                                             tmpMetadataDump.metadataType);
-                         });
-    if (itr == metadataDump.end()) {
+    const MetadataDump* metadataDump = findMetadataDump(bufferDump, metadataType);
+    if (!metadataDump) {
         return BAD_VALUE;
     }
 
-    return decodeFunction(itr->metadata, outT);
+    return decodeFunction(metadataDump->metadata, outT);
 }
 
 status_t Gralloc4Mapper::bufferDumpHelper(const BufferDump& bufferDump, std::ostringstream* outDump,
@@ -23,6 +23,9 @@
 #include <limits.h>
 #include <stdio.h>
 
+#include <algorithm>
+#include <vector>
+
 #include <grallocusage/GrallocUsageConversion.h>
 
 #include <android-base/stringprintf.h>
@@ -43,9 +46,98 @@ using base::StringAppendF;
 
 ANDROID_SINGLETON_STATIC_INSTANCE( GraphicBufferAllocator )
 
-Mutex GraphicBufferAllocator::sLock;
-KeyedVector<buffer_handle_t,
-    GraphicBufferAllocator::alloc_rec_t> GraphicBufferAllocator::sAllocList;
+GraphicBufferAllocator::AllocationTracker GraphicBufferAllocator::sAllocations;
+
+auto GraphicBufferAllocator::AllocationTracker::shardFor(buffer_handle_t handle) -> Shard& {
+    // Handles are heap pointers, so the low bits are mostly alignment. Mix all of the bits into the
+    // top ones with a Fibonacci hash.
+    const uint64_t hash = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle)) *
+            0x9e3779b97f4a7c15ull;
+    return mShards[hash >> (64 - kShardBits)];
+}
+
+void GraphicBufferAllocator::AllocationTracker::add(buffer_handle_t handle, alloc_rec_t rec) {
+    Shard& shard = shardFor(handle);
+    std::lock_guard lock(shard.lock);
+
+    const auto [it, inserted] = shard.records.try_emplace(handle, std::move(rec));
+    if (!inserted) {
+        // Like KeyedVector::add, replace the stale record of a handle that was never freed.
+        subtract(shard, it->second);
+        it->second = std::move(rec);
+    }
+
+    const alloc_rec_t& added = it->second;
+    RequestorTotal& total = shard.requestors[added.requestorName];
+    total.count++;
+    total.size += added.size;
+    shard.size.store(shard.size.load(std::memory_order_relaxed) + added.size,
+                     std::memory_order_relaxed);
+}
+
+void GraphicBufferAllocator::AllocationTracker::remove(buffer_handle_t handle) {
+    Shard& shard = shardFor(handle);
+    std::lock_guard lock(shard.lock);
+
+    const auto it = shard.records.find(handle);
+    if (it == shard.records.end()) return;
+
+    subtract(shard, it->second);
+    shard.records.erase(it);
+}
+
+void GraphicBufferAllocator::AllocationTracker::subtract(Shard& shard, const alloc_rec_t& rec) {
+    const auto it = shard.requestors.find(rec.requestorName);
+    it->second.size -= rec.size;
+    if (--it->second.count == 0) {
+        shard.requestors.erase(it);
+    }
+    shard.size.store(shard.size.load(std::memory_order_relaxed) - rec.size,
+                     std::memory_order_relaxed);
+}
+
+uint64_t GraphicBufferAllocator::AllocationTracker::getTotalSize() const {
+    uint64_t total = 0;
+    for (const Shard& shard : mShards) {
+        total += shard.size.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::unordered_map<std::string, uint64_t>
+GraphicBufferAllocator::AllocationTracker::getTotalSizeByRequestor() const {
+    std::unordered_map<std::string, uint64_t> totals;
+    for (const Shard& shard : mShards) {
+        std::lock_guard lock(shard.lock);
+        for (const auto& [name, total] : shard.requestors) {
+            totals[name] += total.size;
+        }
+    }
+    return totals;
+}
+
+uint64_t GraphicBufferAllocator::AllocationTracker::dump(std::string& result) const {
+    std::vector<std::pair<buffer_handle_t, alloc_rec_t>> list;
+    for (const Shard& shard : mShards) {
+        std::lock_guard lock(shard.lock);
+        list.insert(list.end(), shard.records.begin(), shard.records.end());
+    }
+    // Keep the handle order of the dump stable, as it was when the records were a KeyedVector.
+    std::sort(list.begin(), list.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+    uint64_t total = 0;
+    for (const auto& [handle, rec] : list) {
+        std::string sizeStr = (rec.size)
+                ? base::StringPrintf("%7.2f KiB", static_cast<double>(rec.size) / 1024.0)
+                : "unknown";
+        StringAppendF(&result, "%10p | %11s | %4u (%4u) x %4u | %6u | %8X | 0x%8" PRIx64 " | %s\n",
+                      handle, sizeStr.c_str(), rec.width, rec.stride, rec.height,
+                      rec.layerCount, rec.format, rec.usage, rec.requestorName.c_str());
+        total += rec.size;
+    }
+    return total;
+}
 
 GraphicBufferAllocator::GraphicBufferAllocator() : mMapper(GraphicBufferMapper::getInstance()) {
     mAllocator = std::make_unique<const Gralloc4Allocator>(
@@ -70,32 +162,18 @@ GraphicBufferAllocator::GraphicBufferAllocator() : mMapper(GraphicBufferMapper::
 GraphicBufferAllocator::~GraphicBufferAllocator() {}
 
 uint64_t GraphicBufferAllocator::getTotalSize() const {
-    Mutex::Autolock _l(sLock);
-    uint64_t total = 0;
-    for (size_t i = 0; i < sAllocList.size(); ++i) {
-        total += sAllocList.valueAt(i).size;
-    }
-    return total;
+    return sAllocations.getTotalSize();
+}
+
+std::unordered_map<std::string, uint64_t> GraphicBufferAllocator::getTotalSizeByRequestor() const {
+    return sAllocations.getTotalSizeByRequestor();
 }
 
 void GraphicBufferAllocator::dump(std::string& result, bool less) const {
-    Mutex::Autolock _l(sLock);
-    KeyedVector<buffer_handle_t, alloc_rec_t>& list(sAllocList);
-    uint64_t total = 0;
     result.append("GraphicBufferAllocator buffers:\n");
-    const size_t count = list.size();
     StringAppendF(&result, "%10s | %11s | %18s | %s | %8s | %10s | %s\n", "Handle", "Size",
                   "W (Stride) x H", "Layers", "Format", "Usage", "Requestor");
-    for (size_t i = 0; i < count; i++) {
-        const alloc_rec_t& rec(list.valueAt(i));
-        std::string sizeStr = (rec.size)
-                ? base::StringPrintf("%7.2f KiB", static_cast<double>(rec.size) / 1024.0)
-                : "unknown";
-        StringAppendF(&result, "%10p | %11s | %4u (%4u) x %4u | %6u | %8X | 0x%8" PRIx64 " | %s\n",
-                      list.keyAt(i), sizeStr.c_str(), rec.width, rec.stride, rec.height,
-                      rec.layerCount, rec.format, rec.usage, rec.requestorName.c_str());
-        total += rec.size;
-    }
+    const uint64_t total = sAllocations.dump(result);
     StringAppendF(&result, "Total allocated by GraphicBufferAllocator (estimate): %.2f KB\n",
                   static_cast<double>(total) / 1024.0);
 
@@ -158,8 +236,6 @@ status_t GraphicBufferAllocator::allocateHelper(uint32_t width, uint32_t height,
         bufSize = static_cast<size_t>((*stride)) * height * bpp;
     }
 
-    Mutex::Autolock _l(sLock);
-    KeyedVector<buffer_handle_t, alloc_rec_t>& list(sAllocList);
     alloc_rec_t rec;
     rec.width = width;
     rec.height = height;
@@ -169,7 +245,7 @@ status_t GraphicBufferAllocator::allocateHelper(uint32_t width, uint32_t height,
     rec.usage = usage;
     rec.size = bufSize;
     rec.requestorName = std::move(requestorName);
-    list.add(*handle, rec);
+    sAllocations.add(*handle, std::move(rec));
 
     return NO_ERROR;
 }
@@ -206,9 +282,7 @@ status_t GraphicBufferAllocator::free(buffer_handle_t handle)
     // mapper to get the handle.  We just need to free the handle now.
     mMapper.freeBuffer(handle);
 
-    Mutex::Autolock _l(sLock);
-    KeyedVector<buffer_handle_t, alloc_rec_t>& list(sAllocList);
-    list.removeItem(handle);
+    sAllocations.remove(handle);
 
     return NO_ERROR;
 }
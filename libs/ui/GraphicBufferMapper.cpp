@@ -310,6 +310,11 @@ status_t GraphicBufferMapper::setCta861_3(buffer_handle_t bufferHandle,
     return mMapper->setCta861_3(bufferHandle, cta861_3);
 }
 
+status_t GraphicBufferMapper::getFrameMetadata(buffer_handle_t bufferHandle,
+                                               ui::FrameMetadata* outFrameMetadata) {
+    return mMapper->getFrameMetadata(bufferHandle, outFrameMetadata);
+}
+
 status_t GraphicBufferMapper::getSmpte2094_40(
         buffer_handle_t bufferHandle, std::optional<std::vector<uint8_t>>* outSmpte2094_40) {
     return mMapper->getSmpte2094_40(bufferHandle, outSmpte2094_40);
@@ -18,6 +18,7 @@
 
 #include <inttypes.h>
 #include <limits.h>
+#include <algorithm>
 
 #include <android-base/stringprintf.h>
 
@@ -377,6 +378,54 @@ Region& Region::scaleSelf(float sx, float sy) {
     return *this;
 }
 
+Region& Region::flipSelf(bool horizontal, bool vertical) {
+    if ((!horizontal && !vertical) || isEmpty()) {
+        return *this;
+    }
+#if defined(VALIDATE_REGIONS)
+    validate(*this, "flipSelf (before)");
+#endif
+    for (Rect& rect : mStorage) {
+        if (horizontal) {
+            const int32_t left = rect.left;
+            rect.left = -rect.right;
+            rect.right = -left;
+        }
+        if (vertical) {
+            const int32_t top = rect.top;
+            rect.top = -rect.bottom;
+            rect.bottom = -top;
+        }
+    }
+
+    // A mirrored region is still canonical, only the ordering of the spans changes: flipping
+    // vertically reverses the order of the bands, flipping horizontally reverses the order of the
+    // spans within each band. Reversing the whole array does both, so the spans of each band are
+    // reversed again when only one of the two flips is applied. The trailing bounds rect (if any)
+    // is left in place.
+    if (mStorage.size() > 1) {
+        Rect* const begin = mStorage.data();
+        Rect* const end = begin + mStorage.size() - 1;
+        if (vertical) {
+            std::reverse(begin, end);
+        }
+        if (horizontal != vertical) {
+            for (Rect* band = begin; band != end;) {
+                Rect* bandEnd = band;
+                while (bandEnd != end && bandEnd->top == band->top) {
+                    bandEnd++;
+                }
+                std::reverse(band, bandEnd);
+                band = bandEnd;
+            }
+        }
+    }
+#if defined(VALIDATE_REGIONS)
+    validate(*this, "flipSelf (after)");
+#endif
+    return *this;
+}
+
 // ----------------------------------------------------------------------------
 
 const Region Region::merge(const Rect& rhs) const {
@@ -18,6 +18,7 @@
 #define LOG_TAG "Transform"
 
 #include <math.h>
+#include <vector>
 
 #include <android-base/stringprintf.h>
 #include <cutils/compiler.h>
@@ -32,7 +33,7 @@ Transform::Transform() {
 }
 
 Transform::Transform(const Transform&  other)
-    : mMatrix(other.mMatrix), mType(other.mType) {
+    : mMatrix(other.mMatrix), mType(other.mType), mMapping(other.mMapping) {
 }
 
 Transform::Transform(uint32_t orientation, int w, int h) {
@@ -43,6 +44,35 @@ Transform::~Transform() = default;
 
 static const float EPSILON = 0.0f;
 
+// Integers (and sums of two integers) below this magnitude are represented exactly as floats, so
+// the integral fast paths produce exactly the same results as the float evaluation.
+static constexpr int32_t MAX_EXACT_COORDINATE = 1 << 23;
+
+static bool isExactCoordinate(int32_t v) {
+    return v > -MAX_EXACT_COORDINATE && v < MAX_EXACT_COORDINATE;
+}
+
+static bool isExactRect(const Rect& r) {
+    return isExactCoordinate(r.left) && isExactCoordinate(r.top) &&
+            isExactCoordinate(r.right) && isExactCoordinate(r.bottom);
+}
+
+static Rect roundRect(float left, float top, float right, float bottom, bool roundOutwards) {
+    Rect r;
+    if (roundOutwards) {
+        r.left   = static_cast<int32_t>(floorf(left));
+        r.top    = static_cast<int32_t>(floorf(top));
+        r.right  = static_cast<int32_t>(ceilf(right));
+        r.bottom = static_cast<int32_t>(ceilf(bottom));
+    } else {
+        r.left   = static_cast<int32_t>(floorf(left + 0.5f));
+        r.top    = static_cast<int32_t>(floorf(top + 0.5f));
+        r.right  = static_cast<int32_t>(floorf(right + 0.5f));
+        r.bottom = static_cast<int32_t>(floorf(bottom + 0.5f));
+    }
+    return r;
+}
+
 bool Transform::isZero(float f) {
     return fabs(f) <= EPSILON;
 }
@@ -51,6 +81,10 @@ bool Transform::absIsOne(float f) {
     return isZero(fabs(f) - 1.0f);
 }
 
+bool Transform::isExactInt(float f) {
+    return fabsf(f) < static_cast<float>(MAX_EXACT_COORDINATE) && f == floorf(f);
+}
+
 bool Transform::operator==(const Transform& other) const {
     return mMatrix[0][0] == other.mMatrix[0][0] && mMatrix[0][1] == other.mMatrix[0][1] &&
             mMatrix[0][2] == other.mMatrix[0][2] && mMatrix[1][0] == other.mMatrix[1][0] &&
@@ -84,6 +118,7 @@ Transform Transform::operator*(const Transform& rhs) const {
     // TODO: we could recompute this value from r and rhs
     r.mType &= 0xFF;
     r.mType |= UNKNOWN_TYPE;
+    r.mMapping = Mapping::UNKNOWN;
     return r;
 }
 
@@ -96,6 +131,7 @@ Transform Transform::operator * (float value) const {
             R[i][j] = M[i][j] * value;
         }
     }
+    r.mMapping = Mapping::UNKNOWN;
     r.type();
     return r;
 }
@@ -103,6 +139,7 @@ Transform Transform::operator * (float value) const {
 Transform& Transform::operator=(const Transform& other) {
     mMatrix = other.mMatrix;
     mType = other.mType;
+    mMapping = other.mMapping;
     return *this;
 }
 
@@ -148,6 +185,7 @@ float Transform::getScaleY() const {
 
 void Transform::reset() {
     mType = IDENTITY;
+    mMapping = Mapping::IDENTITY;
     for(size_t i = 0; i < 3; i++) {
         vec3& v(mMatrix[i]);
         for (size_t j = 0; j < 3; j++)
@@ -159,6 +197,7 @@ void Transform::set(float tx, float ty) {
     mMatrix[2][0] = tx;
     mMatrix[2][1] = ty;
     mMatrix[2][2] = 1.0f;
+    mMapping = Mapping::UNKNOWN;
 
     if (isZero(tx) && isZero(ty)) {
         mType &= ~TRANSLATE;
@@ -173,6 +212,7 @@ void Transform::set(float a, float b, float c, float d) {
     M[0][1] = c;    M[1][1] = d;
     M[0][2] = 0;    M[1][2] = 0;
     mType = UNKNOWN_TYPE;
+    mMapping = Mapping::UNKNOWN;
 }
 
 status_t Transform::set(uint32_t flags, float w, float h) {
@@ -191,6 +231,7 @@ status_t Transform::set(uint32_t flags, float w, float h) {
     if (flags & FLIP_H) {
         H.mType = (FLIP_H << 8) | SCALE;
         H.mType |= isZero(w) ? IDENTITY : TRANSLATE;
+        H.mMapping = Mapping::UNKNOWN;
         mat33& M(H.mMatrix);
         M[0][0] = -1;
         M[2][0] = w;
@@ -199,6 +240,7 @@ status_t Transform::set(uint32_t flags, float w, float h) {
     if (flags & FLIP_V) {
         V.mType = (FLIP_V << 8) | SCALE;
         V.mType |= isZero(h) ? IDENTITY : TRANSLATE;
+        V.mMapping = Mapping::UNKNOWN;
         mat33& M(V.mMatrix);
         M[1][1] = -1;
         M[2][1] = h;
@@ -208,6 +250,7 @@ status_t Transform::set(uint32_t flags, float w, float h) {
         const float original_w = h;
         R.mType = (ROT_90 << 8) | ROTATE;
         R.mType |= isZero(original_w) ? IDENTITY : TRANSLATE;
+        R.mMapping = Mapping::UNKNOWN;
         mat33& M(R.mMatrix);
         M[0][0] = 0;    M[1][0] =-1;    M[2][0] = original_w;
         M[0][1] = 1;    M[1][1] = 0;
@@ -223,6 +266,7 @@ void Transform::set(const std::array<float, 9>& matrix) {
     M[0][1] = matrix[3];  M[1][1] = matrix[4];  M[2][1] = matrix[5];
     M[0][2] = matrix[6];  M[1][2] = matrix[7];  M[2][2] = matrix[8];
     mType = UNKNOWN_TYPE;
+    mMapping = Mapping::UNKNOWN;
     type();
 }
 
@@ -252,7 +296,42 @@ Rect Transform::makeBounds(int w, int h) const {
 }
 
 Rect Transform::transform(const Rect& bounds, bool roundOutwards) const {
-    Rect r;
+    const Mapping kind = mapping();
+
+    if (kind <= Mapping::INTEGRAL_ROT_90 && isExactRect(bounds)) {
+        // Unit scale factors and a whole-pixel translation: the float evaluation below would be
+        // exact, so do it in integer math. Rounding is a no-op in either mode.
+        const mat33& M(mMatrix);
+        const int32_t tx = static_cast<int32_t>(M[2][0]);
+        const int32_t ty = static_cast<int32_t>(M[2][1]);
+        int32_t x0, x1, y0, y1;
+        if (kind == Mapping::INTEGRAL_ROT_90) {
+            const int32_t b = M[1][0] < 0 ? -1 : 1;
+            const int32_t c = M[0][1] < 0 ? -1 : 1;
+            x0 = b * bounds.top + tx;
+            x1 = b * bounds.bottom + tx;
+            y0 = c * bounds.left + ty;
+            y1 = c * bounds.right + ty;
+        } else {
+            const int32_t a = M[0][0] < 0 ? -1 : 1;
+            const int32_t d = M[1][1] < 0 ? -1 : 1;
+            x0 = a * bounds.left + tx;
+            x1 = a * bounds.right + tx;
+            y0 = d * bounds.top + ty;
+            y1 = d * bounds.bottom + ty;
+        }
+        return Rect(std::min(x0, x1), std::min(y0, y1), std::max(x0, x1), std::max(y0, y1));
+    }
+
+    if (kind != Mapping::GENERAL) {
+        // Each output coordinate depends on a single input coordinate, so two opposite corners
+        // span the same bounds as all four.
+        const vec2 lt = transform(vec2(bounds.left, bounds.top));
+        const vec2 rb = transform(vec2(bounds.right, bounds.bottom));
+        return roundRect(std::min(lt[0], rb[0]), std::min(lt[1], rb[1]), std::max(lt[0], rb[0]),
+                         std::max(lt[1], rb[1]), roundOutwards);
+    }
+
     vec2 lt( bounds.left,  bounds.top    );
     vec2 rt( bounds.right, bounds.top    );
     vec2 lb( bounds.left,  bounds.bottom );
@@ -263,22 +342,19 @@ Rect Transform::transform(const Rect& bounds, bool roundOutwards) const {
     lb = transform(lb);
     rb = transform(rb);
 
-    if (roundOutwards) {
-        r.left   = static_cast<int32_t>(floorf(std::min({lt[0], rt[0], lb[0], rb[0]})));
-        r.top    = static_cast<int32_t>(floorf(std::min({lt[1], rt[1], lb[1], rb[1]})));
-        r.right  = static_cast<int32_t>(ceilf(std::max({lt[0], rt[0], lb[0], rb[0]})));
-        r.bottom = static_cast<int32_t>(ceilf(std::max({lt[1], rt[1], lb[1], rb[1]})));
-    } else {
-        r.left   = static_cast<int32_t>(floorf(std::min({lt[0], rt[0], lb[0], rb[0]}) + 0.5f));
-        r.top    = static_cast<int32_t>(floorf(std::min({lt[1], rt[1], lb[1], rb[1]}) + 0.5f));
-        r.right  = static_cast<int32_t>(floorf(std::max({lt[0], rt[0], lb[0], rb[0]}) + 0.5f));
-        r.bottom = static_cast<int32_t>(floorf(std::max({lt[1], rt[1], lb[1], rb[1]}) + 0.5f));
-    }
-
-    return r;
+    return roundRect(std::min({lt[0], rt[0], lb[0], rb[0]}), std::min({lt[1], rt[1], lb[1], rb[1]}),
+                     std::max({lt[0], rt[0], lb[0], rb[0]}), std::max({lt[1], rt[1], lb[1], rb[1]}),
+                     roundOutwards);
 }
 
 FloatRect Transform::transform(const FloatRect& bounds) const {
+    if (mapping() != Mapping::GENERAL) {
+        const vec2 lt = transform(vec2(bounds.left, bounds.top));
+        const vec2 rb = transform(vec2(bounds.right, bounds.bottom));
+        return FloatRect(std::min(lt[0], rb[0]), std::min(lt[1], rb[1]), std::max(lt[0], rb[0]),
+                         std::max(lt[1], rb[1]));
+    }
+
     vec2 lt(bounds.left, bounds.top);
     vec2 rt(bounds.right, bounds.top);
     vec2 lb(bounds.left, bounds.bottom);
@@ -301,12 +377,40 @@ FloatRect Transform::transform(const FloatRect& bounds) const {
 Region Transform::transform(const Region& reg) const {
     Region out;
     if (CC_UNLIKELY(type() > TRANSLATE)) {
-        if (CC_LIKELY(preserveRects())) {
+        if (mapping() == Mapping::INTEGRAL_FLIP && !reg.isEmpty() && isExactRect(reg.bounds())) {
+            // Mirroring keeps the region canonical, so there is no need to rebuild it rect by
+            // rect.
+            out = reg;
+            out.flipSelf(mMatrix[0][0] < 0, mMatrix[1][1] < 0)
+                    .translateSelf(static_cast<int>(tx()), static_cast<int>(ty()));
+        } else if (CC_LIKELY(preserveRects())) {
             Region::const_iterator it = reg.begin();
             Region::const_iterator const end = reg.end();
+            if (end - it <= 4) {
+                while (it != end) {
+                    out.orSelf(transform(*it++));
+                }
+                return out;
+            }
+
+            // Each orSelf() copies the whole region built so far, so union the mapped rects
+            // pairwise instead: every rect then takes part in O(log n) merges rather than O(n).
+            std::vector<Region> parts;
+            parts.reserve(static_cast<size_t>(end - it));
             while (it != end) {
-                out.orSelf(transform(*it++));
+                parts.emplace_back(transform(*it++));
+            }
+            while (parts.size() > 1) {
+                const size_t count = parts.size();
+                for (size_t i = 0; i + 1 < count; i += 2) {
+                    parts[i / 2] = parts[i].merge(parts[i + 1]);
+                }
+                if (count % 2) {
+                    parts[count / 2] = std::move(parts[count - 1]);
+                }
+                parts.resize((count + 1) / 2);
             }
+            out = parts[0];
         } else {
             out.set(transform(reg.bounds()));
         }
@@ -411,9 +515,36 @@ Transform Transform::inverse() const {
         result.mMatrix[2][0] = T[0];
         result.mMatrix[2][1] = T[1];
     }
+    result.mMapping = Mapping::UNKNOWN;
     return result;
 }
 
+Transform::Mapping Transform::mapping() const {
+    if (mMapping != Mapping::UNKNOWN) {
+        return mMapping;
+    }
+
+    const uint32_t orientation = getOrientation();
+    const mat33& M(mMatrix);
+    const bool integralTranslate = isExactInt(M[2][0]) && isExactInt(M[2][1]);
+    if (orientation & ROT_INVALID) {
+        mMapping = Mapping::GENERAL;
+    } else if (orientation & ROT_90) {
+        const bool unitScale = absIsOne(M[1][0]) && absIsOne(M[0][1]);
+        mMapping = unitScale && integralTranslate ? Mapping::INTEGRAL_ROT_90
+                                                  : Mapping::SCALE_ROT_90;
+    } else if (!absIsOne(M[0][0]) || !absIsOne(M[1][1]) || !integralTranslate) {
+        mMapping = Mapping::SCALE_TRANSLATE;
+    } else if (orientation & ROT_180) {
+        mMapping = Mapping::INTEGRAL_FLIP;
+    } else if (isZero(M[2][0]) && isZero(M[2][1])) {
+        mMapping = Mapping::IDENTITY;
+    } else {
+        mMapping = Mapping::INTEGRAL_TRANSLATE;
+    }
+    return mMapping;
+}
+
 uint32_t Transform::getType() const {
     return type() & 0xFF;
 }
@@ -185,6 +185,10 @@ public:
                                  std::optional<ui::Cta861_3> /*cta861_3*/) const {
         return INVALID_OPERATION;
     }
+    virtual status_t getFrameMetadata(buffer_handle_t /*bufferHandle*/,
+                                      ui::FrameMetadata* /*outFrameMetadata*/) const {
+        return INVALID_OPERATION;
+    }
     virtual status_t getSmpte2094_40(
             buffer_handle_t /*bufferHandle*/,
             std::optional<std::vector<uint8_t>>* /*outSmpte2094_40*/) const {
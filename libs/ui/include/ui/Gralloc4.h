@@ -27,7 +27,14 @@
 #include <ui/Rect.h>
 #include <utils/StrongPointer.h>
 
+#include <android-base/thread_annotations.h>
+
+#include <list>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <utility>
 
 namespace android {
 
@@ -37,6 +44,9 @@ public:
 
     Gralloc4Mapper();
 
+    // For testing: wraps the given mapper instead of the service.
+    explicit Gralloc4Mapper(sp<hardware::graphics::mapper::V4_0::IMapper> mapper);
+
     bool isLoaded() const override;
 
     std::string dumpBuffer(buffer_handle_t bufferHandle, bool less = true) const override;
@@ -104,6 +114,8 @@ public:
     status_t getDataspace(buffer_handle_t bufferHandle, ui::Dataspace* outDataspace) const override;
     status_t setDataspace(buffer_handle_t bufferHandle, ui::Dataspace dataspace) const override;
     status_t getBlendMode(buffer_handle_t bufferHandle, ui::BlendMode* outBlendMode) const override;
+    status_t getFrameMetadata(buffer_handle_t bufferHandle,
+                              ui::FrameMetadata* outFrameMetadata) const override;
     status_t getSmpte2086(buffer_handle_t bufferHandle,
                           std::optional<ui::Smpte2086>* outSmpte2086) const override;
     status_t setSmpte2086(buffer_handle_t bufferHandle,
@@ -174,6 +186,41 @@ private:
             const android::hardware::graphics::mapper::V4_0::IMapper::MetadataType& metadataType,
             DecodeFunction<T> decodeFunction, T* outMetadata) const;
 
+    // Metadata that is fixed when the buffer is allocated, which is cached after the first query.
+    struct ImmutableMetadata {
+        std::optional<uint64_t> bufferId;
+        std::optional<std::string> name;
+        std::optional<uint64_t> width;
+        std::optional<uint64_t> height;
+        std::optional<uint64_t> layerCount;
+        std::optional<ui::PixelFormat> pixelFormatRequested;
+        std::optional<uint32_t> pixelFormatFourCC;
+        std::optional<uint64_t> pixelFormatModifier;
+        std::optional<uint64_t> usage;
+        std::optional<uint64_t> allocationSize;
+    };
+
+    template <class T>
+    status_t getImmutable(
+            buffer_handle_t bufferHandle,
+            const android::hardware::graphics::mapper::V4_0::IMapper::MetadataType& metadataType,
+            DecodeFunction<T> decodeFunction, std::optional<T> ImmutableMetadata::*field,
+            T* outMetadata) const;
+
+    // Like get, but returns NO_ERROR and leaves outMetadata unchanged if the metadata type is not
+    // supported by the mapper.
+    template <class T>
+    status_t getIfSupported(
+            buffer_handle_t bufferHandle,
+            const android::hardware::graphics::mapper::V4_0::IMapper::MetadataType& metadataType,
+            DecodeFunction<T> decodeFunction, T* outMetadata) const;
+
+    void invalidateCache(buffer_handle_t bufferHandle) const;
+
+    // Gets the frame metadata with a get call per metadata type, for mappers without dumpBuffer.
+    status_t getFrameMetadataSeparately(buffer_handle_t bufferHandle,
+                                        ui::FrameMetadata* outFrameMetadata) const;
+
     template <class T>
     status_t set(
             buffer_handle_t bufferHandle,
@@ -197,6 +244,17 @@ private:
             std::ostringstream* outDump, uint64_t* outAllocationSize, bool less) const;
 
     sp<hardware::graphics::mapper::V4_0::IMapper> mMapper;
+
+    // Keyed by handle rather than buffer id, since the id would itself take a mapper call to get.
+    // Handles are only reused after being freed, which drops their entry. Once kMaxCachedBuffers
+    // buffers are cached, the least recently used one is evicted.
+    using CacheEntries = std::list<std::pair<buffer_handle_t, ImmutableMetadata>>;
+    static constexpr size_t kMaxCachedBuffers = 1024;
+    mutable std::mutex mCacheMutex;
+    // Most recently used first.
+    mutable CacheEntries mCacheEntries GUARDED_BY(mCacheMutex);
+    mutable std::unordered_map<buffer_handle_t, CacheEntries::iterator> mCache
+            GUARDED_BY(mCacheMutex);
 };
 
 class Gralloc4Allocator : public GrallocAllocator {
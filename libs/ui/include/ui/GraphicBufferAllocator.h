@@ -20,8 +20,12 @@
 
 #include <stdint.h>
 
+#include <array>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 #include <cutils/native_handle.h>
 
@@ -74,6 +78,11 @@ public:
 
     uint64_t getTotalSize() const;
 
+    /**
+     * Returns the estimated size of the live buffers allocated by each requestor.
+     */
+    std::unordered_map<std::string, uint64_t> getTotalSizeByRequestor() const;
+
     void dump(std::string& res, bool less = true) const;
     static void dumpToSystemLog(bool less = true);
 
@@ -93,8 +102,47 @@ protected:
                             uint64_t usage, buffer_handle_t* handle, uint32_t* stride,
                             std::string requestorName, bool importBuffer);
 
-    static Mutex sLock;
-    static KeyedVector<buffer_handle_t, alloc_rec_t> sAllocList;
+    /**
+     * Records of the live imported buffers, keyed by handle. The records are spread over shards
+     * by handle hash, so that threads allocating and freeing buffers concurrently rarely contend
+     * on the same lock. The total size and the per-requestor sizes are maintained as records are
+     * added and removed, so querying them does not walk the records.
+     */
+    class AllocationTracker {
+    public:
+        void add(buffer_handle_t handle, alloc_rec_t rec);
+        void remove(buffer_handle_t handle);
+
+        uint64_t getTotalSize() const;
+        std::unordered_map<std::string, uint64_t> getTotalSizeByRequestor() const;
+
+        // Appends one line per record, in ascending handle order, and returns the total size.
+        uint64_t dump(std::string& result) const;
+
+    private:
+        static constexpr size_t kShardBits = 4;
+        static constexpr size_t kShardCount = 1 << kShardBits;
+
+        struct RequestorTotal {
+            size_t count = 0;
+            uint64_t size = 0;
+        };
+
+        struct alignas(64) Shard {
+            mutable std::mutex lock;
+            std::unordered_map<buffer_handle_t, alloc_rec_t> records;
+            std::unordered_map<std::string, RequestorTotal> requestors;
+            // Written under the lock, but read without it by getTotalSize.
+            std::atomic<uint64_t> size = 0;
+        };
+
+        Shard& shardFor(buffer_handle_t handle);
+        static void subtract(Shard& shard, const alloc_rec_t& rec);
+
+        std::array<Shard, kShardCount> mShards;
+    };
+
+    static AllocationTracker sAllocations;
 
     friend class Singleton<GraphicBufferAllocator>;
     GraphicBufferAllocator();
@@ -127,6 +127,13 @@ public:
     status_t setSmpte2086(buffer_handle_t bufferHandle, std::optional<ui::Smpte2086> smpte2086);
     status_t getCta861_3(buffer_handle_t bufferHandle, std::optional<ui::Cta861_3>* outCta861_3);
     status_t setCta861_3(buffer_handle_t bufferHandle, std::optional<ui::Cta861_3> cta861_3);
+
+    /**
+     * Gets the dataspace, crop, blend mode and HDR static metadata of a buffer with a single mapper
+     * call, which is cheaper than getting each of them separately.
+     */
+    status_t getFrameMetadata(buffer_handle_t bufferHandle, ui::FrameMetadata* outFrameMetadata);
+
     status_t getSmpte2094_40(buffer_handle_t bufferHandle,
                              std::optional<std::vector<uint8_t>>* outSmpte2094_40);
     status_t setSmpte2094_40(buffer_handle_t bufferHandle,
@@ -22,11 +22,15 @@
 #include <aidl/android/hardware/graphics/common/Cta861_3.h>
 #include <aidl/android/hardware/graphics/common/Interlaced.h>
 #include <aidl/android/hardware/graphics/common/PlaneLayout.h>
+#include <aidl/android/hardware/graphics/common/Rect.h>
 #include <aidl/android/hardware/graphics/common/Smpte2086.h>
 #include <android/hardware/graphics/common/1.1/types.h>
 #include <android/hardware/graphics/common/1.2/types.h>
 #include <system/graphics.h>
 
+#include <optional>
+#include <vector>
+
 namespace android {
 
 /**
@@ -80,5 +84,18 @@ inline Cta861_3 translate(const android_cta861_3_metadata& metadata) {
                     .maxFrameAverageLightLevel = metadata.maxFrameAverageLightLevel};
 }
 
+/**
+ * Metadata of a buffer that its producer may change from frame to frame, which is fetched at once
+ * by GraphicBufferMapper::getFrameMetadata. Metadata that the buffer does not have keeps its
+ * default value.
+ */
+struct FrameMetadata {
+    Dataspace dataspace = Dataspace::UNKNOWN;
+    std::vector<aidl::android::hardware::graphics::common::Rect> crop;
+    BlendMode blendMode = BlendMode::INVALID;
+    std::optional<Smpte2086> smpte2086;
+    std::optional<Cta861_3> cta861_3;
+};
+
 }  // namespace ui
 }  // namespace android
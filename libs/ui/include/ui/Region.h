@@ -91,6 +91,8 @@ public:
             // these translate rhs first
             Region&     translateSelf(int dx, int dy);
             Region&     scaleSelf(float sx, float sy);
+            // mirrors the region about the y axis (x -> -x) and/or x axis (y -> -y)
+            Region&     flipSelf(bool horizontal, bool vertical);
             Region&     orSelf(const Region& rhs, int dx, int dy);
             Region&     xorSelf(const Region& rhs, int dx, int dy);
             Region&     andSelf(const Region& rhs, int dx, int dy);
@@ -124,12 +124,29 @@ private:
 
     enum { UNKNOWN_TYPE = 0x80000000 };
 
+    // How rects are mapped by this transform, derived lazily from mMatrix so that the rect and
+    // region paths can skip the general 4-corner float evaluation. The integral mappings have
+    // unit scale factors and a whole-pixel translation, so they are evaluated in integer math.
+    enum class Mapping : uint8_t {
+        UNKNOWN,             // not computed yet, mMatrix changed since the last query
+        IDENTITY,
+        INTEGRAL_TRANSLATE,  // x + tx, y + ty
+        INTEGRAL_FLIP,       // FLIP_H, FLIP_V or ROT_180, plus a whole-pixel translation
+        INTEGRAL_ROT_90,     // ROT_90 or ROT_270 (possibly flipped), plus a whole-pixel translation
+        SCALE_TRANSLATE,     // axis aligned: any scale and translation
+        SCALE_ROT_90,        // axis swapping: any scale and translation
+        GENERAL,             // skew or a rotation that is not a multiple of 90 degrees
+    };
+
     uint32_t type() const;
+    Mapping mapping() const;
     static bool absIsOne(float f);
     static bool isZero(float f);
+    static bool isExactInt(float f);
 
     mat33               mMatrix;
     mutable uint32_t    mType;
+    mutable Mapping     mMapping = Mapping::UNKNOWN;
 };
 
 inline void PrintTo(const Transform& t, ::std::ostream* os) {
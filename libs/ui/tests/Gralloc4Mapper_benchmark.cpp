@@ -0,0 +1,104 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <gralloctypes/Gralloc4.h>
+#include <ui/Gralloc4.h>
+
+#include "mock/FakeMapper4.h"
+
+namespace android {
+namespace {
+
+using aidl::android::hardware::graphics::common::Dataspace;
+using aidl::android::hardware::graphics::common::Rect;
+using hardware::hidl_vec;
+using hardware::graphics::mapper::V4_0::IMapper;
+
+const auto kBuffer = reinterpret_cast<buffer_handle_t>(0x1000);
+
+template <class T>
+void setMetadata(mock::FakeMapper4& mapper, const IMapper::MetadataType& metadataType,
+                 const T& metadata, status_t (*encodeFunction)(const T&, hidl_vec<uint8_t>*)) {
+    hidl_vec<uint8_t> encoded;
+    encodeFunction(metadata, &encoded);
+    mapper.set(const_cast<native_handle_t*>(kBuffer), metadataType, encoded);
+}
+
+sp<mock::FakeMapper4> makeFakeMapper() {
+    auto mapper = sp<mock::FakeMapper4>::make();
+    setMetadata(*mapper, gralloc4::MetadataType_Width, uint64_t{1920}, gralloc4::encodeWidth);
+    setMetadata(*mapper, gralloc4::MetadataType_Height, uint64_t{1080}, gralloc4::encodeHeight);
+    setMetadata(*mapper, gralloc4::MetadataType_Usage, uint64_t{0x900}, gralloc4::encodeUsage);
+    setMetadata(*mapper, gralloc4::MetadataType_Dataspace, Dataspace::BT2020_ITU_PQ,
+                gralloc4::encodeDataspace);
+    setMetadata(*mapper, gralloc4::MetadataType_BlendMode, ui::BlendMode::PREMULTIPLIED,
+                gralloc4::encodeBlendMode);
+    setMetadata(*mapper, gralloc4::MetadataType_Smpte2086,
+                std::make_optional(ui::Smpte2086{.maxLuminance = 1000.f, .minLuminance = 0.005f}),
+                gralloc4::encodeSmpte2086);
+    setMetadata(*mapper, gralloc4::MetadataType_Crop,
+                std::vector<Rect>{{.left = 0, .top = 0, .right = 1920, .bottom = 1080}},
+                gralloc4::encodeCrop);
+    setMetadata(*mapper, gralloc4::MetadataType_Cta861_3,
+                std::make_optional(ui::Cta861_3{.maxContentLightLevel = 1000.f,
+                                                .maxFrameAverageLightLevel = 400.f}),
+                gralloc4::encodeCta861_3);
+    return mapper;
+}
+
+// Width, height and usage are cached after the first query.
+void BM_GetImmutableMetadata(benchmark::State& state) {
+    const Gralloc4Mapper mapper(makeFakeMapper());
+    uint64_t width, height, usage;
+    for (auto _ : state) {
+        mapper.getWidth(kBuffer, &width);
+        mapper.getHeight(kBuffer, &height);
+        mapper.getUsage(kBuffer, &usage);
+        benchmark::DoNotOptimize(width + height + usage);
+    }
+}
+BENCHMARK(BM_GetImmutableMetadata);
+
+// Gets all the frame metadata with a single dumpBuffer call.
+void BM_GetFrameMetadata(benchmark::State& state) {
+    const Gralloc4Mapper mapper(makeFakeMapper());
+    ui::FrameMetadata metadata;
+    for (auto _ : state) {
+        mapper.getFrameMetadata(kBuffer, &metadata);
+        benchmark::DoNotOptimize(metadata);
+    }
+}
+BENCHMARK(BM_GetFrameMetadata);
+
+// Gets the frame metadata with a get call per type, as for mappers without dumpBuffer.
+void BM_GetFrameMetadataSeparately(benchmark::State& state) {
+    const auto fakeMapper = makeFakeMapper();
+    fakeMapper->setDumpBufferSupported(false);
+    const Gralloc4Mapper mapper(fakeMapper);
+    ui::FrameMetadata metadata;
+    for (auto _ : state) {
+        mapper.getFrameMetadata(kBuffer, &metadata);
+        benchmark::DoNotOptimize(metadata);
+    }
+}
+BENCHMARK(BM_GetFrameMetadataSeparately);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
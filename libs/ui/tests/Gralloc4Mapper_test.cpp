@@ -0,0 +1,221 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Gralloc4MapperTest"
+
+#include <gralloctypes/Gralloc4.h>
+#include <gtest/gtest.h>
+#include <ui/Gralloc4.h>
+
+#include "mock/FakeMapper4.h"
+
+namespace android {
+namespace {
+
+using aidl::android::hardware::graphics::common::Dataspace;
+using aidl::android::hardware::graphics::common::Rect;
+using hardware::hidl_vec;
+using hardware::graphics::mapper::V4_0::IMapper;
+
+class Gralloc4MapperTest : public testing::Test {
+protected:
+    // Sets metadata behind the back of the Gralloc4Mapper, like another process would.
+    template <class T>
+    void setMetadata(buffer_handle_t buffer, const IMapper::MetadataType& metadataType,
+                     const T& metadata,
+                     status_t (*encodeFunction)(const T&, hidl_vec<uint8_t>*)) {
+        hidl_vec<uint8_t> encoded;
+        ASSERT_EQ(NO_ERROR, encodeFunction(metadata, &encoded));
+        mFakeMapper->set(const_cast<native_handle_t*>(buffer), metadataType, encoded);
+    }
+
+    void setWidth(buffer_handle_t buffer, uint64_t width) {
+        setMetadata(buffer, gralloc4::MetadataType_Width, width, gralloc4::encodeWidth);
+    }
+
+    void setDataspace(buffer_handle_t buffer, ui::Dataspace dataspace) {
+        setMetadata(buffer, gralloc4::MetadataType_Dataspace, static_cast<Dataspace>(dataspace),
+                    gralloc4::encodeDataspace);
+    }
+
+    const sp<mock::FakeMapper4> mFakeMapper = sp<mock::FakeMapper4>::make();
+    Gralloc4Mapper mMapper{mFakeMapper};
+
+    const buffer_handle_t mBuffer = reinterpret_cast<buffer_handle_t>(0x1000);
+    const buffer_handle_t mOtherBuffer = reinterpret_cast<buffer_handle_t>(0x2000);
+};
+
+TEST_F(Gralloc4MapperTest, cachesImmutableMetadata) {
+    setWidth(mBuffer, 1920);
+    setWidth(mOtherBuffer, 1080);
+
+    uint64_t width = 0;
+    EXPECT_EQ(NO_ERROR, mMapper.getWidth(mBuffer, &width));
+    EXPECT_EQ(1920u, width);
+    EXPECT_EQ(NO_ERROR, mMapper.getWidth(mBuffer, &width));
+    EXPECT_EQ(1920u, width);
+    EXPECT_EQ(1u, mFakeMapper->getCallCount());
+
+    EXPECT_EQ(NO_ERROR, mMapper.getWidth(mOtherBuffer, &width));
+    EXPECT_EQ(1080u, width);
+    EXPECT_EQ(2u, mFakeMapper->getCallCount());
+}
+
+TEST_F(Gralloc4MapperTest, doesNotCacheErrors) {
+    uint64_t width = 0;
+    EXPECT_NE(NO_ERROR, mMapper.getWidth(mBuffer, &width));
+
+    setWidth(mBuffer, 1920);
+    EXPECT_EQ(NO_ERROR, mMapper.getWidth(mBuffer, &width));
+    EXPECT_EQ(1920u, width);
+}
+
+TEST_F(Gralloc4MapperTest, freeBufferDropsCachedMetadata) {
+    setWidth(mBuffer, 1920);
+    uint64_t width = 0;
+    EXPECT_EQ(NO_ERROR, mMapper.getWidth(mBuffer, &width));
+
+    // A new buffer may be imported at the address of the freed one.
+    mMapper.freeBuffer(mBuffer);
+    setWidth(mBuffer, 640);
+
+    EXPECT_EQ(NO_ERROR, mMapper.getWidth(mBuffer, &width));
+    EXPECT_EQ(640u, width);
+}
+
+TEST_F(Gralloc4MapperTest, setDropsCachedMetadata) {
+    setWidth(mBuffer, 1920);
+    uint64_t width = 0;
+    EXPECT_EQ(NO_ERROR, mMapper.getWidth(mBuffer, &width));
+    EXPECT_EQ(1u, mFakeMapper->getCallCount());
+
+    EXPECT_EQ(NO_ERROR, mMapper.setDataspace(mBuffer, ui::Dataspace::SRGB));
+    EXPECT_EQ(NO_ERROR, mMapper.getWidth(mBuffer, &width));
+    EXPECT_EQ(1920u, width);
+    EXPECT_EQ(2u, mFakeMapper->getCallCount());
+}
+
+TEST_F(Gralloc4MapperTest, doesNotCacheMutableMetadata) {
+    EXPECT_EQ(NO_ERROR, mMapper.setDataspace(mBuffer, ui::Dataspace::SRGB));
+
+    ui::Dataspace dataspace = ui::Dataspace::UNKNOWN;
+    EXPECT_EQ(NO_ERROR, mMapper.getDataspace(mBuffer, &dataspace));
+    EXPECT_EQ(ui::Dataspace::SRGB, dataspace);
+
+    // The producer of the buffer may change its dataspace from another process.
+    setDataspace(mBuffer, ui::Dataspace::DISPLAY_P3);
+    EXPECT_EQ(NO_ERROR, mMapper.getDataspace(mBuffer, &dataspace));
+    EXPECT_EQ(ui::Dataspace::DISPLAY_P3, dataspace);
+}
+
+TEST_F(Gralloc4MapperTest, evictsLeastRecentlyUsedBuffer) {
+    // Matches Gralloc4Mapper::kMaxCachedBuffers.
+    constexpr uintptr_t kMaxCachedBuffers = 1024;
+    const auto buffer = [](uintptr_t i) { return reinterpret_cast<buffer_handle_t>(0x1000 * i); };
+    for (uintptr_t i = 1; i <= kMaxCachedBuffers + 1; i++) {
+        setWidth(buffer(i), i);
+    }
+
+    uint64_t width = 0;
+    for (uintptr_t i = 1; i <= kMaxCachedBuffers; i++) {
+        ASSERT_EQ(NO_ERROR, mMapper.getWidth(buffer(i), &width));
+    }
+    EXPECT_EQ(kMaxCachedBuffers, mFakeMapper->getCallCount());
+
+    // Using the oldest buffer again keeps it cached when the next buffer is added.
+    EXPECT_EQ(NO_ERROR, mMapper.getWidth(buffer(1), &width));
+    EXPECT_EQ(NO_ERROR, mMapper.getWidth(buffer(kMaxCachedBuffers + 1), &width));
+    EXPECT_EQ(kMaxCachedBuffers + 1, mFakeMapper->getCallCount());
+
+    EXPECT_EQ(NO_ERROR, mMapper.getWidth(buffer(1), &width));
+    EXPECT_EQ(1u, width);
+    EXPECT_EQ(kMaxCachedBuffers + 1, mFakeMapper->getCallCount());
+
+    // The least recently used buffer was evicted instead.
+    EXPECT_EQ(NO_ERROR, mMapper.getWidth(buffer(2), &width));
+    EXPECT_EQ(2u, width);
+    EXPECT_EQ(kMaxCachedBuffers + 2, mFakeMapper->getCallCount());
+}
+
+TEST_F(Gralloc4MapperTest, getFrameMetadata) {
+    const ui::Smpte2086 smpte2086 = {.primaryRed = {.x = 0.680f, .y = 0.320f},
+                                     .primaryGreen = {.x = 0.265f, .y = 0.690f},
+                                     .primaryBlue = {.x = 0.150f, .y = 0.060f},
+                                     .whitePoint = {.x = 0.3127f, .y = 0.3290f},
+                                     .maxLuminance = 1000.f,
+                                     .minLuminance = 0.005f};
+    const std::vector<Rect> crop = {{.left = 10, .top = 20, .right = 1910, .bottom = 1060}};
+
+    setDataspace(mBuffer, ui::Dataspace::BT2020_ITU_PQ);
+    setMetadata(mBuffer, gralloc4::MetadataType_Crop, crop, gralloc4::encodeCrop);
+    setMetadata(mBuffer, gralloc4::MetadataType_BlendMode, ui::BlendMode::PREMULTIPLIED,
+                gralloc4::encodeBlendMode);
+    setMetadata(mBuffer, gralloc4::MetadataType_Smpte2086, std::make_optional(smpte2086),
+                gralloc4::encodeSmpte2086);
+
+    ui::FrameMetadata metadata;
+    ASSERT_EQ(NO_ERROR, mMapper.getFrameMetadata(mBuffer, &metadata));
+    EXPECT_EQ(ui::Dataspace::BT2020_ITU_PQ, metadata.dataspace);
+    EXPECT_EQ(crop, metadata.crop);
+    EXPECT_EQ(ui::BlendMode::PREMULTIPLIED, metadata.blendMode);
+    EXPECT_EQ(smpte2086, metadata.smpte2086);
+    // Metadata that was never set keeps its default value.
+    EXPECT_EQ(std::nullopt, metadata.cta861_3);
+
+    // All of it is fetched with a single mapper call.
+    EXPECT_EQ(1u, mFakeMapper->getDumpBufferCallCount());
+    EXPECT_EQ(0u, mFakeMapper->getCallCount());
+
+    // It matches the metadata returned by the individual getters.
+    ui::Dataspace dataspace;
+    ui::BlendMode blendMode;
+    std::optional<ui::Smpte2086> smpte2086Out;
+    EXPECT_EQ(NO_ERROR, mMapper.getDataspace(mBuffer, &dataspace));
+    EXPECT_EQ(NO_ERROR, mMapper.getBlendMode(mBuffer, &blendMode));
+    EXPECT_EQ(NO_ERROR, mMapper.getSmpte2086(mBuffer, &smpte2086Out));
+    EXPECT_EQ(dataspace, metadata.dataspace);
+    EXPECT_EQ(blendMode, metadata.blendMode);
+    EXPECT_EQ(smpte2086Out, metadata.smpte2086);
+}
+
+TEST_F(Gralloc4MapperTest, getFrameMetadataWithoutDumpBuffer) {
+    mFakeMapper->setDumpBufferSupported(false);
+    const std::vector<Rect> crop = {{.left = 10, .top = 20, .right = 1910, .bottom = 1060}};
+
+    setDataspace(mBuffer, ui::Dataspace::BT2020_ITU_PQ);
+    setMetadata(mBuffer, gralloc4::MetadataType_Crop, crop, gralloc4::encodeCrop);
+
+    ui::FrameMetadata metadata;
+    ASSERT_EQ(NO_ERROR, mMapper.getFrameMetadata(mBuffer, &metadata));
+    EXPECT_EQ(ui::Dataspace::BT2020_ITU_PQ, metadata.dataspace);
+    EXPECT_EQ(crop, metadata.crop);
+    EXPECT_EQ(ui::BlendMode::INVALID, metadata.blendMode);
+    EXPECT_EQ(std::nullopt, metadata.smpte2086);
+    EXPECT_EQ(std::nullopt, metadata.cta861_3);
+}
+
+TEST_F(Gralloc4MapperTest, getFrameMetadataOfBufferWithoutMetadata) {
+    ui::FrameMetadata metadata;
+    ASSERT_EQ(NO_ERROR, mMapper.getFrameMetadata(mBuffer, &metadata));
+    EXPECT_EQ(ui::Dataspace::UNKNOWN, metadata.dataspace);
+    EXPECT_TRUE(metadata.crop.empty());
+    EXPECT_EQ(ui::BlendMode::INVALID, metadata.blendMode);
+    EXPECT_EQ(std::nullopt, metadata.smpte2086);
+    EXPECT_EQ(std::nullopt, metadata.cta861_3);
+}
+
+} // namespace
+} // namespace android
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <ui/Gralloc.h>
+#include <ui/GraphicBufferAllocator.h>
+#include <ui/PixelFormat.h>
+#include <utils/KeyedVector.h>
+#include <utils/Mutex.h>
+
+#include <atomic>
+#include <vector>
+
+namespace android {
+namespace {
+
+constexpr int kLiveBufferCount = 2000;
+constexpr int kBuffersPerIteration = 16;
+
+// Returns distinct fake handles without touching gralloc, so that the benchmark measures the
+// bookkeeping of GraphicBufferAllocator rather than the allocator HAL.
+class FakeGrallocAllocator : public GrallocAllocator {
+public:
+    bool isLoaded() const override { return true; }
+
+    std::string dumpDebugInfo(bool) const override { return {}; }
+
+    status_t allocate(std::string, uint32_t width, uint32_t, PixelFormat, uint32_t, uint64_t,
+                      uint32_t bufferCount, uint32_t* outStride, buffer_handle_t* outBufferHandles,
+                      bool) const override {
+        for (uint32_t i = 0; i < bufferCount; i++) {
+            // Space the handles like heap allocations of native_handle_t.
+            outBufferHandles[i] = reinterpret_cast<buffer_handle_t>(
+                    mNextHandle.fetch_add(64, std::memory_order_relaxed));
+        }
+        *outStride = width;
+        return NO_ERROR;
+    }
+
+private:
+    mutable std::atomic<uintptr_t> mNextHandle = 0x10000;
+};
+
+class FakeGraphicBufferAllocator : public GraphicBufferAllocator {
+public:
+    FakeGraphicBufferAllocator() { mAllocator = std::make_unique<const FakeGrallocAllocator>(); }
+
+    buffer_handle_t allocate(const std::string& requestorName) {
+        buffer_handle_t handle;
+        uint32_t stride;
+        GraphicBufferAllocator::allocate(256, 256, PIXEL_FORMAT_RGBA_8888, 1, 0, &handle, &stride,
+                                         requestorName);
+        return handle;
+    }
+
+    // The fake handles cannot be freed by the mapper, so only drop their records.
+    void free(buffer_handle_t handle) { sAllocations.remove(handle); }
+};
+
+FakeGraphicBufferAllocator& getAllocator() {
+    static FakeGraphicBufferAllocator allocator;
+    static const std::vector<buffer_handle_t> sLiveBuffers = [] {
+        std::vector<buffer_handle_t> buffers;
+        for (int i = 0; i < kLiveBufferCount; i++) {
+            buffers.push_back(allocator.allocate("LiveBuffer"));
+        }
+        return buffers;
+    }();
+    return allocator;
+}
+
+void BM_AllocateFree(benchmark::State& state) {
+    FakeGraphicBufferAllocator& allocator = getAllocator();
+    const std::string requestorName = "Thread" + std::to_string(state.thread_index());
+    buffer_handle_t handles[kBuffersPerIteration];
+
+    for (auto _ : state) {
+        for (buffer_handle_t& handle : handles) {
+            handle = allocator.allocate(requestorName);
+        }
+        for (buffer_handle_t handle : handles) {
+            allocator.free(handle);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kBuffersPerIteration);
+}
+BENCHMARK(BM_AllocateFree)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_GetTotalSize(benchmark::State& state) {
+    FakeGraphicBufferAllocator& allocator = getAllocator();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(allocator.getTotalSize());
+    }
+}
+BENCHMARK(BM_GetTotalSize);
+
+// The bookkeeping that GraphicBufferAllocator used before its records were sharded, for reference.
+struct KeyedVectorTracker {
+    struct Record {
+        uint64_t size;
+        std::string requestorName;
+    };
+
+    Mutex lock;
+    KeyedVector<buffer_handle_t, Record> records;
+};
+
+void BM_AllocateFree_KeyedVector(benchmark::State& state) {
+    static KeyedVectorTracker sTracker;
+    static std::atomic<uintptr_t> sNextHandle = 0x10000;
+    if (state.thread_index() == 0) {
+        Mutex::Autolock _l(sTracker.lock);
+        if (sTracker.records.isEmpty()) {
+            for (int i = 0; i < kLiveBufferCount; i++) {
+                sTracker.records.add(reinterpret_cast<buffer_handle_t>(sNextHandle.fetch_add(64)),
+                                     {256 * 256 * 4, "LiveBuffer"});
+            }
+        }
+    }
+
+    const std::string requestorName = "Thread" + std::to_string(state.thread_index());
+    buffer_handle_t handles[kBuffersPerIteration];
+
+    for (auto _ : state) {
+        for (buffer_handle_t& handle : handles) {
+            handle = reinterpret_cast<buffer_handle_t>(sNextHandle.fetch_add(64));
+            Mutex::Autolock _l(sTracker.lock);
+            sTracker.records.add(handle, {256 * 256 * 4, requestorName});
+        }
+        for (buffer_handle_t handle : handles) {
+            Mutex::Autolock _l(sTracker.lock);
+            sTracker.records.removeItem(handle);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kBuffersPerIteration);
+}
+BENCHMARK(BM_AllocateFree_KeyedVector)->ThreadRange(1, 8)->UseRealTime();
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
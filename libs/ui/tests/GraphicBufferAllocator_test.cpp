@@ -20,6 +20,7 @@
 #include <ui/GraphicBufferAllocator.h>
 #include <ui/PixelFormat.h>
 
+#include <android-base/stringprintf.h>
 #include <gtest/gtest.h>
 
 #include "mock/MockGrallocAllocator.h"
@@ -53,7 +54,16 @@ public:
                     allocate)
                 .WillOnce(DoAll(SetArgPointee<7>(stride), Return(err)));
     }
+    void setUpAllocateExpectations(buffer_handle_t handle, uint32_t stride) {
+        EXPECT_CALL(*(reinterpret_cast<const mock::MockGrallocAllocator*>(mAllocator.get())),
+                    allocate)
+                .WillOnce(DoAll(SetArgPointee<7>(stride), SetArgPointee<8>(handle),
+                                Return(NO_ERROR)));
+    }
     std::unique_ptr<const GrallocAllocator>& getAllocator() { return mAllocator; }
+
+    // The handles returned by the mock cannot be freed by the mapper, so only drop their records.
+    void untrack(buffer_handle_t handle) { sAllocations.remove(handle); }
 };
 
 class GraphicBufferAllocatorTest : public testing::Test {
@@ -113,4 +123,56 @@ TEST_F(GraphicBufferAllocatorTest, AllocateLargeStride) {
     ASSERT_EQ(NO_ERROR, err);
     ASSERT_EQ(expectedStride, stride);
 }
+
+TEST_F(GraphicBufferAllocatorTest, TracksSizeByRequestor) {
+    // Fake handles, which are only used as keys.
+    const auto handle1 = reinterpret_cast<buffer_handle_t>(0x1000);
+    const auto handle2 = reinterpret_cast<buffer_handle_t>(0x2000);
+    const auto handle3 = reinterpret_cast<buffer_handle_t>(0x3000);
+
+    const android::PixelFormat format = PIXEL_FORMAT_RGBA_8888;
+    const uint64_t bufferSize = kTestWidth * kTestHeight * 4;
+    const uint64_t totalSize = mAllocator.getTotalSize();
+    uint32_t stride = 0;
+    buffer_handle_t handle;
+
+    mAllocator.setUpAllocateExpectations(handle1, kTestWidth);
+    ASSERT_EQ(NO_ERROR,
+              mAllocator.allocate(kTestWidth, kTestHeight, format, kTestLayerCount, kTestUsage,
+                                  &handle, &stride, "TracksSizeByRequestor.A"));
+    mAllocator.setUpAllocateExpectations(handle2, kTestWidth);
+    ASSERT_EQ(NO_ERROR,
+              mAllocator.allocate(kTestWidth, kTestHeight, format, kTestLayerCount, kTestUsage,
+                                  &handle, &stride, "TracksSizeByRequestor.A"));
+    mAllocator.setUpAllocateExpectations(handle3, kTestWidth);
+    ASSERT_EQ(NO_ERROR,
+              mAllocator.allocate(kTestWidth, kTestHeight, format, kTestLayerCount, kTestUsage,
+                                  &handle, &stride, "TracksSizeByRequestor.B"));
+
+    EXPECT_EQ(totalSize + 3 * bufferSize, mAllocator.getTotalSize());
+    auto sizes = mAllocator.getTotalSizeByRequestor();
+    EXPECT_EQ(2 * bufferSize, sizes["TracksSizeByRequestor.A"]);
+    EXPECT_EQ(bufferSize, sizes["TracksSizeByRequestor.B"]);
+
+    // Records are dumped in handle order, regardless of how they are stored.
+    std::string dump;
+    mAllocator.dump(dump);
+    const size_t pos1 = dump.find(base::StringPrintf("%10p", handle1));
+    const size_t pos2 = dump.find(base::StringPrintf("%10p", handle2));
+    const size_t pos3 = dump.find(base::StringPrintf("%10p", handle3));
+    ASSERT_NE(std::string::npos, pos1);
+    EXPECT_LT(pos1, pos2);
+    EXPECT_LT(pos2, pos3);
+
+    mAllocator.untrack(handle1);
+    mAllocator.untrack(handle3);
+
+    EXPECT_EQ(totalSize + bufferSize, mAllocator.getTotalSize());
+    sizes = mAllocator.getTotalSizeByRequestor();
+    EXPECT_EQ(bufferSize, sizes["TracksSizeByRequestor.A"]);
+    EXPECT_EQ(0u, sizes.count("TracksSizeByRequestor.B"));
+
+    mAllocator.untrack(handle2);
+    EXPECT_EQ(totalSize, mAllocator.getTotalSize());
+}
 } // namespace android
@@ -179,5 +179,29 @@ TEST_F(RegionTest, RegionHash) {
     EXPECT_NE(std::hash<Region>{}(region1), std::hash<Region>{}(region2));
 }
 
+TEST_F(RegionTest, FlipSelf_MatchesRectByRectMirroring) {
+    Region region(Rect(-40, -40, 200, 200));
+    region.subtractSelf(Rect(0, 0, 50, 50));
+    region.subtractSelf(Rect(100, 20, 120, 160));
+    region.orSelf(Rect(300, 10, 310, 500));
+
+    for (const bool horizontal : {false, true}) {
+        for (const bool vertical : {false, true}) {
+            Region expected;
+            for (const Rect& rect : region) {
+                expected.orSelf(Rect(horizontal ? -rect.right : rect.left,
+                                     vertical ? -rect.bottom : rect.top,
+                                     horizontal ? -rect.left : rect.right,
+                                     vertical ? -rect.top : rect.bottom));
+            }
+
+            Region flipped(region);
+            flipped.flipSelf(horizontal, vertical);
+            EXPECT_TRUE(expected.hasSameRects(flipped));
+            EXPECT_EQ(expected.bounds(), flipped.bounds());
+        }
+    }
+}
+
 }; // namespace android
 
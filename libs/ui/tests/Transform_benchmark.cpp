@@ -0,0 +1,86 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <ui/Region.h>
+#include <ui/Transform.h>
+
+namespace android::ui {
+namespace {
+
+enum TransformKind { kIdentity, kTranslate, kFlip, kRotate90, kScale, kRotate45 };
+
+Transform makeTransform(int64_t kind) {
+    Transform t;
+    switch (kind) {
+        case kIdentity:
+            break;
+        case kTranslate:
+            t.set(120, 340);
+            break;
+        case kFlip:
+            t.set(Transform::ROT_180, 1080, 2340);
+            break;
+        case kRotate90:
+            t.set(Transform::ROT_90, 1080, 2340);
+            break;
+        case kScale:
+            t.set(1.5f, 0, 0, 1.5f);
+            t.set(12.5f, 3.f);
+            break;
+        case kRotate45:
+            t.set(0.7071f, -0.7071f, 0.7071f, 0.7071f);
+            break;
+    }
+    return t;
+}
+
+// A region made of many bands, like the visible region of a window partially covered by others.
+Region makeRegion(int64_t bands) {
+    Region region;
+    for (int i = 0; i < bands; i++) {
+        region.orSelf(Rect(i * 10, i * 7, i * 10 + 35, i * 7 + 9));
+    }
+    return region;
+}
+
+void BM_TransformRect(benchmark::State& state) {
+    const Transform t = makeTransform(state.range(0));
+    Rect rect(10, 20, 1000, 2000);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(rect);
+        Rect result = t.transform(rect);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_TransformRect)->DenseRange(kIdentity, kRotate45);
+
+void BM_TransformRegion(benchmark::State& state) {
+    const Transform t = makeTransform(state.range(0));
+    const Region region = makeRegion(state.range(1));
+    for (auto _ : state) {
+        Region result = t.transform(region);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_TransformRegion)
+        ->ArgsProduct({benchmark::CreateDenseRange(kIdentity, kRotate45, 1), {1, 16, 128}});
+
+} // namespace
+} // namespace android::ui
+
+BENCHMARK_MAIN();
@@ -14,11 +14,125 @@
  * limitations under the License.
  */
 
+#include <ui/Region.h>
 #include <ui/Transform.h>
 
 #include <gtest/gtest.h>
 
+#include <cmath>
+#include <vector>
+
 namespace android::ui {
+namespace {
+
+// Reference implementations that map all four corners of every rect in float math, which is what
+// Transform did before it special-cased axis aligned mappings.
+Rect referenceTransform(const Transform& t, const Rect& bounds, bool roundOutwards) {
+    const vec2 lt = t.transform(vec2(bounds.left, bounds.top));
+    const vec2 rt = t.transform(vec2(bounds.right, bounds.top));
+    const vec2 lb = t.transform(vec2(bounds.left, bounds.bottom));
+    const vec2 rb = t.transform(vec2(bounds.right, bounds.bottom));
+    const float left = std::min({lt[0], rt[0], lb[0], rb[0]});
+    const float top = std::min({lt[1], rt[1], lb[1], rb[1]});
+    const float right = std::max({lt[0], rt[0], lb[0], rb[0]});
+    const float bottom = std::max({lt[1], rt[1], lb[1], rb[1]});
+    if (roundOutwards) {
+        return Rect(static_cast<int32_t>(floorf(left)), static_cast<int32_t>(floorf(top)),
+                    static_cast<int32_t>(ceilf(right)), static_cast<int32_t>(ceilf(bottom)));
+    }
+    return Rect(static_cast<int32_t>(floorf(left + 0.5f)), static_cast<int32_t>(floorf(top + 0.5f)),
+                static_cast<int32_t>(floorf(right + 0.5f)),
+                static_cast<int32_t>(floorf(bottom + 0.5f)));
+}
+
+Region referenceTransform(const Transform& t, const Region& region) {
+    Region out;
+    if (t.getType() <= Transform::TRANSLATE) {
+        return region.translate(static_cast<int>(floorf(t.tx() + 0.5f)),
+                                static_cast<int>(floorf(t.ty() + 0.5f)));
+    }
+    if (!t.preserveRects()) {
+        out.set(referenceTransform(t, region.bounds(), false));
+        return out;
+    }
+    for (const Rect& rect : region) {
+        out.orSelf(referenceTransform(t, rect, false));
+    }
+    return out;
+}
+
+std::vector<Transform> testTransforms() {
+    std::vector<Transform> transforms;
+    transforms.emplace_back();
+
+    Transform translate;
+    translate.set(12, -34);
+    transforms.push_back(translate);
+
+    Transform subpixelTranslate;
+    subpixelTranslate.set(10.5f, -3.25f);
+    transforms.push_back(subpixelTranslate);
+
+    const uint32_t orientations[] = {Transform::ROT_0,   Transform::FLIP_H,
+                                     Transform::FLIP_V,  Transform::ROT_90,
+                                     Transform::ROT_180, Transform::ROT_270,
+                                     Transform::FLIP_H | Transform::ROT_90,
+                                     Transform::FLIP_V | Transform::ROT_90};
+    for (const uint32_t flags : orientations) {
+        transforms.emplace_back(flags, 1080, 2340);
+        transforms.emplace_back(flags);
+        transforms.push_back(transforms.back() * translate);
+        transforms.push_back(transforms.back() * subpixelTranslate);
+    }
+
+    Transform scale;
+    scale.set(2.5f, 0, 0, 0.75f);
+    transforms.push_back(scale);
+    transforms.push_back(translate * scale);
+    transforms.push_back(Transform(Transform::ROT_90, 100, 200) * scale);
+
+    Transform mirroredScale;
+    mirroredScale.set(-2.0f, 0, 0, 3.0f);
+    transforms.push_back(mirroredScale * subpixelTranslate);
+
+    Transform rotate45;
+    const float c = std::cos(static_cast<float>(M_PI) / 4.f);
+    rotate45.set(c, -c, c, c);
+    transforms.push_back(rotate45);
+    transforms.push_back(translate * rotate45);
+    return transforms;
+}
+
+std::vector<Rect> testRects() {
+    return {Rect(0, 0, 100, 200),     Rect(-50, -60, 70, 80),        Rect(5, 7, 5, 9),
+            Rect(30, 40, 10, 20),     Rect(0, 0, 0, 0),              Rect(-1000, 3, 1000, 4),
+            Rect(0, 0, 1 << 22, 1 << 22), Rect(-(1 << 25) - 1, 0, (1 << 25) + 1, 17)};
+}
+
+std::vector<Region> testRegions() {
+    std::vector<Region> regions;
+    regions.emplace_back();
+    regions.emplace_back(Rect(10, 20, 300, 400));
+
+    Region lShape(Rect(0, 0, 100, 20));
+    lShape.orSelf(Rect(0, 20, 20, 100));
+    regions.push_back(lShape);
+
+    Region holes(Rect(-40, -40, 200, 200));
+    holes.subtractSelf(Rect(0, 0, 50, 50));
+    holes.subtractSelf(Rect(100, 20, 120, 160));
+    holes.orSelf(Rect(300, 10, 310, 500));
+    regions.push_back(holes);
+
+    Region staircase;
+    for (int i = 0; i < 20; i++) {
+        staircase.orSelf(Rect(i * 10, i * 7, i * 10 + 35, i * 7 + 9));
+    }
+    regions.push_back(staircase);
+    return regions;
+}
+
+} // namespace
 
 TEST(TransformTest, inverseRotation_hasCorrectType) {
     const auto testRotationFlagsForInverse = [](Transform::RotationFlags rotation,
@@ -46,4 +160,68 @@ TEST(TransformTest, inverseRotation_hasCorrectType) {
     testRotationFlagsForInverse(Transform::FLIP_V, Transform::FLIP_V, false);
 }
 
+TEST(TransformTest, transformRect_matchesFourCornerEvaluation) {
+    for (const Transform& t : testTransforms()) {
+        for (const Rect& rect : testRects()) {
+            SCOPED_TRACE(::testing::PrintToString(t));
+            EXPECT_EQ(referenceTransform(t, rect, false), t.transform(rect));
+            EXPECT_EQ(referenceTransform(t, rect, true), t.transform(rect, true));
+        }
+    }
+}
+
+TEST(TransformTest, transformFloatRect_matchesFourCornerEvaluation) {
+    for (const Transform& t : testTransforms()) {
+        for (const Rect& rect : testRects()) {
+            SCOPED_TRACE(::testing::PrintToString(t));
+            const FloatRect bounds = rect.toFloatRect();
+            const vec2 lt = t.transform(vec2(bounds.left, bounds.top));
+            const vec2 rt = t.transform(vec2(bounds.right, bounds.top));
+            const vec2 lb = t.transform(vec2(bounds.left, bounds.bottom));
+            const vec2 rb = t.transform(vec2(bounds.right, bounds.bottom));
+            const FloatRect expected(std::min({lt[0], rt[0], lb[0], rb[0]}),
+                                     std::min({lt[1], rt[1], lb[1], rb[1]}),
+                                     std::max({lt[0], rt[0], lb[0], rb[0]}),
+                                     std::max({lt[1], rt[1], lb[1], rb[1]}));
+            EXPECT_EQ(expected, t.transform(bounds));
+        }
+    }
+}
+
+TEST(TransformTest, transformRegion_matchesRectByRectEvaluation) {
+    for (const Transform& t : testTransforms()) {
+        for (const Region& region : testRegions()) {
+            SCOPED_TRACE(::testing::PrintToString(t));
+            const Region expected = referenceTransform(t, region);
+            const Region actual = t.transform(region);
+            EXPECT_TRUE(expected.hasSameRects(actual));
+            EXPECT_EQ(expected.bounds(), actual.bounds());
+        }
+    }
+}
+
+TEST(TransformTest, transformRect_tracksMatrixUpdates) {
+    Transform t;
+    const Rect rect(10, 20, 30, 40);
+    EXPECT_EQ(rect, t.transform(rect));
+
+    t.set(5, 7);
+    EXPECT_EQ(Rect(15, 27, 35, 47), t.transform(rect));
+
+    t.set(-1, 0, 0, 1);
+    EXPECT_EQ(Rect(-25, 27, -5, 47), t.transform(rect));
+
+    t.set(Transform::ROT_90, 100, 200);
+    EXPECT_EQ(Rect(60, 10, 80, 30), t.transform(rect));
+
+    t.set({2, 0, 0, 0, 2, 0, 0, 0, 1});
+    EXPECT_EQ(Rect(20, 40, 60, 80), t.transform(rect));
+
+    t = Transform(Transform::FLIP_V, 0, 100).inverse();
+    EXPECT_EQ(Rect(10, 60, 30, 80), t.transform(rect));
+
+    t.reset();
+    EXPECT_EQ(rect, t.transform(rect));
+}
+
 } // namespace android::ui
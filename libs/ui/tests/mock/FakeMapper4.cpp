@@ -0,0 +1,141 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FakeMapper4.h"
+
+namespace android {
+namespace mock {
+
+using hardware::hidl_handle;
+using hardware::hidl_vec;
+using hardware::Return;
+using hardware::Void;
+
+FakeMapper4::FakeMapper4() = default;
+FakeMapper4::~FakeMapper4() = default;
+
+Return<void> FakeMapper4::createDescriptor(const BufferDescriptorInfo&,
+                                           createDescriptor_cb hidl_cb) {
+    hidl_cb(Error::UNSUPPORTED, {});
+    return Void();
+}
+
+Return<void> FakeMapper4::importBuffer(const hidl_handle&, importBuffer_cb hidl_cb) {
+    hidl_cb(Error::UNSUPPORTED, nullptr);
+    return Void();
+}
+
+Return<FakeMapper4::Error> FakeMapper4::freeBuffer(void* buffer) {
+    mMetadata.erase(buffer);
+    return Error::NONE;
+}
+
+Return<FakeMapper4::Error> FakeMapper4::validateBufferSize(void*, const BufferDescriptorInfo&,
+                                                           uint32_t) {
+    return Error::UNSUPPORTED;
+}
+
+Return<void> FakeMapper4::getTransportSize(void*, getTransportSize_cb hidl_cb) {
+    hidl_cb(Error::UNSUPPORTED, 0, 0);
+    return Void();
+}
+
+Return<void> FakeMapper4::lock(void*, uint64_t, const Rect&, const hidl_handle&, lock_cb hidl_cb) {
+    hidl_cb(Error::UNSUPPORTED, nullptr);
+    return Void();
+}
+
+Return<void> FakeMapper4::unlock(void*, unlock_cb hidl_cb) {
+    hidl_cb(Error::UNSUPPORTED, nullptr);
+    return Void();
+}
+
+Return<void> FakeMapper4::flushLockedBuffer(void*, flushLockedBuffer_cb hidl_cb) {
+    hidl_cb(Error::UNSUPPORTED, nullptr);
+    return Void();
+}
+
+Return<FakeMapper4::Error> FakeMapper4::rereadLockedBuffer(void*) {
+    return Error::UNSUPPORTED;
+}
+
+Return<void> FakeMapper4::isSupported(const BufferDescriptorInfo&, isSupported_cb hidl_cb) {
+    hidl_cb(Error::NONE, false);
+    return Void();
+}
+
+Return<void> FakeMapper4::get(void* buffer, const MetadataType& metadataType, get_cb hidl_cb) {
+    mGetCallCount++;
+    const auto& metadata = mMetadata[buffer];
+    const auto it = metadata.find({metadataType.name, metadataType.value});
+    if (it == metadata.end()) {
+        hidl_cb(Error::UNSUPPORTED, {});
+    } else {
+        hidl_cb(Error::NONE, it->second);
+    }
+    return Void();
+}
+
+Return<FakeMapper4::Error> FakeMapper4::set(void* buffer, const MetadataType& metadataType,
+                                            const hidl_vec<uint8_t>& metadata) {
+    mMetadata[buffer][{metadataType.name, metadataType.value}] = metadata;
+    return Error::NONE;
+}
+
+Return<void> FakeMapper4::getFromBufferDescriptorInfo(const BufferDescriptorInfo&,
+                                                      const MetadataType&,
+                                                      getFromBufferDescriptorInfo_cb hidl_cb) {
+    hidl_cb(Error::UNSUPPORTED, {});
+    return Void();
+}
+
+Return<void> FakeMapper4::listSupportedMetadataTypes(listSupportedMetadataTypes_cb hidl_cb) {
+    hidl_cb(Error::UNSUPPORTED, {});
+    return Void();
+}
+
+Return<void> FakeMapper4::dumpBuffer(void* buffer, dumpBuffer_cb hidl_cb) {
+    mDumpBufferCallCount++;
+    if (!mDumpBufferSupported) {
+        hidl_cb(Error::UNSUPPORTED, {});
+        return Void();
+    }
+
+    const auto& metadata = mMetadata[buffer];
+    BufferDump bufferDump;
+    bufferDump.metadataDump.resize(metadata.size());
+    size_t i = 0;
+    for (const auto& [key, value] : metadata) {
+        bufferDump.metadataDump[i].metadataType = {.name = key.first, .value = key.second};
+        bufferDump.metadataDump[i].metadata = value;
+        i++;
+    }
+    hidl_cb(Error::NONE, bufferDump);
+    return Void();
+}
+
+Return<void> FakeMapper4::dumpBuffers(dumpBuffers_cb hidl_cb) {
+    hidl_cb(Error::UNSUPPORTED, {});
+    return Void();
+}
+
+Return<void> FakeMapper4::getReservedRegion(void*, getReservedRegion_cb hidl_cb) {
+    hidl_cb(Error::UNSUPPORTED, nullptr, 0);
+    return Void();
+}
+
+} // namespace mock
+} // namespace android
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android/hardware/graphics/mapper/4.0/IMapper.h>
+
+#include <map>
+#include <string>
+#include <utility>
+
+namespace android {
+namespace mock {
+
+// An in-memory IMapper which stores the encoded metadata that is set on each buffer, and counts
+// calls to get and dumpBuffer. Buffers are opaque keys; they are never dereferenced. All other
+// operations are unsupported.
+class FakeMapper4 : public hardware::graphics::mapper::V4_0::IMapper {
+public:
+    using Error = hardware::graphics::mapper::V4_0::Error;
+    using MetadataType = hardware::graphics::mapper::V4_0::IMapper::MetadataType;
+
+    FakeMapper4();
+    ~FakeMapper4() override;
+
+    size_t getCallCount() const { return mGetCallCount; }
+    size_t getDumpBufferCallCount() const { return mDumpBufferCallCount; }
+
+    // Makes dumpBuffer return UNSUPPORTED, like mappers which do not implement it.
+    void setDumpBufferSupported(bool supported) { mDumpBufferSupported = supported; }
+
+    hardware::Return<void> createDescriptor(const BufferDescriptorInfo& description,
+                                            createDescriptor_cb hidl_cb) override;
+    hardware::Return<void> importBuffer(const hardware::hidl_handle& rawHandle,
+                                        importBuffer_cb hidl_cb) override;
+    hardware::Return<Error> freeBuffer(void* buffer) override;
+    hardware::Return<Error> validateBufferSize(void* buffer,
+                                               const BufferDescriptorInfo& description,
+                                               uint32_t stride) override;
+    hardware::Return<void> getTransportSize(void* buffer, getTransportSize_cb hidl_cb) override;
+    hardware::Return<void> lock(void* buffer, uint64_t cpuUsage, const Rect& accessRegion,
+                                const hardware::hidl_handle& acquireFence,
+                                lock_cb hidl_cb) override;
+    hardware::Return<void> unlock(void* buffer, unlock_cb hidl_cb) override;
+    hardware::Return<void> flushLockedBuffer(void* buffer, flushLockedBuffer_cb hidl_cb) override;
+    hardware::Return<Error> rereadLockedBuffer(void* buffer) override;
+    hardware::Return<void> isSupported(const BufferDescriptorInfo& description,
+                                       isSupported_cb hidl_cb) override;
+    hardware::Return<void> get(void* buffer, const MetadataType& metadataType,
+                               get_cb hidl_cb) override;
+    hardware::Return<Error> set(void* buffer, const MetadataType& metadataType,
+                                const hardware::hidl_vec<uint8_t>& metadata) override;
+    hardware::Return<void> getFromBufferDescriptorInfo(
+            const BufferDescriptorInfo& description, const MetadataType& metadataType,
+            getFromBufferDescriptorInfo_cb hidl_cb) override;
+    hardware::Return<void> listSupportedMetadataTypes(
+            listSupportedMetadataTypes_cb hidl_cb) override;
+    hardware::Return<void> dumpBuffer(void* buffer, dumpBuffer_cb hidl_cb) override;
+    hardware::Return<void> dumpBuffers(dumpBuffers_cb hidl_cb) override;
+    hardware::Return<void> getReservedRegion(void* buffer, getReservedRegion_cb hidl_cb) override;
+
+private:
+    using MetadataKey = std::pair<std::string, int64_t>;
+
+    std::map<void*, std::map<MetadataKey, hardware::hidl_vec<uint8_t>>> mMetadata;
+    size_t mGetCallCount = 0;
+    size_t mDumpBufferCallCount = 0;
+    bool mDumpBufferSupported = true;
+};
+
+} // namespace mock
+} // namespace android
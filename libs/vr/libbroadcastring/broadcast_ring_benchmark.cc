@@ -0,0 +1,92 @@
+#include "libbroadcastring/broadcast_ring.h"
+#include "libbroadcastring/multi_producer_broadcast_ring.h"
+
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace android {
+namespace dvr {
+namespace {
+
+constexpr uint32_t kCapacity = 1 << 20;
+
+struct alignas(8) Record {
+  char v[256];
+};
+
+struct RingRecordTraits : public DefaultRingTraits {
+  static constexpr uint32_t kStaticRecordCount = kCapacity / sizeof(Record);
+};
+
+using Ring = BroadcastRing<Record, RingRecordTraits>;
+
+// Rings shared by all the threads of a benchmark. They are never torn down,
+// since both rings simply overwrite their oldest records.
+Ring* GetRing() {
+  static std::unique_ptr<char[]> mmap(new char[Ring::MemorySize()]);
+  static Ring ring = Ring::Create(mmap.get(), Ring::MemorySize());
+  return &ring;
+}
+
+using MultiRing = MultiProducerBroadcastRing;
+
+MultiRing* GetMultiRing() {
+  static constexpr size_t kSize = MultiRing::MemorySize(kCapacity);
+  static std::unique_ptr<char[]> mmap(new char[kSize]);
+  static MultiRing ring = MultiRing::Create(mmap.get(), kSize, kCapacity);
+  return &ring;
+}
+
+// Baseline: the single writer ring with fixed 256 byte records.
+void BM_BroadcastRing_Put(benchmark::State& state) {
+  Ring* ring = GetRing();
+  Record record{};
+  for (auto _ : state)
+    ring->Put(record);
+  state.SetBytesProcessed(state.iterations() * sizeof(Record));
+}
+BENCHMARK(BM_BroadcastRing_Put);
+
+// Records of state.range(0) bytes put by an increasing number of threads.
+void BM_MultiProducerBroadcastRing_Put(benchmark::State& state) {
+  MultiRing* ring = GetMultiRing();
+  const std::vector<char> record(state.range(0));
+  for (auto _ : state)
+    ring->Put(record.data(), record.size());
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * record.size());
+}
+BENCHMARK(BM_MultiProducerBroadcastRing_Put)
+    ->Arg(16)
+    ->Arg(256)
+    ->Arg(4096)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// Reads every record of a full ring of state.range(0) byte records.
+void BM_MultiProducerBroadcastRing_Get(benchmark::State& state) {
+  constexpr size_t kSize = MultiRing::MemorySize(kCapacity);
+  std::unique_ptr<char[]> mmap(new char[kSize]);
+  MultiRing ring = MultiRing::Create(mmap.get(), kSize, kCapacity);
+  std::vector<char> record(state.range(0));
+  for (size_t filled = 0; filled < kCapacity; filled += record.size())
+    ring.Put(record.data(), record.size());
+
+  uint32_t sequence = ring.GetOldestSequence();
+  uint32_t size;
+  for (auto _ : state) {
+    if (!ring.Get(&sequence, record.data(), record.size(), &size))
+      sequence = ring.GetOldestSequence();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * record.size());
+}
+BENCHMARK(BM_MultiProducerBroadcastRing_Get)->Arg(16)->Arg(256)->Arg(4096);
+
+}  // namespace
+}  // namespace dvr
+}  // namespace android
+
+BENCHMARK_MAIN();
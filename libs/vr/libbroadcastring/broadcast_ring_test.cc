@@ -1,8 +1,10 @@
 #include "libbroadcastring/broadcast_ring.h"
+#include "libbroadcastring/multi_producer_broadcast_ring.h"
 
 #include <stdlib.h>
 #include <memory>
 #include <thread>  // NOLINT
+#include <vector>
 #include <sys/mman.h>
 
 #include <gtest/gtest.h>
@@ -862,5 +864,304 @@ TEST(BroadcastRingTest, ThreadedOverwriteTortureLarge) {
   ThreadedOverwriteTorture<Dynamic_256_NxM_1plus0::Ring>();
 }
 
+//
+// MultiProducerBroadcastRing
+//
+
+using MultiRing = MultiProducerBroadcastRing;
+
+FakeMmap CreateMultiRing(MultiRing* ring, uint32_t capacity) {
+  FakeMmap mmap(MultiRing::MemorySize(capacity));
+  *ring = MultiRing::Create(mmap.mmap(), mmap.size, capacity);
+  return mmap;
+}
+
+// Builds a record whose contents can be checked without knowing which record
+// was expected: the first two bytes are the producer and the record length
+// modulo 256, and the rest is a pattern derived from both.
+std::vector<char> MultiRecord(uint8_t producer, uint32_t index,
+                              uint32_t length) {
+  std::vector<char> record(length);
+  for (uint32_t i = 0; i < length; ++i)
+    record[i] = static_cast<char>(producer * 31 + index + i);
+  if (length >= 2) {
+    record[0] = static_cast<char>(producer);
+    record[1] = static_cast<char>(index);
+  }
+  return record;
+}
+
+bool IsMultiRecord(const char* data, uint32_t length) {
+  if (length < 2)
+    return true;
+  const auto producer = static_cast<uint8_t>(data[0]);
+  const auto index = static_cast<uint8_t>(data[1]);
+  return MultiRecord(producer, index, length) ==
+         std::vector<char>(data, data + length);
+}
+
+TEST(MultiProducerBroadcastRingTest, PutGet) {
+  MultiRing ring;
+  auto mmap = CreateMultiRing(&ring, 1024);
+  EXPECT_EQ(1024U, ring.capacity());
+
+  uint32_t sequence = ring.GetNextSequence();
+  std::vector<char> buffer(ring.max_record_size());
+  uint32_t size;
+  EXPECT_FALSE(ring.Get(&sequence, buffer.data(), buffer.size(), &size));
+
+  for (uint32_t length : {0U, 1U, 7U, 8U, 9U, 100U}) {
+    const auto record = MultiRecord(1, length, length);
+    ASSERT_TRUE(ring.Put(record.data(), length));
+    ASSERT_TRUE(ring.Get(&sequence, buffer.data(), buffer.size(), &size));
+    ASSERT_EQ(length, size);
+    EXPECT_EQ(record, std::vector<char>(buffer.begin(), buffer.begin() + size));
+    EXPECT_EQ(ring.GetNextSequence(), sequence);
+    EXPECT_FALSE(ring.Get(&sequence, buffer.data(), buffer.size(), &size));
+  }
+}
+
+TEST(MultiProducerBroadcastRingTest, ShouldWrapAroundWithPadding) {
+  MultiRing ring;
+  auto mmap = CreateMultiRing(&ring, 256);
+
+  // Lengths that do not divide the ring exercise the padding at its end.
+  uint32_t sequence = ring.GetNextSequence();
+  std::vector<char> buffer(ring.max_record_size());
+  for (uint32_t i = 0; i < 1000; ++i) {
+    const uint32_t length = 1 + (i * 37) % ring.max_record_size();
+    const auto record = MultiRecord(2, i, length);
+    ASSERT_TRUE(ring.Put(record.data(), length));
+
+    uint32_t size;
+    ASSERT_TRUE(ring.Get(&sequence, buffer.data(), buffer.size(), &size));
+    ASSERT_EQ(length, size);
+    ASSERT_EQ(record,
+              std::vector<char>(buffer.begin(), buffer.begin() + size));
+  }
+}
+
+TEST(MultiProducerBroadcastRingTest, ShouldSkipOverwrittenRecords) {
+  MultiRing ring;
+  auto mmap = CreateMultiRing(&ring, 256);
+
+  uint32_t sequence = ring.GetOldestSequence();
+  constexpr uint32_t kRecordCount = 100;
+  constexpr uint32_t kLength = 20;
+  for (uint32_t i = 0; i < kRecordCount; ++i) {
+    const auto record = MultiRecord(3, i, kLength);
+    ASSERT_TRUE(ring.Put(record.data(), kLength));
+  }
+
+  // The reader starts over from the oldest record that is still available.
+  std::vector<char> buffer(kLength);
+  uint32_t size;
+  uint32_t count = 0;
+  uint8_t last_index = 0;
+  while (ring.Get(&sequence, buffer.data(), buffer.size(), &size)) {
+    ASSERT_EQ(kLength, size);
+    ASSERT_TRUE(IsMultiRecord(buffer.data(), size));
+    last_index = static_cast<uint8_t>(buffer[1]);
+    count++;
+  }
+  EXPECT_LT(0U, count);
+  EXPECT_GT(ring.capacity() / kLength, count);
+  EXPECT_EQ(static_cast<uint8_t>(kRecordCount - 1), last_index);
+}
+
+TEST(MultiProducerBroadcastRingTest, ShouldTruncateToBufferSize) {
+  MultiRing ring;
+  auto mmap = CreateMultiRing(&ring, 256);
+
+  const auto record = MultiRecord(4, 0, 50);
+  ASSERT_TRUE(ring.Put(record.data(), record.size()));
+
+  uint32_t sequence = ring.GetOldestSequence();
+  std::vector<char> buffer(10, 0);
+  uint32_t size;
+  ASSERT_TRUE(ring.Get(&sequence, buffer.data(), buffer.size(), &size));
+  EXPECT_EQ(record.size(), size);
+  EXPECT_EQ(std::vector<char>(record.begin(), record.begin() + buffer.size()),
+            buffer);
+}
+
+TEST(MultiProducerBroadcastRingTest, ShouldRejectOversizedRecord) {
+  MultiRing ring;
+  auto mmap = CreateMultiRing(&ring, 256);
+
+  std::vector<char> record(ring.max_record_size() + 1);
+  const uint32_t next_sequence = ring.GetNextSequence();
+  EXPECT_FALSE(ring.Put(record.data(), record.size()));
+  EXPECT_EQ(next_sequence, ring.GetNextSequence());
+  EXPECT_TRUE(ring.Put(record.data(), ring.max_record_size()));
+}
+
+TEST(MultiProducerBroadcastRingTest, ShouldRecoverFromBadSequence) {
+  MultiRing ring;
+  auto mmap = CreateMultiRing(&ring, 256);
+
+  const auto record = MultiRecord(5, 0, 40);
+  ASSERT_TRUE(ring.Put(record.data(), record.size()));
+
+  // A sequence in the middle of a record goes back to the oldest record.
+  uint32_t sequence = ring.GetOldestSequence() + 8;
+  std::vector<char> buffer(record.size());
+  uint32_t size;
+  ASSERT_TRUE(ring.Get(&sequence, buffer.data(), buffer.size(), &size));
+  EXPECT_EQ(record, buffer);
+}
+
+TEST(MultiProducerBroadcastRingTest, ShouldFailImportIfGeometryInvalid) {
+  MultiRing ring;
+  auto mmap = CreateMultiRing(&ring, 256);
+
+  bool import_ok;
+  std::tie(ring, import_ok) = MultiRing::Import(mmap.mmap(), mmap.size - 1);
+  EXPECT_FALSE(import_ok);
+  std::tie(ring, import_ok) = MultiRing::Import(mmap.mmap(), mmap.size);
+  EXPECT_TRUE(import_ok);
+  EXPECT_EQ(256U, ring.capacity());
+
+  // Corrupt the capacity.
+  *static_cast<uint32_t*>(mmap.mmap()) = 255;
+  std::tie(ring, import_ok) = MultiRing::Import(mmap.mmap(), mmap.size);
+  EXPECT_FALSE(import_ok);
+
+  EXPECT_DEATH_IF_SUPPORTED(
+      { MultiRing::Create(mmap.mmap(), mmap.size, 128 + 64); }, "");
+  EXPECT_DEATH_IF_SUPPORTED({ MultiRing::Create(mmap.mmap(), mmap.size, 32); },
+                            "");
+}
+
+TEST(MultiProducerBroadcastRingTest, ShouldImportIfReadonlyMmap) {
+  constexpr uint32_t kCapacity = 1024;
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t mmap_size = (MultiRing::MemorySize(kCapacity) + (page_size - 1)) &
+                     ~(page_size - 1);
+
+  void* mmap_base = mmap(nullptr, mmap_size, PROT_READ | PROT_WRITE,
+                         MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  ASSERT_NE(MAP_FAILED, mmap_base);
+
+  MultiRing ring = MultiRing::Create(mmap_base, mmap_size, kCapacity);
+  for (uint32_t i = 0; i < 10; ++i) {
+    const auto record = MultiRecord(6, i, i * 3);
+    ASSERT_TRUE(ring.Put(record.data(), record.size()));
+  }
+
+  ASSERT_EQ(0, mprotect(mmap_base, mmap_size, PROT_READ));
+
+  {
+    MultiRing imported_ring;
+    bool import_ok;
+    std::tie(imported_ring, import_ok) =
+        MultiRing::Import(mmap_base, mmap_size);
+    EXPECT_TRUE(import_ok);
+
+    uint32_t sequence = imported_ring.GetOldestSequence();
+    std::vector<char> buffer(imported_ring.max_record_size());
+    uint32_t size;
+    for (uint32_t i = 0; i < 10; ++i) {
+      ASSERT_TRUE(
+          imported_ring.Get(&sequence, buffer.data(), buffer.size(), &size));
+      EXPECT_EQ(MultiRecord(6, i, i * 3),
+                std::vector<char>(buffer.begin(), buffer.begin() + size));
+    }
+    EXPECT_FALSE(
+        imported_ring.Get(&sequence, buffer.data(), buffer.size(), &size));
+  }
+
+  ASSERT_EQ(0, munmap(mmap_base, mmap_size));
+}
+
+// Runs |kProducers| threads that each put |records| records of varying length.
+void MultiProducerPutTask(MultiRing* ring, uint32_t records,
+                          std::vector<std::thread>* threads) {
+  constexpr uint8_t kProducers = 4;
+  for (uint8_t producer = 0; producer < kProducers; ++producer) {
+    threads->emplace_back([ring, records, producer]() {
+      for (uint32_t i = 0; i < records; ++i) {
+        const auto record = MultiRecord(producer, i, 2 + (i * 13) % 100);
+        ring->Put(record.data(), record.size());
+      }
+    });
+  }
+}
+
+TEST(MultiProducerBroadcastRingTest, ThreadedMultiProducerLossless) {
+  // The ring is large enough to hold every record, so that none are lost.
+  constexpr uint32_t kRecordsPerProducer = 2000;
+  MultiRing ring;
+  auto mmap = CreateMultiRing(&ring, 1 << 20);
+
+  std::vector<std::thread> producers;
+  MultiProducerPutTask(&ring, kRecordsPerProducer, &producers);
+  for (auto& producer : producers)
+    producer.join();
+
+  // Each producer's records come out complete and in order.
+  std::vector<uint32_t> counts(producers.size());
+  uint32_t sequence = ring.GetOldestSequence();
+  std::vector<char> buffer(ring.max_record_size());
+  uint32_t size;
+  while (ring.Get(&sequence, buffer.data(), buffer.size(), &size)) {
+    ASSERT_TRUE(IsMultiRecord(buffer.data(), size));
+    const auto producer = static_cast<uint8_t>(buffer[0]);
+    ASSERT_LT(producer, counts.size());
+    ASSERT_EQ(static_cast<uint8_t>(counts[producer]),
+              static_cast<uint8_t>(buffer[1]));
+    ASSERT_EQ(2 + (counts[producer] * 13) % 100, size);
+    counts[producer]++;
+  }
+  for (uint32_t count : counts)
+    EXPECT_EQ(kRecordsPerProducer, count);
+}
+
+TEST(MultiProducerBroadcastRingTest, ThreadedOverwriteTorture) {
+  // Maximize overwrites with a small ring, while readers check every record
+  // they get.
+  constexpr uint32_t kRecordsPerProducer = 5000;
+  constexpr int kReaders = 2;
+
+  for (uint32_t capacity : {256U, 4096U}) {
+    MultiRing ring;
+    auto mmap = CreateMultiRing(&ring, capacity);
+
+    std::atomic<bool> quit(false);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < kReaders; ++i) {
+      readers.emplace_back([&quit, &mmap]() {
+        MultiRing in_ring;
+        bool import_ok;
+        std::tie(in_ring, import_ok) =
+            MultiRing::Import(mmap.mmap(), mmap.size);
+        ASSERT_TRUE(import_ok);
+
+        uint32_t sequence = in_ring.GetOldestSequence();
+        std::vector<char> buffer(in_ring.max_record_size());
+        uint32_t size;
+        while (!std::atomic_load_explicit(&quit, std::memory_order_relaxed)) {
+          if (in_ring.Get(&sequence, buffer.data(), buffer.size(), &size)) {
+            ASSERT_LE(size, in_ring.max_record_size());
+            ASSERT_TRUE(IsMultiRecord(buffer.data(), size));
+          }
+        }
+      });
+    }
+
+    std::vector<std::thread> producers;
+    MultiProducerPutTask(&ring, kRecordsPerProducer, &producers);
+    for (auto& producer : producers)
+      producer.join();
+
+    std::atomic_store_explicit(&quit, true, std::memory_order_relaxed);
+    for (auto& reader : readers)
+      reader.join();
+
+    EXPECT_LE(ring.GetNextSequence() - ring.GetOldestSequence(),
+              ring.capacity());
+  }
+}
+
 } // namespace dvr
 } // namespace android
@@ -0,0 +1,499 @@
+#ifndef ANDROID_DVR_MULTI_PRODUCER_BROADCAST_RING_H_
+#define ANDROID_DVR_MULTI_PRODUCER_BROADCAST_RING_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>  // NOLINT
+#include <tuple>
+#include <type_traits>
+
+#include "android-base/logging.h"
+
+#if ATOMIC_LONG_LOCK_FREE != 2 || ATOMIC_INT_LOCK_FREE != 2
+#error "This file requires lock free atomic uint32_t and long"
+#endif
+
+namespace android {
+namespace dvr {
+
+// Nonblocking ring of variable-length records suitable for concurrent
+// multi-writer, multi-reader access.
+//
+// This is a variant of BroadcastRing for sources that publish samples of
+// varying size at a high rate from several threads or processes. The ring is a
+// byte buffer of records, each prefixed with its length. Sequence numbers are
+// byte positions in the ring rather than record indexes, so readers move from
+// one record to the next with the updated sequence that Get() returns.
+//
+// Writers claim space by atomically advancing the reserved tail, write their
+// record, and then publish it once all the records claimed before it are
+// published. Writers only wait on each other: when a writer has claimed space
+// but not yet published its record, later writers may wait for it before
+// publishing, and before claiming space that would overwrite it.
+//
+// Readers never block writers and see the same guarantees as with
+// BroadcastRing: records are read under a sequence lock, and inconsistent data
+// can only be returned if at least 2^32 bytes are written during the read-side
+// critical section. Readers may have a read-only mapping; each reader's state
+// is a single local sequence number.
+//
+// Both readers and writers avoid accesses outside the bounds of the mmap area
+// passed in during initialization, even if there is a misbehaving or malicious
+// task with write access to the mmap area.
+//
+// Example Writer Usage (from any number of threads):
+//
+//   using Ring = MultiProducerBroadcastRing;
+//
+//   uint32_t capacity = kMyDesiredCapacityInBytes;  // A power of two.
+//   size_t ring_size = Ring::MemorySize(capacity);
+//
+//   // Allocate & map as for BroadcastRing.
+//   Ring ring = Ring::Create(mmap_base, mmap_size, capacity);
+//
+//   while (!done) {
+//     std::string sample = BuildNextSampleBlocking();
+//     CHECK(ring.Put(sample.data(), sample.size()));
+//   }
+//
+// Example Reader Usage:
+//
+//   Ring ring;
+//   bool import_ok;
+//   std::tie(ring, import_ok) = Ring::Import(mmap_base, mmap_size);
+//   CHECK(import_ok);
+//
+//   std::vector<char> buffer(ring.max_record_size());
+//   uint32_t sequence = ring.GetOldestSequence();
+//   uint32_t size;
+//   while (ring.Get(&sequence, buffer.data(), buffer.size(), &size))
+//     ProcessSample(buffer.data(), size);
+//
+class MultiProducerBroadcastRing {
+ public:
+  // Must have room for at least a couple of records.
+  static constexpr uint32_t kMinCapacity = 64;
+
+  static constexpr bool IsPowerOfTwo(uint32_t size) {
+    return (size & (size - 1)) == 0;
+  }
+
+  MultiProducerBroadcastRing() {}
+
+  // Creates a new ring at |mmap| with |capacity| bytes of record storage.
+  //
+  // |capacity| must be a power of two of at least kMinCapacity. There must be
+  // at least |MemorySize(capacity)| bytes of space already allocated at |mmap|.
+  // The ring does not take ownership.
+  static MultiProducerBroadcastRing Create(void* mmap, size_t mmap_size,
+                                           uint32_t capacity) {
+    MultiProducerBroadcastRing ring(mmap);
+    CHECK(ring.ValidateGeometry(mmap_size, capacity));
+    ring.InitializeHeader(capacity);
+    return ring;
+  }
+
+  // Imports an existing ring at |mmap|.
+  //
+  // Import may fail if the ring parameters in the mmap header are not sensible.
+  // In this case the returned boolean is false; make sure to check this value.
+  static std::tuple<MultiProducerBroadcastRing, bool> Import(void* mmap,
+                                                             size_t mmap_size) {
+    MultiProducerBroadcastRing ring(mmap);
+    uint32_t capacity = 0;
+    if (mmap_size >= sizeof(Header)) {
+      capacity = std::atomic_load_explicit(&ring.header_mmap()->capacity,
+                                           std::memory_order_relaxed);
+    }
+    bool ok = ring.ValidateGeometry(mmap_size, capacity);
+    return std::make_tuple(ring, ok);
+  }
+
+  // Calculates the space necessary for a ring of |capacity| bytes.
+  static constexpr size_t MemorySize(uint32_t capacity) {
+    return sizeof(Header) + capacity;
+  }
+
+  // Writes a record of |size| bytes to the ring.
+  //
+  // The oldest records are overwritten to make room. Returns false without
+  // writing anything if |size| is larger than max_record_size().
+  bool Put(const void* data, uint32_t size) {
+    if (size > max_record_size())
+      return false;
+
+    uint32_t start;
+    uint32_t end;
+    uint32_t padding;
+    Claim(RecordSpan(size), &start, &end, &padding);
+    Reserve(end);
+
+    if (padding)
+      PutRecordInternal(start, kPaddingLength, nullptr);
+    PutRecordInternal(start + padding, size, data);
+
+    Publish(start, end);
+    return true;
+  }
+
+  // Gets sequence number of the oldest currently available record.
+  uint32_t GetOldestSequence() const {
+    return std::atomic_load_explicit(&header_mmap()->head,
+                                     std::memory_order_relaxed);
+  }
+
+  // Gets sequence number of the first future record.
+  //
+  // If the returned value is passed to Get() and there is no concurrent Put(),
+  // Get() will return false.
+  uint32_t GetNextSequence() const {
+    return std::atomic_load_explicit(&header_mmap()->tail,
+                                     std::memory_order_relaxed);
+  }
+
+  // Copies the oldest available record with sequence at least |*sequence| to
+  // |data|, which has room for |max_size| bytes.
+  //
+  // Returns false if there is no recent enough record available.
+  //
+  // Sets |*size| to the size of the record; only the first |max_size| bytes are
+  // copied if it is larger. Updates |*sequence| with the sequence number that
+  // follows the record returned, which is the one to pass in to get the next
+  // record.
+  //
+  // This function synchronizes with the writers the same way as
+  // BroadcastRing::Get(): the load-acquire of |tail| pairs with the
+  // store-release in Publish(), and the acquire fence before the final load of
+  // |head| pairs with the release fence in Reserve().
+  bool Get(uint32_t* sequence /*inout*/, void* data /*out*/, uint32_t max_size,
+           uint32_t* size /*out*/) const {
+    for (;;) {
+      uint32_t tail = std::atomic_load_explicit(&header_mmap()->tail,
+                                                std::memory_order_acquire);
+      uint32_t head = std::atomic_load_explicit(&header_mmap()->head,
+                                                std::memory_order_relaxed);
+
+      if (tail - head > capacity())
+        continue;  // Concurrent modification; re-try.
+
+      if (*sequence - head > tail - head)
+        *sequence = head;  // Out of window, skip forward to first available.
+
+      if (*sequence == tail) return false;  // No new records available.
+
+      // The header may be garbage if the record is being overwritten; it is
+      // only trusted once |head| has been checked again below.
+      const RecordHeader header = GetHeaderInternal(*sequence);
+      const uint32_t index = SequenceToIndex(*sequence);
+      const bool is_padding = header.length == kPaddingLength;
+      const uint32_t span = is_padding ? capacity() - index
+                                       : RecordSpan(header.length);
+      const bool is_valid = header.sequence == *sequence &&
+                            (is_padding || header.length <= capacity()) &&
+                            span <= tail - *sequence &&
+                            span <= capacity() - index;
+
+      if (is_valid && !is_padding) {
+        GetDataInternal(index + sizeof(RecordHeader), data,
+                        std::min(header.length, max_size));
+      }
+
+      // NB: It is not sufficient to change this to a load-acquire of |head|.
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      uint32_t final_head = std::atomic_load_explicit(
+          &header_mmap()->head, std::memory_order_relaxed);
+
+      if (final_head - head > *sequence - head)
+        continue;  // Concurrent modification; re-try.
+
+      if (!is_valid) {
+        // Either |*sequence| did not point at a record, or the ring has been
+        // corrupted by a misbehaving writer.
+        if (*sequence == head) return false;
+        *sequence = head;
+        continue;
+      }
+
+      *sequence += span;
+      if (is_padding)
+        continue;
+
+      *size = header.length;
+      return true;
+    }
+  }
+
+  // Returns true if this instance has been created or imported.
+  bool is_valid() const { return !!data_.mmap; }
+
+  uint32_t capacity() const { return data_.capacity; }
+
+  // Largest record that Put() accepts. This keeps a record and the padding
+  // that may precede it within the ring.
+  uint32_t max_record_size() const {
+    return capacity() / 2 - sizeof(RecordHeader);
+  }
+
+  static constexpr uint32_t mmap_alignment() { return alignof(Mmap); }
+
+ private:
+  struct Header {
+    // Size of the record storage in bytes.
+    std::atomic<uint32_t> capacity;
+
+    // Readable region is [head, tail), the region being written by writers is
+    // [tail, reserve).
+    //
+    // These are byte sequence numbers, not indexes - indexes should be computed
+    // with a modulus. |head| and |tail| are always at the start of a record.
+    //
+    // To ensure consistency:
+    //
+    // (1) Writers claim space by advancing |reserve|, advance |head| past any
+    //     records they are about to overwrite before writing to them, and
+    //     advance |tail| after they are written and all preceding records are
+    //     published.
+    // (2) Readers check |tail| before reading data and |head| after,
+    //     making sure to discard any data that was written to concurrently.
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    std::atomic<uint32_t> reserve;
+  };
+
+  // Precedes each record in the ring.
+  struct RecordHeader {
+    // Length of the record in bytes, or kPaddingLength.
+    uint32_t length;
+
+    // Sequence number of the record, to tell records apart from stale data.
+    uint32_t sequence;
+  };
+
+  // Marks the unused space at the end of the ring when a record does not fit.
+  static constexpr uint32_t kPaddingLength = UINT32_MAX;
+
+  // Store using the standard word size.
+  using StorageType = long;  // NOLINT
+
+  // Always require 8 byte alignment so that the same records are legal on 32
+  // and 64 bit builds.
+  static constexpr uint32_t kRecordAlignment = 8;
+  static_assert(kRecordAlignment % sizeof(StorageType) == 0,
+                "Bad record alignment");
+  static_assert(sizeof(RecordHeader) % kRecordAlignment == 0,
+                "Bad record header size");
+
+  // Mmap area layout.
+  struct Mmap {
+    Header header;
+    std::atomic<StorageType> data[];
+  };
+
+  static_assert(std::is_standard_layout<Mmap>::value,
+                "Mmap must be standard layout");
+  static_assert(sizeof(Header) % kRecordAlignment == 0, "Bad header size");
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                "Lockless atomics contain extra state");
+  static_assert(sizeof(std::atomic<StorageType>) == sizeof(StorageType),
+                "Lockless atomics contain extra state");
+
+  explicit MultiProducerBroadcastRing(void* mmap) {
+    CHECK_EQ(0U, reinterpret_cast<uintptr_t>(mmap) % alignof(Mmap));
+    data_.mmap = reinterpret_cast<Mmap*>(mmap);
+  }
+
+  // Initializes the mmap area header for a new ring.
+  void InitializeHeader(uint32_t capacity) {
+    constexpr uint32_t kInitialSequence = -4096;  // Force an early wrap.
+    std::atomic_store_explicit(&header_mmap()->capacity, capacity,
+                               std::memory_order_relaxed);
+    std::atomic_store_explicit(&header_mmap()->head, kInitialSequence,
+                               std::memory_order_relaxed);
+    std::atomic_store_explicit(&header_mmap()->tail, kInitialSequence,
+                               std::memory_order_relaxed);
+    std::atomic_store_explicit(&header_mmap()->reserve, kInitialSequence,
+                               std::memory_order_relaxed);
+  }
+
+  // Validates ring geometry.
+  //
+  // The capacity is validated carefully on import and then cached. This allows
+  // us to avoid out-of-range accesses even if the header is later changed.
+  bool ValidateGeometry(size_t mmap_size, uint32_t header_capacity) {
+    data_.capacity = header_capacity;
+
+    if (capacity() < kMinCapacity) return false;
+    if (!IsPowerOfTwo(capacity())) return false;
+    if (MemorySize(capacity()) > mmap_size) return false;
+
+    return true;
+  }
+
+  // Space taken in the ring by a record of |length| bytes.
+  static uint32_t RecordSpan(uint32_t length) {
+    return (sizeof(RecordHeader) + length + kRecordAlignment - 1) &
+           ~(kRecordAlignment - 1);
+  }
+
+  uint32_t SequenceToIndex(uint32_t sequence) const {
+    return sequence & (capacity() - 1);
+  }
+
+  // Claims |span| bytes for a record, plus the padding needed to skip the end
+  // of the ring if the record does not fit there.
+  //
+  // Claims never extend over records that are not yet published, so that
+  // Reserve() can walk the records that it overwrites.
+  void Claim(uint32_t span, uint32_t* start, uint32_t* end,
+             uint32_t* padding) {
+    uint32_t reserve = std::atomic_load_explicit(&header_mmap()->reserve,
+                                                 std::memory_order_relaxed);
+    for (;;) {
+      const uint32_t room = capacity() - SequenceToIndex(reserve);
+      *padding = room < span ? room : 0;
+      *end = reserve + *padding + span;
+
+      // Pairs with the store-release in Publish() so that the headers of the
+      // records overwritten by this claim are visible to Reserve().
+      const uint32_t tail = std::atomic_load_explicit(
+          &header_mmap()->tail, std::memory_order_acquire);
+      if (*end - tail > capacity()) {
+        // Another writer has yet to publish the record that would be
+        // overwritten.
+        std::this_thread::yield();
+        reserve = std::atomic_load_explicit(&header_mmap()->reserve,
+                                            std::memory_order_relaxed);
+        continue;
+      }
+
+      if (std::atomic_compare_exchange_weak_explicit(
+              &header_mmap()->reserve, &reserve, *end,
+              std::memory_order_relaxed, std::memory_order_relaxed)) {
+        *start = reserve;
+        return;
+      }
+    }
+  }
+
+  // Advances |head| past the records that the claim ending at |end| overwrites.
+  //
+  // As with BroadcastRing::Reserve(), nothing prevents overwriting records
+  // that have concurrent readers, but the fence ensures the |head| update will
+  // be the first update seen by readers so that they can detect it. Writers
+  // advance |head| concurrently, one record at a time; a writer that fails to
+  // move |head| forward picks up where the other one left it.
+  void Reserve(uint32_t end) {
+    const uint32_t target = end - capacity();
+    uint32_t head = std::atomic_load_explicit(&header_mmap()->head,
+                                              std::memory_order_relaxed);
+    while (static_cast<int32_t>(target - head) > 0) {
+      const RecordHeader header = GetHeaderInternal(head);
+      const uint32_t span = header.length == kPaddingLength
+                                ? capacity() - SequenceToIndex(head)
+                                : RecordSpan(std::min(header.length,
+                                                      max_record_size()));
+
+      // Together with the release fence below, makes sure that if the header
+      // was written by a writer that already moved |head| past it, the
+      // exchange sees that and fails.
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      std::atomic_compare_exchange_weak_explicit(
+          &header_mmap()->head, &head, head + span, std::memory_order_relaxed,
+          std::memory_order_relaxed);
+    }
+
+    // NB: It is not sufficient to change this to a store-release of |head|.
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  // Makes the records in [start, end) visible to readers, once all records
+  // claimed before them are.
+  void Publish(uint32_t start, uint32_t end) {
+    while (std::atomic_load_explicit(&header_mmap()->tail,
+                                     std::memory_order_acquire) != start) {
+      std::this_thread::yield();
+    }
+    std::atomic_store_explicit(&header_mmap()->tail, end,
+                               std::memory_order_release);
+  }
+
+  // Copies a record into the ring at |sequence|.
+  //
+  // This is done with relaxed atomics because otherwise it is racy according to
+  // the C++ memory model. This is very low overhead once optimized.
+  void PutRecordInternal(uint32_t sequence, uint32_t length,
+                         const void* data) {
+    const uint32_t index = SequenceToIndex(sequence);
+    const RecordHeader header{length, sequence};
+    PutDataInternal(index, &header, sizeof(header));
+    if (data)
+      PutDataInternal(index + sizeof(header), data, length);
+  }
+
+  RecordHeader GetHeaderInternal(uint32_t sequence) const {
+    RecordHeader header;
+    GetDataInternal(SequenceToIndex(sequence), &header, sizeof(header));
+    return header;
+  }
+
+  // Copies |size| bytes to the ring at byte |index|, which is word aligned.
+  // Callers make sure that the range lies within the ring.
+  void PutDataInternal(uint32_t index, const void* in, uint32_t size) {
+    std::atomic<StorageType>* out =
+        &data_.mmap->data[index / sizeof(StorageType)];
+    const char* bytes = static_cast<const char*>(in);
+    const size_t words = size / sizeof(StorageType);
+    for (size_t i = 0; i < words; ++i) {
+      StorageType word;
+      memcpy(&word, bytes + i * sizeof(StorageType), sizeof(word));
+      std::atomic_store_explicit(&out[i], word, std::memory_order_relaxed);
+    }
+    if (const size_t remainder = size % sizeof(StorageType)) {
+      StorageType word = 0;
+      memcpy(&word, bytes + words * sizeof(StorageType), remainder);
+      std::atomic_store_explicit(&out[words], word, std::memory_order_relaxed);
+    }
+  }
+
+  // Copies |size| bytes out of the ring at byte |index|, which is word aligned.
+  // Callers make sure that the range lies within the ring.
+  void GetDataInternal(uint32_t index, void* out, uint32_t size) const {
+    const std::atomic<StorageType>* in =
+        &data_.mmap->data[index / sizeof(StorageType)];
+    char* bytes = static_cast<char*>(out);
+    const size_t words = size / sizeof(StorageType);
+    for (size_t i = 0; i < words; ++i) {
+      StorageType word =
+          std::atomic_load_explicit(&in[i], std::memory_order_relaxed);
+      memcpy(bytes + i * sizeof(StorageType), &word, sizeof(word));
+    }
+    if (const size_t remainder = size % sizeof(StorageType)) {
+      StorageType word =
+          std::atomic_load_explicit(&in[words], std::memory_order_relaxed);
+      memcpy(bytes + words * sizeof(StorageType), &word, remainder);
+    }
+  }
+
+  // Helpers to compute addresses in mmap area.
+  Header* header_mmap() const { return &data_.mmap->header; }
+
+  struct Data {
+    Mmap* mmap = nullptr;
+
+    // Cached to make sure misbehaving writers cannot cause out-of-bounds memory
+    // accesses by updating the value in the mmap header.
+    uint32_t capacity = 0;
+  };
+
+  Data data_;
+};
+
+}  // namespace dvr
+}  // namespace android
+
+#endif  // ANDROID_DVR_MULTI_PRODUCER_BROADCAST_RING_H_
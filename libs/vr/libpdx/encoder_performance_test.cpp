@@ -1,11 +1,16 @@
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <thread>
 #include <vector>
 
 #include <pdx/rpc/argument_encoder.h>
@@ -59,6 +64,17 @@ class TestPayload : public MessagePayload<SendBuffer>,
   InputResourceMapper* GetInputResourceMapper() override { return this; }
 };
 
+// TestPayload that lets large contiguous members be sent from the caller's
+// memory, the way ClientPayload and ServicePayload do.
+class ReferencingTestPayload : public TestPayload {
+ public:
+  // MessageWriter
+  bool ReferenceWriteBufferData(void* dest, const void* data,
+                                size_t size) override {
+    return AddReference(dest, data, size);
+  }
+};
+
 class StaticBuffer : public MessageWriter,
                      public MessageReader,
                      public NoOpResourceMapper {
@@ -409,6 +425,127 @@ std::string GenerateContainerName(const std::string& type, size_t count) {
   return ss.str();
 }
 
+// Sends all of |vector| over |socket_fd|, continuing with sendmsg() from where
+// a partial send stopped.
+bool SendVectorAll(int socket_fd, std::vector<iovec> vector) {
+  msghdr msg = {};
+  msg.msg_iov = vector.data();
+  msg.msg_iovlen = vector.size();
+  while (msg.msg_iovlen > 0) {
+    ssize_t size_written = sendmsg(socket_fd, &msg, MSG_NOSIGNAL);
+    if (size_written < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    while (msg.msg_iovlen > 0 &&
+           static_cast<size_t>(size_written) >= msg.msg_iov->iov_len) {
+      size_written -= msg.msg_iov->iov_len;
+      msg.msg_iov++;
+      msg.msg_iovlen--;
+    }
+    if (msg.msg_iovlen > 0) {
+      msg.msg_iov->iov_base = AdvancePointer(msg.msg_iov->iov_base, size_written);
+      msg.msg_iov->iov_len -= size_written;
+    }
+  }
+  return true;
+}
+
+// Serializes |value| into |payload| and sends it over |socket_fd| with
+// sendmsg(), the way the UDS transport sends requests.
+template <typename T>
+std::chrono::nanoseconds TransmitTestRunner(TestPayload* payload,
+                                            int socket_fd, size_t iterations,
+                                            const T& value) {
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    payload->Clear();
+    Serialize(value, payload);
+    if (!SendVectorAll(socket_fd, payload->SendVector()))
+      return start - std::chrono::high_resolution_clock::now();
+  }
+  auto stop = std::chrono::high_resolution_clock::now();
+  return stop - start;
+}
+
+// Measures the throughput of serializing and sending large payloads, with and
+// without letting the payload reference the data in place.
+void RunTransmitTests() {
+  using float_seconds = std::chrono::duration<double>;
+  constexpr size_t kBytesPerTest = 256 * 1024 * 1024;
+  constexpr size_t kMebibyte = 1024 * 1024;
+  const size_t name_column_width = 34;
+  const size_t size_column_width = 10;
+  const size_t throughput_column_width = 18;
+  const size_t total_width =
+      name_column_width + size_column_width + 2 * throughput_column_width + 9;
+  const std::string dbl_separator(total_width, '=');
+
+  int sockets[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) {
+    std::cerr << "Failed to create socket pair: " << strerror(errno)
+              << std::endl;
+    exit(1);
+  }
+  const int socket_buffer_size = 4 * kMebibyte;
+  setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &socket_buffer_size,
+             sizeof(socket_buffer_size));
+
+  // Drains the receiving end, so that only the sending side is measured.
+  std::thread drain_thread([socket_fd = sockets[1]] {
+    std::vector<uint8_t> buffer(kMebibyte);
+    ssize_t size_read;
+    do {
+      size_read = read(socket_fd, buffer.data(), buffer.size());
+    } while (size_read > 0 || (size_read < 0 && errno == EINTR));
+  });
+
+  TestPayload copy_payload;
+  ReferencingTestPayload referencing_payload;
+
+  std::cout << dbl_separator << std::endl;
+  std::cout << "Transmit benchmarks (" << kBytesPerTest / kMebibyte
+            << " MiB per test)" << std::endl;
+  std::cout << dbl_separator << std::endl;
+  std::cout << std::setw(name_column_width) << "Test Name" << " : "
+            << std::setw(size_column_width) << "Size" << " || "
+            << std::setw(throughput_column_width) << "Copy, MiB/s" << " | "
+            << std::setw(throughput_column_width) << "Zero-copy, MiB/s"
+            << std::endl;
+  std::cout << std::string(total_width, '-') << std::endl;
+
+  auto run = [&](const std::string& name, size_t size, auto&& value) {
+    const size_t iterations = std::max<size_t>(kBytesPerTest / size, 1);
+    std::cout << std::setw(name_column_width) << name << " : "
+              << std::setw(size_column_width) << size << " || ";
+    for (TestPayload* payload :
+         {&copy_payload,
+          static_cast<TestPayload*>(&referencing_payload)}) {
+      auto seconds = std::chrono::duration_cast<float_seconds>(
+          TransmitTestRunner(payload, sockets[0], iterations, value));
+      double throughput =
+          static_cast<double>(iterations * size) / kMebibyte / seconds.count();
+      std::cout << std::fixed << std::setprecision(3)
+                << std::setw(throughput_column_width) << throughput
+                << (payload == &copy_payload ? " | " : "");
+    }
+    std::cout << std::endl;
+  };
+
+  for (size_t size : {64 * 1024, 256 * 1024, 1024 * 1024, 4 * 1024 * 1024}) {
+    std::vector<uint8_t> data(size, 0x5a);
+    run(GenerateContainerName("BufferWrapper<uint8_t*>", size), size,
+        BufferWrapper<uint8_t*>(data.data(), data.size()));
+    run(GenerateContainerName("string", size), size, std::string(size, '*'));
+  }
+  std::cout << dbl_separator << std::endl;
+
+  close(sockets[0]);
+  drain_thread.join();
+  close(sockets[1]);
+}
+
 }  // anonymous namespace
 
 int main(int /*argc*/, char** /*argv*/) {
@@ -511,5 +648,7 @@ int main(int /*argc*/, char** /*argv*/) {
 
   // Finally, run all the tests.
   test_runner.RunTests(iteration_count, buffers);
+
+  RunTransmitTests();
   return 0;
 }
@@ -30,6 +30,16 @@ class MessageWriter {
   virtual void* GetNextWriteBufferSection(size_t size) = 0;
   virtual OutputResourceMapper* GetOutputResourceMapper() = 0;
 
+  // Offers to send |size| bytes at |data| in place of the bytes at |dest|,
+  // which lie within the last section returned by GetNextWriteBufferSection().
+  // Writers that accept return true and leave the bytes at |dest| unwritten;
+  // |data| must then stay valid and unmodified until the message is sent. The
+  // default implementation declines, in which case the data is copied.
+  virtual bool ReferenceWriteBufferData(void* /*dest*/, const void* /*data*/,
+                                        size_t /*size*/) {
+    return false;
+  }
+
  protected:
   virtual ~MessageWriter() = default;
 };
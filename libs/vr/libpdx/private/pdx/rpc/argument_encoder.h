@@ -27,8 +27,10 @@ class ArgumentEncoder<void(Args...)> {
  public:
   explicit ArgumentEncoder(MessageWriter* writer) : writer_{writer} {}
 
-  // Serializes the arguments as a tuple.
-  void EncodeArguments(Args... args) {
+  // Serializes the arguments as a tuple. The arguments are taken by reference
+  // since the writer may reference large strings and buffers in place until
+  // the payload is sent.
+  void EncodeArguments(const Args&... args) {
     Serialize(std::forward_as_tuple(args...), writer_);
   }
 
@@ -45,8 +47,10 @@ class ArgumentEncoder<Return(Args...)> {
 
   explicit ArgumentEncoder(MessageWriter* writer) : writer_{writer} {}
 
-  // Serializes the arguments as a tuple.
-  void EncodeArguments(Args... args) {
+  // Serializes the arguments as a tuple. The arguments are taken by reference
+  // since the writer may reference large strings and buffers in place until
+  // the payload is sent.
+  void EncodeArguments(const Args&... args) {
     Serialize(std::forward_as_tuple(args...), writer_);
   }
 
@@ -1,7 +1,10 @@
 #ifndef ANDROID_PDX_RPC_PAYLOAD_H_
 #define ANDROID_PDX_RPC_PAYLOAD_H_
 
+#include <sys/uio.h>
+
 #include <iterator>
+#include <vector>
 
 #include <pdx/client.h>
 #include <pdx/rpc/message_buffer.h>
@@ -39,6 +42,7 @@ class MessagePayload {
   // Resizes the underlying MessageBuffer and sets the cursor to the beginning.
   void Resize(std::size_t size) {
     buffer_.resize(size);
+    references_.clear();
     cursor_ = buffer_.begin();
     const_cursor_ = buffer_.cbegin();
   }
@@ -58,6 +62,7 @@ class MessagePayload {
   // Clears the underlying MessageBuffer and sets the cursor to the beginning.
   void Clear() {
     buffer_.clear();
+    references_.clear();
     cursor_ = buffer_.begin();
     const_cursor_ = buffer_.cbegin();
   }
@@ -67,10 +72,56 @@ class MessagePayload {
   std::size_t Size() const { return buffer_.size(); }
   std::size_t Capacity() const { return buffer_.capacity(); }
 
+  // Records that |size| bytes at |data| are to be sent in place of the bytes
+  // at |dest| in the underlying MessageBuffer, which are left unwritten.
+  // References must be added in increasing order of |dest|. Returns false once
+  // kMaxReferences have been added, so that the send vector stays well below
+  // the limit of the transport.
+  bool AddReference(void* dest, const void* data, std::size_t size) {
+    if (references_.size() == kMaxReferences)
+      return false;
+    references_.push_back(
+        {static_cast<std::size_t>(PointerDistance(dest, Data())), data, size});
+    return true;
+  }
+
+  // Returns whether any data is sent from outside of the underlying
+  // MessageBuffer, in which case the payload must be sent with SendVector().
+  bool HasReferences() const { return !references_.empty(); }
+
+  // Returns the payload as a vector of the sections of the underlying
+  // MessageBuffer, interleaved with the referenced data.
+  std::vector<iovec> SendVector() const {
+    std::vector<iovec> vector;
+    vector.reserve(2 * references_.size() + 1);
+    auto append = [&vector](const void* base, std::size_t size) {
+      if (size)
+        vector.push_back({const_cast<void*>(base), size});
+    };
+
+    std::size_t offset = 0;
+    for (const auto& reference : references_) {
+      append(AdvancePointer(Data(), offset), reference.offset - offset);
+      append(reference.data, reference.size);
+      offset = reference.offset + reference.size;
+    }
+    append(AdvancePointer(Data(), offset), Size() - offset);
+    return vector;
+  }
+
  private:
+  static constexpr std::size_t kMaxReferences = 64;
+
+  struct Reference {
+    std::size_t offset;
+    const void* data;
+    std::size_t size;
+  };
+
   BufferType& buffer_;
   typename BufferType::iterator cursor_;
   typename BufferType::const_iterator const_cursor_;
+  std::vector<Reference> references_;
 
   MessagePayload(const MessagePayload<Slot>&) = delete;
   void operator=(const MessagePayload<Slot>&) = delete;
@@ -93,6 +144,11 @@ class ServicePayload : public MessagePayload<Slot>,
 
   OutputResourceMapper* GetOutputResourceMapper() override { return &message_; }
 
+  bool ReferenceWriteBufferData(void* dest, const void* data,
+                                size_t size) override {
+    return this->AddReference(dest, data, size);
+  }
+
   // MessageReader
   BufferSection GetNextReadBufferSection() override {
     return {&*this->ConstCursor(), &*this->ConstEnd()};
@@ -133,6 +189,11 @@ class ClientPayload : public MessagePayload<Slot>,
     return &transaction_;
   }
 
+  bool ReferenceWriteBufferData(void* dest, const void* data,
+                                size_t size) override {
+    return this->AddReference(dest, data, size);
+  }
+
   // MessageReader
   BufferSection GetNextReadBufferSection() override {
     return {&*this->ConstCursor(), &*this->ConstEnd()};
@@ -151,6 +212,37 @@ class ClientPayload : public MessagePayload<Slot>,
   Transaction& transaction_;
 };
 
+// Sends the payload of a client-side RPC, together with any data it references,
+// in a single message.
+template <typename R, typename Slot>
+Status<R> SendPayload(Transaction& transaction, int opcode,
+                      const ClientPayload<Slot>& payload, void* receive_buffer,
+                      size_t receive_length) {
+  if (!payload.HasReferences()) {
+    return transaction.Send<R>(opcode, payload.Data(), payload.Size(),
+                               receive_buffer, receive_length);
+  }
+
+  const std::vector<iovec> send_vector = payload.SendVector();
+  const bool receive = (receive_buffer && receive_length);
+  const iovec receive_vector = {receive_buffer, receive_length};
+  return transaction.SendVector<R>(opcode, send_vector.data(),
+                                   send_vector.size(),
+                                   receive ? &receive_vector : nullptr,
+                                   receive ? 1 : 0);
+}
+
+// Writes the payload of a service-side reply, together with any data it
+// references, to the message.
+template <typename Slot>
+Status<void> WritePayload(Message& message, const ServicePayload<Slot>& payload) {
+  if (!payload.HasReferences())
+    return message.WriteAll(payload.Data(), payload.Size());
+
+  const std::vector<iovec> send_vector = payload.SendVector();
+  return message.WriteVectorAll(send_vector.data(), send_vector.size());
+}
+
 }  // namespace rpc
 }  // namespace pdx
 }  // namespace android
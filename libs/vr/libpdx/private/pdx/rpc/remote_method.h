@@ -148,7 +148,7 @@ EnableIfNotDirectReturn<typename RemoteMethodType::Return> RemoteMethodReturn(
   rpc::ServicePayload<ReplyBuffer> payload(message);
   MakeArgumentEncoder<Signature>(&payload).EncodeReturn(return_value);
 
-  auto ret = message.WriteAll(payload.Data(), payload.Size());
+  auto ret = WritePayload(message, payload);
   auto status = message.Reply(ret);
   ALOGE_IF(!status, "RemoteMethodReturn: Failed to reply to message: %s",
            status.GetErrorMessage().c_str());
@@ -333,31 +333,31 @@ struct CheckArgumentTypes;
 template <int Opcode, typename Return, typename... Args>
 struct CheckArgumentTypes<Opcode, Return(Args...)> {
   template <typename R>
-  static typename rpc::EnableIfDirectReturn<R, Status<R>> Invoke(Client& client,
-                                                                 Args... args) {
+  static typename rpc::EnableIfDirectReturn<R, Status<R>> Invoke(
+      Client& client, const Args&... args) {
     Transaction trans{client};
     rpc::ClientPayload<rpc::SendBuffer> payload{trans};
     rpc::MakeArgumentEncoder<Return(Args...)>(&payload).EncodeArguments(
-        std::forward<Args>(args)...);
-    return trans.Send<R>(Opcode, payload.Data(), payload.Size(), nullptr, 0);
+        args...);
+    return rpc::SendPayload<R>(trans, Opcode, payload, nullptr, 0);
   }
 
   template <typename R>
   static typename rpc::EnableIfNotDirectReturn<R, Status<R>> Invoke(
-      Client& client, Args... args) {
+      Client& client, const Args&... args) {
     Transaction trans{client};
 
     rpc::ClientPayload<rpc::SendBuffer> send_payload{trans};
     rpc::MakeArgumentEncoder<Return(Args...)>(&send_payload)
-        .EncodeArguments(std::forward<Args>(args)...);
+        .EncodeArguments(args...);
 
     rpc::ClientPayload<rpc::ReplyBuffer> reply_payload{trans};
     reply_payload.Resize(reply_payload.Capacity());
 
     Status<R> result;
     auto status =
-        trans.Send<void>(Opcode, send_payload.Data(), send_payload.Size(),
-                         reply_payload.Data(), reply_payload.Size());
+        rpc::SendPayload<void>(trans, Opcode, send_payload,
+                               reply_payload.Data(), reply_payload.Size());
     if (!status) {
       result.SetError(status.error());
     } else {
@@ -387,16 +387,16 @@ struct CheckArgumentTypes<Opcode, Return(Args...)> {
 
   template <typename R>
   static typename rpc::EnableIfDirectReturn<R, Status<void>> InvokeInPlace(
-      Client& client, R* return_value, Args... args) {
+      Client& client, R* return_value, const Args&... args) {
     Transaction trans{client};
 
     rpc::ClientPayload<rpc::SendBuffer> send_payload{trans};
     rpc::MakeArgumentEncoder<Return(Args...)>(&send_payload)
-        .EncodeArguments(std::forward<Args>(args)...);
+        .EncodeArguments(args...);
 
     Status<void> result;
-    auto status = trans.Send<R>(Opcode, send_payload.Data(),
-                                send_payload.Size(), nullptr, 0);
+    auto status =
+        rpc::SendPayload<R>(trans, Opcode, send_payload, nullptr, 0);
     if (status) {
       *return_value = status.take();
       result.SetValue();
@@ -408,19 +408,19 @@ struct CheckArgumentTypes<Opcode, Return(Args...)> {
 
   template <typename R>
   static typename rpc::EnableIfNotDirectReturn<R, Status<void>> InvokeInPlace(
-      Client& client, R* return_value, Args... args) {
+      Client& client, R* return_value, const Args&... args) {
     Transaction trans{client};
 
     rpc::ClientPayload<rpc::SendBuffer> send_payload{trans};
     rpc::MakeArgumentEncoder<Return(Args...)>(&send_payload)
-        .EncodeArguments(std::forward<Args>(args)...);
+        .EncodeArguments(args...);
 
     rpc::ClientPayload<rpc::ReplyBuffer> reply_payload{trans};
     reply_payload.Resize(reply_payload.Capacity());
 
     auto result =
-        trans.Send<void>(Opcode, send_payload.Data(), send_payload.Size(),
-                         reply_payload.Data(), reply_payload.Size());
+        rpc::SendPayload<void>(trans, Opcode, send_payload,
+                               reply_payload.Data(), reply_payload.Size());
     if (result) {
       rpc::ErrorType error =
           rpc::MakeArgumentDecoder<Return(Args...)>(&reply_payload)
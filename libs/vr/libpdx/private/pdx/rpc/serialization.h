@@ -460,6 +460,21 @@ inline void WriteRawData(void*& dest, const void* src, size_t size) {
   dest = static_cast<uint8_t*>(dest) + size;
 }
 
+// Contiguous payloads of at least this many bytes are offered to the writer to
+// be sent in place, instead of being copied into the write buffer.
+constexpr std::size_t kMinReferencedDataSize = 16 * 1024;
+
+// Writes a contiguous payload, letting the writer reference it in place if it
+// is large enough.
+inline void WriteRawData(void*& dest, const void* src, size_t size,
+                         MessageWriter* writer) {
+  if (size < kMinReferencedDataSize ||
+      !writer->ReferenceWriteBufferData(dest, src, size)) {
+    memcpy(dest, src, size);
+  }
+  dest = static_cast<uint8_t*>(dest) + size;
+}
+
 // Serializes a primitive array into a raw byte string.
 template <typename T,
           typename = typename std::enable_if<std::is_pod<T>::value>::type>
@@ -927,38 +942,39 @@ inline void SerializeObject(const ChannelHandle<Mode>& handle,
 // Serializes the payload of BufferWrapper types.
 template <typename T, typename Allocator>
 inline void SerializeObject(const BufferWrapper<std::vector<T, Allocator>>& b,
-                            MessageWriter* /*writer*/, void*& buffer) {
+                            MessageWriter* writer, void*& buffer) {
   const auto value_type_size =
       sizeof(typename BufferWrapper<std::vector<T, Allocator>>::value_type);
   SerializeType(b, buffer);
-  WriteRawData(buffer, b.data(), b.size() * value_type_size);
+  WriteRawData(buffer, b.data(), b.size() * value_type_size, writer);
 }
 template <typename T>
-inline void SerializeObject(const BufferWrapper<T*>& b,
-                            MessageWriter* /*writer*/, void*& buffer) {
+inline void SerializeObject(const BufferWrapper<T*>& b, MessageWriter* writer,
+                            void*& buffer) {
   const auto value_type_size = sizeof(typename BufferWrapper<T*>::value_type);
   SerializeType(b, buffer);
-  WriteRawData(buffer, b.data(), b.size() * value_type_size);
+  WriteRawData(buffer, b.data(), b.size() * value_type_size, writer);
 }
 
 // Serializes the payload of string types.
 template <typename StringType>
-inline void SerializeString(const StringType& s, void*& buffer) {
+inline void SerializeString(const StringType& s, MessageWriter* writer,
+                            void*& buffer) {
   const auto value_type_size = sizeof(typename StringType::value_type);
   SerializeType(s, buffer);
-  WriteRawData(buffer, s.data(), s.length() * value_type_size);
+  WriteRawData(buffer, s.data(), s.length() * value_type_size, writer);
 }
 
 // Overload of SerializeObject() for std::string and StringWrapper. These types
 // are interchangeable and must serialize to the same format.
-inline void SerializeObject(const std::string& s, MessageWriter* /*writer*/,
+inline void SerializeObject(const std::string& s, MessageWriter* writer,
                             void*& buffer) {
-  SerializeString(s, buffer);
+  SerializeString(s, writer, buffer);
 }
 template <typename T>
-inline void SerializeObject(const StringWrapper<T>& s,
-                            MessageWriter* /*writer*/, void*& buffer) {
-  SerializeString(s, buffer);
+inline void SerializeObject(const StringWrapper<T>& s, MessageWriter* writer,
+                            void*& buffer) {
+  SerializeString(s, writer, buffer);
 }
 
 // Serializes the payload of array types.
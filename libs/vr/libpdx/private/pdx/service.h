@@ -624,6 +624,13 @@ class Service : public std::enable_shared_from_this<Service> {
    */
   Status<void> ReceiveAndDispatch();
 
+  /*
+   * Dispatches a message received on this Service instance's endpoint to the
+   * impulse, system message or message handler. This is the second half of
+   * ReceiveAndDispatch(), for callers that need to act between the two steps.
+   */
+  Status<void> DispatchMessage(Message& message);
+
  private:
   friend class Message;
 
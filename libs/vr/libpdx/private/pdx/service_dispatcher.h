@@ -1,8 +1,11 @@
 #ifndef ANDROID_PDX_SERVICE_DISPATCHER_H_
 #define ANDROID_PDX_SERVICE_DISPATCHER_H_
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -17,6 +20,12 @@ class Service;
  * ServiceDispatcher manages a list of Service instances and handles message
  * reception and dispatch to the services. This makes repetitive dispatch tasks
  * easier to implement.
+ *
+ * Service endpoints are watched in one-shot mode: the thread woken for an
+ * endpoint re-arms it as soon as it has received a message, so that other
+ * threads can receive the next messages while the first one is handled.
+ * Endpoints only report a channel again once its message has been handled,
+ * which keeps the messages of each channel in order.
  */
 class ServiceDispatcher {
  public:
@@ -68,6 +77,17 @@ class ServiceDispatcher {
    */
   int EnterDispatchLoop();
 
+  /*
+   * Starts |thread_count| threads that receive and dispatch messages until the
+   * dispatcher is canceled, as if each of them had entered
+   * EnterDispatchLoop(). The threads are joined by SetCanceled(true) and by the
+   * destructor.
+   *
+   * Returns 0 on success; -EINVAL if |thread_count| is 0; -EBUSY if the
+   * dispatcher is canceled or already has a thread pool.
+   */
+  int StartThreadPool(size_t thread_count);
+
   /*
    * Sets the canceled state of the dispatcher. When canceled is true, any
    * threads blocked waiting for messages will return. This method waits until
@@ -87,11 +107,17 @@ class ServiceDispatcher {
   int ThreadEnter();
   void ThreadExit();
 
+  // Receives one message from |service|, re-arms its endpoint and dispatches
+  // the message.
+  void DispatchService(Service* service);
+  int DispatchLoop();
+
   std::mutex mutex_;
   std::condition_variable condition_;
   std::atomic<bool> canceled_{false};
 
   std::vector<std::shared_ptr<Service>> services_;
+  std::vector<std::thread> thread_pool_;
 
   int thread_count_ = 0;
   LocalHandle event_fd_;
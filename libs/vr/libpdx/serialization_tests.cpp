@@ -2503,3 +2503,109 @@ TEST(DeserializationTest, ErrorType) {
   error = Deserialize(&p, &buffer);
   EXPECT_EQ(ErrorCode::UNEXPECTED_TYPE_SIZE, error);
 }
+
+namespace {
+
+// MessagePayload that lets large contiguous members be sent from the caller's
+// memory, the way ClientPayload and ServicePayload do.
+class ReferencingPayload : public MessagePayload<SendBuffer>,
+                           public MessageWriter,
+                           public NoOpOutputResourceMapper {
+ public:
+  ReferencingPayload() { Clear(); }
+
+  // MessageWriter
+  void* GetNextWriteBufferSection(size_t size) override {
+    const size_t section_offset = Size();
+    Extend(size);
+    return Data() + section_offset;
+  }
+
+  OutputResourceMapper* GetOutputResourceMapper() override { return this; }
+
+  bool ReferenceWriteBufferData(void* dest, const void* data,
+                                size_t size) override {
+    return AddReference(dest, data, size);
+  }
+
+  // Returns the bytes that are sent for this payload.
+  Payload Gather() const {
+    Payload result;
+    for (const iovec& vec : SendVector()) {
+      memcpy(result.GetNextWriteBufferSection(vec.iov_len), vec.iov_base,
+             vec.iov_len);
+    }
+    return result;
+  }
+};
+
+}  // anonymous namespace
+
+TEST(SerializationTest, ReferencedData) {
+  const std::string large_string(kMinReferencedDataSize, 'a');
+  std::vector<std::uint8_t> large_buffer(kMinReferencedDataSize + 1);
+  std::iota(large_buffer.begin(), large_buffer.end(), 0);
+  const auto value = std::make_tuple(
+      1, large_string, std::string("small"),
+      BufferWrapper<std::uint8_t*>(large_buffer.data(), large_buffer.size()),
+      2.0);
+
+  Payload expected;
+  Serialize(value, &expected);
+
+  ReferencingPayload payload;
+  Serialize(value, &payload);
+  EXPECT_TRUE(payload.HasReferences());
+  // Header, string, separator, buffer, trailer.
+  EXPECT_EQ(5u, payload.SendVector().size());
+  EXPECT_EQ(expected, payload.Gather());
+
+  // The referenced data is read from the caller's memory when sending.
+  large_buffer[0] = 0xff;
+  EXPECT_NE(expected, payload.Gather());
+}
+
+TEST(SerializationTest, ReferencedDataSmallPayload) {
+  const auto value = std::make_tuple(
+      std::string(kMinReferencedDataSize - 8, 'a'), std::string("small"));
+
+  Payload expected;
+  Serialize(value, &expected);
+
+  ReferencingPayload payload;
+  Serialize(value, &payload);
+  EXPECT_FALSE(payload.HasReferences());
+  EXPECT_EQ(1u, payload.SendVector().size());
+  EXPECT_EQ(expected, payload.Gather());
+}
+
+TEST(SerializationTest, ReferencedDataLimit) {
+  const std::vector<std::string> value(100,
+                                       std::string(kMinReferencedDataSize, 'a'));
+
+  Payload expected;
+  Serialize(value, &expected);
+
+  // Once the limit is reached, the remaining strings are copied.
+  ReferencingPayload payload;
+  Serialize(value, &payload);
+  EXPECT_LE(payload.SendVector().size(), 2 * 64u + 1);
+  EXPECT_EQ(expected, payload.Gather());
+}
+
+TEST(SerializationTest, ReferencedArguments) {
+  const std::string large_string(kMinReferencedDataSize, 'a');
+  const BufferWrapper<std::vector<std::uint8_t>> large_buffer(
+      std::vector<std::uint8_t>(kMinReferencedDataSize, 0x55));
+
+  // The payload references the arguments of the caller, not copies of them
+  // that would be destroyed before the payload is sent.
+  ReferencingPayload payload;
+  MakeArgumentEncoder<void(std::string,
+                           BufferWrapper<std::vector<std::uint8_t>>)>(&payload)
+      .EncodeArguments(large_string, large_buffer);
+  const std::vector<iovec> send_vector = payload.SendVector();
+  ASSERT_EQ(4u, send_vector.size());
+  EXPECT_EQ(large_string.data(), send_vector[1].iov_base);
+  EXPECT_EQ(large_buffer.data(), send_vector[3].iov_base);
+}
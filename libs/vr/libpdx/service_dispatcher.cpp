@@ -10,6 +10,12 @@
 
 static const int kMaxEventsPerLoop = 128;
 
+// Service endpoints are registered one-shot so that a message wakes a single
+// dispatch thread; DispatchService() re-arms them once the message is received.
+// EPOLLEXCLUSIVE would be the alternative, but it cannot be used on the epoll
+// fds that the endpoints expose.
+static const uint32_t kServiceEvents = EPOLLIN | EPOLLONESHOT;
+
 namespace android {
 namespace pdx {
 
@@ -72,7 +78,7 @@ int ServiceDispatcher::AddService(const std::shared_ptr<Service>& service) {
   std::lock_guard<std::mutex> autolock(mutex_);
 
   epoll_event event;
-  event.events = EPOLLIN;
+  event.events = kServiceEvents;
   event.data.ptr = service.get();
 
   if (epoll_ctl(epoll_fd_.Get(), EPOLL_CTL_ADD, service->endpoint()->epoll_fd(),
@@ -127,11 +133,7 @@ int ServiceDispatcher::ReceiveAndDispatch(int timeout) {
       ThreadExit();
       return -EBUSY;
     } else {
-      Service* service = static_cast<Service*>(events[i].data.ptr);
-
-      ALOGI_IF(TRACE, "Dispatching message: fd=%d\n",
-               service->endpoint()->epoll_fd());
-      service->ReceiveAndDispatch();
+      DispatchService(static_cast<Service*>(events[i].data.ptr));
     }
   }
 
@@ -144,26 +146,74 @@ int ServiceDispatcher::EnterDispatchLoop() {
   if (ret < 0)
     return ret;
 
-  epoll_event events[kMaxEventsPerLoop];
+  return DispatchLoop();
+}
+
+int ServiceDispatcher::StartThreadPool(size_t thread_count) {
+  if (thread_count == 0)
+    return -EINVAL;
+
+  std::lock_guard<std::mutex> autolock(mutex_);
+  if (canceled_ || !thread_pool_.empty())
+    return -EBUSY;
+
+  // Account for the threads here so that canceling right after this method
+  // returns waits for all of them.
+  thread_count_ += thread_count;
+  thread_pool_.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; i++)
+    thread_pool_.emplace_back([this] { DispatchLoop(); });
+
+  return 0;
+}
+
+void ServiceDispatcher::DispatchService(Service* service) {
+  ALOGI_IF(TRACE, "Dispatching message: fd=%d\n",
+           service->endpoint()->epoll_fd());
+
+  Message message;
+  auto status = service->endpoint()->MessageReceive(&message);
+
+  // Let the next waiting thread pick up the other channels of this endpoint
+  // while this thread handles the message.
+  epoll_event event;
+  event.events = kServiceEvents;
+  event.data.ptr = service;
+  if (epoll_ctl(epoll_fd_.Get(), EPOLL_CTL_MOD, service->endpoint()->epoll_fd(),
+                &event) < 0) {
+    ALOGE("Failed to re-arm service in dispatcher because: %s\n",
+          strerror(errno));
+  }
+
+  if (!status) {
+    // Another thread may have received the pending message first.
+    ALOGE_IF(status.error() != ETIMEDOUT, "Failed to receive message: %s\n",
+             status.GetErrorMessage().c_str());
+    return;
+  }
+
+  service->DispatchMessage(message);
+}
+
+int ServiceDispatcher::DispatchLoop() {
+  // Take one event at a time so that the other ready services are left to the
+  // other threads in the dispatcher.
+  epoll_event event;
 
   while (!IsCanceled()) {
-    int count = epoll_wait(epoll_fd_.Get(), events, kMaxEventsPerLoop, -1);
+    int count = epoll_wait(epoll_fd_.Get(), &event, 1, -1);
     if (count < 0 && errno != EINTR) {
       ALOGE("Failed to wait for epoll events because: %s\n", strerror(errno));
       ThreadExit();
       return -errno;
     }
 
-    for (int i = 0; i < count; i++) {
-      if (events[i].data.ptr == this) {
+    if (count > 0) {
+      if (event.data.ptr == this) {
         ThreadExit();
         return -EBUSY;
       } else {
-        Service* service = static_cast<Service*>(events[i].data.ptr);
-
-        ALOGI_IF(TRACE, "Dispatching message: fd=%d\n",
-                 service->endpoint()->epoll_fd());
-        service->ReceiveAndDispatch();
+        DispatchService(static_cast<Service*>(event.data.ptr));
       }
     }
   }
@@ -173,17 +223,27 @@ int ServiceDispatcher::EnterDispatchLoop() {
 }
 
 void ServiceDispatcher::SetCanceled(bool cancel) {
-  std::unique_lock<std::mutex> lock(mutex_);
-  canceled_ = cancel;
+  std::vector<std::thread> thread_pool;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    canceled_ = cancel;
 
-  if (canceled_ && thread_count_ > 0) {
-    eventfd_write(event_fd_.Get(), 1);  // Signal threads to quit.
+    if (canceled_ && thread_count_ > 0) {
+      eventfd_write(event_fd_.Get(), 1);  // Signal threads to quit.
 
-    condition_.wait(lock, [this] { return !(canceled_ && thread_count_ > 0); });
+      condition_.wait(lock,
+                      [this] { return !(canceled_ && thread_count_ > 0); });
 
-    eventfd_t value;
-    eventfd_read(event_fd_.Get(), &value);  // Unsignal.
+      eventfd_t value;
+      eventfd_read(event_fd_.Get(), &value);  // Unsignal.
+    }
+
+    if (canceled_)
+      thread_pool = std::move(thread_pool_);
   }
+
+  for (auto& thread : thread_pool)
+    thread.join();
 }
 
 bool ServiceDispatcher::IsCanceled() const { return canceled_; }
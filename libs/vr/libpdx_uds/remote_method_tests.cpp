@@ -3,6 +3,7 @@
 #include <unistd.h>
 
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <numeric>
@@ -20,6 +21,8 @@
 #include <uds/client_channel_factory.h>
 #include <uds/service_endpoint.h>
 
+#include "rot13_test_service.h"
+
 using android::pdx::BorrowedHandle;
 using android::pdx::Channel;
 using android::pdx::ClientBase;
@@ -33,24 +36,13 @@ using android::pdx::ServiceBase;
 using android::pdx::ServiceDispatcher;
 using android::pdx::Status;
 using android::pdx::uds::Endpoint;
+using android::pdx::uds::Rot13;
+using android::pdx::uds::Rot13Client;
+using android::pdx::uds::Rot13Service;
 using namespace android::pdx::rpc;
 
 namespace {
 
-std::string Rot13(const std::string& s) {
-  std::string text = s;
-  std::transform(std::begin(text), std::end(text), std::begin(text),
-                 [](char c) -> char {
-                   if (!std::isalpha(c)) {
-                     return c;
-                   } else {
-                     const char pivot = std::isupper(c) ? 'A' : 'a';
-                     return (c - pivot + 13) % 26 + pivot;
-                   }
-                 });
-  return text;
-}
-
 // Defines a serializable user type that may be transferred between client and
 // service.
 struct TestType {
@@ -764,6 +756,69 @@ TEST_F(RemoteMethodTest, BufferWrapper) {
   EXPECT_EQ(expected, buffer);
 }
 
+// Runs |function| on each client in a thread of its own and waits for all of
+// them to finish.
+template <typename F>
+void RunClients(const std::vector<std::unique_ptr<Rot13Client>>& clients,
+                F function) {
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < clients.size(); i++)
+    threads.emplace_back([&, i] { function(i, clients[i].get()); });
+  for (auto& thread : threads)
+    thread.join();
+}
+
+// Same as RemoteMethodTest, with messages dispatched by a pool of threads.
+class RemoteMethodThreadPoolTest : public ::testing::Test {
+ protected:
+  static constexpr char kClientPath[] = "thread_pool_test";
+  static constexpr size_t kThreadCount = 4;
+  static constexpr size_t kClientCount = 8;
+
+  std::unique_ptr<ServiceDispatcher> dispatcher_;
+
+  void SetUp() override {
+    dispatcher_ = android::pdx::ServiceDispatcher::Create();
+    ASSERT_NE(nullptr, dispatcher_);
+    ASSERT_EQ(0, dispatcher_->StartThreadPool(kThreadCount));
+  }
+
+  void TearDown() override {
+    if (dispatcher_)
+      dispatcher_->SetCanceled(true);
+  }
+};
+
+constexpr char RemoteMethodThreadPoolTest::kClientPath[];
+
+TEST_F(RemoteMethodThreadPoolTest, ConcurrentClients) {
+  auto service = Rot13Service::Create(kClientPath);
+  ASSERT_NE(nullptr, service);
+  ASSERT_EQ(0, dispatcher_->AddService(service));
+
+  std::vector<std::unique_ptr<Rot13Client>> clients;
+  for (size_t i = 0; i < kClientCount; i++) {
+    clients.push_back(Rot13Client::Create(kClientPath));
+    ASSERT_NE(nullptr, clients.back());
+  }
+
+  // Each client is served in order while the clients run concurrently.
+  std::atomic<int> failures{0};
+  RunClients(clients, [&failures](size_t index, Rot13Client* client) {
+    for (int i = 0; i < 200; i++) {
+      const std::string text = "client " + std::to_string(index) + " request " +
+                               std::to_string(i);
+      Status<std::string> status = client->Rot13(text);
+      if (!status || status.get() != Rot13(text))
+        failures++;
+    }
+  });
+  EXPECT_EQ(0, failures);
+
+  EXPECT_EQ(-EBUSY, dispatcher_->StartThreadPool(kThreadCount));
+  EXPECT_EQ(-EBUSY, dispatcher_->RemoveService(service));
+}
+
 //
 // RemoteMethodFramework: Tests the type-based framework that remote method
 // support is built upon.
@@ -0,0 +1,53 @@
+#include "rot13_test_service.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include <uds/client_channel_factory.h>
+#include <uds/service_endpoint.h>
+
+namespace android {
+namespace pdx {
+namespace uds {
+
+using rpc::DispatchRemoteMethod;
+
+std::string Rot13(const std::string& s) {
+  std::string text = s;
+  std::transform(std::begin(text), std::end(text), std::begin(text),
+                 [](char c) -> char {
+                   if (!std::isalpha(c)) {
+                     return c;
+                   } else {
+                     const char pivot = std::isupper(c) ? 'A' : 'a';
+                     return (c - pivot + 13) % 26 + pivot;
+                   }
+                 });
+  return text;
+}
+
+Rot13Client::Rot13Client(const std::string& path)
+    : BASE{ClientChannelFactory::Create(path)} {}
+
+Rot13Service::Rot13Service(const std::string& path)
+    : BASE("Rot13Service", Endpoint::CreateAndBindSocket(path)) {}
+
+Status<void> Rot13Service::HandleMessage(Message& message) {
+  switch (message.GetOp()) {
+    case Rot13Interface::Rot13::Opcode:
+      DispatchRemoteMethod<Rot13Interface::Rot13>(
+          *this, &Rot13Service::OnRot13, message);
+      return {};
+
+    default:
+      return Service::DefaultHandleMessage(message);
+  }
+}
+
+Status<std::string> Rot13Service::OnRot13(Message&, const std::string& s) {
+  return {Rot13(s)};
+}
+
+}  // namespace uds
+}  // namespace pdx
+}  // namespace android
@@ -0,0 +1,64 @@
+#ifndef ANDROID_PDX_UDS_ROT13_TEST_SERVICE_H_
+#define ANDROID_PDX_UDS_ROT13_TEST_SERVICE_H_
+
+#include <string>
+
+#include <pdx/client.h>
+#include <pdx/rpc/remote_method.h>
+#include <pdx/service.h>
+
+namespace android {
+namespace pdx {
+namespace uds {
+
+// Returns |s| with its letters rotated by 13 places.
+std::string Rot13(const std::string& s);
+
+// Test interface used by the thread pool tests, whose single method has the
+// service do some work on each request.
+struct Rot13Interface final {
+  enum {
+    kOpRot13 = 0,
+  };
+
+  PDX_REMOTE_METHOD(Rot13, kOpRot13, std::string(const std::string&));
+
+  PDX_REMOTE_API(API, Rot13);
+};
+
+class Rot13Client : public ClientBase<Rot13Client> {
+ public:
+  Status<std::string> Rot13(const std::string& string) {
+    return InvokeRemoteMethod<Rot13Interface::Rot13>(string);
+  }
+
+ private:
+  friend BASE;
+
+  explicit Rot13Client(const std::string& path);
+
+  Rot13Client(const Rot13Client&) = delete;
+  void operator=(const Rot13Client&) = delete;
+};
+
+// Serves Rot13Interface on the socket at |path|.
+class Rot13Service : public ServiceBase<Rot13Service> {
+ public:
+  Status<void> HandleMessage(Message& message) override;
+
+ private:
+  friend BASE;
+
+  explicit Rot13Service(const std::string& path);
+
+  Status<std::string> OnRot13(Message&, const std::string& s);
+
+  Rot13Service(const Rot13Service&) = delete;
+  void operator=(const Rot13Service&) = delete;
+};
+
+}  // namespace uds
+}  // namespace pdx
+}  // namespace android
+
+#endif  // ANDROID_PDX_UDS_ROT13_TEST_SERVICE_H_
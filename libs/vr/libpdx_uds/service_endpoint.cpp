@@ -123,6 +123,8 @@ struct MessageState {
   std::vector<uint8_t> request_data;
   size_t request_data_read_pos{0};
   std::vector<uint8_t> response_data;
+  // Channel of an impulse, re-armed when the impulse has been handled.
+  int32_t impulse_channel_id{-1};
 };
 
 }  // anonymous namespace
@@ -209,7 +211,16 @@ void Endpoint::Init(LocalHandle socket_fd) {
 void* Endpoint::AllocateMessageState() { return new MessageState; }
 
 void Endpoint::FreeMessageState(void* state) {
-  delete static_cast<MessageState*>(state);
+  auto* message_state = static_cast<MessageState*>(state);
+  // Impulses are not replied to, so their channel is only reported again once
+  // the message is gone. This keeps a dispatch thread pool from handling the
+  // next message of the channel while the impulse is still being handled.
+  if (message_state->impulse_channel_id >= 0) {
+    auto channel_fd = GetChannelSocketFd(message_state->impulse_channel_id);
+    if (channel_fd)
+      ReenableEpollEvent(channel_fd);
+  }
+  delete message_state;
 }
 
 Status<void> Endpoint::AcceptConnection(Message* message) {
@@ -542,7 +553,7 @@ Status<void> Endpoint::ReceiveMessageForChannel(
   }
 
   if (status && state->request.is_impulse)
-    status = ReenableEpollEvent(channel_fd);
+    state->impulse_channel_id = channel_id;
 
   if (!status) {
     if (status.error() == ESHUTDOWN) {
@@ -0,0 +1,87 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pdx/service_dispatcher.h>
+
+#include "rot13_test_service.h"
+
+using android::pdx::ServiceDispatcher;
+using android::pdx::Status;
+using android::pdx::uds::Rot13Client;
+using android::pdx::uds::Rot13Service;
+
+namespace {
+
+constexpr char kClientPath[] = "thread_pool_performance_test";
+constexpr size_t kClientCount = 8;
+constexpr int kRequestsPerClient = 500;
+
+// Returns the requests per second served by |thread_count| dispatch threads to
+// kClientCount concurrent clients, or a negative value on error.
+double MeasureThroughput(size_t thread_count, const std::string& text) {
+  auto dispatcher = ServiceDispatcher::Create();
+  if (!dispatcher || dispatcher->StartThreadPool(thread_count) != 0)
+    return -1;
+
+  auto service = Rot13Service::Create(kClientPath);
+  if (!service || dispatcher->AddService(service) != 0)
+    return -1;
+
+  std::vector<std::unique_ptr<Rot13Client>> clients;
+  for (size_t i = 0; i < kClientCount; i++) {
+    clients.push_back(Rot13Client::Create(kClientPath));
+    if (!clients.back())
+      return -1;
+  }
+
+  std::atomic<int> failures{0};
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (auto& client : clients) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < kRequestsPerClient; i++) {
+        Status<std::string> status = client->Rot13(text);
+        if (!status || status.get().size() != text.size())
+          failures++;
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  // Clients send close messages on destruction, so they have to go before the
+  // dispatcher is canceled.
+  clients.clear();
+  dispatcher->SetCanceled(true);
+
+  if (failures > 0)
+    return -1;
+  return kClientCount * kRequestsPerClient / elapsed.count();
+}
+
+}  // anonymous namespace
+
+// Measures the requests per second served for a growing number of dispatch
+// threads. Each request rotates a 4KiB string, so that the service has some
+// work to spread across the threads.
+int main(int /*argc*/, char** /*argv*/) {
+  const std::string text(4096, 'a');
+  printf("%-8s %12s\n", "Threads", "Requests/s");
+  for (size_t thread_count : {1, 2, 4, 8}) {
+    const double requests_per_second = MeasureThroughput(thread_count, text);
+    if (requests_per_second < 0) {
+      fprintf(stderr, "Failed to serve the requests with %zu threads\n",
+              thread_count);
+      return 1;
+    }
+    printf("%-8zu %12.0f\n", thread_count, requests_per_second);
+  }
+  return 0;
+}
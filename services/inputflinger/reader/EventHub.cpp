@@ -69,6 +69,9 @@ static const char* DEVICE_INPUT_PATH = "/dev/input";
 // v4l2 devices go directly into /dev
 static const char* DEVICE_PATH = "/dev";
 
+// Compiled key maps, relative to ANDROID_DATA.
+static const char* KEY_MAP_CACHE_PATH = "/system/keymap_cache";
+
 static constexpr size_t OBFUSCATED_LENGTH = 8;
 
 static constexpr int32_t FF_STRONG_MAGNITUDE_CHANNEL_IDX = 0;
@@ -684,6 +687,12 @@ EventHub::EventHub(void)
         mPendingINotify(false) {
     ensureProcessCanBlockSuspend();
 
+    // Key maps are compiled on their first load, so that the devices added later and the next
+    // boots read the compiled maps instead of parsing the files again.
+    const char* androidData = getenv("ANDROID_DATA");
+    setKeyMapCacheDirectory(std::string(androidData != nullptr ? androidData : "/data") +
+                            KEY_MAP_CACHE_PATH);
+
     mEpollFd = epoll_create1(EPOLL_CLOEXEC);
     LOG_ALWAYS_FATAL_IF(mEpollFd < 0, "Could not create epoll instance: %s", strerror(errno));
 
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *                        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHintQueue"
+#include <powermanager/PowerHintQueue.h>
+#include <pthread.h>
+#include <utils/Log.h>
+
+#include <algorithm>
+
+using namespace android::hardware::power;
+
+namespace android {
+
+namespace power {
+
+// -------------------------------------------------------------------------------------------------
+
+PowerHintQueue::PowerHintQueue(std::shared_ptr<HalWrapper> hal) : mHal(std::move(hal)) {
+    mThread = std::thread(&PowerHintQueue::threadMain, this);
+    pthread_setname_np(mThread.native_handle(), "PowerHintQueue");
+}
+
+PowerHintQueue::~PowerHintQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mCondition.notify_all();
+    mThread.join();
+}
+
+template <typename T, typename Matches, typename Merge>
+void PowerHintQueue::queue(T hint, Matches matches, Merge merge) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        // Merging into an earlier hint would send this one ahead of the hints queued since.
+        if (!mHints.empty()) {
+            T* queuedHint = std::get_if<T>(&mHints.back());
+            if (queuedHint != nullptr && matches(*queuedHint)) {
+                merge(*queuedHint, std::move(hint));
+                return;
+            }
+        }
+        mHints.emplace_back(std::move(hint));
+    }
+    mCondition.notify_all();
+}
+
+HalResult<void> PowerHintQueue::setBoost(Boost boost, int32_t durationMs) {
+    queue(BoostHint{boost, durationMs},
+          [boost](const BoostHint& queued) { return queued.boost == boost; },
+          [](BoostHint& queued, BoostHint&& hint) {
+              queued.durationMs = std::max(queued.durationMs, hint.durationMs);
+          });
+    return HalResult<void>::ok();
+}
+
+HalResult<void> PowerHintQueue::setMode(Mode mode, bool enabled) {
+    queue(ModeHint{mode, enabled}, [mode](const ModeHint& queued) { return queued.mode == mode; },
+          [](ModeHint& queued, ModeHint&& hint) { queued.enabled = hint.enabled; });
+    return HalResult<void>::ok();
+}
+
+HalResult<sp<IPowerHintSession>> PowerHintQueue::createHintSession(
+        int32_t tgid, int32_t uid, const std::vector<int32_t>& threadIds, int64_t durationNanos) {
+    return mHal->createHintSession(tgid, uid, threadIds, durationNanos);
+}
+
+HalResult<int64_t> PowerHintQueue::getHintSessionPreferredRate() {
+    return mHal->getHintSessionPreferredRate();
+}
+
+void PowerHintQueue::updateTargetWorkDuration(const sp<IPowerHintSession>& session,
+                                              int64_t targetDurationNanos) {
+    queue(TargetWorkDurationHint{session, targetDurationNanos},
+          [&session](const TargetWorkDurationHint& queued) { return queued.session == session; },
+          [](TargetWorkDurationHint& queued, TargetWorkDurationHint&& hint) {
+              queued.targetDurationNanos = hint.targetDurationNanos;
+          });
+}
+
+void PowerHintQueue::reportActualWorkDuration(const sp<IPowerHintSession>& session,
+                                              const std::vector<WorkDuration>& durations) {
+    queue(ActualWorkDurationHint{session, durations},
+          [&session](const ActualWorkDurationHint& queued) { return queued.session == session; },
+          [](ActualWorkDurationHint& queued, ActualWorkDurationHint&& hint) {
+              auto& durations = queued.durations;
+              durations.insert(durations.end(), hint.durations.begin(), hint.durations.end());
+              // Keep the latest durations if the HAL stalls for long.
+              if (durations.size() > kMaxBatchedWorkDurations) {
+                  durations.erase(durations.begin(),
+                                  durations.end() - kMaxBatchedWorkDurations);
+              }
+          });
+}
+
+void PowerHintQueue::flush() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [this]() REQUIRES(mMutex) { return mHints.empty() && !mSending; });
+}
+
+void PowerHintQueue::threadMain() {
+    std::deque<Hint> hints;
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mCondition.wait(lock, [this]() REQUIRES(mMutex) { return !mHints.empty() || mStopping; });
+        if (mHints.empty()) {
+            return;
+        }
+        // Hints queued while these are sent are coalesced among themselves.
+        hints.swap(mHints);
+        mSending = true;
+        lock.unlock();
+        for (Hint& hint : hints) {
+            send(hint);
+        }
+        hints.clear();
+        lock.lock();
+        mSending = false;
+        mCondition.notify_all();
+    }
+}
+
+void PowerHintQueue::send(Hint& hint) {
+    if (auto* boost = std::get_if<BoostHint>(&hint)) {
+        mHal->setBoost(boost->boost, boost->durationMs);
+    } else if (auto* mode = std::get_if<ModeHint>(&hint)) {
+        mHal->setMode(mode->mode, mode->enabled);
+    } else if (auto* target = std::get_if<TargetWorkDurationHint>(&hint)) {
+        binder::Status status =
+                target->session->updateTargetWorkDuration(target->targetDurationNanos);
+        ALOGE_IF(!status.isOk(), "updateTargetWorkDuration failed: %s",
+                 status.toString8().c_str());
+    } else if (auto* actual = std::get_if<ActualWorkDurationHint>(&hint)) {
+        binder::Status status = actual->session->reportActualWorkDuration(actual->durations);
+        ALOGE_IF(!status.isOk(), "reportActualWorkDuration failed: %s",
+                 status.toString8().c_str());
+    }
+}
+
+} // namespace power
+
+} // namespace android
@@ -16,17 +16,27 @@
 
 #define LOG_TAG "PowerHalControllerBenchmarks"
 
+#include <android/hardware/power/BnPowerHintSession.h>
 #include <android/hardware/power/Boost.h>
 #include <android/hardware/power/Mode.h>
+#include <android/hardware/power/WorkDuration.h>
 #include <benchmark/benchmark.h>
 #include <powermanager/PowerHalController.h>
+#include <powermanager/PowerHintQueue.h>
 #include <testUtil.h>
 #include <chrono>
 
+using android::binder::Status;
+using android::hardware::power::BnPowerHintSession;
 using android::hardware::power::Boost;
+using android::hardware::power::IPowerHintSession;
 using android::hardware::power::Mode;
+using android::hardware::power::WorkDuration;
+using android::power::HalConnector;
 using android::power::HalResult;
+using android::power::HalWrapper;
 using android::power::PowerHalController;
+using android::power::PowerHintQueue;
 
 using namespace android;
 using namespace std::chrono_literals;
@@ -40,6 +50,56 @@ static constexpr int64_t LAST_MODE = static_cast<int64_t>(Mode::CAMERA_STREAMING
 // Delay between oneway method calls to avoid overflowing the binder buffers.
 static constexpr std::chrono::microseconds ONEWAY_API_DELAY = 100us;
 
+// Time spent by the mock HAL on each call, close to a binder call to the Power HAL.
+static constexpr std::chrono::microseconds MOCK_HAL_CALL_DURATION = 50us;
+
+static void mockHalCall() {
+    testDelaySpin(
+            std::chrono::duration_cast<std::chrono::duration<float>>(MOCK_HAL_CALL_DURATION)
+                    .count());
+}
+
+class MockHalWrapper : public HalWrapper {
+public:
+    HalResult<void> setBoost(Boost, int32_t) override {
+        mockHalCall();
+        return HalResult<void>::ok();
+    }
+    HalResult<void> setMode(Mode, bool) override {
+        mockHalCall();
+        return HalResult<void>::ok();
+    }
+    HalResult<sp<IPowerHintSession>> createHintSession(int32_t, int32_t,
+                                                       const std::vector<int32_t>&,
+                                                       int64_t) override {
+        return HalResult<sp<IPowerHintSession>>::unsupported();
+    }
+    HalResult<int64_t> getHintSessionPreferredRate() override {
+        return HalResult<int64_t>::unsupported();
+    }
+};
+
+class MockHalConnector : public HalConnector {
+public:
+    std::unique_ptr<HalWrapper> connect() override { return std::make_unique<MockHalWrapper>(); }
+    void reset() override {}
+};
+
+class MockPowerHintSession : public BnPowerHintSession {
+public:
+    Status pause() override { return Status::ok(); }
+    Status resume() override { return Status::ok(); }
+    Status close() override { return Status::ok(); }
+    Status updateTargetWorkDuration(int64_t) override {
+        mockHalCall();
+        return Status::ok();
+    }
+    Status reportActualWorkDuration(const std::vector<WorkDuration>&) override {
+        mockHalCall();
+        return Status::ok();
+    }
+};
+
 template <typename T, class... Args0, class... Args1>
 static void runBenchmark(benchmark::State& state, HalResult<T> (PowerHalController::*fn)(Args0...),
                          Args1&&... args1) {
@@ -108,9 +168,99 @@ static void BM_PowerHalControllerBenchmarks_setModeCached(benchmark::State& stat
     runCachedBenchmark(state, &PowerHalController::setMode, mode, false);
 }
 
+// Caller side latency of hints sent to the mock HAL, either directly or through a PowerHintQueue.
+// The queued benchmarks send state.range(0) hints, coalesced by the queue, before waiting for the
+// queue to be flushed out of the measured time.
+
+static void BM_PowerHalControllerBenchmarks_setBoostMockHal(benchmark::State& state) {
+    PowerHalController controller(std::make_unique<MockHalConnector>());
+    controller.init();
+    while (state.KeepRunning()) {
+        for (int64_t i = 0; i < state.range(0); i++) {
+            controller.setBoost(Boost::INTERACTION, 0);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_PowerHalControllerBenchmarks_setBoostQueuedMockHal(benchmark::State& state) {
+    auto controller = std::make_shared<PowerHalController>(std::make_unique<MockHalConnector>());
+    controller->init();
+    PowerHintQueue queue(controller);
+    while (state.KeepRunning()) {
+        for (int64_t i = 0; i < state.range(0); i++) {
+            queue.setBoost(Boost::INTERACTION, 0);
+        }
+        state.PauseTiming();
+        queue.flush();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_PowerHalControllerBenchmarks_setModeMockHal(benchmark::State& state) {
+    PowerHalController controller(std::make_unique<MockHalConnector>());
+    controller.init();
+    while (state.KeepRunning()) {
+        for (int64_t i = 0; i < state.range(0); i++) {
+            controller.setMode(Mode::LAUNCH, i % 2 == 0);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_PowerHalControllerBenchmarks_setModeQueuedMockHal(benchmark::State& state) {
+    auto controller = std::make_shared<PowerHalController>(std::make_unique<MockHalConnector>());
+    controller->init();
+    PowerHintQueue queue(controller);
+    while (state.KeepRunning()) {
+        for (int64_t i = 0; i < state.range(0); i++) {
+            queue.setMode(Mode::LAUNCH, i % 2 == 0);
+        }
+        state.PauseTiming();
+        queue.flush();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_PowerHalControllerBenchmarks_reportActualWorkDurationMockHal(
+        benchmark::State& state) {
+    sp<IPowerHintSession> session = sp<MockPowerHintSession>::make();
+    std::vector<WorkDuration> durations(1);
+    while (state.KeepRunning()) {
+        for (int64_t i = 0; i < state.range(0); i++) {
+            session->reportActualWorkDuration(durations);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_PowerHalControllerBenchmarks_reportActualWorkDurationQueuedMockHal(
+        benchmark::State& state) {
+    sp<IPowerHintSession> session = sp<MockPowerHintSession>::make();
+    std::vector<WorkDuration> durations(1);
+    PowerHintQueue queue(std::make_shared<PowerHalController>(std::make_unique<MockHalConnector>()));
+    while (state.KeepRunning()) {
+        for (int64_t i = 0; i < state.range(0); i++) {
+            queue.reportActualWorkDuration(session, durations);
+        }
+        state.PauseTiming();
+        queue.flush();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
 BENCHMARK(BM_PowerHalControllerBenchmarks_init);
 BENCHMARK(BM_PowerHalControllerBenchmarks_initCached);
 BENCHMARK(BM_PowerHalControllerBenchmarks_setBoost)->DenseRange(FIRST_BOOST, LAST_BOOST, 1);
 BENCHMARK(BM_PowerHalControllerBenchmarks_setBoostCached)->DenseRange(FIRST_BOOST, LAST_BOOST, 1);
 BENCHMARK(BM_PowerHalControllerBenchmarks_setMode)->DenseRange(FIRST_MODE, LAST_MODE, 1);
 BENCHMARK(BM_PowerHalControllerBenchmarks_setModeCached)->DenseRange(FIRST_MODE, LAST_MODE, 1);
+BENCHMARK(BM_PowerHalControllerBenchmarks_setBoostMockHal)->Arg(1)->Arg(8);
+BENCHMARK(BM_PowerHalControllerBenchmarks_setBoostQueuedMockHal)->Arg(1)->Arg(8);
+BENCHMARK(BM_PowerHalControllerBenchmarks_setModeMockHal)->Arg(1)->Arg(8);
+BENCHMARK(BM_PowerHalControllerBenchmarks_setModeQueuedMockHal)->Arg(1)->Arg(8);
+BENCHMARK(BM_PowerHalControllerBenchmarks_reportActualWorkDurationMockHal)->Arg(1)->Arg(8);
+BENCHMARK(BM_PowerHalControllerBenchmarks_reportActualWorkDurationQueuedMockHal)->Arg(1)->Arg(8);
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *            http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PowerHintQueueTest"
+
+#include <android/hardware/power/Boost.h>
+#include <android/hardware/power/IPowerHintSession.h>
+#include <android/hardware/power/Mode.h>
+#include <android/hardware/power/WorkDuration.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <powermanager/PowerHintQueue.h>
+#include <utils/Log.h>
+
+#include <future>
+
+using android::binder::Status;
+using android::hardware::power::Boost;
+using android::hardware::power::IPowerHintSession;
+using android::hardware::power::Mode;
+using android::hardware::power::WorkDuration;
+
+using namespace android;
+using namespace android::power;
+using namespace testing;
+
+// -------------------------------------------------------------------------------------------------
+
+class MockHalWrapper : public HalWrapper {
+public:
+    MOCK_METHOD(HalResult<void>, setBoost, (Boost boost, int32_t durationMs), (override));
+    MOCK_METHOD(HalResult<void>, setMode, (Mode mode, bool enabled), (override));
+    MOCK_METHOD(HalResult<sp<IPowerHintSession>>, createHintSession,
+                (int32_t tgid, int32_t uid, const std::vector<int32_t>& threadIds,
+                 int64_t durationNanos),
+                (override));
+    MOCK_METHOD(HalResult<int64_t>, getHintSessionPreferredRate, (), (override));
+};
+
+class MockIPowerHintSession : public IPowerHintSession {
+public:
+    MOCK_METHOD(IBinder*, onAsBinder, (), (override));
+    MOCK_METHOD(Status, pause, (), (override));
+    MOCK_METHOD(Status, resume, (), (override));
+    MOCK_METHOD(Status, close, (), (override));
+    MOCK_METHOD(int32_t, getInterfaceVersion, (), (override));
+    MOCK_METHOD(std::string, getInterfaceHash, (), (override));
+    MOCK_METHOD(Status, updateTargetWorkDuration, (int64_t), (override));
+    MOCK_METHOD(Status, reportActualWorkDuration, (const std::vector<WorkDuration>&), (override));
+};
+
+static WorkDuration workDuration(int64_t durationNanos, int64_t timeStampNanos) {
+    WorkDuration duration;
+    duration.durationNanos = durationNanos;
+    duration.timeStampNanos = timeStampNanos;
+    return duration;
+}
+
+MATCHER_P(DurationsAre, durations, "") {
+    return std::equal(arg.begin(), arg.end(), durations.begin(), durations.end(),
+                      [](const WorkDuration& a, const WorkDuration& b) {
+                          return a.durationNanos == b.durationNanos &&
+                                  a.timeStampNanos == b.timeStampNanos;
+                      });
+}
+
+// -------------------------------------------------------------------------------------------------
+
+class PowerHintQueueTest : public Test {
+public:
+    void SetUp() override {
+        mMockHal = std::make_shared<StrictMock<MockHalWrapper>>();
+        mMockSession = new StrictMock<MockIPowerHintSession>();
+        mQueue = std::make_unique<PowerHintQueue>(mMockHal);
+    }
+
+protected:
+    std::shared_ptr<StrictMock<MockHalWrapper>> mMockHal;
+    sp<StrictMock<MockIPowerHintSession>> mMockSession;
+    std::unique_ptr<PowerHintQueue> mQueue;
+
+    // Keeps the queue thread busy sending a first boost until the returned promise is set, so
+    // that the hints queued meanwhile can be coalesced.
+    std::promise<void> blockQueue() {
+        std::promise<void> unblock;
+        std::shared_future<void> unblocked = unblock.get_future().share();
+        auto blocked = std::make_shared<std::promise<void>>();
+        EXPECT_CALL(*mMockHal, setBoost(Eq(Boost::CAMERA_LAUNCH), Eq(0)))
+                .WillOnce([blocked, unblocked](Boost, int32_t) {
+                    blocked->set_value();
+                    unblocked.wait();
+                    return HalResult<void>::ok();
+                });
+        std::future<void> sending = blocked->get_future();
+        mQueue->setBoost(Boost::CAMERA_LAUNCH, 0);
+        sending.wait();
+        return unblock;
+    }
+};
+
+// -------------------------------------------------------------------------------------------------
+
+TEST_F(PowerHintQueueTest, TestHintsSentInOrder) {
+    {
+        InSequence seq;
+        EXPECT_CALL(*mMockHal, setBoost(Eq(Boost::INTERACTION), Eq(100)))
+                .WillOnce(Return(HalResult<void>::ok()));
+        EXPECT_CALL(*mMockHal, setMode(Eq(Mode::LAUNCH), Eq(true)))
+                .WillOnce(Return(HalResult<void>::ok()));
+        EXPECT_CALL(*mMockSession, updateTargetWorkDuration(Eq(16'000'000)))
+                .WillOnce(Return(Status::ok()));
+        EXPECT_CALL(*mMockSession, reportActualWorkDuration(_)).WillOnce(Return(Status::ok()));
+    }
+
+    EXPECT_TRUE(mQueue->setBoost(Boost::INTERACTION, 100).isOk());
+    EXPECT_TRUE(mQueue->setMode(Mode::LAUNCH, true).isOk());
+    mQueue->updateTargetWorkDuration(mMockSession, 16'000'000);
+    mQueue->reportActualWorkDuration(mMockSession, {workDuration(10, 1)});
+    mQueue->flush();
+}
+
+TEST_F(PowerHintQueueTest, TestRedundantBoostsCoalesced) {
+    std::promise<void> unblock = blockQueue();
+    {
+        InSequence seq;
+        EXPECT_CALL(*mMockHal, setBoost(Eq(Boost::INTERACTION), Eq(300)))
+                .WillOnce(Return(HalResult<void>::ok()));
+        EXPECT_CALL(*mMockHal, setBoost(Eq(Boost::DISPLAY_UPDATE_IMMINENT), Eq(0)))
+                .WillOnce(Return(HalResult<void>::ok()));
+    }
+
+    mQueue->setBoost(Boost::INTERACTION, 100);
+    mQueue->setBoost(Boost::INTERACTION, 300);
+    mQueue->setBoost(Boost::INTERACTION, 200);
+    mQueue->setBoost(Boost::DISPLAY_UPDATE_IMMINENT, 0);
+    mQueue->setBoost(Boost::DISPLAY_UPDATE_IMMINENT, 0);
+    unblock.set_value();
+    mQueue->flush();
+}
+
+TEST_F(PowerHintQueueTest, TestRedundantModesCoalesced) {
+    std::promise<void> unblock = blockQueue();
+    {
+        InSequence seq;
+        EXPECT_CALL(*mMockHal, setMode(Eq(Mode::EXPENSIVE_RENDERING), Eq(false)))
+                .WillOnce(Return(HalResult<void>::ok()));
+        EXPECT_CALL(*mMockHal, setMode(Eq(Mode::LOW_POWER), Eq(true)))
+                .WillOnce(Return(HalResult<void>::ok()));
+    }
+
+    mQueue->setMode(Mode::EXPENSIVE_RENDERING, true);
+    mQueue->setMode(Mode::EXPENSIVE_RENDERING, false);
+    mQueue->setMode(Mode::LOW_POWER, true);
+    unblock.set_value();
+    mQueue->flush();
+}
+
+TEST_F(PowerHintQueueTest, TestHintsNotCoalescedAcrossOtherHints) {
+    std::promise<void> unblock = blockQueue();
+    {
+        InSequence seq;
+        EXPECT_CALL(*mMockHal, setMode(Eq(Mode::EXPENSIVE_RENDERING), Eq(true)))
+                .WillOnce(Return(HalResult<void>::ok()));
+        EXPECT_CALL(*mMockHal, setBoost(Eq(Boost::INTERACTION), Eq(100)))
+                .WillOnce(Return(HalResult<void>::ok()));
+        EXPECT_CALL(*mMockHal, setMode(Eq(Mode::EXPENSIVE_RENDERING), Eq(false)))
+                .WillOnce(Return(HalResult<void>::ok()));
+    }
+
+    // The boost must still be sent while the mode is enabled.
+    mQueue->setMode(Mode::EXPENSIVE_RENDERING, true);
+    mQueue->setBoost(Boost::INTERACTION, 100);
+    mQueue->setMode(Mode::EXPENSIVE_RENDERING, false);
+    unblock.set_value();
+    mQueue->flush();
+}
+
+TEST_F(PowerHintQueueTest, TestWorkDurationsBatched) {
+    std::promise<void> unblock = blockQueue();
+    const std::vector<WorkDuration> durations = {workDuration(10, 1), workDuration(20, 2),
+                                                 workDuration(30, 3)};
+    {
+        InSequence seq;
+        EXPECT_CALL(*mMockSession, updateTargetWorkDuration(Eq(8'000'000)))
+                .WillOnce(Return(Status::ok()));
+        EXPECT_CALL(*mMockSession, reportActualWorkDuration(DurationsAre(durations)))
+                .WillOnce(Return(Status::ok()));
+    }
+
+    mQueue->updateTargetWorkDuration(mMockSession, 16'000'000);
+    mQueue->updateTargetWorkDuration(mMockSession, 8'000'000);
+    mQueue->reportActualWorkDuration(mMockSession, {durations[0]});
+    mQueue->reportActualWorkDuration(mMockSession, {durations[1], durations[2]});
+    unblock.set_value();
+    mQueue->flush();
+}
+
+TEST_F(PowerHintQueueTest, TestBatchedWorkDurationsCapped) {
+    // Matches PowerHintQueue::kMaxBatchedWorkDurations.
+    constexpr int64_t kMaxBatchedWorkDurations = 100;
+    std::promise<void> unblock = blockQueue();
+    std::vector<WorkDuration> latestDurations;
+    for (int64_t i = kMaxBatchedWorkDurations / 2; i < kMaxBatchedWorkDurations * 3 / 2; i++) {
+        latestDurations.push_back(workDuration(i, i));
+    }
+    EXPECT_CALL(*mMockSession, reportActualWorkDuration(DurationsAre(latestDurations)))
+            .WillOnce(Return(Status::ok()));
+
+    for (int64_t i = 0; i < kMaxBatchedWorkDurations * 3 / 2; i++) {
+        mQueue->reportActualWorkDuration(mMockSession, {workDuration(i, i)});
+    }
+    unblock.set_value();
+    mQueue->flush();
+}
+
+TEST_F(PowerHintQueueTest, TestHintsQueuedWhileSendingNotCoalescedWithSentOnes) {
+    std::promise<void> unblock = blockQueue();
+    EXPECT_CALL(*mMockHal, setBoost(Eq(Boost::CAMERA_LAUNCH), Eq(100)))
+            .WillOnce(Return(HalResult<void>::ok()));
+
+    mQueue->setBoost(Boost::CAMERA_LAUNCH, 100);
+    unblock.set_value();
+    mQueue->flush();
+}
+
+TEST_F(PowerHintQueueTest, TestDestructorSendsQueuedHints) {
+    std::promise<void> unblock = blockQueue();
+    EXPECT_CALL(*mMockHal, setMode(Eq(Mode::LAUNCH), Eq(true)))
+            .WillOnce(Return(HalResult<void>::ok()));
+
+    mQueue->setMode(Mode::LAUNCH, true);
+    unblock.set_value();
+    mQueue.reset();
+}
+
+TEST_F(PowerHintQueueTest, TestSessionCallsNotQueued) {
+    EXPECT_CALL(*mMockHal, getHintSessionPreferredRate())
+            .WillOnce(Return(HalResult<int64_t>::ok(100)));
+    EXPECT_CALL(*mMockHal, createHintSession(Eq(1), Eq(2), _, Eq(16'000'000)))
+            .WillOnce(Return(HalResult<sp<IPowerHintSession>>::ok(mMockSession)));
+
+    auto rate = mQueue->getHintSessionPreferredRate();
+    ASSERT_TRUE(rate.isOk());
+    EXPECT_EQ(100, rate.value());
+    auto session = mQueue->createHintSession(1, 2, {3}, 16'000'000);
+    ASSERT_TRUE(session.isOk());
+    EXPECT_EQ(mMockSession, session.value());
+}
@@ -307,9 +307,8 @@ void BufferLayer::preparePerFrameCompositionState() {
     }
 
     compositionState->buffer = getBuffer();
-    compositionState->bufferSlot = (mBufferInfo.mBufferSlot == BufferQueue::INVALID_BUFFER_SLOT)
-            ? 0
-            : mBufferInfo.mBufferSlot;
+    // Without a slot, the HWC buffer cache looks the buffer up by id.
+    compositionState->bufferSlot = mBufferInfo.mBufferSlot;
     compositionState->acquireFence = mBufferInfo.mFence;
     compositionState->frameNumber = mBufferInfo.mFrameNumber;
     compositionState->sidebandStreamHasFrame = false;
@@ -694,6 +694,12 @@ status_t BufferStateLayer::updateActiveBuffer() {
 
     if (!mBufferInfo.mBuffer || !s.buffer->hasSameBuffer(*mBufferInfo.mBuffer)) {
         decrementPendingBufferCount();
+        // Buffers which are not in the client cache have no slot, and are cached in the HWC by id.
+        // Uncache them once released, since the client may free them at any time. The others are
+        // uncached when they are erased from the client cache.
+        if (mBufferInfo.mBuffer && mBufferInfo.mBufferSlot == BufferQueue::INVALID_BUFFER_SLOT) {
+            mFlinger->mBufferIdsToUncache.push_back(mBufferInfo.mBuffer->getBuffer()->getId());
+        }
     }
 
     mPreviousReleaseCallbackId = {getCurrentBufferId(), mBufferInfo.mFrameNumber};
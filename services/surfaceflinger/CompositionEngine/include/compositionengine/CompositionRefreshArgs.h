@@ -47,6 +47,10 @@ struct CompositionRefreshArgs {
     // All the layers that have queued updates.
     Layers layersWithQueuedFrames;
 
+    // The ids of the buffers which were released or erased from the client cache since the last
+    // refresh. They are removed from the HWC buffer caches of the output layers.
+    std::vector<uint64_t> bufferIdsToUncache;
+
     // Controls how the color mode is chosen for an output
     OutputColorSetting outputColorSetting{OutputColorSetting::kEnhanced};
 
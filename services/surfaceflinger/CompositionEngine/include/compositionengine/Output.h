@@ -23,6 +23,7 @@
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <compositionengine/LayerFE.h>
 #include <renderengine/LayerSettings.h>
@@ -37,6 +38,7 @@
 
 #include <ui/DisplayIdentification.h>
 #include "DisplayHardware/HWComposer.h"
+#include "DisplayHardware/LayerSlotArray.h"
 
 namespace android {
 
@@ -128,7 +130,8 @@ public:
     struct FrameFences {
         sp<Fence> presentFence{Fence::NO_FENCE};
         sp<Fence> clientTargetAcquireFence{Fence::NO_FENCE};
-        std::unordered_map<HWC2::Layer*, sp<Fence>> layerFences;
+        // Indexed by HWC2::Layer::getDisplaySlot.
+        HWC2::LayerSlotArray<sp<Fence>> layerFences;
     };
 
     struct ColorProfile {
@@ -279,6 +282,7 @@ protected:
     virtual void collectVisibleLayers(const CompositionRefreshArgs&, CoverageState&) = 0;
     virtual void ensureOutputLayerIfVisible(sp<LayerFE>&, CoverageState&) = 0;
     virtual void setReleasedLayers(const CompositionRefreshArgs&) = 0;
+    virtual void uncacheBuffers(const std::vector<uint64_t>& bufferIdsToUncache) = 0;
 
     virtual void updateCompositionState(const CompositionRefreshArgs&) = 0;
     virtual void planComposition() = 0;
@@ -19,6 +19,7 @@
 #include <cstdint>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include <ui/Transform.h>
 #include <utils/StrongPointer.h>
@@ -104,6 +105,10 @@ public:
     // Updates the cursor position with the HWC
     virtual void writeCursorPositionToHWC() const = 0;
 
+    // Removes the buffers from the HWC buffer cache, and clears the HWC buffer slots they were
+    // cached in so that the HWC releases them.
+    virtual void uncacheBuffers(const std::vector<uint64_t>& bufferIdsToUncache) = 0;
+
     // Returns the HWC2::Layer associated with this layer, if it exists
     virtual HWC2::Layer* getHwcLayer() const = 0;
 
@@ -17,7 +17,9 @@
 #pragma once
 
 #include <cstdint>
-#include <deque>
+#include <list>
+#include <string>
+#include <unordered_map>
 
 #include <compositionengine/LayerFE.h>
 #include <renderengine/DisplaySettings.h>
@@ -37,16 +39,52 @@ namespace compositionengine::impl {
 // the composition request. We need to make sure the request, including the order of the
 // layers, do not change from call to call. The snapshot removes strong references to the
 // client buffer id so we don't extend the lifetime of the buffer by storing it in the cache.
+//
+// Each request is stored with a 64-bit fingerprint of the fields compared by the cache, so a
+// changed request is usually rejected without comparing the layer settings. Matching
+// fingerprints are still confirmed by comparing the whole request, so that a collision can
+// never reuse a stale buffer. When full, the least recently used request is evicted.
 class ClientCompositionRequestCache {
 public:
+    using Fingerprint = uint64_t;
+
     explicit ClientCompositionRequestCache(uint32_t cacheSize) : mMaxCacheSize(cacheSize){};
     ~ClientCompositionRequestCache() = default;
+
+    // Computes the fingerprint of a request. It only depends on the fields compared by exists(),
+    // so it can be computed once per composition and passed to both exists() and add().
+    static Fingerprint getFingerprint(const renderengine::DisplaySettings& display,
+                                      const std::vector<LayerFE::LayerSettings>& layerSettings);
+
+    bool exists(uint64_t bufferId, Fingerprint fingerprint,
+                const renderengine::DisplaySettings& display,
+                const std::vector<LayerFE::LayerSettings>& layerSettings);
     bool exists(uint64_t bufferId, const renderengine::DisplaySettings& display,
-                const std::vector<LayerFE::LayerSettings>& layerSettings) const;
-    void add(uint64_t bufferId, const renderengine::DisplaySettings& display,
+                const std::vector<LayerFE::LayerSettings>& layerSettings) {
+        return exists(bufferId, getFingerprint(display, layerSettings), display, layerSettings);
+    }
+    void add(uint64_t bufferId, Fingerprint fingerprint,
+             const renderengine::DisplaySettings& display,
              const std::vector<LayerFE::LayerSettings>& layerSettings);
+    void add(uint64_t bufferId, const renderengine::DisplaySettings& display,
+             const std::vector<LayerFE::LayerSettings>& layerSettings) {
+        add(bufferId, getFingerprint(display, layerSettings), display, layerSettings);
+    }
     void remove(uint64_t bufferId);
 
+    size_t size() const { return mCache.size(); }
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        // Misses where the fingerprints matched but the requests did not.
+        uint64_t collisions = 0;
+        uint64_t evictions = 0;
+    };
+    const Stats& getStats() const { return mStats; }
+
+    void dump(std::string& out) const;
+
 private:
     uint32_t mMaxCacheSize;
     struct ClientCompositionRequest {
@@ -58,8 +96,19 @@ private:
                     const std::vector<LayerFE::LayerSettings>& _layerSettings) const;
     };
 
+    struct CachedRequest {
+        Fingerprint fingerprint;
+        ClientCompositionRequest request;
+        // Position of the buffer id in mLruBufferIds.
+        std::list<uint64_t>::iterator lruPosition;
+    };
+
     // Cache of requests, keyed by corresponding GraphicBuffer ID.
-    std::deque<std::pair<uint64_t /* bufferId */, ClientCompositionRequest>> mCache;
+    std::unordered_map<uint64_t /* bufferId */, CachedRequest> mCache;
+    // Buffer ids of the cached requests, from the least to the most recently used.
+    std::list<uint64_t> mLruBufferIds;
+
+    Stats mStats;
 };
 
 } // namespace compositionengine::impl
@@ -17,6 +17,9 @@
 #pragma once
 
 #include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
@@ -54,18 +57,55 @@ public:
     //
     // outBuffer is set to buffer when buffer is not in the HWC cache;
     // otherwise, outBuffer is set to nullptr.
+    //
+    // A valid slot is the BufferQueue slot of the buffer, and the buffer is cached in it. Buffers
+    // without a slot, such as the BLAST buffers which are not in the client cache, are looked up
+    // by id instead. Such a buffer which is not cached yet takes an empty slot, or the slot of a
+    // freed buffer, or else the least recently used slot.
     void getHwcBuffer(int slot, const sp<GraphicBuffer>& buffer, uint32_t* outSlot,
                       sp<GraphicBuffer>* outBuffer);
 
+    // Forgets the buffer, e.g. when it was released or erased from the client cache, so that its
+    // slot is reused before the slots of buffers still in use. Returns the slot the buffer was
+    // cached in, which the HWC should clear, or nothing if the buffer was not cached.
+    std::optional<uint32_t> uncache(uint64_t bufferId);
+
+    struct Stats {
+        // Buffers found in the HWC cache, which were not sent again.
+        uint64_t hits = 0;
+        // Buffers which were sent to the HWC.
+        uint64_t misses = 0;
+        // Buffers without a slot which replaced a buffer still in use.
+        uint64_t evictions = 0;
+    };
+    const Stats& getStats() const { return mStats; }
+
+    void dump(std::string& out) const;
+
     // Special caching slot for the layer caching feature.
     static const constexpr size_t FLATTENER_CACHING_SLOT = BufferQueue::NUM_BUFFER_SLOTS;
 
 private:
-    // an array where the index corresponds to a slot and the value corresponds to a (counter,
-    // buffer) pair. "counter" is a unique value that indicates the last time this slot was updated
-    // or used and allows us to keep track of the least-recently used buffer.
     static const constexpr size_t kMaxLayerBufferCount = BufferQueue::NUM_BUFFER_SLOTS + 1;
-    wp<GraphicBuffer> mBuffers[kMaxLayerBufferCount];
+
+    struct Slot {
+        wp<GraphicBuffer> buffer;
+        uint64_t bufferId = 0;
+        // A unique value that indicates the last time this slot was updated or used, to keep
+        // track of the least recently used buffer.
+        uint64_t counter = 0;
+    };
+
+    uint32_t findSlotForBuffer(const sp<GraphicBuffer>& buffer);
+    uint32_t getLeastRecentlyUsedSlot();
+    void cacheBuffer(uint32_t slot, const sp<GraphicBuffer>& buffer);
+
+    // An array where the index corresponds to a slot.
+    Slot mSlots[kMaxLayerBufferCount];
+    // The slots of the cached buffers, by buffer id.
+    std::unordered_map<uint64_t, uint32_t> mSlotsByBufferId;
+    uint64_t mCounter = 0;
+    Stats mStats;
 };
 
 } // namespace compositionengine::impl
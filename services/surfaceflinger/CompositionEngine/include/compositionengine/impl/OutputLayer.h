@@ -19,6 +19,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <compositionengine/LayerFE.h>
 #include <compositionengine/OutputLayer.h>
@@ -48,6 +49,7 @@ public:
     void writeStateToHWC(bool includeGeometry, bool skipLayer, uint32_t z, bool zIsOverridden,
                          bool isPeekingThrough) override;
     void writeCursorPositionToHWC() const override;
+    void uncacheBuffers(const std::vector<uint64_t>& bufferIdsToUncache) override;
 
     HWC2::Layer* getHwcLayer() const override;
     bool requiresClientComposition() const override;
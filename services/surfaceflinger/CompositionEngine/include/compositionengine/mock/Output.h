@@ -90,6 +90,7 @@ public:
     MOCK_METHOD2(ensureOutputLayerIfVisible,
                  void(sp<compositionengine::LayerFE>&, compositionengine::Output::CoverageState&));
     MOCK_METHOD1(setReleasedLayers, void(const compositionengine::CompositionRefreshArgs&));
+    MOCK_METHOD1(uncacheBuffers, void(const std::vector<uint64_t>&));
 
     MOCK_CONST_METHOD1(updateLayerStateFromFE, void(const CompositionRefreshArgs&));
     MOCK_METHOD1(updateCompositionState, void(const CompositionRefreshArgs&));
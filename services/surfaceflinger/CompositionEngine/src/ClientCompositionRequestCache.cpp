@@ -15,7 +15,11 @@
  */
 
 #include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <type_traits>
 
+#include <android-base/stringprintf.h>
 #include <compositionengine/impl/ClientCompositionRequestCache.h>
 #include <renderengine/DisplaySettings.h>
 #include <renderengine/LayerSettings.h>
@@ -66,6 +70,122 @@ bool layerSettingsAreEqual(const LayerFE::LayerSettings& lhs, const LayerFE::Lay
             equalIgnoringBuffer(lhs, rhs);
 }
 
+// Accumulates the fields compared by the cache into a 64-bit fingerprint. Values which compare
+// equal must add the same bits, so negative zeros are added as positive zeros.
+class FingerprintBuilder {
+public:
+    void add(uint64_t value) {
+        mFingerprint ^= value + 0x9e3779b97f4a7c15ull + (mFingerprint << 6) + (mFingerprint >> 2);
+    }
+
+    void add(int32_t value) { add(static_cast<uint64_t>(static_cast<uint32_t>(value))); }
+    void add(uint32_t value) { add(static_cast<uint64_t>(value)); }
+    void add(bool value) { add(static_cast<uint64_t>(value)); }
+
+    void add(float value) {
+        if (value == 0.f) {
+            value = 0.f;
+        }
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        add(bits);
+    }
+
+    void add(half value) { add(static_cast<float>(value)); }
+
+    template <typename T, std::enable_if_t<std::is_enum_v<T>, bool> = true>
+    void add(T value) {
+        add(static_cast<uint64_t>(static_cast<std::underlying_type_t<T>>(value)));
+    }
+
+    template <template <typename> class Vec, typename T>
+    void add(const Vec<T>& vector) {
+        for (size_t i = 0; i < vector.size(); i++) {
+            add(vector[i]);
+        }
+    }
+
+    void add(const mat4& matrix) {
+        for (size_t i = 0; i < mat4::COL_SIZE; i++) {
+            add(matrix[i]);
+        }
+    }
+
+    void add(const Rect& rect) {
+        add(rect.left);
+        add(rect.top);
+        add(rect.right);
+        add(rect.bottom);
+    }
+
+    void add(const FloatRect& rect) {
+        add(rect.left);
+        add(rect.top);
+        add(rect.right);
+        add(rect.bottom);
+    }
+
+    void add(const renderengine::DisplaySettings& display) {
+        add(display.physicalDisplay);
+        add(display.clip);
+        add(display.maxLuminance);
+        add(display.currentLuminanceNits);
+        add(display.outputDataspace);
+        add(display.colorTransform);
+        add(display.deviceHandlesColorTransform);
+        add(display.orientation);
+        add(display.targetLuminanceNits);
+        add(display.dimmingStage);
+        add(display.renderIntent);
+    }
+
+    // Must stay in sync with layerSettingsAreEqual.
+    void add(const LayerFE::LayerSettings& settings) {
+        add(settings.bufferId);
+        add(settings.frameNumber);
+
+        add(settings.geometry.boundaries);
+        add(settings.geometry.positionTransform);
+        add(settings.geometry.roundedCornersRadius);
+        add(settings.geometry.roundedCornersCrop);
+        add(settings.alpha);
+        add(settings.sourceDataspace);
+        add(settings.colorTransform);
+        add(settings.disableBlending);
+        add(settings.shadow.boundaries);
+        add(settings.shadow.ambientColor);
+        add(settings.shadow.spotColor);
+        add(settings.shadow.lightPos);
+        add(settings.shadow.lightRadius);
+        add(settings.shadow.length);
+        add(settings.shadow.casterIsTranslucent);
+        add(settings.backgroundBlurRadius);
+        add(settings.stretchEffect.width);
+        add(settings.stretchEffect.height);
+        add(settings.stretchEffect.vectorX);
+        add(settings.stretchEffect.vectorY);
+        add(settings.stretchEffect.maxAmountX);
+        add(settings.stretchEffect.maxAmountY);
+        add(settings.stretchEffect.mappedChildBounds);
+
+        add(settings.source.solidColor);
+
+        const renderengine::Buffer& buffer = settings.source.buffer;
+        add(buffer.textureName);
+        add(buffer.useTextureFiltering);
+        add(buffer.textureTransform);
+        add(buffer.usePremultipliedAlpha);
+        add(buffer.isOpaque);
+        add(buffer.isY410BT2020);
+        add(buffer.maxLuminanceNits);
+    }
+
+    uint64_t get() const { return mFingerprint; }
+
+private:
+    uint64_t mFingerprint = 0;
+};
+
 } // namespace
 
 ClientCompositionRequestCache::ClientCompositionRequest::ClientCompositionRequest(
@@ -86,42 +206,74 @@ bool ClientCompositionRequestCache::ClientCompositionRequest::equals(
                        newLayerSettings.end(), layerSettingsAreEqual);
 }
 
+ClientCompositionRequestCache::Fingerprint ClientCompositionRequestCache::getFingerprint(
+        const renderengine::DisplaySettings& display,
+        const std::vector<LayerFE::LayerSettings>& layerSettings) {
+    FingerprintBuilder builder;
+    builder.add(display);
+    builder.add(static_cast<uint64_t>(layerSettings.size()));
+    for (const LayerFE::LayerSettings& settings : layerSettings) {
+        builder.add(settings);
+    }
+    return builder.get();
+}
+
 bool ClientCompositionRequestCache::exists(
-        uint64_t bufferId, const renderengine::DisplaySettings& display,
-        const std::vector<LayerFE::LayerSettings>& layerSettings) const {
-    for (const auto& [cachedBufferId, cachedRequest] : mCache) {
-        if (cachedBufferId == bufferId) {
-            return cachedRequest.equals(display, layerSettings);
-        }
+        uint64_t bufferId, Fingerprint fingerprint, const renderengine::DisplaySettings& display,
+        const std::vector<LayerFE::LayerSettings>& layerSettings) {
+    const auto it = mCache.find(bufferId);
+    if (it == mCache.end() || it->second.fingerprint != fingerprint) {
+        mStats.misses++;
+        return false;
     }
-    return false;
+
+    if (!it->second.request.equals(display, layerSettings)) {
+        mStats.misses++;
+        mStats.collisions++;
+        return false;
+    }
+
+    mStats.hits++;
+    mLruBufferIds.splice(mLruBufferIds.end(), mLruBufferIds, it->second.lruPosition);
+    return true;
 }
 
-void ClientCompositionRequestCache::add(uint64_t bufferId,
+void ClientCompositionRequestCache::add(uint64_t bufferId, Fingerprint fingerprint,
                                         const renderengine::DisplaySettings& display,
                                         const std::vector<LayerFE::LayerSettings>& layerSettings) {
-    const ClientCompositionRequest request(display, layerSettings);
-    for (auto& [cachedBufferId, cachedRequest] : mCache) {
-        if (cachedBufferId == bufferId) {
-            cachedRequest = std::move(request);
-            return;
-        }
+    if (const auto it = mCache.find(bufferId); it != mCache.end()) {
+        it->second.fingerprint = fingerprint;
+        it->second.request = ClientCompositionRequest(display, layerSettings);
+        mLruBufferIds.splice(mLruBufferIds.end(), mLruBufferIds, it->second.lruPosition);
+        return;
     }
 
     if (mCache.size() >= mMaxCacheSize) {
-        mCache.pop_front();
+        mCache.erase(mLruBufferIds.front());
+        mLruBufferIds.pop_front();
+        mStats.evictions++;
     }
 
-    mCache.emplace_back(bufferId, std::move(request));
+    const auto lruPosition = mLruBufferIds.insert(mLruBufferIds.end(), bufferId);
+    mCache.emplace(bufferId,
+                   CachedRequest{fingerprint, ClientCompositionRequest(display, layerSettings),
+                                 lruPosition});
 }
 
 void ClientCompositionRequestCache::remove(uint64_t bufferId) {
-    for (auto it = mCache.begin(); it != mCache.end(); it++) {
-        if (it->first == bufferId) {
-            mCache.erase(it);
-            return;
-        }
+    if (const auto it = mCache.find(bufferId); it != mCache.end()) {
+        mLruBufferIds.erase(it->second.lruPosition);
+        mCache.erase(it);
     }
 }
 
+void ClientCompositionRequestCache::dump(std::string& out) const {
+    base::StringAppendF(&out,
+                        "   Client composition request cache: %zu/%u requests, %" PRIu64
+                        " hits, %" PRIu64 " misses (%" PRIu64 " collisions), %" PRIu64
+                        " evictions\n",
+                        mCache.size(), mMaxCacheSize, mStats.hits, mStats.misses,
+                        mStats.collisions, mStats.evictions);
+}
+
 } // namespace android::compositionengine::impl
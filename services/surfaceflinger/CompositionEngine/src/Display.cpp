@@ -314,10 +314,9 @@ void Display::applyChangedTypesToLayers(const ChangedTypes& changedTypes) {
             continue;
         }
 
-        if (auto it = changedTypes.find(hwcLayer); it != changedTypes.end()) {
+        if (const auto* type = changedTypes.get(hwcLayer->getDisplaySlot())) {
             layer->applyDeviceCompositionTypeChange(
-                    static_cast<aidl::android::hardware::graphics::composer3::Composition>(
-                            it->second));
+                    static_cast<aidl::android::hardware::graphics::composer3::Composition>(*type));
         }
     }
 }
@@ -338,9 +337,9 @@ void Display::applyLayerRequestsToLayers(const LayerRequests& layerRequests) {
             continue;
         }
 
-        if (auto it = layerRequests.find(hwcLayer); it != layerRequests.end()) {
+        if (const auto* request = layerRequests.get(hwcLayer->getDisplaySlot())) {
             layer->applyDeviceLayerRequest(
-                    static_cast<Hwc2::IComposerClient::LayerRequest>(it->second));
+                    static_cast<Hwc2::IComposerClient::LayerRequest>(*request));
         }
     }
 }
@@ -396,7 +395,8 @@ compositionengine::Output::FrameFences Display::presentAndGetFrameFences() {
             continue;
         }
 
-        fences.layerFences.emplace(hwcLayer, hwc.getLayerReleaseFence(*halDisplayIdOpt, hwcLayer));
+        fences.layerFences.set(hwcLayer->getDisplaySlot(),
+                               hwc.getLayerReleaseFence(*halDisplayIdOpt, hwcLayer));
     }
 
     hwc.clearReleaseFences(*halDisplayIdOpt);
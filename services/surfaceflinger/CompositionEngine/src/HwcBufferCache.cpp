@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <android-base/stringprintf.h>
 #include <compositionengine/impl/HwcBufferCache.h>
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
@@ -26,33 +27,111 @@
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
 #pragma clang diagnostic pop // ignored "-Wconversion"
 
+#include <cinttypes>
+
 namespace android::compositionengine::impl {
 
-HwcBufferCache::HwcBufferCache() {
-    std::fill(std::begin(mBuffers), std::end(mBuffers), wp<GraphicBuffer>(nullptr));
-}
+HwcBufferCache::HwcBufferCache() = default;
 
 void HwcBufferCache::getHwcBuffer(int slot, const sp<GraphicBuffer>& buffer, uint32_t* outSlot,
                                   sp<GraphicBuffer>* outBuffer) {
-    // default is 0
-    if (slot == BufferQueue::INVALID_BUFFER_SLOT || slot < 0 ||
-        slot >= static_cast<int32_t>(kMaxLayerBufferCount)) {
-        *outSlot = 0;
-    } else {
+    if (slot >= 0 && slot < static_cast<int32_t>(kMaxLayerBufferCount)) {
         *outSlot = static_cast<uint32_t>(slot);
+    } else if (buffer) {
+        *outSlot = findSlotForBuffer(buffer);
+    } else {
+        // default is 0
+        *outSlot = 0;
     }
 
-    auto& currentBuffer = mBuffers[*outSlot];
-    wp<GraphicBuffer> weakCopy(buffer);
-    if (currentBuffer == weakCopy) {
+    auto& currentSlot = mSlots[*outSlot];
+    currentSlot.counter = mCounter++;
+    // The id is compared as well, as a freed buffer may be followed by a new one at the same
+    // address.
+    if (currentSlot.buffer.unsafe_get() == buffer.get() &&
+        (!buffer || currentSlot.bufferId == buffer->getId())) {
         // already cached in HWC, skip sending the buffer
         *outBuffer = nullptr;
+        if (buffer) {
+            mStats.hits++;
+        }
     } else {
         *outBuffer = buffer;
+        if (buffer) {
+            mStats.misses++;
+        }
 
         // update cache
-        currentBuffer = buffer;
+        cacheBuffer(*outSlot, buffer);
+    }
+}
+
+std::optional<uint32_t> HwcBufferCache::uncache(uint64_t bufferId) {
+    const auto it = mSlotsByBufferId.find(bufferId);
+    if (it == mSlotsByBufferId.end()) {
+        return {};
+    }
+    const uint32_t slot = it->second;
+    cacheBuffer(slot, nullptr);
+    mSlots[slot].counter = 0;
+    return slot;
+}
+
+uint32_t HwcBufferCache::findSlotForBuffer(const sp<GraphicBuffer>& buffer) {
+    if (const auto it = mSlotsByBufferId.find(buffer->getId()); it != mSlotsByBufferId.end()) {
+        return it->second;
+    }
+
+    // The flattener slot is left out, as the layer caching feature sets it explicitly.
+    for (uint32_t slot = 0; slot < BufferQueue::NUM_BUFFER_SLOTS; slot++) {
+        if (mSlots[slot].buffer.promote() == nullptr) {
+            return slot;
+        }
+    }
+
+    mStats.evictions++;
+    return getLeastRecentlyUsedSlot();
+}
+
+uint32_t HwcBufferCache::getLeastRecentlyUsedSlot() {
+    uint32_t lruSlot = 0;
+    for (uint32_t slot = 1; slot < BufferQueue::NUM_BUFFER_SLOTS; slot++) {
+        if (mSlots[slot].counter < mSlots[lruSlot].counter) {
+            lruSlot = slot;
+        }
+    }
+    return lruSlot;
+}
+
+void HwcBufferCache::cacheBuffer(uint32_t slot, const sp<GraphicBuffer>& buffer) {
+    auto& entry = mSlots[slot];
+    if (entry.buffer.unsafe_get() != nullptr) {
+        // The same buffer may be in several slots, in which case the id maps to the last one.
+        if (const auto it = mSlotsByBufferId.find(entry.bufferId);
+            it != mSlotsByBufferId.end() && it->second == slot) {
+            mSlotsByBufferId.erase(it);
+        }
+    }
+
+    entry.buffer = buffer;
+    entry.bufferId = buffer ? buffer->getId() : 0;
+    if (buffer) {
+        mSlotsByBufferId[entry.bufferId] = slot;
+    }
+}
+
+void HwcBufferCache::dump(std::string& out) const {
+    size_t cachedCount = 0;
+    for (const auto& slot : mSlots) {
+        if (slot.buffer.unsafe_get() != nullptr) {
+            cachedCount++;
+        }
     }
+    base::StringAppendF(&out,
+                        "bufferCache=%zu/%zu slots (%" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64
+                        " evictions) ",
+                        cachedCount, kMaxLayerBufferCount, mStats.hits, mStats.misses,
+                        mStats.evictions);
 }
 
 } // namespace android::compositionengine::impl
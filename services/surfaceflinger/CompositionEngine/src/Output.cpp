@@ -318,6 +318,11 @@ void Output::dumpBase(std::string& out) const {
         out.append("    No render surface!\n");
     }
 
+    if (mClientCompositionRequestCache) {
+        out += '\n';
+        mClientCompositionRequestCache->dump(out);
+    }
+
     base::StringAppendF(&out, "\n   %zu Layers\n", getOutputLayerCount());
     for (const auto* outputLayer : getOutputLayersOrderedByZ()) {
         if (!outputLayer) {
@@ -424,6 +429,7 @@ void Output::prepare(const compositionengine::CompositionRefreshArgs& refreshArg
     ALOGV(__FUNCTION__);
 
     rebuildLayerStacks(refreshArgs, geomSnapshots);
+    uncacheBuffers(refreshArgs.bufferIdsToUncache);
 }
 
 void Output::present(const compositionengine::CompositionRefreshArgs& refreshArgs) {
@@ -725,6 +731,15 @@ void Output::setReleasedLayers(const compositionengine::CompositionRefreshArgs&)
     // The base class does nothing with this call.
 }
 
+void Output::uncacheBuffers(const std::vector<uint64_t>& bufferIdsToUncache) {
+    if (bufferIdsToUncache.empty()) {
+        return;
+    }
+    for (auto* layer : getOutputLayersOrderedByZ()) {
+        layer->uncacheBuffers(bufferIdsToUncache);
+    }
+}
+
 void Output::updateLayerStateFromFE(const CompositionRefreshArgs& args) const {
     for (auto* layer : getOutputLayersOrderedByZ()) {
         layer->getLayerFE().prepareCompositionState(
@@ -1237,7 +1252,10 @@ std::optional<base::unique_fd> Output::composeSurfaces(
     // Check if the client composition requests were rendered into the provided graphic buffer. If
     // so, we can reuse the buffer and avoid client composition.
     if (mClientCompositionRequestCache) {
-        if (mClientCompositionRequestCache->exists(tex->getBuffer()->getId(),
+        const auto fingerprint =
+                ClientCompositionRequestCache::getFingerprint(clientCompositionDisplay,
+                                                              clientCompositionLayers);
+        if (mClientCompositionRequestCache->exists(tex->getBuffer()->getId(), fingerprint,
                                                    clientCompositionDisplay,
                                                    clientCompositionLayers)) {
             ATRACE_NAME("ClientCompositionCacheHit");
@@ -1247,8 +1265,8 @@ std::optional<base::unique_fd> Output::composeSurfaces(
             return base::unique_fd(std::move(fd));
         }
         ATRACE_NAME("ClientCompositionCacheMiss");
-        mClientCompositionRequestCache->add(tex->getBuffer()->getId(), clientCompositionDisplay,
-                                            clientCompositionLayers);
+        mClientCompositionRequestCache->add(tex->getBuffer()->getId(), fingerprint,
+                                            clientCompositionDisplay, clientCompositionLayers);
     }
 
     // We boost GPU frequency here because there will be color spaces conversion
@@ -1460,8 +1478,8 @@ void Output::postFramebuffer() {
         sp<Fence> releaseFence = Fence::NO_FENCE;
 
         if (auto hwcLayer = layer->getHwcLayer()) {
-            if (auto f = frame.layerFences.find(hwcLayer); f != frame.layerFences.end()) {
-                releaseFence = f->second;
+            if (const sp<Fence>* fence = frame.layerFences.get(hwcLayer->getDisplaySlot())) {
+                releaseFence = *fence;
             }
         }
 
@@ -698,6 +698,29 @@ void OutputLayer::writeCursorPositionToHWC() const {
     }
 }
 
+void OutputLayer::uncacheBuffers(const std::vector<uint64_t>& bufferIdsToUncache) {
+    // Skip doing this if there is no HWC interface
+    auto hwcLayer = getHwcLayer();
+    if (!hwcLayer) {
+        return;
+    }
+
+    std::vector<uint32_t> slotsToClear;
+    for (uint64_t bufferId : bufferIdsToUncache) {
+        if (const auto slot = editState().hwc->hwcBufferCache.uncache(bufferId)) {
+            slotsToClear.push_back(*slot);
+        }
+    }
+    if (slotsToClear.empty()) {
+        return;
+    }
+
+    if (auto error = hwcLayer->clearBufferSlots(slotsToClear); error != hal::Error::NONE) {
+        ALOGE("[%s] Failed to clear %zu buffer slots: %s (%d)", getLayerFE().getDebugName(),
+              slotsToClear.size(), to_string(error).c_str(), static_cast<int32_t>(error));
+    }
+}
+
 HWC2::Layer* OutputLayer::getHwcLayer() const {
     const auto& state = getState();
     return state.hwc ? state.hwc->hwcLayer.get() : nullptr;
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <compositionengine/impl/ClientCompositionRequestCache.h>
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace android::compositionengine {
+namespace {
+
+using impl::ClientCompositionRequestCache;
+
+constexpr uint64_t kBufferId1 = 1;
+constexpr uint64_t kBufferId2 = 2;
+constexpr uint64_t kBufferId3 = 3;
+
+class ClientCompositionRequestCacheTest : public testing::Test {
+public:
+    ClientCompositionRequestCacheTest() {
+        mDisplay.physicalDisplay = Rect(0, 0, 1080, 2340);
+        mDisplay.clip = Rect(0, 0, 1080, 2340);
+        mDisplay.outputDataspace = ui::Dataspace::V0_SRGB;
+
+        LayerFE::LayerSettings layer;
+        layer.bufferId = 42;
+        layer.frameNumber = 7;
+        layer.geometry.boundaries = FloatRect(0.f, 0.f, 100.f, 200.f);
+        layer.alpha = 1.f;
+        layer.source.buffer.textureName = 3;
+        mLayers.push_back(layer);
+
+        layer.bufferId = 0;
+        layer.frameNumber = 0;
+        layer.source.solidColor = half3(1.f, 0.f, 0.f);
+        mLayers.push_back(layer);
+    }
+
+    ClientCompositionRequestCache mCache{3};
+    renderengine::DisplaySettings mDisplay;
+    std::vector<LayerFE::LayerSettings> mLayers;
+};
+
+TEST_F(ClientCompositionRequestCacheTest, existsAfterAdd) {
+    EXPECT_FALSE(mCache.exists(kBufferId1, mDisplay, mLayers));
+
+    mCache.add(kBufferId1, mDisplay, mLayers);
+    EXPECT_TRUE(mCache.exists(kBufferId1, mDisplay, mLayers));
+    EXPECT_FALSE(mCache.exists(kBufferId2, mDisplay, mLayers));
+
+    mCache.remove(kBufferId1);
+    EXPECT_FALSE(mCache.exists(kBufferId1, mDisplay, mLayers));
+    EXPECT_EQ(0u, mCache.size());
+}
+
+TEST_F(ClientCompositionRequestCacheTest, ignoresBufferReferences) {
+    mCache.add(kBufferId1, mDisplay, mLayers);
+
+    mLayers[0].source.buffer.fence = sp<Fence>::make();
+    EXPECT_TRUE(mCache.exists(kBufferId1, mDisplay, mLayers));
+}
+
+TEST_F(ClientCompositionRequestCacheTest, negativeZeroMatchesZero) {
+    mCache.add(kBufferId1, mDisplay, mLayers);
+
+    mLayers[0].geometry.boundaries.left = -0.f;
+    EXPECT_TRUE(mCache.exists(kBufferId1, mDisplay, mLayers));
+}
+
+TEST_F(ClientCompositionRequestCacheTest, changedRequestDoesNotExist) {
+    const std::vector<std::pair<std::string, std::function<void()>>> changes = {
+            {"display clip", [&] { mDisplay.clip = Rect(0, 0, 10, 10); }},
+            {"display dataspace", [&] { mDisplay.outputDataspace = ui::Dataspace::DISPLAY_P3; }},
+            {"display color transform", [&] { mDisplay.colorTransform[0][0] = 0.5f; }},
+            {"buffer id", [&] { mLayers[0].bufferId++; }},
+            {"frame number", [&] { mLayers[0].frameNumber++; }},
+            {"boundaries", [&] { mLayers[0].geometry.boundaries.right = 101.f; }},
+            {"position", [&] { mLayers[0].geometry.positionTransform[3][0] = 5.f; }},
+            {"corner radius", [&] { mLayers[0].geometry.roundedCornersRadius.x = 4.f; }},
+            {"alpha", [&] { mLayers[0].alpha = 0.5f; }},
+            {"dataspace", [&] { mLayers[0].sourceDataspace = ui::Dataspace::BT2020_PQ; }},
+            {"blending", [&] { mLayers[0].disableBlending = true; }},
+            {"shadow", [&] { mLayers[0].shadow.length = 2.f; }},
+            {"blur", [&] { mLayers[0].backgroundBlurRadius = 10; }},
+            {"stretch", [&] { mLayers[0].stretchEffect.vectorX = 0.5f; }},
+            {"solid color", [&] { mLayers[1].source.solidColor.g = 1.f; }},
+            {"texture name", [&] { mLayers[0].source.buffer.textureName = 4; }},
+            {"texture transform", [&] { mLayers[0].source.buffer.textureTransform[1][1] = -1.f; }},
+            {"opaque", [&] { mLayers[0].source.buffer.isOpaque = true; }},
+            {"luminance", [&] { mLayers[0].source.buffer.maxLuminanceNits = 500.f; }},
+            {"layer order", [&] { std::swap(mLayers[0], mLayers[1]); }},
+            {"removed layer", [&] { mLayers.pop_back(); }},
+            {"added layer", [&] { mLayers.push_back(mLayers[0]); }},
+    };
+
+    const renderengine::DisplaySettings display = mDisplay;
+    const std::vector<LayerFE::LayerSettings> layers = mLayers;
+    mCache.add(kBufferId1, display, layers);
+    const auto fingerprint = ClientCompositionRequestCache::getFingerprint(display, layers);
+
+    for (const auto& [name, change] : changes) {
+        SCOPED_TRACE(name);
+        mDisplay = display;
+        mLayers = layers;
+        change();
+        EXPECT_NE(fingerprint, ClientCompositionRequestCache::getFingerprint(mDisplay, mLayers));
+        EXPECT_FALSE(mCache.exists(kBufferId1, mDisplay, mLayers));
+    }
+}
+
+TEST_F(ClientCompositionRequestCacheTest, fingerprintCollisionIsNotAHit) {
+    const ClientCompositionRequestCache::Fingerprint fingerprint = 0x1234;
+    mCache.add(kBufferId1, fingerprint, mDisplay, mLayers);
+
+    std::vector<LayerFE::LayerSettings> otherLayers = mLayers;
+    otherLayers[0].alpha = 0.25f;
+    EXPECT_FALSE(mCache.exists(kBufferId1, fingerprint, mDisplay, otherLayers));
+    EXPECT_EQ(1u, mCache.getStats().collisions);
+
+    EXPECT_TRUE(mCache.exists(kBufferId1, fingerprint, mDisplay, mLayers));
+}
+
+TEST_F(ClientCompositionRequestCacheTest, addReplacesRequestOfBuffer) {
+    mCache.add(kBufferId1, mDisplay, mLayers);
+
+    std::vector<LayerFE::LayerSettings> otherLayers = mLayers;
+    otherLayers[0].frameNumber++;
+    mCache.add(kBufferId1, mDisplay, otherLayers);
+
+    EXPECT_EQ(1u, mCache.size());
+    EXPECT_FALSE(mCache.exists(kBufferId1, mDisplay, mLayers));
+    EXPECT_TRUE(mCache.exists(kBufferId1, mDisplay, otherLayers));
+}
+
+TEST_F(ClientCompositionRequestCacheTest, evictsLeastRecentlyUsedRequest) {
+    constexpr uint64_t kBufferId4 = 4;
+
+    mCache.add(kBufferId1, mDisplay, mLayers);
+    mCache.add(kBufferId2, mDisplay, mLayers);
+    mCache.add(kBufferId3, mDisplay, mLayers);
+
+    // Using the first request makes the second one the least recently used.
+    EXPECT_TRUE(mCache.exists(kBufferId1, mDisplay, mLayers));
+    mCache.add(kBufferId4, mDisplay, mLayers);
+
+    EXPECT_EQ(3u, mCache.size());
+    EXPECT_EQ(1u, mCache.getStats().evictions);
+    EXPECT_TRUE(mCache.exists(kBufferId1, mDisplay, mLayers));
+    EXPECT_FALSE(mCache.exists(kBufferId2, mDisplay, mLayers));
+    EXPECT_TRUE(mCache.exists(kBufferId3, mDisplay, mLayers));
+    EXPECT_TRUE(mCache.exists(kBufferId4, mDisplay, mLayers));
+}
+
+TEST_F(ClientCompositionRequestCacheTest, countsHitsAndMisses) {
+    EXPECT_FALSE(mCache.exists(kBufferId1, mDisplay, mLayers));
+    mCache.add(kBufferId1, mDisplay, mLayers);
+    EXPECT_TRUE(mCache.exists(kBufferId1, mDisplay, mLayers));
+    EXPECT_TRUE(mCache.exists(kBufferId1, mDisplay, mLayers));
+
+    mLayers[0].frameNumber++;
+    EXPECT_FALSE(mCache.exists(kBufferId1, mDisplay, mLayers));
+
+    const ClientCompositionRequestCache::Stats& stats = mCache.getStats();
+    EXPECT_EQ(2u, stats.hits);
+    EXPECT_EQ(2u, stats.misses);
+    EXPECT_EQ(0u, stats.collisions);
+    EXPECT_EQ(0u, stats.evictions);
+
+    std::string dump;
+    mCache.dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("2 hits, 2 misses"));
+}
+
+} // namespace
+} // namespace android::compositionengine
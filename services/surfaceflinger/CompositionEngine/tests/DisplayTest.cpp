@@ -72,10 +72,16 @@ constexpr GpuVirtualDisplayId GPU_VIRTUAL_DISPLAY_ID{789u};
 
 constexpr ui::Size DEFAULT_RESOLUTION{1920, 1080};
 
+constexpr uint32_t LAYER_1_SLOT = 1u;
+constexpr uint32_t LAYER_2_SLOT = 2u;
+// A slot of the display which is not used by any of its output layers.
+constexpr uint32_t UNKNOWN_LAYER_SLOT = 5u;
+
 struct Layer {
-    Layer() {
+    explicit Layer(uint32_t slot) {
         EXPECT_CALL(*outputLayer, getLayerFE()).WillRepeatedly(ReturnRef(*layerFE));
         EXPECT_CALL(*outputLayer, getHwcLayer()).WillRepeatedly(Return(&hwc2Layer));
+        EXPECT_CALL(hwc2Layer, getDisplaySlot()).WillRepeatedly(Return(slot));
     }
 
     sp<StrictMock<mock::LayerFE>> layerFE = sp<StrictMock<mock::LayerFE>>::make();
@@ -204,9 +210,9 @@ struct PartialMockDisplayTestCommon : public DisplayTestCommon {
                                               getDisplayCreationArgsForPhysicalDisplay());
 
     android::HWComposer::DeviceRequestedChanges mDeviceRequestedChanges{
-            {{nullptr, Composition::CLIENT}},
+            {{LAYER_1_SLOT, Composition::CLIENT}},
             hal::DisplayRequest::FLIP_CLIENT_TARGET,
-            {{nullptr, hal::LayerRequest::CLEAR_CLIENT_TARGET}},
+            {{LAYER_1_SLOT, hal::LayerRequest::CLEAR_CLIENT_TARGET}},
             {DEFAULT_DISPLAY_ID.value,
              {aidl::android::hardware::graphics::common::PixelFormat::RGBA_8888,
               aidl::android::hardware::graphics::common::Dataspace::UNKNOWN},
@@ -245,10 +251,9 @@ struct DisplayWithLayersTestCommon : public FullDisplayImplTestCommon {
                                                          0ULL /*usage*/);
     }
 
-    Layer mLayer1;
-    Layer mLayer2;
+    Layer mLayer1{LAYER_1_SLOT};
+    Layer mLayer2{LAYER_2_SLOT};
     LayerNoHWC2Layer mLayer3;
-    StrictMock<HWC2::mock::Layer> hwc2LayerUnknown;
     std::shared_ptr<Display> mDisplay =
             createDisplay<Display>(mCompositionEngine, getDisplayCreationArgsForPhysicalDisplay());
     impl::GpuCompositionResult mResultWithBuffer;
@@ -770,9 +775,9 @@ TEST_F(DisplayApplyChangedTypesToLayersTest, appliesChanges) {
             .Times(1);
 
     mDisplay->applyChangedTypesToLayers(impl::Display::ChangedTypes{
-            {&mLayer1.hwc2Layer, Composition::CLIENT},
-            {&mLayer2.hwc2Layer, Composition::DEVICE},
-            {&hwc2LayerUnknown, Composition::SOLID_COLOR},
+            {LAYER_1_SLOT, Composition::CLIENT},
+            {LAYER_2_SLOT, Composition::DEVICE},
+            {UNKNOWN_LAYER_SLOT, Composition::SOLID_COLOR},
     });
 }
 
@@ -834,8 +839,8 @@ TEST_F(DisplayApplyLayerRequestsToLayersTest, appliesDeviceLayerRequests) {
             .Times(1);
 
     mDisplay->applyLayerRequestsToLayers(impl::Display::LayerRequests{
-            {&mLayer1.hwc2Layer, hal::LayerRequest::CLEAR_CLIENT_TARGET},
-            {&hwc2LayerUnknown, hal::LayerRequest::CLEAR_CLIENT_TARGET},
+            {LAYER_1_SLOT, hal::LayerRequest::CLEAR_CLIENT_TARGET},
+            {UNKNOWN_LAYER_SLOT, hal::LayerRequest::CLEAR_CLIENT_TARGET},
     });
 }
 
@@ -918,10 +923,10 @@ TEST_F(DisplayPresentAndGetFrameFencesTest, returnsPresentAndLayerFences) {
     EXPECT_EQ(presentFence, result.presentFence);
 
     EXPECT_EQ(2u, result.layerFences.size());
-    ASSERT_EQ(1u, result.layerFences.count(&mLayer1.hwc2Layer));
-    EXPECT_EQ(layer1Fence, result.layerFences[&mLayer1.hwc2Layer]);
-    ASSERT_EQ(1u, result.layerFences.count(&mLayer2.hwc2Layer));
-    EXPECT_EQ(layer2Fence, result.layerFences[&mLayer2.hwc2Layer]);
+    ASSERT_NE(nullptr, result.layerFences.get(LAYER_1_SLOT));
+    EXPECT_EQ(layer1Fence, *result.layerFences.get(LAYER_1_SLOT));
+    ASSERT_NE(nullptr, result.layerFences.get(LAYER_2_SLOT));
+    EXPECT_EQ(layer2Fence, *result.layerFences.get(LAYER_2_SLOT));
 }
 
 /*
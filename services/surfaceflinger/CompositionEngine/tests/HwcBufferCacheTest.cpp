@@ -19,6 +19,11 @@
 #include <gui/BufferQueue.h>
 #include <ui/GraphicBuffer.h>
 
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace android::compositionengine {
 namespace {
 
@@ -65,6 +70,29 @@ public:
         EXPECT_EQ(nullptr, outBuffer.get());
     }
 
+    static sp<GraphicBuffer> makeBuffer() {
+        return sp<GraphicBuffer>::make(1, 1, HAL_PIXEL_FORMAT_RGBA_8888, 1, 0);
+    }
+
+    // Returns the slot of the buffer, and whether the buffer was sent.
+    std::pair<uint32_t, bool> getHwcBuffer(int slot, const sp<GraphicBuffer>& buffer) {
+        uint32_t outSlot;
+        sp<GraphicBuffer> outBuffer;
+        mCache.getHwcBuffer(slot, buffer, &outSlot, &outBuffer);
+        return {outSlot, outBuffer != nullptr};
+    }
+
+    // Fills all the slots available to buffers without a slot.
+    std::vector<sp<GraphicBuffer>> fillSlotsWithoutSlot() {
+        std::vector<sp<GraphicBuffer>> buffers;
+        for (uint32_t slot = 0; slot < BufferQueue::NUM_BUFFER_SLOTS; slot++) {
+            buffers.push_back(makeBuffer());
+            EXPECT_EQ(std::make_pair(slot, true),
+                      getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, buffers.back()));
+        }
+        return buffers;
+    }
+
     impl::HwcBufferCache mCache;
     sp<GraphicBuffer> mBuffer1{new GraphicBuffer(1, 1, HAL_PIXEL_FORMAT_RGBA_8888, 1, 0)};
     sp<GraphicBuffer> mBuffer2{new GraphicBuffer(1, 1, HAL_PIXEL_FORMAT_RGBA_8888, 1, 0)};
@@ -78,8 +106,101 @@ TEST_F(HwcBufferCacheTest, cacheWorksForMaxSlot) {
     testSlot(BufferQueue::NUM_BUFFER_SLOTS - 1, BufferQueue::NUM_BUFFER_SLOTS - 1);
 }
 
-TEST_F(HwcBufferCacheTest, cacheMapsNegativeSlotToZero) {
-    testSlot(-123, 0);
+TEST_F(HwcBufferCacheTest, cacheMapsNegativeSlotWithoutBufferToZero) {
+    uint32_t outSlot;
+    sp<GraphicBuffer> outBuffer;
+    mCache.getHwcBuffer(-123, sp<GraphicBuffer>(), &outSlot, &outBuffer);
+    EXPECT_EQ(0u, outSlot);
+    EXPECT_EQ(nullptr, outBuffer.get());
+}
+
+TEST_F(HwcBufferCacheTest, cacheLooksUpBuffersWithoutSlotById) {
+    EXPECT_EQ(std::make_pair(0u, true), getHwcBuffer(-123, mBuffer1));
+    EXPECT_EQ(std::make_pair(0u, false), getHwcBuffer(-123, mBuffer1));
+
+    // A second buffer takes another slot, instead of replacing the first one.
+    EXPECT_EQ(std::make_pair(1u, true), getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer2));
+    EXPECT_EQ(std::make_pair(0u, false), getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer1));
+    EXPECT_EQ(std::make_pair(1u, false), getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer2));
+}
+
+// Counts the buffers sent to the HWC for a BLAST layer which rotates through three buffers which
+// are not in the client cache. Each buffer should only be sent once.
+TEST_F(HwcBufferCacheTest, blastBufferRotationSendsEachBufferOnce) {
+    constexpr int kFrameCount = 300;
+    const std::vector<sp<GraphicBuffer>> buffers = {makeBuffer(), makeBuffer(), makeBuffer()};
+
+    int sentCount = 0;
+    for (int frame = 0; frame < kFrameCount; frame++) {
+        const auto [slot, sent] =
+                getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, buffers[frame % buffers.size()]);
+        EXPECT_EQ(static_cast<uint32_t>(frame % buffers.size()), slot);
+        sentCount += sent;
+    }
+
+    EXPECT_EQ(3, sentCount);
+    EXPECT_EQ(static_cast<uint64_t>(kFrameCount - 3), mCache.getStats().hits);
+    EXPECT_EQ(3u, mCache.getStats().misses);
+    EXPECT_EQ(0u, mCache.getStats().evictions);
+}
+
+TEST_F(HwcBufferCacheTest, evictsLeastRecentlyUsedBufferWithoutSlot) {
+    const std::vector<sp<GraphicBuffer>> buffers = fillSlotsWithoutSlot();
+
+    // Using the first buffer again makes the second one the least recently used.
+    EXPECT_EQ(std::make_pair(0u, false), getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, buffers[0]));
+    EXPECT_EQ(std::make_pair(1u, true), getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer1));
+    EXPECT_EQ(1u, mCache.getStats().evictions);
+
+    // The evicted buffer is sent again.
+    EXPECT_TRUE(getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, buffers[1]).second);
+    EXPECT_FALSE(getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, buffers[0]).second);
+}
+
+TEST_F(HwcBufferCacheTest, reusesSlotOfFreedBuffer) {
+    std::vector<sp<GraphicBuffer>> buffers = fillSlotsWithoutSlot();
+
+    buffers[5].clear();
+    EXPECT_EQ(std::make_pair(5u, true), getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer1));
+    EXPECT_EQ(0u, mCache.getStats().evictions);
+}
+
+TEST_F(HwcBufferCacheTest, uncacheForgetsBuffer) {
+    EXPECT_EQ(std::make_pair(3u, true), getHwcBuffer(3, mBuffer1));
+    EXPECT_EQ(std::make_pair(3u, false), getHwcBuffer(3, mBuffer1));
+
+    EXPECT_EQ(std::make_optional(3u), mCache.uncache(mBuffer1->getId()));
+    EXPECT_EQ(std::nullopt, mCache.uncache(mBuffer1->getId()));
+    EXPECT_EQ(std::make_pair(3u, true), getHwcBuffer(3, mBuffer1));
+}
+
+TEST_F(HwcBufferCacheTest, uncacheIgnoresUnknownBuffer) {
+    getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer1);
+
+    EXPECT_EQ(std::nullopt, mCache.uncache(mBuffer2->getId()));
+    EXPECT_EQ(std::make_pair(0u, false), getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer1));
+}
+
+TEST_F(HwcBufferCacheTest, uncachedSlotIsReusedByBufferWithoutSlot) {
+    const std::vector<sp<GraphicBuffer>> buffers = fillSlotsWithoutSlot();
+
+    EXPECT_EQ(std::make_optional(7u), mCache.uncache(buffers[7]->getId()));
+    EXPECT_EQ(std::make_pair(7u, true), getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer1));
+    EXPECT_EQ(0u, mCache.getStats().evictions);
+
+    // The uncached buffer is sent again.
+    EXPECT_TRUE(getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, buffers[7]).second);
+}
+
+TEST_F(HwcBufferCacheTest, dumpsStats) {
+    getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer1);
+    getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer1);
+    getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer2);
+
+    std::string dump;
+    mCache.dump(dump);
+    EXPECT_NE(std::string::npos, dump.find("bufferCache=2/"));
+    EXPECT_NE(std::string::npos, dump.find("1 hits, 2 misses, 0 evictions"));
 }
 
 } // namespace
@@ -51,11 +51,13 @@ public:
     ~Layer() override;
 
     MOCK_CONST_METHOD0(getId, hal::HWLayerId());
+    MOCK_CONST_METHOD0(getDisplaySlot, uint32_t());
 
     MOCK_METHOD2(setCursorPosition, Error(int32_t, int32_t));
     MOCK_METHOD3(setBuffer,
                  Error(uint32_t, const android::sp<android::GraphicBuffer>&,
                        const android::sp<android::Fence>&));
+    MOCK_METHOD1(clearBufferSlots, Error(const std::vector<uint32_t>&));
     MOCK_METHOD1(setSurfaceDamage, Error(const android::Region&));
     MOCK_METHOD1(setBlendMode, Error(hal::BlendMode));
     MOCK_METHOD1(setColor, Error(aidl::android::hardware::graphics::composer3::Color));
@@ -1392,6 +1392,55 @@ TEST_F(OutputLayerWriteCursorPositionToHWCTest, writeCursorPositionToHWCRotatedB
     mOutputLayer.writeCursorPositionToHWC();
 }
 
+/*
+ * OutputLayer::uncacheBuffers()
+ */
+
+struct OutputLayerUncacheBuffersTest : public OutputLayerTest {
+    OutputLayerUncacheBuffersTest() {
+        mOutputLayer.editState().hwc = impl::OutputLayerCompositionState::Hwc(mHwcLayer);
+    }
+
+    void cacheBuffer(int slot, const sp<GraphicBuffer>& buffer) {
+        uint32_t hwcSlot;
+        sp<GraphicBuffer> hwcBuffer;
+        mOutputLayer.editState().hwc->hwcBufferCache.getHwcBuffer(slot, buffer, &hwcSlot,
+                                                                 &hwcBuffer);
+    }
+
+    std::shared_ptr<HWC2::mock::Layer> mHwcLayer{std::make_shared<StrictMock<HWC2::mock::Layer>>()};
+    sp<GraphicBuffer> mBuffer1{sp<GraphicBuffer>::make()};
+    sp<GraphicBuffer> mBuffer2{sp<GraphicBuffer>::make()};
+};
+
+TEST_F(OutputLayerUncacheBuffersTest, handlesNoHwcState) {
+    mOutputLayer.editState().hwc.reset();
+
+    mOutputLayer.uncacheBuffers({mBuffer1->getId()});
+}
+
+TEST_F(OutputLayerUncacheBuffersTest, doesNothingIfBuffersAreNotCached) {
+    cacheBuffer(2, mBuffer1);
+
+    mOutputLayer.uncacheBuffers({mBuffer2->getId()});
+}
+
+TEST_F(OutputLayerUncacheBuffersTest, clearsSlotsOfCachedBuffers) {
+    cacheBuffer(2, mBuffer1);
+    cacheBuffer(5, mBuffer2);
+
+    EXPECT_CALL(*mHwcLayer, clearBufferSlots(std::vector<uint32_t>{5, 2}))
+            .WillOnce(Return(hal::Error::NONE));
+
+    mOutputLayer.uncacheBuffers({mBuffer2->getId(), mBuffer1->getId()});
+
+    // The buffers are sent again.
+    uint32_t hwcSlot;
+    sp<GraphicBuffer> hwcBuffer;
+    mOutputLayer.editState().hwc->hwcBufferCache.getHwcBuffer(2, mBuffer1, &hwcSlot, &hwcBuffer);
+    EXPECT_EQ(mBuffer1, hwcBuffer);
+}
+
 /*
  * OutputLayer::getHwcLayer()
  */
@@ -808,6 +808,33 @@ TEST_F(OutputUpdateLayerStateFromFETest, preparesGeometryAndContentStateForAllCo
     mOutput->updateLayerStateFromFE(refreshArgs);
 }
 
+/*
+ * Output::uncacheBuffers()
+ */
+
+using OutputUncacheBuffersTest = OutputTest;
+
+TEST_F(OutputUncacheBuffersTest, doesNothingWithoutBuffersToUncache) {
+    InjectedLayer layer;
+    injectOutputLayer(layer);
+
+    mOutput->uncacheBuffers({});
+}
+
+TEST_F(OutputUncacheBuffersTest, uncachesBuffersFromAllContainedLayers) {
+    InjectedLayer layer1;
+    InjectedLayer layer2;
+    const std::vector<uint64_t> bufferIds = {1, 2};
+
+    EXPECT_CALL(*layer1.outputLayer, uncacheBuffers(bufferIds));
+    EXPECT_CALL(*layer2.outputLayer, uncacheBuffers(bufferIds));
+
+    injectOutputLayer(layer1);
+    injectOutputLayer(layer2);
+
+    mOutput->uncacheBuffers(bufferIds);
+}
+
 /*
  * Output::updateAndWriteCompositionState()
  */
@@ -1241,6 +1268,7 @@ struct OutputPrepareTest : public testing::Test {
         MOCK_METHOD2(rebuildLayerStacks,
                      void(const compositionengine::CompositionRefreshArgs&,
                           compositionengine::LayerFESet&));
+        MOCK_METHOD1(uncacheBuffers, void(const std::vector<uint64_t>&));
     };
 
     StrictMock<OutputPartialMock> mOutput;
@@ -1248,9 +1276,12 @@ struct OutputPrepareTest : public testing::Test {
     LayerFESet mGeomSnapshots;
 };
 
-TEST_F(OutputPrepareTest, justInvokesRebuildLayerStacks) {
+TEST_F(OutputPrepareTest, rebuildsLayerStacksAndUncachesBuffers) {
+    mRefreshArgs.bufferIdsToUncache = {1, 2};
+
     InSequence seq;
     EXPECT_CALL(mOutput, rebuildLayerStacks(Ref(mRefreshArgs), Ref(mGeomSnapshots)));
+    EXPECT_CALL(mOutput, uncacheBuffers(mRefreshArgs.bufferIdsToUncache));
 
     mOutput.prepare(mRefreshArgs, mGeomSnapshots);
 }
@@ -3176,9 +3207,10 @@ struct OutputPostFramebufferTest : public testing::Test {
     };
 
     struct Layer {
-        Layer() {
+        explicit Layer(uint32_t slot) {
             EXPECT_CALL(outputLayer, getLayerFE()).WillRepeatedly(ReturnRef(*layerFE));
             EXPECT_CALL(outputLayer, getHwcLayer()).WillRepeatedly(Return(&hwc2Layer));
+            EXPECT_CALL(hwc2Layer, getDisplaySlot()).WillRepeatedly(Return(slot));
         }
 
         StrictMock<mock::OutputLayer> outputLayer;
@@ -3204,9 +3236,9 @@ struct OutputPostFramebufferTest : public testing::Test {
     mock::DisplayColorProfile* mDisplayColorProfile = new StrictMock<mock::DisplayColorProfile>();
     mock::RenderSurface* mRenderSurface = new StrictMock<mock::RenderSurface>();
 
-    Layer mLayer1;
-    Layer mLayer2;
-    Layer mLayer3;
+    Layer mLayer1{0u};
+    Layer mLayer2{1u};
+    Layer mLayer3{2u};
 };
 
 TEST_F(OutputPostFramebufferTest, ifNotEnabledDoesNothing) {
@@ -3246,9 +3278,9 @@ TEST_F(OutputPostFramebufferTest, releaseFencesAreSentToLayerFE) {
     sp<Fence> layer3Fence = sp<Fence>::make();
 
     Output::FrameFences frameFences;
-    frameFences.layerFences.emplace(&mLayer1.hwc2Layer, layer1Fence);
-    frameFences.layerFences.emplace(&mLayer2.hwc2Layer, layer2Fence);
-    frameFences.layerFences.emplace(&mLayer3.hwc2Layer, layer3Fence);
+    frameFences.layerFences.set(0u, layer1Fence);
+    frameFences.layerFences.set(1u, layer2Fence);
+    frameFences.layerFences.set(2u, layer3Fence);
 
     EXPECT_CALL(*mRenderSurface, flip());
     EXPECT_CALL(mOutput, presentAndGetFrameFences()).WillOnce(Return(frameFences));
@@ -3280,9 +3312,9 @@ TEST_F(OutputPostFramebufferTest, releaseFencesIncludeClientTargetAcquireFence)
 
     Output::FrameFences frameFences;
     frameFences.clientTargetAcquireFence = sp<Fence>::make();
-    frameFences.layerFences.emplace(&mLayer1.hwc2Layer, sp<Fence>::make());
-    frameFences.layerFences.emplace(&mLayer2.hwc2Layer, sp<Fence>::make());
-    frameFences.layerFences.emplace(&mLayer3.hwc2Layer, sp<Fence>::make());
+    frameFences.layerFences.set(0u, sp<Fence>::make());
+    frameFences.layerFences.set(1u, sp<Fence>::make());
+    frameFences.layerFences.set(2u, sp<Fence>::make());
 
     EXPECT_CALL(*mRenderSurface, flip());
     EXPECT_CALL(mOutput, presentAndGetFrameFences()).WillOnce(Return(frameFences));
@@ -85,7 +85,8 @@ DisplayDevice::DisplayDevice(DisplayDeviceCreationArgs& args)
     if (!mFlinger->mDisableClientCompositionCache &&
         SurfaceFlinger::maxFrameBufferAcquiredBuffers > 0) {
         mCompositionDisplay->createClientCompositionCache(
-                static_cast<uint32_t>(SurfaceFlinger::maxFrameBufferAcquiredBuffers));
+                std::max(static_cast<uint32_t>(SurfaceFlinger::maxFrameBufferAcquiredBuffers),
+                         mFlinger->mClientCompositionCacheSize));
     }
 
     mCompositionDisplay->setPredictCompositionStrategy(mFlinger->mPredictCompositionStrategy);
@@ -147,6 +147,11 @@ status_t FramebufferSurface::nextBuffer(uint32_t& outSlot,
 }
 
 void FramebufferSurface::freeBufferLocked(int slotIndex) {
+    // The client target has no HWC call to clear its slots. A freed slot is overwritten by the
+    // next buffer acquired in it, which forgetting the freed buffer makes sure is sent.
+    if (slotIndex >= 0 && mSlots[slotIndex].mGraphicBuffer != nullptr) {
+        mHwcBufferCache.uncache(mSlots[slotIndex].mGraphicBuffer->getId());
+    }
     ConsumerBase::freeBufferLocked(slotIndex);
     if (slotIndex == mCurrentBufferSlot) {
         mCurrentBufferSlot = BufferQueue::INVALID_BUFFER_SLOT;
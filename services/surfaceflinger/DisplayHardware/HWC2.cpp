@@ -35,6 +35,7 @@
 #include <cinttypes>
 #include <iterator>
 #include <set>
+#include <utility>
 
 using aidl::android::hardware::graphics::composer3::Color;
 using aidl::android::hardware::graphics::composer3::Composition;
@@ -65,6 +66,39 @@ inline bool hasMetadataKey(const std::set<Hwc2::PerFrameMetadataKey>& keys,
     return keys.find(key) != keys.end();
 }
 
+// Returns whether the value is the last one accepted by the HWC for a layer.
+template <typename T>
+inline bool wasSent(const std::optional<T>& sent, const T& value) {
+    return sent && *sent == value;
+}
+
+inline bool wasSent(const std::optional<Region>& sent, const Region& region) {
+    return sent && sent->hasSameRects(region);
+}
+
+// Records the value of a layer command, unless the HWC rejected it.
+template <typename T>
+inline Error recordSent(std::optional<T>& sent, const T& value, Error error) {
+    if (error == Error::NONE) {
+        sent = value;
+    } else {
+        sent.reset();
+    }
+    return error;
+}
+
+// The buffer written to the buffer slots to clear, so that the HWC releases the buffers it cached
+// in them.
+const sp<GraphicBuffer>& getClearSlotBuffer() {
+    static const auto buffer =
+            sp<GraphicBuffer>::make(1, 1, PIXEL_FORMAT_RGBX_8888,
+                                    GraphicBuffer::USAGE_HW_COMPOSER |
+                                            GraphicBuffer::USAGE_SW_READ_OFTEN |
+                                            GraphicBuffer::USAGE_SW_WRITE_OFTEN,
+                                    "HWC2 clear slot buffer");
+    return buffer;
+}
+
 } // namespace anonymous
 
 // Display methods
@@ -88,8 +122,8 @@ Display::~Display() {
     // the contents of the local container.
     Layers destroyingLayers;
     std::swap(mLayers, destroyingLayers);
-    for (const auto& [_, weakLayer] : destroyingLayers) {
-        if (std::shared_ptr layer = weakLayer.lock()) {
+    for (const auto& [_, entry] : destroyingLayers) {
+        if (std::shared_ptr layer = entry.layer.lock()) {
             layer->onOwningDisplayDestroyed();
         }
     }
@@ -132,13 +166,34 @@ base::expected<std::shared_ptr<HWC2::Layer>, hal::Error> Display::createLayer()
         return base::unexpected(error);
     }
 
-    auto layer = std::make_shared<impl::Layer>(mComposer, mCapabilities, *this, layerId);
-    mLayers.emplace(layerId, layer);
+    uint32_t slot;
+    if (!mFreeLayerSlots.empty()) {
+        slot = mFreeLayerSlots.back();
+        mFreeLayerSlots.pop_back();
+    } else {
+        slot = mLayerSlotCount++;
+    }
+
+    auto layer = std::make_shared<impl::Layer>(mComposer, mCapabilities, *this, layerId, slot);
+    mLayers.emplace(layerId, LayerEntry{layer, slot});
     return layer;
 }
 
 void Display::onLayerDestroyed(hal::HWLayerId layerId) {
-    mLayers.erase(layerId);
+    const auto it = mLayers.find(layerId);
+    if (it == mLayers.end()) {
+        return;
+    }
+    mFreeLayerSlots.push_back(it->second.slot);
+    mLayers.erase(it);
+}
+
+void Display::resetLayersSentState() {
+    for (const auto& [_, entry] : mLayers) {
+        if (std::shared_ptr layer = entry.layer.lock()) {
+            layer->resetSentState();
+        }
+    }
 }
 
 bool Display::isVsyncPeriodSwitchSupported() const {
@@ -158,7 +213,7 @@ Error Display::getPhysicalDisplayOrientation(Hwc2::AidlTransform* outTransform)
     return static_cast<Error>(error);
 }
 
-Error Display::getChangedCompositionTypes(std::unordered_map<HWC2::Layer*, Composition>* outTypes) {
+Error Display::getChangedCompositionTypes(LayerSlotArray<Composition>* outTypes) {
     std::vector<Hwc2::Layer> layerIds;
     std::vector<Composition> types;
     auto intError = mComposer.getChangedCompositionTypes(
@@ -171,14 +226,13 @@ Error Display::getChangedCompositionTypes(std::unordered_map<HWC2::Layer*, Compo
     }
 
     outTypes->clear();
-    outTypes->reserve(numElements);
     for (uint32_t element = 0; element < numElements; ++element) {
         auto layer = getLayerById(layerIds[element]);
         if (layer) {
             auto type = types[element];
             ALOGV("getChangedCompositionTypes: adding %" PRIu64 " %s",
                     layer->getId(), to_string(type).c_str());
-            outTypes->emplace(layer.get(), type);
+            outTypes->set(layer->getDisplaySlot(), type);
         } else {
             ALOGE("getChangedCompositionTypes: invalid layer %" PRIu64 " found"
                     " on display %" PRIu64, layerIds[element], mId);
@@ -251,7 +305,7 @@ Error Display::getName(std::string* outName) const
 }
 
 Error Display::getRequests(HWC2::DisplayRequest* outDisplayRequests,
-                           std::unordered_map<HWC2::Layer*, LayerRequest>* outLayerRequests) {
+                           LayerSlotArray<LayerRequest>* outLayerRequests) {
     uint32_t intDisplayRequests = 0;
     std::vector<Hwc2::Layer> layerIds;
     std::vector<uint32_t> layerRequests;
@@ -265,13 +319,12 @@ Error Display::getRequests(HWC2::DisplayRequest* outDisplayRequests,
 
     *outDisplayRequests = static_cast<DisplayRequest>(intDisplayRequests);
     outLayerRequests->clear();
-    outLayerRequests->reserve(numElements);
     for (uint32_t element = 0; element < numElements; ++element) {
         auto layer = getLayerById(layerIds[element]);
         if (layer) {
             auto layerRequest =
                     static_cast<LayerRequest>(layerRequests[element]);
-            outLayerRequests->emplace(layer.get(), layerRequest);
+            outLayerRequests->set(layer->getDisplaySlot(), layerRequest);
         } else {
             ALOGE("getRequests: invalid layer %" PRIu64 " found on display %"
                     PRIu64, layerIds[element], mId);
@@ -354,7 +407,7 @@ Error Display::getDisplayedContentSample(uint64_t maxFrames, uint64_t timestamp,
     return static_cast<Error>(intError);
 }
 
-Error Display::getReleaseFences(std::unordered_map<HWC2::Layer*, sp<Fence>>* outFences) const {
+Error Display::getReleaseFences(LayerSlotArray<sp<Fence>>* outFences) const {
     std::vector<Hwc2::Layer> layerIds;
     std::vector<int> fenceFds;
     auto intError = mComposer.getReleaseFences(mId, &layerIds, &fenceFds);
@@ -364,16 +417,17 @@ Error Display::getReleaseFences(std::unordered_map<HWC2::Layer*, sp<Fence>>* out
         return error;
     }
 
-    std::unordered_map<HWC2::Layer*, sp<Fence>> releaseFences;
-    releaseFences.reserve(numElements);
+    // The fences are set in place to reuse the storage of the previous frame, so a failure leaves
+    // no fence rather than those of the previous frame.
+    outFences->clear();
     for (uint32_t element = 0; element < numElements; ++element) {
         auto layer = getLayerById(layerIds[element]);
         if (layer) {
-            sp<Fence> fence(new Fence(fenceFds[element]));
-            releaseFences.emplace(layer.get(), fence);
+            outFences->set(layer->getDisplaySlot(), sp<Fence>::make(fenceFds[element]));
         } else {
             ALOGE("getReleaseFences: invalid layer %" PRIu64
                     " found on display %" PRIu64, layerIds[element], mId);
+            outFences->clear();
             for (; element < numElements; ++element) {
                 close(fenceFds[element]);
             }
@@ -381,7 +435,6 @@ Error Display::getReleaseFences(std::unordered_map<HWC2::Layer*, sp<Fence>>* out
         }
     }
 
-    *outFences = std::move(releaseFences);
     return Error::NONE;
 }
 
@@ -391,6 +444,7 @@ Error Display::present(sp<Fence>* outPresentFence)
     auto intError = mComposer.presentDisplay(mId, &presentFenceFd);
     auto error = static_cast<Error>(intError);
     if (error != Error::NONE) {
+        resetLayersSentState();
         return error;
     }
 
@@ -510,6 +564,7 @@ Error Display::validate(nsecs_t expectedPresentTime, uint32_t* outNumTypes,
     auto intError = mComposer.validateDisplay(mId, expectedPresentTime, &numTypes, &numRequests);
     auto error = static_cast<Error>(intError);
     if (error != Error::NONE && !hasChangesError(error)) {
+        resetLayersSentState();
         return error;
     }
 
@@ -528,6 +583,7 @@ Error Display::presentOrValidate(nsecs_t expectedPresentTime, uint32_t* outNumTy
                                                        &numRequests, &presentFenceFd, state);
     auto error = static_cast<Error>(intError);
     if (error != Error::NONE && !hasChangesError(error)) {
+        resetLayersSentState();
         return error;
     }
 
@@ -618,7 +674,7 @@ void Display::setConnected(bool connected) {
 
 std::shared_ptr<HWC2::Layer> Display::getLayerById(HWLayerId id) const {
     auto it = mLayers.find(id);
-    return it != mLayers.end() ? it->second.lock() : nullptr;
+    return it != mLayers.end() ? it->second.layer.lock() : nullptr;
 }
 } // namespace impl
 
@@ -645,12 +701,12 @@ namespace impl {
 
 Layer::Layer(android::Hwc2::Composer& composer,
              const std::unordered_set<AidlCapability>& capabilities, HWC2::Display& display,
-             HWLayerId layerId)
+             HWLayerId layerId, uint32_t displaySlot)
       : mComposer(composer),
         mCapabilities(capabilities),
         mDisplay(&display),
         mId(layerId),
-        mColorMatrix(android::mat4()) {
+        mDisplaySlot(displaySlot) {
     ALOGV("Created layer %" PRIu64 " on display %" PRIu64, layerId, display.getId());
 }
 
@@ -684,6 +740,13 @@ void Layer::onOwningDisplayDestroyed() {
     mDisplay = nullptr;
 }
 
+void Layer::resetSentState() {
+    // The dataspace and HDR metadata may no longer be the defaults either. The color transform is
+    // left as the identity, which composers without layer color transforms would reject on every
+    // frame.
+    mSentState = SentState{.dataspace = std::nullopt, .hdrMetadata = std::nullopt};
+}
+
 Error Layer::setCursorPosition(int32_t x, int32_t y)
 {
     if (CC_UNLIKELY(!mDisplay)) {
@@ -701,14 +764,58 @@ Error Layer::setBuffer(uint32_t slot, const sp<GraphicBuffer>& buffer,
         return Error::BAD_DISPLAY;
     }
 
-    if (buffer == nullptr && mBufferSlot == slot) {
+    if (buffer == nullptr && wasSent(mSentState.bufferSlot, slot)) {
         return Error::NONE;
     }
-    mBufferSlot = slot;
 
     int32_t fenceFd = acquireFence->dup();
     auto intError = mComposer.setLayerBuffer(mDisplay->getId(), mId, slot, buffer, fenceFd);
-    return static_cast<Error>(intError);
+    const auto error = recordSent(mSentState.bufferSlot, slot, static_cast<Error>(intError));
+    if (error != Error::NONE || !mBufferSlotToClear) {
+        return error;
+    }
+
+    // The slot left behind is cleared now, unless it was just reused.
+    const uint32_t slotToClear = *std::exchange(mBufferSlotToClear, std::nullopt);
+    return slotToClear == slot ? Error::NONE : clearBufferSlots({slotToClear});
+}
+
+Error Layer::clearBufferSlots(const std::vector<uint32_t>& slots) {
+    if (CC_UNLIKELY(!mDisplay)) {
+        return Error::BAD_DISPLAY;
+    }
+
+    const sp<GraphicBuffer>& clearSlotBuffer = getClearSlotBuffer();
+    if (clearSlotBuffer->initCheck() != android::OK) {
+        return Error::NO_RESOURCES;
+    }
+
+    bool cleared = false;
+    for (uint32_t slot : slots) {
+        if (wasSent(mSentState.bufferSlot, slot)) {
+            // The HWC still uses the buffer.
+            mBufferSlotToClear = slot;
+            continue;
+        }
+        auto intError = mComposer.setLayerBuffer(mDisplay->getId(), mId, slot, clearSlotBuffer,
+                                                 /*acquireFence*/ -1);
+        if (static_cast<Error>(intError) != Error::NONE) {
+            mSentState.bufferSlot.reset();
+            return static_cast<Error>(intError);
+        }
+        cleared = true;
+    }
+
+    if (!cleared || !mSentState.bufferSlot) {
+        return Error::NONE;
+    }
+
+    // The placeholder became the buffer of the layer, so set the current buffer again from its
+    // slot.
+    const uint32_t currentSlot = *mSentState.bufferSlot;
+    auto intError = mComposer.setLayerBuffer(mDisplay->getId(), mId, currentSlot, nullptr,
+                                             /*acquireFence*/ -1);
+    return recordSent(mSentState.bufferSlot, currentSlot, static_cast<Error>(intError));
 }
 
 Error Layer::setSurfaceDamage(const Region& damage)
@@ -717,11 +824,9 @@ Error Layer::setSurfaceDamage(const Region& damage)
         return Error::BAD_DISPLAY;
     }
 
-    if (damage.isRect() && mDamageRegion.isRect() &&
-        (damage.getBounds() == mDamageRegion.getBounds())) {
+    if (wasSent(mSentState.damageRegion, damage)) {
         return Error::NONE;
     }
-    mDamageRegion = damage;
 
     // We encode default full-screen damage as INVALID_RECT upstream, but as 0
     // rects for HWC
@@ -734,7 +839,7 @@ Error Layer::setSurfaceDamage(const Region& damage)
         intError = mComposer.setLayerSurfaceDamage(mDisplay->getId(), mId, hwcRects);
     }
 
-    return static_cast<Error>(intError);
+    return recordSent(mSentState.damageRegion, damage, static_cast<Error>(intError));
 }
 
 Error Layer::setBlendMode(BlendMode mode)
@@ -743,8 +848,12 @@ Error Layer::setBlendMode(BlendMode mode)
         return Error::BAD_DISPLAY;
     }
 
+    if (wasSent(mSentState.blendMode, mode)) {
+        return Error::NONE;
+    }
+
     auto intError = mComposer.setLayerBlendMode(mDisplay->getId(), mId, mode);
-    return static_cast<Error>(intError);
+    return recordSent(mSentState.blendMode, mode, static_cast<Error>(intError));
 }
 
 Error Layer::setColor(Color color) {
@@ -752,8 +861,12 @@ Error Layer::setColor(Color color) {
         return Error::BAD_DISPLAY;
     }
 
+    if (wasSent(mSentState.color, color)) {
+        return Error::NONE;
+    }
+
     auto intError = mComposer.setLayerColor(mDisplay->getId(), mId, color);
-    return static_cast<Error>(intError);
+    return recordSent(mSentState.color, color, static_cast<Error>(intError));
 }
 
 Error Layer::setCompositionType(Composition type)
@@ -772,12 +885,12 @@ Error Layer::setDataspace(Dataspace dataspace)
         return Error::BAD_DISPLAY;
     }
 
-    if (dataspace == mDataSpace) {
+    if (wasSent(mSentState.dataspace, dataspace)) {
         return Error::NONE;
     }
-    mDataSpace = dataspace;
-    auto intError = mComposer.setLayerDataspace(mDisplay->getId(), mId, mDataSpace);
-    return static_cast<Error>(intError);
+
+    auto intError = mComposer.setLayerDataspace(mDisplay->getId(), mId, dataspace);
+    return recordSent(mSentState.dataspace, dataspace, static_cast<Error>(intError));
 }
 
 Error Layer::setPerFrameMetadata(const int32_t supportedPerFrameMetadata,
@@ -787,56 +900,58 @@ Error Layer::setPerFrameMetadata(const int32_t supportedPerFrameMetadata,
         return Error::BAD_DISPLAY;
     }
 
-    if (metadata == mHdrMetadata) {
+    if (wasSent(mSentState.hdrMetadata, metadata)) {
         return Error::NONE;
     }
 
-    mHdrMetadata = metadata;
-    int validTypes = mHdrMetadata.validTypes & supportedPerFrameMetadata;
+    // Unlike other commands, the metadata is not sent again after an error: HWCs without
+    // support for some of the keys would otherwise receive it on every frame.
+    mSentState.hdrMetadata = metadata;
+    int validTypes = metadata.validTypes & supportedPerFrameMetadata;
     std::vector<Hwc2::PerFrameMetadata> perFrameMetadatas;
     if (validTypes & HdrMetadata::SMPTE2086) {
         perFrameMetadatas.insert(perFrameMetadatas.end(),
                                  {{Hwc2::PerFrameMetadataKey::DISPLAY_RED_PRIMARY_X,
-                                   mHdrMetadata.smpte2086.displayPrimaryRed.x},
+                                   metadata.smpte2086.displayPrimaryRed.x},
                                   {Hwc2::PerFrameMetadataKey::DISPLAY_RED_PRIMARY_Y,
-                                   mHdrMetadata.smpte2086.displayPrimaryRed.y},
+                                   metadata.smpte2086.displayPrimaryRed.y},
                                   {Hwc2::PerFrameMetadataKey::DISPLAY_GREEN_PRIMARY_X,
-                                   mHdrMetadata.smpte2086.displayPrimaryGreen.x},
+                                   metadata.smpte2086.displayPrimaryGreen.x},
                                   {Hwc2::PerFrameMetadataKey::DISPLAY_GREEN_PRIMARY_Y,
-                                   mHdrMetadata.smpte2086.displayPrimaryGreen.y},
+                                   metadata.smpte2086.displayPrimaryGreen.y},
                                   {Hwc2::PerFrameMetadataKey::DISPLAY_BLUE_PRIMARY_X,
-                                   mHdrMetadata.smpte2086.displayPrimaryBlue.x},
+                                   metadata.smpte2086.displayPrimaryBlue.x},
                                   {Hwc2::PerFrameMetadataKey::DISPLAY_BLUE_PRIMARY_Y,
-                                   mHdrMetadata.smpte2086.displayPrimaryBlue.y},
+                                   metadata.smpte2086.displayPrimaryBlue.y},
                                   {Hwc2::PerFrameMetadataKey::WHITE_POINT_X,
-                                   mHdrMetadata.smpte2086.whitePoint.x},
+                                   metadata.smpte2086.whitePoint.x},
                                   {Hwc2::PerFrameMetadataKey::WHITE_POINT_Y,
-                                   mHdrMetadata.smpte2086.whitePoint.y},
+                                   metadata.smpte2086.whitePoint.y},
                                   {Hwc2::PerFrameMetadataKey::MAX_LUMINANCE,
-                                   mHdrMetadata.smpte2086.maxLuminance},
+                                   metadata.smpte2086.maxLuminance},
                                   {Hwc2::PerFrameMetadataKey::MIN_LUMINANCE,
-                                   mHdrMetadata.smpte2086.minLuminance}});
+                                   metadata.smpte2086.minLuminance}});
     }
 
     if (validTypes & HdrMetadata::CTA861_3) {
         perFrameMetadatas.insert(perFrameMetadatas.end(),
                                  {{Hwc2::PerFrameMetadataKey::MAX_CONTENT_LIGHT_LEVEL,
-                                   mHdrMetadata.cta8613.maxContentLightLevel},
+                                   metadata.cta8613.maxContentLightLevel},
                                   {Hwc2::PerFrameMetadataKey::MAX_FRAME_AVERAGE_LIGHT_LEVEL,
-                                   mHdrMetadata.cta8613.maxFrameAverageLightLevel}});
+                                   metadata.cta8613.maxFrameAverageLightLevel}});
     }
 
     Error error = static_cast<Error>(
             mComposer.setLayerPerFrameMetadata(mDisplay->getId(), mId, perFrameMetadatas));
 
     if (validTypes & HdrMetadata::HDR10PLUS) {
-        if (CC_UNLIKELY(mHdrMetadata.hdr10plus.size() == 0)) {
+        if (CC_UNLIKELY(metadata.hdr10plus.size() == 0)) {
             return Error::BAD_PARAMETER;
         }
 
         std::vector<Hwc2::PerFrameMetadataBlob> perFrameMetadataBlobs;
         perFrameMetadataBlobs.push_back(
-                {Hwc2::PerFrameMetadataKey::HDR10_PLUS_SEI, mHdrMetadata.hdr10plus});
+                {Hwc2::PerFrameMetadataKey::HDR10_PLUS_SEI, metadata.hdr10plus});
         Error setMetadataBlobsError =
                 static_cast<Error>(mComposer.setLayerPerFrameMetadataBlobs(mDisplay->getId(), mId,
                                                                            perFrameMetadataBlobs));
@@ -853,10 +968,14 @@ Error Layer::setDisplayFrame(const Rect& frame)
         return Error::BAD_DISPLAY;
     }
 
+    if (wasSent(mSentState.displayFrame, frame)) {
+        return Error::NONE;
+    }
+
     Hwc2::IComposerClient::Rect hwcRect{frame.left, frame.top,
         frame.right, frame.bottom};
     auto intError = mComposer.setLayerDisplayFrame(mDisplay->getId(), mId, hwcRect);
-    return static_cast<Error>(intError);
+    return recordSent(mSentState.displayFrame, frame, static_cast<Error>(intError));
 }
 
 Error Layer::setPlaneAlpha(float alpha)
@@ -865,8 +984,12 @@ Error Layer::setPlaneAlpha(float alpha)
         return Error::BAD_DISPLAY;
     }
 
+    if (wasSent(mSentState.planeAlpha, alpha)) {
+        return Error::NONE;
+    }
+
     auto intError = mComposer.setLayerPlaneAlpha(mDisplay->getId(), mId, alpha);
-    return static_cast<Error>(intError);
+    return recordSent(mSentState.planeAlpha, alpha, static_cast<Error>(intError));
 }
 
 Error Layer::setSidebandStream(const native_handle_t* stream)
@@ -890,10 +1013,14 @@ Error Layer::setSourceCrop(const FloatRect& crop)
         return Error::BAD_DISPLAY;
     }
 
+    if (wasSent(mSentState.sourceCrop, crop)) {
+        return Error::NONE;
+    }
+
     Hwc2::IComposerClient::FRect hwcRect{
         crop.left, crop.top, crop.right, crop.bottom};
     auto intError = mComposer.setLayerSourceCrop(mDisplay->getId(), mId, hwcRect);
-    return static_cast<Error>(intError);
+    return recordSent(mSentState.sourceCrop, crop, static_cast<Error>(intError));
 }
 
 Error Layer::setTransform(Transform transform)
@@ -902,9 +1029,13 @@ Error Layer::setTransform(Transform transform)
         return Error::BAD_DISPLAY;
     }
 
+    if (wasSent(mSentState.transform, transform)) {
+        return Error::NONE;
+    }
+
     auto intTransform = static_cast<Hwc2::Transform>(transform);
     auto intError = mComposer.setLayerTransform(mDisplay->getId(), mId, intTransform);
-    return static_cast<Error>(intError);
+    return recordSent(mSentState.transform, transform, static_cast<Error>(intError));
 }
 
 Error Layer::setVisibleRegion(const Region& region)
@@ -913,14 +1044,13 @@ Error Layer::setVisibleRegion(const Region& region)
         return Error::BAD_DISPLAY;
     }
 
-    if (region.isRect() && mVisibleRegion.isRect() &&
-        (region.getBounds() == mVisibleRegion.getBounds())) {
+    if (wasSent(mSentState.visibleRegion, region)) {
         return Error::NONE;
     }
-    mVisibleRegion = region;
+
     const auto hwcRects = convertRegionToHwcRects(region);
     auto intError = mComposer.setLayerVisibleRegion(mDisplay->getId(), mId, hwcRects);
-    return static_cast<Error>(intError);
+    return recordSent(mSentState.visibleRegion, region, static_cast<Error>(intError));
 }
 
 Error Layer::setZOrder(uint32_t z)
@@ -929,8 +1059,12 @@ Error Layer::setZOrder(uint32_t z)
         return Error::BAD_DISPLAY;
     }
 
+    if (wasSent(mSentState.z, z)) {
+        return Error::NONE;
+    }
+
     auto intError = mComposer.setLayerZOrder(mDisplay->getId(), mId, z);
-    return static_cast<Error>(intError);
+    return recordSent(mSentState.z, z, static_cast<Error>(intError));
 }
 
 // Composer HAL 2.3
@@ -939,15 +1073,17 @@ Error Layer::setColorTransform(const android::mat4& matrix) {
         return Error::BAD_DISPLAY;
     }
 
-    if (matrix == mColorMatrix) {
+    if (wasSent(mSentState.colorTransform, matrix)) {
         return Error::NONE;
     }
+
     auto intError = mComposer.setLayerColorTransform(mDisplay->getId(), mId, matrix.asArray());
     Error error = static_cast<Error>(intError);
-    if (error != Error::NONE) {
-        return error;
+    // A rejected transform keeps the last accepted one, rather than clearing it, so that going
+    // back to the identity is not sent to composers which reject all transforms.
+    if (error == Error::NONE) {
+        mSentState.colorTransform = matrix;
     }
-    mColorMatrix = matrix;
     return error;
 }
 
@@ -969,8 +1105,12 @@ Error Layer::setBrightness(float brightness) {
         return Error::BAD_DISPLAY;
     }
 
+    if (wasSent(mSentState.brightness, brightness)) {
+        return Error::NONE;
+    }
+
     auto intError = mComposer.setLayerBrightness(mDisplay->getId(), mId, brightness);
-    return static_cast<Error>(intError);
+    return recordSent(mSentState.brightness, brightness, static_cast<Error>(intError));
 }
 
 Error Layer::setBlockingRegion(const Region& region) {
@@ -978,14 +1118,13 @@ Error Layer::setBlockingRegion(const Region& region) {
         return Error::BAD_DISPLAY;
     }
 
-    if (region.isRect() && mBlockingRegion.isRect() &&
-        (region.getBounds() == mBlockingRegion.getBounds())) {
+    if (wasSent(mSentState.blockingRegion, region)) {
         return Error::NONE;
     }
-    mBlockingRegion = region;
+
     const auto hwcRects = convertRegionToHwcRects(region);
     const auto intError = mComposer.setLayerBlockingRegion(mDisplay->getId(), mId, hwcRects);
-    return static_cast<Error>(intError);
+    return recordSent(mSentState.blockingRegion, region, static_cast<Error>(intError));
 }
 
 } // namespace impl
@@ -21,6 +21,7 @@
 #include <ftl/future.h>
 #include <gui/HdrMetadata.h>
 #include <math/mat4.h>
+#include <ui/FloatRect.h>
 #include <ui/HdrCapabilities.h>
 #include <ui/Region.h>
 #include <ui/StaticDisplayInfo.h>
@@ -29,6 +30,7 @@
 #include <utils/Timers.h>
 
 #include <functional>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -36,6 +38,7 @@
 
 #include "ComposerHal.h"
 #include "Hal.h"
+#include "LayerSlotArray.h"
 
 #include <aidl/android/hardware/graphics/common/DisplayDecorationSupport.h>
 #include <aidl/android/hardware/graphics/composer3/Capability.h>
@@ -47,7 +50,6 @@
 namespace android {
 
 class Fence;
-class FloatRect;
 class GraphicBuffer;
 class TestableSurfaceFlinger;
 struct DisplayedFrameStats;
@@ -94,12 +96,15 @@ public:
     virtual bool isVsyncPeriodSwitchSupported() const = 0;
     virtual bool hasDisplayIdleTimerCapability() const = 0;
     virtual void onLayerDestroyed(hal::HWLayerId layerId) = 0;
+    // Forgets the state last sent for the layers of this display, after the HWC may have dropped
+    // the commands which sent it.
+    virtual void resetLayersSentState() = 0;
 
     [[nodiscard]] virtual hal::Error acceptChanges() = 0;
     [[nodiscard]] virtual base::expected<std::shared_ptr<HWC2::Layer>, hal::Error>
     createLayer() = 0;
     [[nodiscard]] virtual hal::Error getChangedCompositionTypes(
-            std::unordered_map<Layer*, aidl::android::hardware::graphics::composer3::Composition>*
+            LayerSlotArray<aidl::android::hardware::graphics::composer3::Composition>*
                     outTypes) = 0;
     [[nodiscard]] virtual hal::Error getColorModes(std::vector<hal::ColorMode>* outModes) const = 0;
     // Returns a bitmask which contains HdrMetadata::Type::*.
@@ -112,7 +117,7 @@ public:
     [[nodiscard]] virtual hal::Error getName(std::string* outName) const = 0;
     [[nodiscard]] virtual hal::Error getRequests(
             hal::DisplayRequest* outDisplayRequests,
-            std::unordered_map<Layer*, hal::LayerRequest>* outLayerRequests) = 0;
+            LayerSlotArray<hal::LayerRequest>* outLayerRequests) = 0;
     [[nodiscard]] virtual hal::Error getConnectionType(ui::DisplayConnectionType*) const = 0;
     [[nodiscard]] virtual hal::Error supportsDoze(bool* outSupport) const = 0;
     [[nodiscard]] virtual hal::Error getHdrCapabilities(
@@ -127,7 +132,7 @@ public:
             uint64_t maxFrames, uint64_t timestamp,
             android::DisplayedFrameStats* outStats) const = 0;
     [[nodiscard]] virtual hal::Error getReleaseFences(
-            std::unordered_map<Layer*, android::sp<android::Fence>>* outFences) const = 0;
+            LayerSlotArray<android::sp<android::Fence>>* outFences) const = 0;
     [[nodiscard]] virtual hal::Error present(android::sp<android::Fence>* outPresentFence) = 0;
     [[nodiscard]] virtual hal::Error setClientTarget(
             uint32_t slot, const android::sp<android::GraphicBuffer>& target,
@@ -187,8 +192,7 @@ public:
     hal::Error acceptChanges() override;
     base::expected<std::shared_ptr<HWC2::Layer>, hal::Error> createLayer() override;
     hal::Error getChangedCompositionTypes(
-            std::unordered_map<HWC2::Layer*,
-                               aidl::android::hardware::graphics::composer3::Composition>* outTypes)
+            LayerSlotArray<aidl::android::hardware::graphics::composer3::Composition>* outTypes)
             override;
     hal::Error getColorModes(std::vector<hal::ColorMode>* outModes) const override;
     // Returns a bitmask which contains HdrMetadata::Type::*.
@@ -198,9 +202,8 @@ public:
     hal::Error getDataspaceSaturationMatrix(hal::Dataspace, android::mat4* outMatrix) override;
 
     hal::Error getName(std::string* outName) const override;
-    hal::Error getRequests(
-            hal::DisplayRequest* outDisplayRequests,
-            std::unordered_map<HWC2::Layer*, hal::LayerRequest>* outLayerRequests) override;
+    hal::Error getRequests(hal::DisplayRequest* outDisplayRequests,
+                           LayerSlotArray<hal::LayerRequest>* outLayerRequests) override;
     hal::Error getConnectionType(ui::DisplayConnectionType*) const override;
     hal::Error supportsDoze(bool* outSupport) const override EXCLUDES(mDisplayCapabilitiesMutex);
     hal::Error getHdrCapabilities(android::HdrCapabilities* outCapabilities) const override;
@@ -211,8 +214,8 @@ public:
                                                 uint64_t maxFrames) const override;
     hal::Error getDisplayedContentSample(uint64_t maxFrames, uint64_t timestamp,
                                          android::DisplayedFrameStats* outStats) const override;
-    hal::Error getReleaseFences(std::unordered_map<HWC2::Layer*, android::sp<android::Fence>>*
-                                        outFences) const override;
+    hal::Error getReleaseFences(
+            LayerSlotArray<android::sp<android::Fence>>* outFences) const override;
     hal::Error present(android::sp<android::Fence>* outPresentFence) override;
     hal::Error setClientTarget(uint32_t slot, const android::sp<android::GraphicBuffer>& target,
                                const android::sp<android::Fence>& acquireFence,
@@ -259,6 +262,7 @@ public:
     bool isVsyncPeriodSwitchSupported() const override;
     bool hasDisplayIdleTimerCapability() const override;
     void onLayerDestroyed(hal::HWLayerId layerId) override;
+    void resetLayersSentState() override;
     hal::Error getPhysicalDisplayOrientation(Hwc2::AidlTransform* outTransform) const override;
 
 private:
@@ -282,9 +286,18 @@ private:
     hal::DisplayType mType;
     bool mIsConnected = false;
 
-    using Layers = std::unordered_map<hal::HWLayerId, std::weak_ptr<HWC2::impl::Layer>>;
+    struct LayerEntry {
+        std::weak_ptr<HWC2::impl::Layer> layer;
+        uint32_t slot;
+    };
+    using Layers = std::unordered_map<hal::HWLayerId, LayerEntry>;
     Layers mLayers;
 
+    // Slots of destroyed layers, reused before growing the slot count so that the slots stay
+    // dense. See HWC2::Layer::getDisplaySlot.
+    std::vector<uint32_t> mFreeLayerSlots;
+    uint32_t mLayerSlotCount = 0;
+
     mutable std::mutex mDisplayCapabilitiesMutex;
     std::once_flag mDisplayCapabilityQueryFlag;
     std::optional<
@@ -300,10 +313,19 @@ public:
 
     virtual hal::HWLayerId getId() const = 0;
 
+    // Returns the index of the layer among the layers of its display. Slots are assigned on
+    // creation and reused after the layer is destroyed, so they stay dense enough to index the
+    // LayerSlotArray results of the display.
+    virtual uint32_t getDisplaySlot() const = 0;
+
     [[nodiscard]] virtual hal::Error setCursorPosition(int32_t x, int32_t y) = 0;
     [[nodiscard]] virtual hal::Error setBuffer(uint32_t slot,
                                                const android::sp<android::GraphicBuffer>& buffer,
                                                const android::sp<android::Fence>& acquireFence) = 0;
+    // Replaces the buffers the HWC cached in the slots with a placeholder buffer, so that the HWC
+    // releases them. The slot of the current buffer of the layer is cleared once the layer is set
+    // a buffer in another slot.
+    [[nodiscard]] virtual hal::Error clearBufferSlots(const std::vector<uint32_t>& slots) = 0;
     [[nodiscard]] virtual hal::Error setSurfaceDamage(const android::Region& damage) = 0;
 
     [[nodiscard]] virtual hal::Error setBlendMode(hal::BlendMode mode) = 0;
@@ -344,16 +366,21 @@ public:
     Layer(android::Hwc2::Composer& composer,
           const std::unordered_set<aidl::android::hardware::graphics::composer3::Capability>&
                   capabilities,
-          HWC2::Display& display, hal::HWLayerId layerId);
+          HWC2::Display& display, hal::HWLayerId layerId, uint32_t displaySlot);
     ~Layer() override;
 
     void onOwningDisplayDestroyed();
+    // Sends all the state again with the next commands. The composers only report errors when the
+    // commands are executed, and drop the whole batch of commands if that fails.
+    void resetSentState();
 
     hal::HWLayerId getId() const override { return mId; }
+    uint32_t getDisplaySlot() const override { return mDisplaySlot; }
 
     hal::Error setCursorPosition(int32_t x, int32_t y) override;
     hal::Error setBuffer(uint32_t slot, const android::sp<android::GraphicBuffer>& buffer,
                          const android::sp<android::Fence>& acquireFence) override;
+    hal::Error clearBufferSlots(const std::vector<uint32_t>& slots) override;
     hal::Error setSurfaceDamage(const android::Region& damage) override;
 
     hal::Error setBlendMode(hal::BlendMode mode) override;
@@ -392,16 +419,34 @@ private:
 
     HWC2::Display* mDisplay;
     hal::HWLayerId mId;
-
-    // Cached HWC2 data, to ensure the same commands aren't sent to the HWC
-    // multiple times.
-    android::Region mVisibleRegion = android::Region::INVALID_REGION;
-    android::Region mDamageRegion = android::Region::INVALID_REGION;
-    android::Region mBlockingRegion = android::Region::INVALID_REGION;
-    hal::Dataspace mDataSpace = hal::Dataspace::UNKNOWN;
-    android::HdrMetadata mHdrMetadata;
-    android::mat4 mColorMatrix;
-    uint32_t mBufferSlot;
+    const uint32_t mDisplaySlot;
+
+    // Shadow of the layer state last accepted by the HWC, to ensure the same commands aren't
+    // sent to the HWC multiple times. A value is unset until it has been sent, or after the HWC
+    // rejected it. The composition type is not shadowed, as the HWC may change it on validate.
+    struct SentState {
+        std::optional<uint32_t> bufferSlot;
+        std::optional<android::Region> damageRegion;
+        std::optional<hal::BlendMode> blendMode;
+        std::optional<aidl::android::hardware::graphics::composer3::Color> color;
+        // The dataspace, HDR metadata and color transform start with the defaults of the HWC, which
+        // are not sent. Composers without layer color transforms reject even the identity.
+        std::optional<hal::Dataspace> dataspace = hal::Dataspace::UNKNOWN;
+        std::optional<android::HdrMetadata> hdrMetadata = android::HdrMetadata{};
+        std::optional<android::Rect> displayFrame;
+        std::optional<float> planeAlpha;
+        std::optional<android::FloatRect> sourceCrop;
+        std::optional<hal::Transform> transform;
+        std::optional<android::Region> visibleRegion;
+        std::optional<uint32_t> z;
+        std::optional<android::mat4> colorTransform = android::mat4();
+        std::optional<float> brightness;
+        std::optional<android::Region> blockingRegion;
+    };
+    SentState mSentState;
+
+    // The slot of the buffer which was current when it was to be cleared.
+    std::optional<uint32_t> mBufferSlotToClear;
 };
 
 } // namespace impl
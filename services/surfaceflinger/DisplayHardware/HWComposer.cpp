@@ -449,9 +449,7 @@ status_t HWComposer::getDeviceCompositionChanges(
             RETURN_IF_HWC_ERROR_FOR("presentOrValidate", error, displayId, UNKNOWN_ERROR);
         }
         if (state == 1) { //Present Succeeded.
-            std::unordered_map<HWC2::Layer*, sp<Fence>> releaseFences;
-            error = hwcDisplay->getReleaseFences(&releaseFences);
-            displayData.releaseFences = std::move(releaseFences);
+            error = hwcDisplay->getReleaseFences(&displayData.releaseFences);
             displayData.lastPresentFence = outPresentFence;
             displayData.validateWasSkipped = true;
             displayData.presentError = error;
@@ -467,13 +465,11 @@ status_t HWComposer::getDeviceCompositionChanges(
     }
 
     android::HWComposer::DeviceRequestedChanges::ChangedTypes changedTypes;
-    changedTypes.reserve(numTypes);
     error = hwcDisplay->getChangedCompositionTypes(&changedTypes);
     RETURN_IF_HWC_ERROR_FOR("getChangedCompositionTypes", error, displayId, BAD_INDEX);
 
     auto displayRequests = static_cast<hal::DisplayRequest>(0);
     android::HWComposer::DeviceRequestedChanges::LayerRequests layerRequests;
-    layerRequests.reserve(numRequests);
     error = hwcDisplay->getRequests(&displayRequests, &layerRequests);
     RETURN_IF_HWC_ERROR_FOR("getRequests", error, displayId, BAD_INDEX);
 
@@ -497,12 +493,12 @@ sp<Fence> HWComposer::getPresentFence(HalDisplayId displayId) const {
 sp<Fence> HWComposer::getLayerReleaseFence(HalDisplayId displayId, HWC2::Layer* layer) const {
     RETURN_IF_INVALID_DISPLAY(displayId, Fence::NO_FENCE);
     const auto& displayFences = mDisplayData.at(displayId).releaseFences;
-    auto fence = displayFences.find(layer);
-    if (fence == displayFences.end()) {
+    const sp<Fence>* fence = displayFences.get(layer->getDisplaySlot());
+    if (!fence) {
         ALOGV("getLayerReleaseFence: Release fence not found");
         return Fence::NO_FENCE;
     }
-    return fence->second;
+    return *fence;
 }
 
 status_t HWComposer::presentAndGetReleaseFences(
@@ -518,6 +514,9 @@ status_t HWComposer::presentAndGetReleaseFences(
     if (displayData.validateWasSkipped) {
         // explicitly flush all pending commands
         auto error = static_cast<hal::Error>(mComposer->executeCommands());
+        if (error != hal::Error::NONE) {
+            hwcDisplay->resetLayersSentState();
+        }
         RETURN_IF_HWC_ERROR_FOR("executeCommands", error, displayId, UNKNOWN_ERROR);
         RETURN_IF_HWC_ERROR_FOR("present", displayData.presentError, displayId, UNKNOWN_ERROR);
         return NO_ERROR;
@@ -535,12 +534,9 @@ status_t HWComposer::presentAndGetReleaseFences(
     auto error = hwcDisplay->present(&displayData.lastPresentFence);
     RETURN_IF_HWC_ERROR_FOR("present", error, displayId, UNKNOWN_ERROR);
 
-    std::unordered_map<HWC2::Layer*, sp<Fence>> releaseFences;
-    error = hwcDisplay->getReleaseFences(&releaseFences);
+    error = hwcDisplay->getReleaseFences(&displayData.releaseFences);
     RETURN_IF_HWC_ERROR_FOR("getReleaseFences", error, displayId, UNKNOWN_ERROR);
 
-    displayData.releaseFences = std::move(releaseFences);
-
     return NO_ERROR;
 }
 
@@ -889,6 +885,10 @@ std::optional<DisplayIdentificationInfo> HWComposer::onHotplugConnect(
         info = DisplayIdentificationInfo{.id = *displayId,
                                          .name = std::string(),
                                          .deviceProductInfo = std::nullopt};
+        // The composer may have reset the display, and with it the state of its layers.
+        if (isConnected(*displayId)) {
+            mDisplayData[*displayId].hwcDisplay->resetLayersSentState();
+        }
         if (mUpdateDeviceProductInfoOnHotplugReconnect) {
             uint8_t port;
             DisplayIdentificationData data;
@@ -42,6 +42,7 @@
 #include "DisplayMode.h"
 #include "HWC2.h"
 #include "Hal.h"
+#include "LayerSlotArray.h"
 
 #include <aidl/android/hardware/graphics/common/DisplayDecorationSupport.h>
 #include <aidl/android/hardware/graphics/composer3/Capability.h>
@@ -76,13 +77,13 @@ struct KnownHWCGenericLayerMetadata {
 class HWComposer {
 public:
     struct DeviceRequestedChanges {
+        // Indexed by HWC2::Layer::getDisplaySlot.
         using ChangedTypes =
-                std::unordered_map<HWC2::Layer*,
-                                   aidl::android::hardware::graphics::composer3::Composition>;
+                HWC2::LayerSlotArray<aidl::android::hardware::graphics::composer3::Composition>;
         using ClientTargetProperty =
                 aidl::android::hardware::graphics::composer3::ClientTargetPropertyWithBrightness;
         using DisplayRequests = hal::DisplayRequest;
-        using LayerRequests = std::unordered_map<HWC2::Layer*, hal::LayerRequest>;
+        using LayerRequests = HWC2::LayerSlotArray<hal::LayerRequest>;
 
         ChangedTypes changedTypes;
         DisplayRequests displayRequests;
@@ -457,7 +458,8 @@ private:
     struct DisplayData {
         std::unique_ptr<HWC2::Display> hwcDisplay;
         sp<Fence> lastPresentFence = Fence::NO_FENCE; // signals when the last set op retires
-        std::unordered_map<HWC2::Layer*, sp<Fence>> releaseFences;
+        // Indexed by HWC2::Layer::getDisplaySlot, and reused from frame to frame.
+        HWC2::LayerSlotArray<sp<Fence>> releaseFences;
 
         bool validateWasSkipped;
         hal::Error presentError;
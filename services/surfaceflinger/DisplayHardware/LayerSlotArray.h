@@ -0,0 +1,88 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace android::HWC2 {
+
+// Values for some of the layers of a display, indexed by the slot the display assigned to each of
+// its layers on creation (see HWC2::Layer::getDisplaySlot). Slots are dense and reused, so unlike
+// a map keyed by layer, a lookup is an array access, and clear() keeps the storage to be filled
+// again on the next frame without allocating.
+template <typename T>
+class LayerSlotArray {
+public:
+    LayerSlotArray() = default;
+    LayerSlotArray(std::initializer_list<std::pair<uint32_t, T>> values) {
+        for (const auto& [slot, value] : values) {
+            set(slot, value);
+        }
+    }
+
+    bool empty() const { return mSetSlots.empty(); }
+    size_t size() const { return mSetSlots.size(); }
+
+    // Unsets all the values, keeping the storage.
+    void clear() {
+        for (uint32_t slot : mSetSlots) {
+            mValues[slot].reset();
+        }
+        mSetSlots.clear();
+    }
+
+    void set(uint32_t slot, T value) {
+        if (slot >= mValues.size()) {
+            mValues.resize(slot + 1);
+        }
+        if (!mValues[slot]) {
+            mSetSlots.push_back(slot);
+        }
+        mValues[slot] = std::move(value);
+    }
+
+    // Returns the value of the slot, or nullptr if it is not set.
+    const T* get(uint32_t slot) const {
+        return slot < mValues.size() && mValues[slot] ? &*mValues[slot] : nullptr;
+    }
+
+    bool operator==(const LayerSlotArray& other) const {
+        if (size() != other.size()) {
+            return false;
+        }
+        for (uint32_t slot : mSetSlots) {
+            const T* otherValue = other.get(slot);
+            if (!otherValue || !(*otherValue == *mValues[slot])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const LayerSlotArray& other) const { return !(*this == other); }
+
+private:
+    std::vector<std::optional<T>> mValues;
+    // The slots with a value, so that clearing does not scan all the slots.
+    std::vector<uint32_t> mSetSlots;
+};
+
+} // namespace android::HWC2
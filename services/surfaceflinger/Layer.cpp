@@ -182,6 +182,7 @@ Layer::~Layer() {
 
     mFrameTracker.logAndResetStats(mName);
     mFlinger->onLayerDestroyed(this);
+    LayerVector::invalidateZOrderCaches();
 
     if (mDrawingState.sidebandStream != nullptr) {
         mFlinger->mTunnelModeEnabledReporter->decrementTunnelModeCount();
@@ -730,6 +731,8 @@ uint32_t Layer::doTransaction(uint32_t flags) {
     }
 
     commitTransaction(mDrawingState);
+    // The window info of the children depends on the state of their parents.
+    invalidateInputInfo();
 
     return flags;
 }
@@ -776,6 +779,7 @@ bool Layer::setChildLayer(const sp<Layer>& childLayer, int32_t z) {
     if (childLayer->setLayer(z)) {
         mCurrentChildren.removeAt(idx);
         mCurrentChildren.add(childLayer);
+        LayerVector::invalidateZOrderCaches();
         return true;
     }
     return false;
@@ -790,6 +794,7 @@ bool Layer::setChildRelativeLayer(const sp<Layer>& childLayer,
     if (childLayer->setRelativeLayer(relativeToHandle, relativeZ)) {
         mCurrentChildren.removeAt(idx);
         mCurrentChildren.add(childLayer);
+        LayerVector::invalidateZOrderCaches();
         return true;
     }
     return false;
@@ -800,6 +805,7 @@ bool Layer::setLayer(int32_t z) {
     mDrawingState.sequence++;
     mDrawingState.z = z;
     mDrawingState.modified = true;
+    LayerVector::invalidateZOrderCaches();
 
     mFlinger->mSomeChildrenChanged = true;
 
@@ -819,6 +825,7 @@ void Layer::removeZOrderRelative(const wp<Layer>& relative) {
     mDrawingState.zOrderRelatives.remove(relative);
     mDrawingState.sequence++;
     mDrawingState.modified = true;
+    LayerVector::invalidateZOrderCaches();
     setTransactionFlags(eTransactionNeeded);
 }
 
@@ -826,6 +833,7 @@ void Layer::addZOrderRelative(const wp<Layer>& relative) {
     mDrawingState.zOrderRelatives.add(relative);
     mDrawingState.modified = true;
     mDrawingState.sequence++;
+    LayerVector::invalidateZOrderCaches();
     setTransactionFlags(eTransactionNeeded);
 }
 
@@ -834,6 +842,7 @@ void Layer::setZOrderRelativeOf(const wp<Layer>& relativeOf) {
     mDrawingState.sequence++;
     mDrawingState.modified = true;
     mDrawingState.isRelativeOf = relativeOf != nullptr;
+    LayerVector::invalidateZOrderCaches();
 
     setTransactionFlags(eTransactionNeeded);
 }
@@ -862,6 +871,7 @@ bool Layer::setRelativeLayer(const sp<IBinder>& relativeToHandle, int32_t relati
     mDrawingState.sequence++;
     mDrawingState.modified = true;
     mDrawingState.z = relativeZ;
+    LayerVector::invalidateZOrderCaches();
 
     auto oldZOrderRelativeOf = mDrawingState.zOrderRelativeOf.promote();
     if (oldZOrderRelativeOf != nullptr) {
@@ -1565,7 +1575,9 @@ void Layer::addChild(const sp<Layer>& layer) {
     setTransactionFlags(eTransactionNeeded);
 
     mCurrentChildren.add(layer);
+    LayerVector::invalidateZOrderCaches();
     layer->setParent(this);
+    layer->invalidateInputInfo();
     layer->setGameModeForTree(mGameMode);
     updateTreeHasFrameRateVote();
 }
@@ -1576,6 +1588,7 @@ ssize_t Layer::removeChild(const sp<Layer>& layer) {
 
     layer->setParent(nullptr);
     const auto removeResult = mCurrentChildren.remove(layer);
+    LayerVector::invalidateZOrderCaches();
 
     updateTreeHasFrameRateVote();
     layer->setGameModeForTree(GameMode::Unsupported);
@@ -1589,6 +1602,7 @@ void Layer::setChildrenDrawingParent(const sp<Layer>& newParent) {
         child->mDrawingParent = newParent;
         child->computeBounds(newParent->mBounds, newParent->mEffectiveTransform,
                              newParent->mEffectiveShadowRadius);
+        child->invalidateInputInfo();
     }
 }
 
@@ -2001,7 +2015,10 @@ void Layer::commitChildList() {
         child->commitChildList();
     }
     mDrawingChildren = mCurrentChildren;
-    mDrawingParent = mCurrentParent;
+    if (mDrawingParent != mCurrentParent) {
+        mDrawingParent = mCurrentParent;
+        invalidateInputInfo();
+    }
     if (CC_UNLIKELY(usingRelativeZ(LayerVector::StateSet::Drawing))) {
         auto zOrderRelativeOf = mDrawingState.zOrderRelativeOf.promote();
         if (zOrderRelativeOf == nullptr) return;
@@ -2010,6 +2027,7 @@ void Layer::commitChildList() {
                   zOrderRelativeOf->mName.c_str());
             ALOGE("Severing rel Z loop, potentially dangerous");
             mDrawingState.isRelativeOf = false;
+            LayerVector::invalidateZOrderCaches();
             zOrderRelativeOf->removeZOrderRelative(this);
         }
     }
@@ -2024,160 +2042,120 @@ void Layer::setInputInfo(const WindowInfo& info) {
     setTransactionFlags(eTransactionNeeded);
 }
 
-LayerProto* Layer::writeToProto(LayersProto& layersProto, uint32_t traceFlags) {
-    LayerProto* layerProto = layersProto.add_layers();
-    writeToProtoDrawingState(layerProto);
-    writeToProtoCommonState(layerProto, LayerVector::StateSet::Drawing, traceFlags);
+void Layer::takeTraceSnapshots(std::vector<LayerTraceSnapshot>& snapshots, uint32_t traceFlags) {
+    LayerTraceSnapshot& snapshot = snapshots.emplace_back();
+    takeTraceSnapshotDrawingState(snapshot);
+    takeTraceSnapshotCommonState(snapshot, traceFlags);
 
     if (traceFlags & LayerTracing::TRACE_COMPOSITION) {
         ftl::FakeGuard guard(mFlinger->mStateLock); // Called from the main thread.
 
         // Only populate for the primary display.
         if (const auto display = mFlinger->getDefaultDisplayDeviceLocked()) {
-            const auto compositionType = getCompositionType(*display);
-            layerProto->set_hwc_composition_type(static_cast<HwcCompositionType>(compositionType));
-            LayerProtoHelper::writeToProto(getVisibleRegion(display.get()),
-                                           [&]() { return layerProto->mutable_visible_region(); });
+            snapshot.composition = LayerTraceSnapshot::Composition{
+                    .compositionType = static_cast<int32_t>(getCompositionType(*display)),
+                    .visibleRegion = getVisibleRegion(display.get())};
         }
     }
 
     for (const sp<Layer>& layer : mDrawingChildren) {
-        layer->writeToProto(layersProto, traceFlags);
+        layer->takeTraceSnapshots(snapshots, traceFlags);
     }
-
-    return layerProto;
 }
 
-void Layer::writeToProtoDrawingState(LayerProto* layerInfo) {
+void Layer::takeTraceSnapshotDrawingState(LayerTraceSnapshot& snapshot) {
     const ui::Transform transform = getTransform();
     auto buffer = getExternalTexture();
     if (buffer != nullptr) {
-        LayerProtoHelper::writeToProto(*buffer,
-                                       [&]() { return layerInfo->mutable_active_buffer(); });
-        LayerProtoHelper::writeToProtoDeprecated(ui::Transform(getBufferTransform()),
-                                                 layerInfo->mutable_buffer_transform());
-    }
-    layerInfo->set_invalidate(contentDirty);
-    layerInfo->set_is_protected(isProtected());
-    layerInfo->set_dataspace(dataspaceDetails(static_cast<android_dataspace>(getDataSpace())));
-    layerInfo->set_queued_frames(getQueuedFrameCount());
-    layerInfo->set_curr_frame(mCurrentFrameNumber);
-    layerInfo->set_effective_scaling_mode(getEffectiveScalingMode());
-
-    layerInfo->set_requested_corner_radius(getDrawingState().cornerRadius);
-    layerInfo->set_corner_radius(
-            (getRoundedCornerState().radius.x + getRoundedCornerState().radius.y) / 2.0);
-    layerInfo->set_background_blur_radius(getBackgroundBlurRadius());
-    layerInfo->set_is_trusted_overlay(isTrustedOverlay());
-    LayerProtoHelper::writeToProtoDeprecated(transform, layerInfo->mutable_transform());
-    LayerProtoHelper::writePositionToProto(transform.tx(), transform.ty(),
-                                           [&]() { return layerInfo->mutable_position(); });
-    LayerProtoHelper::writeToProto(mBounds, [&]() { return layerInfo->mutable_bounds(); });
-    LayerProtoHelper::writeToProto(surfaceDamageRegion,
-                                   [&]() { return layerInfo->mutable_damage_region(); });
+        snapshot.activeBuffer = LayerTraceSnapshot::ActiveBuffer{
+                .width = buffer->getWidth(),
+                .height = buffer->getHeight(),
+                .usage = buffer->getUsage(),
+                .format = buffer->getPixelFormat(),
+                .transform = getBufferTransform()};
+    }
+    snapshot.invalidate = contentDirty;
+    snapshot.isProtected = isProtected();
+    snapshot.dataspace = static_cast<android_dataspace>(getDataSpace());
+    snapshot.queuedFrames = getQueuedFrameCount();
+    snapshot.currFrame = mCurrentFrameNumber;
+    snapshot.effectiveScalingMode = getEffectiveScalingMode();
+
+    const RoundedCornerState roundedCornerState = getRoundedCornerState();
+    snapshot.requestedCornerRadius = getDrawingState().cornerRadius;
+    snapshot.cornerRadius = (roundedCornerState.radius.x + roundedCornerState.radius.y) / 2.0;
+    snapshot.backgroundBlurRadius = getBackgroundBlurRadius();
+    snapshot.isTrustedOverlay = isTrustedOverlay();
+    snapshot.transform = transform;
+    snapshot.bounds = mBounds;
+    snapshot.damageRegion = surfaceDamageRegion;
 
     if (hasColorTransform()) {
-        LayerProtoHelper::writeToProto(getColorTransform(), layerInfo->mutable_color_transform());
+        snapshot.colorTransform = getColorTransform();
     }
 
-    LayerProtoHelper::writeToProto(mSourceBounds,
-                                   [&]() { return layerInfo->mutable_source_bounds(); });
-    LayerProtoHelper::writeToProto(mScreenBounds,
-                                   [&]() { return layerInfo->mutable_screen_bounds(); });
-    LayerProtoHelper::writeToProto(getRoundedCornerState().cropRect,
-                                   [&]() { return layerInfo->mutable_corner_radius_crop(); });
-    layerInfo->set_shadow_radius(mEffectiveShadowRadius);
+    snapshot.sourceBounds = mSourceBounds;
+    snapshot.screenBounds = mScreenBounds;
+    snapshot.cornerRadiusCrop = roundedCornerState.cropRect;
+    snapshot.shadowRadius = mEffectiveShadowRadius;
 }
 
-void Layer::writeToProtoCommonState(LayerProto* layerInfo, LayerVector::StateSet stateSet,
-                                    uint32_t traceFlags) {
-    const bool useDrawing = stateSet == LayerVector::StateSet::Drawing;
-    const LayerVector& children = useDrawing ? mDrawingChildren : mCurrentChildren;
-    const State& state = useDrawing ? mDrawingState : mDrawingState;
-
-    ui::Transform requestedTransform = state.transform;
+void Layer::takeTraceSnapshotCommonState(LayerTraceSnapshot& snapshot, uint32_t traceFlags) {
+    const State& state = mDrawingState;
 
-    layerInfo->set_id(sequence);
-    layerInfo->set_name(getName().c_str());
-    layerInfo->set_type(getType());
+    snapshot.id = sequence;
+    snapshot.name = getName();
+    snapshot.type = getType();
 
-    for (const auto& child : children) {
-        layerInfo->add_children(child->sequence);
+    for (const auto& child : mDrawingChildren) {
+        snapshot.children.push_back(child->sequence);
     }
 
     for (const wp<Layer>& weakRelative : state.zOrderRelatives) {
         sp<Layer> strongRelative = weakRelative.promote();
         if (strongRelative != nullptr) {
-            layerInfo->add_relatives(strongRelative->sequence);
+            snapshot.relatives.push_back(strongRelative->sequence);
         }
     }
 
-    LayerProtoHelper::writeToProto(state.activeTransparentRegion_legacy,
-                                   [&]() { return layerInfo->mutable_transparent_region(); });
-
-    layerInfo->set_layer_stack(getLayerStack().id);
-    layerInfo->set_z(state.z);
-
-    LayerProtoHelper::writePositionToProto(requestedTransform.tx(), requestedTransform.ty(), [&]() {
-        return layerInfo->mutable_requested_position();
-    });
-
-    LayerProtoHelper::writeSizeToProto(state.width, state.height,
-                                       [&]() { return layerInfo->mutable_size(); });
-
-    LayerProtoHelper::writeToProto(state.crop, [&]() { return layerInfo->mutable_crop(); });
-
-    layerInfo->set_is_opaque(isOpaque(state));
-
-    layerInfo->set_pixel_format(decodePixelFormat(getPixelFormat()));
-    LayerProtoHelper::writeToProto(getColor(), [&]() { return layerInfo->mutable_color(); });
-    LayerProtoHelper::writeToProto(state.color,
-                                   [&]() { return layerInfo->mutable_requested_color(); });
-    layerInfo->set_flags(state.flags);
+    snapshot.transparentRegion = state.activeTransparentRegion_legacy;
+    snapshot.layerStack = getLayerStack();
+    snapshot.z = state.z;
+    snapshot.requestedTransform = state.transform;
+    snapshot.width = state.width;
+    snapshot.height = state.height;
+    snapshot.crop = state.crop;
+    snapshot.isOpaque = isOpaque(state);
+    snapshot.pixelFormat = getPixelFormat();
+    snapshot.color = getColor();
+    snapshot.requestedColor = state.color;
+    snapshot.flags = state.flags;
 
-    LayerProtoHelper::writeToProtoDeprecated(requestedTransform,
-                                             layerInfo->mutable_requested_transform());
-
-    auto parent = useDrawing ? mDrawingParent.promote() : mCurrentParent.promote();
-    if (parent != nullptr) {
-        layerInfo->set_parent(parent->sequence);
-    } else {
-        layerInfo->set_parent(-1);
+    if (const auto parent = mDrawingParent.promote()) {
+        snapshot.parent = parent->sequence;
     }
-
-    auto zOrderRelativeOf = state.zOrderRelativeOf.promote();
-    if (zOrderRelativeOf != nullptr) {
-        layerInfo->set_z_order_relative_of(zOrderRelativeOf->sequence);
-    } else {
-        layerInfo->set_z_order_relative_of(-1);
+    if (const auto zOrderRelativeOf = state.zOrderRelativeOf.promote()) {
+        snapshot.zOrderRelativeOf = zOrderRelativeOf->sequence;
     }
-
-    layerInfo->set_is_relative_of(state.isRelativeOf);
-
-    layerInfo->set_owner_uid(mOwnerUid);
+    snapshot.isRelativeOf = state.isRelativeOf;
+    snapshot.ownerUid = mOwnerUid;
 
     if ((traceFlags & LayerTracing::TRACE_INPUT) && needsInputInfo()) {
-        WindowInfo info;
-        if (useDrawing) {
-            info = fillInputInfo(
-                    InputDisplayArgs{.transform = &kIdentityTransform, .isSecure = true});
-        } else {
-            info = state.inputInfo;
+        LayerTraceSnapshot::InputWindow& inputWindow = snapshot.inputWindow.emplace();
+        inputWindow.info =
+                fillInputInfo(InputDisplayArgs{.transform = &kIdentityTransform, .isSecure = true});
+        if (const auto cropLayer = state.touchableRegionCrop.promote()) {
+            inputWindow.cropLayerId = cropLayer->sequence;
+            inputWindow.cropLayerScreenBounds =
+                    cropLayer->getScreenBounds(false /* reduceTransparentRegion */);
         }
-
-        LayerProtoHelper::writeToProto(info, state.touchableRegionCrop,
-                                       [&]() { return layerInfo->mutable_input_window_info(); });
     }
 
     if (traceFlags & LayerTracing::TRACE_EXTRA) {
-        auto protoMap = layerInfo->mutable_metadata();
-        for (const auto& entry : state.metadata.mMap) {
-            (*protoMap)[entry.first] = std::string(entry.second.cbegin(), entry.second.cend());
-        }
+        snapshot.metadata = state.metadata;
     }
 
-    LayerProtoHelper::writeToProto(state.destinationFrame,
-                                   [&]() { return layerInfo->mutable_destination_frame(); });
+    snapshot.destinationFrame = state.destinationFrame;
 }
 
 bool Layer::isRemovedFromCurrentState() const  {
@@ -2440,6 +2418,72 @@ WindowInfo Layer::fillInputInfo(const InputDisplayArgs& displayArgs) {
     return info;
 }
 
+bool Layer::InputInfoKey::operator==(const InputInfoKey& other) const {
+    return displayTransform == other.displayTransform &&
+            isSecureDisplay == other.isSecureDisplay && bounds == other.bounds &&
+            screenBounds == other.screenBounds && transform == other.transform &&
+            inputTransform == other.inputTransform && inputBounds == other.inputBounds &&
+            visible == other.visible && cropLayerScreenBounds == other.cropLayerScreenBounds &&
+            clonedRootScreenBounds == other.clonedRootScreenBounds;
+}
+
+Layer::InputInfoKey Layer::getInputInfoKey(const InputDisplayArgs& displayArgs) {
+    InputInfoKey key;
+    if (displayArgs.transform != nullptr) {
+        key.displayTransform = *displayArgs.transform;
+    }
+    key.isSecureDisplay = displayArgs.isSecure;
+    key.bounds = mBounds;
+    key.screenBounds = mScreenBounds;
+    key.transform = getTransform();
+    key.inputTransform = getInputTransform();
+    key.inputBounds = getInputBounds();
+    key.visible = hasInputInfo() ? canReceiveInput() : isVisible();
+    if (const sp<Layer> cropLayer = mDrawingState.touchableRegionCrop.promote()) {
+        key.cropLayerScreenBounds = cropLayer->mScreenBounds;
+    }
+    if (isClone()) {
+        if (const sp<Layer> clonedRoot = getClonedRoot()) {
+            key.clonedRootScreenBounds = clonedRoot->mScreenBounds;
+        }
+    }
+    return key;
+}
+
+const WindowInfo& Layer::getCachedInputInfo(const InputDisplayArgs& displayArgs) {
+    InputInfoKey key = getInputInfoKey(displayArgs);
+    if (!mInputInfoDirty && key == mInputInfoKey) {
+        return mCachedInputInfo;
+    }
+
+    const bool hadInputInfo = hasInputInfo();
+    mCachedInputInfo = fillInputInfo(displayArgs);
+    // Layers without input info get one when first filled, which changes their visibility check.
+    mInputInfoKey = hadInputInfo == hasInputInfo() ? std::move(key) : getInputInfoKey(displayArgs);
+    mInputInfoDirty = false;
+    return mCachedInputInfo;
+}
+
+void Layer::invalidateInputInfo() {
+    static std::atomic<uint64_t> sInputInfoInvalidation{0};
+    invalidateInputInfo(++sInputInfoInvalidation);
+}
+
+void Layer::invalidateInputInfo(uint64_t invalidation) {
+    // Children in both the current and the drawing lists are only visited once.
+    if (mInputInfoInvalidation == invalidation) {
+        return;
+    }
+    mInputInfoInvalidation = invalidation;
+    mInputInfoDirty = true;
+    for (const sp<Layer>& child : mCurrentChildren) {
+        child->invalidateInputInfo(invalidation);
+    }
+    for (const sp<Layer>& child : mDrawingChildren) {
+        child->invalidateInputInfo(invalidation);
+    }
+}
+
 sp<Layer> Layer::getClonedRoot() {
     if (mClonedChild != nullptr) {
         return this;
@@ -2498,6 +2542,7 @@ void Layer::updateMirrorInfo() {
     mClonedChild->updateClonedDrawingState(clonedLayersMap);
     mClonedChild->updateClonedChildren(this, clonedLayersMap);
     mClonedChild->updateClonedRelatives(clonedLayersMap);
+    LayerVector::invalidateZOrderCaches();
 }
 
 void Layer::updateClonedDrawingState(std::map<sp<Layer>, sp<Layer>>& clonedLayersMap) {
@@ -2668,11 +2713,19 @@ bool Layer::setDropInputMode(gui::DropInputMode mode) {
         return false;
     }
     mDrawingState.dropInputMode = mode;
+    invalidateInputInfo();
     return true;
 }
 
 void Layer::cloneDrawingState(const Layer* from) {
+    // The relatives of clones are restored or rebuilt by the callers, which invalidate the
+    // z-order caches when they change.
+    if (mDrawingState.z != from->mDrawingState.z ||
+        mDrawingState.isRelativeOf != from->mDrawingState.isRelativeOf) {
+        LayerVector::invalidateZOrderCaches();
+    }
     mDrawingState = from->mDrawingState;
+    invalidateInputInfo();
     // Skip callback info since they are not applicable for cloned layers.
     mDrawingState.releaseBufferListener = nullptr;
     mDrawingState.callbackHandles = {};
@@ -684,17 +684,16 @@ public:
 
     bool isRemovedFromCurrentState() const;
 
-    LayerProto* writeToProto(LayersProto& layersProto, uint32_t traceFlags);
-
-    // Write states that are modified by the main thread. This includes drawing
-    // state as well as buffer data. This should be called in the main or tracing
-    // thread.
-    void writeToProtoDrawingState(LayerProto* layerInfo);
-    // Write drawing or current state. If writing current state, the caller should hold the
-    // external mStateLock. If writing drawing state, this function should be called on the
-    // main or tracing thread.
-    void writeToProtoCommonState(LayerProto* layerInfo, LayerVector::StateSet,
-                                 uint32_t traceFlags = LayerTracing::TRACE_ALL);
+    // Appends the snapshots of this layer and of its drawing children, in the order they are
+    // written to the LayersProto. This should be called on the main thread.
+    void takeTraceSnapshots(std::vector<LayerTraceSnapshot>& snapshots, uint32_t traceFlags);
+
+    // Copy states that are modified by the main thread. This includes drawing
+    // state as well as buffer data.
+    void takeTraceSnapshotDrawingState(LayerTraceSnapshot& snapshot);
+    // Copy the requested drawing state along with the hierarchy and input info of the layer.
+    void takeTraceSnapshotCommonState(LayerTraceSnapshot& snapshot,
+                                      uint32_t traceFlags = LayerTracing::TRACE_ALL);
 
     gui::WindowInfo::Type getWindowType() const { return mWindowType; }
 
@@ -851,6 +850,13 @@ public:
     };
     gui::WindowInfo fillInputInfo(const InputDisplayArgs& displayArgs);
 
+    // Returns the window info of fillInputInfo, which is only filled again if the layer, one of
+    // its parents, its geometry or the display changed since the last call.
+    const gui::WindowInfo& getCachedInputInfo(const InputDisplayArgs& displayArgs);
+
+    // Marks the cached window info of this layer and of its descendants as changed.
+    void invalidateInputInfo();
+
     /**
      * Returns whether this layer has an explicitly set input-info.
      */
@@ -1088,6 +1094,25 @@ private:
     // Fills in the frame and transform info for the gui::WindowInfo.
     void fillInputFrameInfo(gui::WindowInfo&, const ui::Transform& screenToDisplay);
 
+    // The inputs of fillInputInfo which change without a transaction on the layer or its parents,
+    // such as its geometry and buffer. The cached window info is filled again when they change.
+    struct InputInfoKey {
+        std::optional<ui::Transform> displayTransform;
+        bool isSecureDisplay = false;
+        FloatRect bounds;
+        FloatRect screenBounds;
+        ui::Transform transform;
+        ui::Transform inputTransform;
+        Rect inputBounds;
+        bool visible = false;
+        std::optional<FloatRect> cropLayerScreenBounds;
+        std::optional<FloatRect> clonedRootScreenBounds;
+
+        bool operator==(const InputInfoKey& other) const;
+    };
+    InputInfoKey getInputInfoKey(const InputDisplayArgs& displayArgs);
+    void invalidateInputInfo(uint64_t invalidation);
+
     // Cached properties computed from drawing state
     // Effective transform taking into account parent transforms and any parent scaling, which is
     // a transform from the current layer coordinate space to display(screen) coordinate space.
@@ -1104,6 +1129,12 @@ private:
     // Layer bounds in screen space.
     FloatRect mScreenBounds;
 
+    // Window info cached by getCachedInputInfo, and the inputs it was filled from.
+    bool mInputInfoDirty = true;
+    uint64_t mInputInfoInvalidation = 0;
+    InputInfoKey mInputInfoKey;
+    gui::WindowInfo mCachedInputInfo;
+
     bool mGetHandleCalled = false;
 
     // Tracks the process and user id of the caller when creating this layer
@@ -168,7 +168,8 @@ void LayerProtoHelper::writeToProto(const renderengine::ExternalTexture& buffer,
 }
 
 void LayerProtoHelper::writeToProto(
-        const WindowInfo& inputInfo, const wp<Layer>& touchableRegionBounds,
+        const WindowInfo& inputInfo, std::optional<int32_t> cropLayerId,
+        const Rect& cropLayerScreenBounds,
         std::function<InputWindowInfoProto*()> getInputWindowInfoProto) {
     if (inputInfo.token == nullptr) {
         return;
@@ -197,11 +198,9 @@ void LayerProtoHelper::writeToProto(
     proto->set_global_scale_factor(inputInfo.globalScaleFactor);
     LayerProtoHelper::writeToProtoDeprecated(inputInfo.transform, proto->mutable_transform());
     proto->set_replace_touchable_region_with_crop(inputInfo.replaceTouchableRegionWithCrop);
-    auto cropLayer = touchableRegionBounds.promote();
-    if (cropLayer != nullptr) {
-        proto->set_crop_layer_id(cropLayer->sequence);
-        LayerProtoHelper::writeToProto(cropLayer->getScreenBounds(
-                                               false /* reduceTransparentRegion */),
+    if (cropLayerId) {
+        proto->set_crop_layer_id(*cropLayerId);
+        LayerProtoHelper::writeToProto(cropLayerScreenBounds,
                                        [&]() { return proto->mutable_touchable_region_crop(); });
     }
 }
@@ -51,8 +51,8 @@ public:
                                       TransformProto* transformProto);
     static void writeToProto(const renderengine::ExternalTexture& buffer,
                              std::function<ActiveBufferProto*()> getActiveBufferProto);
-    static void writeToProto(const gui::WindowInfo& inputInfo,
-                             const wp<Layer>& touchableRegionBounds,
+    static void writeToProto(const gui::WindowInfo& inputInfo, std::optional<int32_t> cropLayerId,
+                             const Rect& cropLayerScreenBounds,
                              std::function<InputWindowInfoProto*()> getInputWindowInfoProto);
     static void writeToProto(const mat4 matrix, ColorTransformProto* colorTransformProto);
     static void readFromProto(const ColorTransformProto& colorTransformProto, mat4& matrix);
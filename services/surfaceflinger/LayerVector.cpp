@@ -21,10 +21,17 @@
 #include "LayerVector.h"
 #include "Layer.h"
 
+#include <algorithm>
+
 namespace android {
 
+std::atomic<uint64_t> LayerVector::sZOrderGeneration{1};
+
 LayerVector::LayerVector(const StateSet stateSet) : mStateSet(stateSet) {}
 
+LayerVector::LayerVector(const LayerVector& rhs)
+      : SortedVector<sp<Layer>>(rhs), mStateSet(rhs.mStateSet) {}
+
 LayerVector::LayerVector(const LayerVector& rhs, const StateSet stateSet)
       : SortedVector<sp<Layer>>(rhs), mStateSet(stateSet) {}
 
@@ -32,7 +39,14 @@ LayerVector::~LayerVector() = default;
 
 // This operator override is needed to prevent mStateSet from getting copied over.
 LayerVector& LayerVector::operator=(const LayerVector& rhs) {
+    // The drawing state is assigned from the current state on every commit, usually with the
+    // same layers, which should not cost a rebuild of the z-order caches.
+    if (array() == rhs.array() ||
+        (size() == rhs.size() && std::equal(begin(), end(), rhs.begin()))) {
+        return *this;
+    }
     SortedVector::operator=(rhs);
+    invalidateZOrderCaches();
     return *this;
 }
 
@@ -62,25 +76,62 @@ int LayerVector::do_compare(const void* lhs, const void* rhs) const
 }
 
 void LayerVector::traverseInZOrder(StateSet stateSet, const Visitor& visitor) const {
-    for (size_t i = 0; i < size(); i++) {
-        const auto& layer = (*this)[i];
-        auto& state = layer->getDrawingState();
-        if (state.isRelativeOf) {
-            continue;
+    traverseZOrderList(*getZOrderList(stateSet, /*reverse=*/false), visitor);
+}
+
+void LayerVector::traverseInReverseZOrder(StateSet stateSet, const Visitor& visitor) const {
+    traverseZOrderList(*getZOrderList(stateSet, /*reverse=*/true), visitor);
+}
+
+void LayerVector::invalidateZOrderCaches() {
+    sZOrderGeneration.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::shared_ptr<const LayerVector::ZOrderList> LayerVector::getZOrderList(StateSet stateSet,
+                                                                          bool reverse) const {
+    std::lock_guard lock(mZOrderCacheMutex);
+    ZOrderCache& cache = reverse ? mReverseZOrderCache : mZOrderCache;
+    const uint64_t generation = sZOrderGeneration.load(std::memory_order_relaxed);
+    if (cache.layers && cache.generation == generation && cache.stateSet == stateSet) {
+        return cache.layers;
+    }
+
+    // The list is collected by the recursive traversal of the layers, which sorts the children
+    // and relatives of every layer. The reverse list is collected separately since it is not
+    // always the reverse of the other, e.g. for relatives on another layer stack.
+    auto layers = std::make_shared<ZOrderList>();
+    const auto collect = [&layers](Layer* layer) { layers->emplace_back(layer); };
+    if (reverse) {
+        for (auto i = static_cast<int64_t>(size()) - 1; i >= 0; i--) {
+            const auto& layer = (*this)[i];
+            if (layer->getDrawingState().isRelativeOf) {
+                continue;
+            }
+            layer->traverseInReverseZOrder(stateSet, collect);
+        }
+    } else {
+        for (size_t i = 0; i < size(); i++) {
+            const auto& layer = (*this)[i];
+            if (layer->getDrawingState().isRelativeOf) {
+                continue;
+            }
+            layer->traverseInZOrder(stateSet, collect);
         }
-        layer->traverseInZOrder(stateSet, visitor);
     }
+
+    cache.generation = generation;
+    cache.stateSet = stateSet;
+    cache.layers = std::move(layers);
+    return cache.layers;
 }
 
-void LayerVector::traverseInReverseZOrder(StateSet stateSet, const Visitor& visitor) const {
-    for (auto i = static_cast<int64_t>(size()) - 1; i >= 0; i--) {
-        const auto& layer = (*this)[i];
-        auto& state = layer->getDrawingState();
-        if (state.isRelativeOf) {
-            continue;
+void LayerVector::traverseZOrderList(const ZOrderList& layers, const Visitor& visitor) {
+    for (const wp<Layer>& weakLayer : layers) {
+        // Skips the layers destroyed since the list was collected.
+        if (const sp<Layer> layer = weakLayer.promote()) {
+            visitor(layer.get());
         }
-        layer->traverseInReverseZOrder(stateSet, visitor);
-     }
+    }
 }
 
 void LayerVector::traverse(const Visitor& visitor) const {
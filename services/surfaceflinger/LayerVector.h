@@ -20,7 +20,11 @@
 #include <utils/SortedVector.h>
 #include <utils/RefBase.h>
 
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace android {
 class Layer;
@@ -39,6 +43,7 @@ public:
     };
 
     explicit LayerVector(const StateSet stateSet);
+    LayerVector(const LayerVector& rhs);
     LayerVector(const LayerVector& rhs, const StateSet stateSet);
     ~LayerVector() override;
 
@@ -51,8 +56,34 @@ public:
     void traverseInReverseZOrder(StateSet stateSet, const Visitor& visitor) const;
     void traverseInZOrder(StateSet stateSet, const Visitor& visitor) const;
     void traverse(const Visitor& visitor) const;
+
+    // The z-order traversals visit a flattened list of the layers, which is only rebuilt after
+    // this has been called. It must be called whenever the children, z or relative-z of any
+    // layer changes, and whenever a LayerVector traversed in z-order is modified other than by
+    // assignment.
+    static void invalidateZOrderCaches();
+
 private:
+    // Layers of a z-order traversal, in visiting order. Layers are weakly held so that the cache
+    // does not keep removed layers alive.
+    using ZOrderList = std::vector<wp<Layer>>;
+
+    struct ZOrderCache {
+        uint64_t generation = 0;
+        StateSet stateSet = StateSet::Invalid;
+        std::shared_ptr<const ZOrderList> layers;
+    };
+
+    std::shared_ptr<const ZOrderList> getZOrderList(StateSet stateSet, bool reverse) const;
+    static void traverseZOrderList(const ZOrderList& layers, const Visitor& visitor);
+
     const StateSet mStateSet;
+
+    static std::atomic<uint64_t> sZOrderGeneration;
+
+    mutable std::mutex mZOrderCacheMutex;
+    mutable ZOrderCache mZOrderCache;
+    mutable ZOrderCache mReverseZOrderCache;
 };
 }
 
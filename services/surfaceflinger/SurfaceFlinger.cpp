@@ -416,6 +416,9 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory) : SurfaceFlinger(factory, SkipI
     property_get("debug.sf.disable_client_composition_cache", value, "0");
     mDisableClientCompositionCache = atoi(value);
 
+    mClientCompositionCacheSize = static_cast<uint32_t>(
+            std::max(property_get_int32("debug.sf.client_composition_cache_size", 0), 0));
+
     property_get("debug.sf.predict_hwc_composition_strategy", value, "1");
     mPredictCompositionStrategy = atoi(value);
 
@@ -441,6 +444,9 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory) : SurfaceFlinger(factory, SkipI
 
     if (!mIsUserBuild && base::GetBoolProperty("debug.sf.enable_transaction_tracing"s, true)) {
         mTransactionTracing.emplace();
+        if (base::GetBoolProperty("debug.sf.transaction_trace_streaming"s, false)) {
+            mTransactionTracing->enableStreaming();
+        }
     }
 
     mIgnoreHdrCameraLayers = ignore_hdr_camera_layers(false);
@@ -2204,6 +2210,8 @@ void SurfaceFlinger::composite(nsecs_t frameTime, int64_t vsyncId)
         if (auto layerFE = layer->getCompositionEngineLayerFE())
             refreshArgs.layersWithQueuedFrames.push_back(layerFE);
     }
+    refreshArgs.bufferIdsToUncache = std::move(mBufferIdsToUncache);
+    mBufferIdsToUncache.clear();
 
     refreshArgs.outputColorSetting = useColorManagement
             ? mDisplayColorSetting
@@ -3337,7 +3345,8 @@ void SurfaceFlinger::buildWindowInfos(std::vector<WindowInfo>& outWindowInfos,
                                                [](const auto& info) -> Layer::InputDisplayArgs {
                                                    return {&info.transform, info.isSecure};
                                                });
-        outWindowInfos.push_back(layer->fillInputInfo(opt.value_or(Layer::InputDisplayArgs{})));
+        outWindowInfos.push_back(
+                layer->getCachedInputInfo(opt.value_or(Layer::InputDisplayArgs{})));
     });
 
     sNumWindowInfos = outWindowInfos.size();
@@ -3506,6 +3515,7 @@ void SurfaceFlinger::doCommitTransactions() {
             if (l->isAtRoot()) {
                 l->setIsAtRoot(false);
                 mCurrentState.layersSortedByZ.remove(l);
+                LayerVector::invalidateZOrderCaches();
             }
 
             // If the layer has been removed and has no parent, then it will not be reachable
@@ -4241,7 +4251,9 @@ bool SurfaceFlinger::applyTransactionState(const FrameTimelineInfo& frameTimelin
     }
 
     if (uncacheBuffer.isValid()) {
-        ClientCache::getInstance().erase(uncacheBuffer);
+        if (const auto buffer = ClientCache::getInstance().erase(uncacheBuffer)) {
+            mBufferIdsToUncache.push_back(buffer->getId());
+        }
     }
 
     // If a synchronous transaction is explicitly requested without any changes, force a transaction
@@ -4404,6 +4416,7 @@ uint32_t SurfaceFlinger::setClientStateLocked(const FrameTimelineInfo& frameTime
             if (layer->setLayer(s.z) && idx >= 0) {
                 mCurrentState.layersSortedByZ.removeAt(idx);
                 mCurrentState.layersSortedByZ.add(layer);
+                LayerVector::invalidateZOrderCaches();
                 // we need traversal (state changed)
                 // AND transaction (list changed)
                 flags |= eTransactionNeeded|eTraversalNeeded;
@@ -4425,6 +4438,7 @@ uint32_t SurfaceFlinger::setClientStateLocked(const FrameTimelineInfo& frameTime
                 idx >= 0) {
                 mCurrentState.layersSortedByZ.removeAt(idx);
                 mCurrentState.layersSortedByZ.add(layer);
+                LayerVector::invalidateZOrderCaches();
                 // we need traversal (state changed)
                 // AND transaction (list changed)
                 flags |= eTransactionNeeded|eTraversalNeeded;
@@ -4493,6 +4507,7 @@ uint32_t SurfaceFlinger::setClientStateLocked(const FrameTimelineInfo& frameTime
         } else if (layer->setLayerStack(s.layerStack)) {
             mCurrentState.layersSortedByZ.removeAt(idx);
             mCurrentState.layersSortedByZ.add(layer);
+            LayerVector::invalidateZOrderCaches();
             // we need traversal (state changed)
             // AND transaction (list changed)
             flags |= eTransactionNeeded | eTraversalNeeded | eTransformHintUpdateNeeded;
@@ -4614,6 +4629,7 @@ uint32_t SurfaceFlinger::setClientStateLocked(const FrameTimelineInfo& frameTime
             if (!hadParent) {
                 layer->setIsAtRoot(false);
                 mCurrentState.layersSortedByZ.remove(layer);
+                LayerVector::invalidateZOrderCaches();
             }
             flags |= eTransactionNeeded | eTraversalNeeded;
         }
@@ -5059,7 +5075,7 @@ status_t SurfaceFlinger::doDump(int fd, const DumpArgs& args, bool asProto) {
             } else {
                 // Dump info that we need to access from the main thread
                 const auto layerTree = LayerProtoParser::generateLayerTree(layersTrace->layers());
-                result.append(LayerProtoParser::layerTreeToString(layerTree));
+                LayerProtoParser::layerTreeToString(layerTree, result);
                 result.append("\n");
                 dumpOffscreenLayers(result);
             }
@@ -5276,12 +5292,19 @@ void SurfaceFlinger::dumpWideColorInfo(std::string& result) const {
 }
 
 LayersProto SurfaceFlinger::dumpDrawingStateProto(uint32_t traceFlags) const {
+    LayersTraceSnapshot snapshot;
+    takeDrawingStateTraceSnapshot(snapshot, traceFlags);
+
     LayersProto layersProto;
+    snapshot.writeToProto(layersProto);
+    return layersProto;
+}
+
+void SurfaceFlinger::takeDrawingStateTraceSnapshot(LayersTraceSnapshot& snapshot,
+                                                   uint32_t traceFlags) const {
     for (const sp<Layer>& layer : mDrawingState.layersSortedByZ) {
-        layer->writeToProto(layersProto, traceFlags);
+        layer->takeTraceSnapshots(snapshot.layers, traceFlags);
     }
-
-    return layersProto;
 }
 
 void SurfaceFlinger::dumpDisplayProto(LayersTraceProto& layersTraceProto) const {
@@ -5306,21 +5329,19 @@ void SurfaceFlinger::dumpHwc(std::string& result) const {
 }
 
 void SurfaceFlinger::dumpOffscreenLayersProto(LayersProto& layersProto, uint32_t traceFlags) const {
-    // Add a fake invisible root layer to the proto output and parent all the offscreen layers to
-    // it.
-    LayerProto* rootProto = layersProto.add_layers();
-    const int32_t offscreenRootLayerId = INT32_MAX - 2;
-    rootProto->set_id(offscreenRootLayerId);
-    rootProto->set_name("Offscreen Root");
-    rootProto->set_parent(-1);
+    LayersTraceSnapshot snapshot;
+    takeOffscreenLayersTraceSnapshot(snapshot, traceFlags);
+    snapshot.writeToProto(layersProto);
+}
 
+void SurfaceFlinger::takeOffscreenLayersTraceSnapshot(LayersTraceSnapshot& snapshot,
+                                                      uint32_t traceFlags) const {
+    snapshot.hasOffscreenLayers = true;
     for (Layer* offscreenLayer : mOffscreenLayers) {
-        // Add layer as child of the fake root
-        rootProto->add_children(offscreenLayer->sequence);
-
-        // Add layer
-        LayerProto* layerProto = offscreenLayer->writeToProto(layersProto, traceFlags);
-        layerProto->set_parent(offscreenRootLayerId);
+        // Parent the layer to the fake offscreen root.
+        const size_t index = snapshot.offscreenLayers.size();
+        offscreenLayer->takeTraceSnapshots(snapshot.offscreenLayers, traceFlags);
+        snapshot.offscreenLayers[index].parent = LayersTraceSnapshot::OFFSCREEN_ROOT_LAYER_ID;
     }
 }
 
@@ -7288,6 +7309,7 @@ void SurfaceFlinger::handleLayerCreatedLocked(const LayerCreatedState& state) {
     if (parent == nullptr && addToRoot) {
         layer->setIsAtRoot(true);
         mCurrentState.layersSortedByZ.add(layer);
+        LayerVector::invalidateZOrderCaches();
     } else if (parent == nullptr) {
         layer->onRemovedFromCurrentState();
     } else if (parent->isRemovedFromCurrentState()) {
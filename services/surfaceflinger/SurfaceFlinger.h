@@ -335,6 +335,9 @@ public:
     // If set, disables reusing client composition buffers. This can be set by
     // debug.sf.disable_client_composition_cache
     bool mDisableClientCompositionCache = false;
+    // Number of client composition requests cached per display, if larger than the number of
+    // framebuffers. This can be set by debug.sf.client_composition_cache_size
+    uint32_t mClientCompositionCacheSize = 0;
     void windowInfosReported();
 
     // Disables expensive rendering for all displays
@@ -1111,6 +1114,11 @@ private:
     LayersProto dumpDrawingStateProto(uint32_t traceFlags) const;
     void dumpOffscreenLayersProto(LayersProto& layersProto,
                                   uint32_t traceFlags = LayerTracing::TRACE_ALL) const;
+    // Copy the layer state written by the above, so that the protos can be built off the main
+    // thread.
+    void takeDrawingStateTraceSnapshot(LayersTraceSnapshot& snapshot, uint32_t traceFlags) const;
+    void takeOffscreenLayersTraceSnapshot(LayersTraceSnapshot& snapshot,
+                                          uint32_t traceFlags = LayerTracing::TRACE_ALL) const;
     void dumpDisplayProto(LayersTraceProto& layersTraceProto) const;
 
     // Dumps state from HW Composer
@@ -1226,6 +1234,9 @@ private:
     // Tracks layers that have pending frames which are candidates for being
     // latched.
     std::unordered_set<sp<Layer>, SpHash<Layer>> mLayersWithQueuedFrames;
+    // The ids of the buffers which were released or erased from the client cache, to be removed
+    // from the HWC buffer caches on the next composition.
+    std::vector<uint64_t> mBufferIdsToUncache;
     // Tracks layers that need to update a display's dirty region.
     std::vector<sp<Layer>> mLayersPendingRefresh;
     std::array<FenceWithFenceTime, 2> mPreviousPresentFences;
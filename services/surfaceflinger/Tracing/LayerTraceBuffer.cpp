@@ -0,0 +1,195 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "LayerTraceBuffer"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "LayerTraceBuffer.h"
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <log/log.h>
+#include <utils/Timers.h>
+#include <utils/Trace.h>
+
+#include <chrono>
+#include <cinttypes>
+
+namespace android {
+
+void LayerTraceBuffer::reset() {
+    // use the swap trick to make sure memory is released
+    std::deque<Entry>().swap(mEntries);
+    std::unordered_map<int32_t, std::string>().swap(mLastLayers);
+    mUsedInBytes = 0;
+    mFullSizeInBytes = 0;
+    mEntriesSinceKeyframe = 0;
+}
+
+void LayerTraceBuffer::emplace(LayersTraceProto&& proto) {
+    ATRACE_CALL();
+    Entry entry;
+    entry.timestamp = proto.elapsed_realtime_nanos();
+
+    LayersProto layers;
+    layers.Swap(proto.mutable_layers());
+    proto.SerializeToString(&entry.header);
+
+    std::vector<std::pair<int32_t, std::string>> serializedLayers;
+    serializedLayers.reserve(static_cast<size_t>(layers.layers_size()));
+    std::unordered_map<int32_t, std::string> nextLayers;
+    nextLayers.reserve(serializedLayers.capacity());
+    size_t layersSizeInBytes = 0;
+    for (const LayerProto& layer : layers.layers()) {
+        std::string serializedLayer;
+        layer.SerializeToString(&serializedLayer);
+        layersSizeInBytes += serializedLayer.size();
+        nextLayers[layer.id()] = serializedLayer;
+        serializedLayers.emplace_back(layer.id(), std::move(serializedLayer));
+    }
+
+    // Layers are diffed by id, so an entry with duplicate ids is stored in full.
+    const bool hasUniqueIds = nextLayers.size() == serializedLayers.size();
+    entry.keyframe = mEntries.empty() || !hasUniqueIds ||
+            mEntriesSinceKeyframe + 1 >= kKeyframeInterval;
+
+    if (entry.keyframe) {
+        entry.layers = std::move(serializedLayers);
+        entry.sizeInBytes = entry.header.size() + layersSizeInBytes;
+    } else {
+        entry.layerIds.reserve(serializedLayers.size());
+        entry.sizeInBytes = entry.header.size() + serializedLayers.size() * sizeof(int32_t);
+        for (auto& [id, layer] : serializedLayers) {
+            entry.layerIds.push_back(id);
+            const auto it = mLastLayers.find(id);
+            if (it == mLastLayers.end() || it->second != layer) {
+                entry.sizeInBytes += layer.size();
+                entry.layers.emplace_back(id, std::move(layer));
+            }
+        }
+    }
+    entry.fullSizeInBytes = entry.header.size() + layersSizeInBytes;
+    mLastLayers = std::move(nextLayers);
+
+    while (!mEntries.empty() && mUsedInBytes + entry.sizeInBytes > mSizeInBytes) {
+        evictOldestKeyframeInterval();
+        if (mEntries.empty() && !entry.keyframe) {
+            // The entry that this one was diffed against is gone.
+            makeKeyframe(entry);
+        }
+    }
+
+    if (entry.sizeInBytes > mSizeInBytes) {
+        ALOGW("Dropping layer trace entry of %zu bytes, which does not fit in the buffer",
+              entry.sizeInBytes);
+        reset();
+        return;
+    }
+
+    mEntriesSinceKeyframe = entry.keyframe ? 0 : mEntriesSinceKeyframe + 1;
+    mUsedInBytes += entry.sizeInBytes;
+    mFullSizeInBytes += entry.fullSizeInBytes;
+    mEntries.emplace_back(std::move(entry));
+}
+
+void LayerTraceBuffer::makeKeyframe(Entry& entry) const {
+    std::vector<std::pair<int32_t, std::string>> layers;
+    layers.reserve(entry.layerIds.size());
+    entry.sizeInBytes = entry.header.size();
+    for (int32_t id : entry.layerIds) {
+        const std::string& layer = mLastLayers.at(id);
+        entry.sizeInBytes += layer.size();
+        layers.emplace_back(id, layer);
+    }
+    entry.keyframe = true;
+    entry.layers = std::move(layers);
+    entry.layerIds.clear();
+}
+
+void LayerTraceBuffer::evictOldestKeyframeInterval() {
+    do {
+        mUsedInBytes -= mEntries.front().sizeInBytes;
+        mFullSizeInBytes -= mEntries.front().fullSizeInBytes;
+        mEntries.pop_front();
+    } while (!mEntries.empty() && !mEntries.front().keyframe);
+}
+
+void LayerTraceBuffer::writeToProto(LayersTraceFileProto& fileProto) const {
+    fileProto.mutable_entry()->Reserve(static_cast<int>(mEntries.size()) +
+                                       fileProto.entry().size());
+
+    // The layers of the previous entry, which point into the entries.
+    std::unordered_map<int32_t, const std::string*> layers;
+    for (const Entry& entry : mEntries) {
+        LayersTraceProto* entryProto = fileProto.add_entry();
+        entryProto->ParseFromString(entry.header);
+        LayersProto* layersProto = entryProto->mutable_layers();
+
+        if (entry.keyframe) {
+            layers.clear();
+        }
+        for (const auto& [id, layer] : entry.layers) {
+            layers[id] = &layer;
+        }
+
+        if (entry.keyframe) {
+            for (const auto& [id, layer] : entry.layers) {
+                layersProto->add_layers()->ParseFromString(layer);
+            }
+        } else {
+            for (int32_t id : entry.layerIds) {
+                layersProto->add_layers()->ParseFromString(*layers.at(id));
+            }
+        }
+    }
+}
+
+status_t LayerTraceBuffer::writeToFile(LayersTraceFileProto& fileProto,
+                                       const std::string& filename) const {
+    ATRACE_CALL();
+    writeToProto(fileProto);
+    std::string output;
+    if (!fileProto.SerializeToString(&output)) {
+        ALOGE("Could not serialize proto.");
+        return UNKNOWN_ERROR;
+    }
+
+    // -rw-r--r--
+    const mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+    if (!android::base::WriteStringToFile(output, filename, mode, getuid(), getgid(), true)) {
+        ALOGE("Could not save the proto file %s", filename.c_str());
+        return PERMISSION_DENIED;
+    }
+    return NO_ERROR;
+}
+
+void LayerTraceBuffer::dump(std::string& result) const {
+    std::chrono::milliseconds duration(0);
+    if (frameCount() > 0) {
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::nanoseconds(systemTime() - mEntries.front().timestamp));
+    }
+    const int64_t durationCount = duration.count();
+    base::StringAppendF(&result,
+                        "  number of entries: %zu (%.2fMB / %.2fMB) duration: %" PRIi64 "ms\n",
+                        frameCount(), float(used()) / (1024.f * 1024.f),
+                        float(size()) / (1024.f * 1024.f), durationCount);
+    base::StringAppendF(&result, "  size of entries if stored in full: %.2fMB\n",
+                        float(mFullSizeInBytes) / (1024.f * 1024.f));
+}
+
+} // namespace android
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <layerproto/LayerProtoHeader.h>
+#include <utils/Errors.h>
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace android::surfaceflinger;
+
+namespace android {
+
+/*
+ * Ring buffer of layer trace entries which stores each entry as the difference from the previous
+ * one, since most layers do not change from one traced frame to the next.
+ *
+ * Every kKeyframeInterval entries, and whenever an entry cannot be diffed, the entry is stored in
+ * full as a keyframe. Entries are evicted a keyframe interval at a time, so that the oldest stored
+ * entry is always a keyframe. Full entries are only reconstructed when the trace is written out,
+ * so the trace file format is unchanged.
+ */
+class LayerTraceBuffer {
+public:
+    static constexpr size_t kKeyframeInterval = 64;
+
+    void setSize(size_t sizeInBytes) { mSizeInBytes = sizeInBytes; }
+    size_t size() const { return mSizeInBytes; }
+    size_t used() const { return mUsedInBytes; }
+    size_t frameCount() const { return mEntries.size(); }
+
+    void reset();
+
+    // Adds the entry, evicting the oldest entries if the buffer is full. The entry is dropped if
+    // it does not fit in the buffer on its own.
+    void emplace(LayersTraceProto&& entry);
+
+    void writeToProto(LayersTraceFileProto& fileProto) const;
+    status_t writeToFile(LayersTraceFileProto& fileProto, const std::string& filename) const;
+
+    void dump(std::string& result) const;
+
+private:
+    struct Entry {
+        bool keyframe = false;
+        // The entry without its layers.
+        std::string header;
+        // The layer ids of the entry, in order. Only set for diffs.
+        std::vector<int32_t> layerIds;
+        // All the layers for keyframes, or only those that differ from the previous entry for
+        // diffs.
+        std::vector<std::pair<int32_t, std::string>> layers;
+        size_t sizeInBytes = 0;
+        // The size of the entry if it were stored in full.
+        size_t fullSizeInBytes = 0;
+        int64_t timestamp = 0;
+    };
+
+    void makeKeyframe(Entry& entry) const;
+    void evictOldestKeyframeInterval();
+
+    size_t mSizeInBytes = 0;
+    size_t mUsedInBytes = 0;
+    std::deque<Entry> mEntries;
+
+    // The serialized layers of the newest entry, by id.
+    std::unordered_map<int32_t, std::string> mLastLayers;
+    size_t mEntriesSinceKeyframe = 0;
+
+    // The size that the stored entries would take if they were stored in full.
+    size_t mFullSizeInBytes = 0;
+};
+
+} // namespace android
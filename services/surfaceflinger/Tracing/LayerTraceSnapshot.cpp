@@ -0,0 +1,160 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ui/DebugUtils.h>
+
+#include "LayerProtoHelper.h"
+#include "LayerTraceSnapshot.h"
+
+namespace android {
+
+void LayerTraceSnapshot::writeToProto(LayerProto* layerProto) const {
+    // Drawing state.
+    if (activeBuffer) {
+        if (activeBuffer->width != 0 || activeBuffer->height != 0 || activeBuffer->usage != 0 ||
+            activeBuffer->format != 0) {
+            ActiveBufferProto* activeBufferProto = layerProto->mutable_active_buffer();
+            activeBufferProto->set_width(activeBuffer->width);
+            activeBufferProto->set_height(activeBuffer->height);
+            activeBufferProto->set_stride(static_cast<uint32_t>(activeBuffer->usage));
+            activeBufferProto->set_format(activeBuffer->format);
+        }
+        LayerProtoHelper::writeToProtoDeprecated(ui::Transform(activeBuffer->transform),
+                                                 layerProto->mutable_buffer_transform());
+    }
+    layerProto->set_invalidate(invalidate);
+    layerProto->set_is_protected(isProtected);
+    layerProto->set_dataspace(dataspaceDetails(dataspace));
+    layerProto->set_queued_frames(queuedFrames);
+    layerProto->set_curr_frame(currFrame);
+    layerProto->set_effective_scaling_mode(static_cast<int32_t>(effectiveScalingMode));
+
+    layerProto->set_requested_corner_radius(requestedCornerRadius);
+    layerProto->set_corner_radius(cornerRadius);
+    layerProto->set_background_blur_radius(backgroundBlurRadius);
+    layerProto->set_is_trusted_overlay(isTrustedOverlay);
+    LayerProtoHelper::writeToProtoDeprecated(transform, layerProto->mutable_transform());
+    LayerProtoHelper::writePositionToProto(transform.tx(), transform.ty(),
+                                           [&]() { return layerProto->mutable_position(); });
+    LayerProtoHelper::writeToProto(bounds, [&]() { return layerProto->mutable_bounds(); });
+    LayerProtoHelper::writeToProto(damageRegion,
+                                   [&]() { return layerProto->mutable_damage_region(); });
+
+    if (colorTransform) {
+        LayerProtoHelper::writeToProto(*colorTransform, layerProto->mutable_color_transform());
+    }
+
+    LayerProtoHelper::writeToProto(sourceBounds,
+                                   [&]() { return layerProto->mutable_source_bounds(); });
+    LayerProtoHelper::writeToProto(screenBounds,
+                                   [&]() { return layerProto->mutable_screen_bounds(); });
+    LayerProtoHelper::writeToProto(cornerRadiusCrop,
+                                   [&]() { return layerProto->mutable_corner_radius_crop(); });
+    layerProto->set_shadow_radius(shadowRadius);
+
+    // Common state.
+    layerProto->set_id(id);
+    layerProto->set_name(name);
+    layerProto->set_type(type);
+
+    for (const int32_t child : children) {
+        layerProto->add_children(child);
+    }
+    for (const int32_t relative : relatives) {
+        layerProto->add_relatives(relative);
+    }
+
+    LayerProtoHelper::writeToProto(transparentRegion,
+                                   [&]() { return layerProto->mutable_transparent_region(); });
+
+    layerProto->set_layer_stack(layerStack.id);
+    layerProto->set_z(z);
+
+    LayerProtoHelper::writePositionToProto(requestedTransform.tx(), requestedTransform.ty(), [&]() {
+        return layerProto->mutable_requested_position();
+    });
+
+    LayerProtoHelper::writeSizeToProto(width, height, [&]() { return layerProto->mutable_size(); });
+
+    LayerProtoHelper::writeToProto(crop, [&]() { return layerProto->mutable_crop(); });
+
+    layerProto->set_is_opaque(isOpaque);
+
+    layerProto->set_pixel_format(decodePixelFormat(pixelFormat));
+    LayerProtoHelper::writeToProto(color, [&]() { return layerProto->mutable_color(); });
+    LayerProtoHelper::writeToProto(requestedColor,
+                                   [&]() { return layerProto->mutable_requested_color(); });
+    layerProto->set_flags(flags);
+
+    LayerProtoHelper::writeToProtoDeprecated(requestedTransform,
+                                             layerProto->mutable_requested_transform());
+
+    layerProto->set_parent(parent);
+    layerProto->set_z_order_relative_of(zOrderRelativeOf);
+    layerProto->set_is_relative_of(isRelativeOf);
+
+    layerProto->set_owner_uid(ownerUid);
+
+    if (inputWindow) {
+        LayerProtoHelper::writeToProto(inputWindow->info, inputWindow->cropLayerId,
+                                       inputWindow->cropLayerScreenBounds, [&]() {
+                                           return layerProto->mutable_input_window_info();
+                                       });
+    }
+
+    if (metadata) {
+        auto protoMap = layerProto->mutable_metadata();
+        for (const auto& [key, value] : metadata->mMap) {
+            (*protoMap)[static_cast<int32_t>(key)] = std::string(value.cbegin(), value.cend());
+        }
+    }
+
+    LayerProtoHelper::writeToProto(destinationFrame,
+                                   [&]() { return layerProto->mutable_destination_frame(); });
+
+    if (composition) {
+        layerProto->set_hwc_composition_type(
+                static_cast<HwcCompositionType>(composition->compositionType));
+        LayerProtoHelper::writeToProto(composition->visibleRegion,
+                                       [&]() { return layerProto->mutable_visible_region(); });
+    }
+}
+
+void LayersTraceSnapshot::writeToProto(LayersProto& layersProto) const {
+    for (const LayerTraceSnapshot& layer : layers) {
+        layer.writeToProto(layersProto.add_layers());
+    }
+
+    if (!hasOffscreenLayers) {
+        return;
+    }
+
+    // Add a fake invisible root layer to the proto output and parent all the offscreen layers to
+    // it.
+    LayerProto* rootProto = layersProto.add_layers();
+    rootProto->set_id(OFFSCREEN_ROOT_LAYER_ID);
+    rootProto->set_name("Offscreen Root");
+    rootProto->set_parent(-1);
+
+    for (const LayerTraceSnapshot& layer : offscreenLayers) {
+        if (layer.parent == OFFSCREEN_ROOT_LAYER_ID) {
+            rootProto->add_children(layer.id);
+        }
+        layer.writeToProto(layersProto.add_layers());
+    }
+}
+
+} // namespace android
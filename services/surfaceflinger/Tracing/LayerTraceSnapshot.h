@@ -0,0 +1,138 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <gui/LayerMetadata.h>
+#include <gui/WindowInfo.h>
+#include <layerproto/LayerProtoHeader.h>
+#include <math/mat4.h>
+#include <math/vec4.h>
+#include <sys/types.h>
+#include <system/graphics.h>
+#include <ui/FloatRect.h>
+#include <ui/LayerStack.h>
+#include <ui/PixelFormat.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+#include <ui/Transform.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace android::surfaceflinger;
+
+namespace android {
+
+/*
+ * Copy of the layer state written to a LayerProto.
+ *
+ * Taking the snapshot on the main thread only copies the values, and the regions share their rects
+ * with the layer until either side changes them. Building the proto, including the string
+ * conversions, is left to the thread that calls writeToProto.
+ */
+struct LayerTraceSnapshot {
+    struct ActiveBuffer {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint64_t usage = 0;
+        PixelFormat format = PIXEL_FORMAT_NONE;
+        uint32_t transform = 0;
+    };
+
+    struct InputWindow {
+        gui::WindowInfo info;
+        // Id and screen bounds of the touchable region crop layer, if any.
+        std::optional<int32_t> cropLayerId;
+        Rect cropLayerScreenBounds;
+    };
+
+    struct Composition {
+        int32_t compositionType = 0;
+        Region visibleRegion;
+    };
+
+    // Drawing state.
+    std::optional<ActiveBuffer> activeBuffer;
+    bool invalidate = false;
+    bool isProtected = false;
+    android_dataspace dataspace = HAL_DATASPACE_UNKNOWN;
+    int32_t queuedFrames = 0;
+    uint64_t currFrame = 0;
+    uint32_t effectiveScalingMode = 0;
+    float requestedCornerRadius = 0.f;
+    float cornerRadius = 0.f;
+    int32_t backgroundBlurRadius = 0;
+    bool isTrustedOverlay = false;
+    ui::Transform transform;
+    FloatRect bounds;
+    Region damageRegion;
+    std::optional<mat4> colorTransform;
+    FloatRect sourceBounds;
+    FloatRect screenBounds;
+    FloatRect cornerRadiusCrop;
+    float shadowRadius = 0.f;
+
+    // Common state.
+    int32_t id = 0;
+    std::string name;
+    const char* type = "";
+    std::vector<int32_t> children;
+    std::vector<int32_t> relatives;
+    Region transparentRegion;
+    ui::LayerStack layerStack;
+    int32_t z = 0;
+    ui::Transform requestedTransform;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    Rect crop;
+    bool isOpaque = false;
+    PixelFormat pixelFormat = PIXEL_FORMAT_NONE;
+    half4 color;
+    half4 requestedColor;
+    uint32_t flags = 0;
+    int32_t parent = -1;
+    int32_t zOrderRelativeOf = -1;
+    bool isRelativeOf = false;
+    uid_t ownerUid = 0;
+    std::optional<InputWindow> inputWindow;
+    std::optional<LayerMetadata> metadata;
+    Rect destinationFrame;
+
+    // Only taken for the primary display, and only if composition state is traced.
+    std::optional<Composition> composition;
+
+    void writeToProto(LayerProto* layerProto) const;
+};
+
+/*
+ * Snapshots of the layers of one trace entry, in the order they are written to the LayersProto.
+ */
+struct LayersTraceSnapshot {
+    // Id of the fake root which the offscreen layers are parented to in the proto.
+    static constexpr int32_t OFFSCREEN_ROOT_LAYER_ID = INT32_MAX - 2;
+
+    std::vector<LayerTraceSnapshot> layers;
+    // The roots of the offscreen hierarchies have OFFSCREEN_ROOT_LAYER_ID as parent.
+    std::vector<LayerTraceSnapshot> offscreenLayers;
+    bool hasOffscreenLayers = false;
+
+    void writeToProto(LayersProto& layersProto) const;
+};
+
+} // namespace android
@@ -24,23 +24,37 @@
 #include <utils/SystemClock.h>
 #include <utils/Trace.h>
 
+#include "LayerTraceBuffer.h"
 #include "LayerTracing.h"
-#include "RingBuffer.h"
 
 namespace android {
 
 LayerTracing::LayerTracing(SurfaceFlinger& flinger) : mFlinger(flinger) {
-    mBuffer = std::make_unique<RingBuffer<LayersTraceFileProto, LayersTraceProto>>();
+    mBuffer = std::make_unique<LayerTraceBuffer>();
 }
 
-LayerTracing::~LayerTracing() = default;
+LayerTracing::~LayerTracing() {
+    std::scoped_lock lock(mTraceLock);
+    stopThreadLocked();
+}
 
 bool LayerTracing::enable() {
     std::scoped_lock lock(mTraceLock);
     if (mEnabled) {
         return false;
     }
-    mBuffer->setSize(mBufferSizeInBytes);
+    {
+        std::scoped_lock bufferLock(mBufferLock);
+        mBuffer->setSize(mBufferSizeInBytes);
+    }
+    {
+        std::scoped_lock pendingLock(mPendingLock);
+        mDone = false;
+        mMissedEntries = 0;
+    }
+    mCaptureTime = 0;
+    mCaptureCount = 0;
+    mThread = std::thread(&LayerTracing::loop, this);
     mEnabled = true;
     return true;
 }
@@ -51,6 +65,10 @@ bool LayerTracing::disable(std::string filename) {
         return false;
     }
     mEnabled = false;
+    stopThreadLocked();
+
+    std::scoped_lock bufferLock(mBufferLock);
+    addPendingEntriesToBufferLocked();
     LayersTraceFileProto fileProto = createTraceFileProto();
     mBuffer->writeToFile(fileProto, filename);
     mBuffer->reset();
@@ -67,6 +85,8 @@ status_t LayerTracing::writeToFile() {
     if (!mEnabled) {
         return STATUS_OK;
     }
+    std::scoped_lock bufferLock(mBufferLock);
+    addPendingEntriesToBufferLocked();
     LayersTraceFileProto fileProto = createTraceFileProto();
     return mBuffer->writeToFile(fileProto, FILE_NAME);
 }
@@ -95,6 +115,11 @@ LayersTraceFileProto LayerTracing::createTraceFileProto() const {
 void LayerTracing::dump(std::string& result) const {
     std::scoped_lock lock(mTraceLock);
     base::StringAppendF(&result, "Tracing state: %s\n", mEnabled ? "enabled" : "disabled");
+    if (mCaptureCount > 0) {
+        base::StringAppendF(&result, "  main thread capture time: %.3fms per entry\n",
+                            static_cast<float>(mCaptureTime) / mCaptureCount / 1e6f);
+    }
+    std::scoped_lock bufferLock(mBufferLock);
     mBuffer->dump(result);
 }
 
@@ -109,16 +134,18 @@ void LayerTracing::notify(bool visibleRegionDirty, int64_t time) {
     }
 
     ATRACE_CALL();
-    LayersTraceProto entry;
+    const nsecs_t captureStart = systemTime();
+    PendingEntry pendingEntry;
+    LayersTraceProto& entry = pendingEntry.entry;
     entry.set_elapsed_realtime_nanos(time);
     const char* where = visibleRegionDirty ? "visibleRegionsDirty" : "bufferLatched";
     entry.set_where(where);
-    LayersProto layers(mFlinger.dumpDrawingStateProto(mFlags));
+    // The layers proto is built by the tracing thread.
+    mFlinger.takeDrawingStateTraceSnapshot(pendingEntry.layers, mFlags);
 
     if (flagIsSet(LayerTracing::TRACE_EXTRA)) {
-        mFlinger.dumpOffscreenLayersProto(layers);
+        mFlinger.takeOffscreenLayersTraceSnapshot(pendingEntry.layers);
     }
-    entry.mutable_layers()->Swap(&layers);
 
     if (flagIsSet(LayerTracing::TRACE_HWC)) {
         std::string hwcDump;
@@ -129,7 +156,63 @@ void LayerTracing::notify(bool visibleRegionDirty, int64_t time) {
         entry.set_excludes_composition_state(true);
     }
     mFlinger.dumpDisplayProto(entry);
-    mBuffer->emplace(std::move(entry));
+
+    {
+        std::scoped_lock pendingLock(mPendingLock);
+        if (mPendingEntries.size() < MAX_PENDING_ENTRIES) {
+            entry.set_missed_entries(mMissedEntries);
+            mMissedEntries = 0;
+            mPendingEntries.emplace_back(std::move(pendingEntry));
+        } else {
+            mMissedEntries++;
+        }
+    }
+    mPendingEntriesCv.notify_one();
+
+    mCaptureTime += systemTime() - captureStart;
+    mCaptureCount++;
+}
+
+void LayerTracing::loop() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mPendingLock);
+            base::ScopedLockAssertion assumeLocked(mPendingLock);
+            mPendingEntriesCv.wait(lock, [&]() REQUIRES(mPendingLock) {
+                return mDone || !mPendingEntries.empty();
+            });
+            if (mDone) {
+                // The remaining entries are added by whoever stopped the thread.
+                break;
+            }
+        } // unlock mPendingLock
+
+        std::scoped_lock lock(mBufferLock);
+        addPendingEntriesToBufferLocked();
+    }
+}
+
+void LayerTracing::stopThreadLocked() {
+    {
+        std::scoped_lock lock(mPendingLock);
+        mDone = true;
+    }
+    mPendingEntriesCv.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+void LayerTracing::addPendingEntriesToBufferLocked() {
+    std::vector<PendingEntry> entries;
+    {
+        std::scoped_lock lock(mPendingLock);
+        entries.swap(mPendingEntries);
+    }
+    for (PendingEntry& pendingEntry : entries) {
+        pendingEntry.layers.writeToProto(*pendingEntry.entry.mutable_layers());
+        mBuffer->emplace(std::move(pendingEntry.entry));
+    }
 }
 
 } // namespace android
@@ -22,21 +22,28 @@
 #include <utils/StrongPointer.h>
 #include <utils/Timers.h>
 
+#include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
+
+#include "LayerTraceSnapshot.h"
 
 using namespace android::surfaceflinger;
 
 namespace android {
 
-template <typename FileProto, typename EntryProto>
-class RingBuffer;
-
+class LayerTraceBuffer;
 class SurfaceFlinger;
 
 /*
  * LayerTracing records layer states during surface flinging. Manages tracing state and
  * configuration.
+ *
+ * The main thread only copies the layer state into a LayersTraceSnapshot, since the layers are only
+ * accessible there. The tracing thread builds the LayersProto of each entry from the snapshot,
+ * diffs it against the previous entry and stores it in the buffer.
  */
 class LayerTracing {
 public:
@@ -64,14 +71,38 @@ public:
 
 private:
     static constexpr auto FILE_NAME = "/data/misc/wmtrace/layers_trace.winscope";
+    // Entries captured while this many are waiting for the tracing thread are dropped.
+    static constexpr size_t MAX_PENDING_ENTRIES = 32;
+
+    void loop();
+    void stopThreadLocked() REQUIRES(mTraceLock);
+    void addPendingEntriesToBufferLocked() REQUIRES(mBufferLock) EXCLUDES(mPendingLock);
+
+    // An entry without its layers, and the snapshot the layers are built from.
+    struct PendingEntry {
+        LayersTraceProto entry;
+        LayersTraceSnapshot layers;
+    };
 
     SurfaceFlinger& mFlinger;
     uint32_t mFlags = TRACE_INPUT;
     mutable std::mutex mTraceLock;
     bool mEnabled GUARDED_BY(mTraceLock) = false;
-    std::unique_ptr<RingBuffer<LayersTraceFileProto, LayersTraceProto>> mBuffer
-            GUARDED_BY(mTraceLock);
     size_t mBufferSizeInBytes GUARDED_BY(mTraceLock) = 20 * 1024 * 1024;
+    std::thread mThread GUARDED_BY(mTraceLock);
+
+    // Time spent capturing entries on the main thread.
+    nsecs_t mCaptureTime GUARDED_BY(mTraceLock) = 0;
+    size_t mCaptureCount GUARDED_BY(mTraceLock) = 0;
+
+    mutable std::mutex mBufferLock;
+    std::unique_ptr<LayerTraceBuffer> mBuffer GUARDED_BY(mBufferLock);
+
+    std::mutex mPendingLock;
+    std::condition_variable mPendingEntriesCv;
+    std::vector<PendingEntry> mPendingEntries GUARDED_BY(mPendingLock);
+    uint32_t mMissedEntries GUARDED_BY(mPendingLock) = 0;
+    bool mDone GUARDED_BY(mPendingLock) = false;
 };
 
 } // namespace android
@@ -0,0 +1,286 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "TraceFileRing"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "TraceFileRing.h"
+
+#include <android-base/stringprintf.h>
+#include <android-base/unique_fd.h>
+#include <fcntl.h>
+#include <log/log.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utils/Trace.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cinttypes>
+#include <cstring>
+#include <new>
+
+namespace android {
+
+namespace {
+
+struct FileHeader {
+    uint64_t magicNumber;
+    uint32_t version;
+    uint32_t dataOffset;
+    uint64_t capacity;
+    std::atomic<uint64_t> begin;
+    std::atomic<uint64_t> end;
+    std::atomic<uint64_t> recordCount;
+};
+
+struct RecordHeader {
+    uint32_t size;
+    TraceFileRing::RecordType type;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+// The header is padded to a page so that the records are page aligned.
+constexpr size_t DATA_OFFSET = 4096;
+constexpr uint64_t RECORD_ALIGNMENT = 8;
+
+uint64_t recordSize(uint64_t dataSize) {
+    const uint64_t size = sizeof(RecordHeader) + dataSize;
+    return (size + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+}
+
+FileHeader& header(uint8_t* mapping) {
+    return *reinterpret_cast<FileHeader*>(mapping);
+}
+
+} // namespace
+
+TraceFileRing::~TraceFileRing() {
+    close();
+}
+
+status_t TraceFileRing::open(const std::string& filename, size_t sizeInBytes) {
+    close();
+
+    const uint64_t capacity = sizeInBytes & ~(RECORD_ALIGNMENT - 1);
+    if (capacity == 0) {
+        return BAD_VALUE;
+    }
+
+    // -rw-r--r--
+    const mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+    base::unique_fd fd(
+            ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW, mode));
+    if (fd < 0) {
+        const int error = errno;
+        ALOGE("Could not open %s: %s", filename.c_str(), strerror(error));
+        return -error;
+    }
+
+    // Allocate the blocks up front, so that writing to the mapping cannot fail later on.
+    const size_t mappingSize = DATA_OFFSET + capacity;
+    if (const int error = posix_fallocate(fd.get(), 0, static_cast<off_t>(mappingSize)); error) {
+        ALOGE("Could not allocate %zu bytes for %s: %s", mappingSize, filename.c_str(),
+              strerror(error));
+        return -error;
+    }
+
+    void* mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (mapping == MAP_FAILED) {
+        const int error = errno;
+        ALOGE("Could not map %s: %s", filename.c_str(), strerror(error));
+        return -error;
+    }
+
+    mFilename = filename;
+    mMapping = static_cast<uint8_t*>(mapping);
+    mMappingSize = mappingSize;
+    mCapacity = capacity;
+
+    FileHeader& h = *new (mMapping) FileHeader();
+    h.magicNumber = MAGIC_NUMBER;
+    h.version = VERSION;
+    h.dataOffset = DATA_OFFSET;
+    h.capacity = capacity;
+    return NO_ERROR;
+}
+
+void TraceFileRing::close() {
+    if (!mMapping) {
+        return;
+    }
+    munmap(mMapping, mMappingSize);
+    mMapping = nullptr;
+    mMappingSize = 0;
+    mCapacity = 0;
+    mFilename.clear();
+}
+
+size_t TraceFileRing::used() const {
+    if (!mMapping) {
+        return 0;
+    }
+    const FileHeader& h = header(mMapping);
+    return static_cast<size_t>(h.end.load(std::memory_order_relaxed) -
+                               h.begin.load(std::memory_order_relaxed));
+}
+
+size_t TraceFileRing::recordCount() const {
+    if (!mMapping) {
+        return 0;
+    }
+    return static_cast<size_t>(header(mMapping).recordCount.load(std::memory_order_relaxed));
+}
+
+status_t TraceFileRing::append(RecordType type, std::string_view data) {
+    if (!mMapping) {
+        return NO_INIT;
+    }
+
+    const uint64_t size = recordSize(data.size());
+    if (size > mCapacity || data.size() > UINT32_MAX) {
+        return BAD_VALUE;
+    }
+
+    FileHeader& h = header(mMapping);
+    uint64_t end = h.end.load(std::memory_order_relaxed);
+    const uint64_t remaining = mCapacity - end % mCapacity;
+    if (remaining < size) {
+        makeRoom(remaining);
+        writeRecord(end, RecordType::PADDING, static_cast<uint32_t>(remaining - recordSize(0)),
+                    nullptr);
+        end += remaining;
+        h.end.store(end, std::memory_order_release);
+    }
+
+    makeRoom(size);
+    writeRecord(end, type, static_cast<uint32_t>(data.size()), data.data());
+    h.recordCount.fetch_add(1, std::memory_order_relaxed);
+    h.end.store(end + size, std::memory_order_release);
+    return NO_ERROR;
+}
+
+void TraceFileRing::writeRecord(uint64_t offset, RecordType type, uint32_t size,
+                                const void* data) {
+    uint8_t* record = mMapping + DATA_OFFSET + offset % mCapacity;
+    if (data) {
+        memcpy(record + sizeof(RecordHeader), data, size);
+    }
+    const RecordHeader recordHeader{size, type};
+    memcpy(record, &recordHeader, sizeof(recordHeader));
+}
+
+void TraceFileRing::makeRoom(uint64_t sizeInBytes) {
+    FileHeader& h = header(mMapping);
+    const uint64_t end = h.end.load(std::memory_order_relaxed);
+    uint64_t begin = h.begin.load(std::memory_order_relaxed);
+    while (mCapacity - (end - begin) < sizeInBytes) {
+        RecordHeader recordHeader;
+        memcpy(&recordHeader, mMapping + DATA_OFFSET + begin % mCapacity, sizeof(recordHeader));
+        begin += recordSize(recordHeader.size);
+        if (recordHeader.type != RecordType::PADDING) {
+            h.recordCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    h.begin.store(begin, std::memory_order_release);
+}
+
+status_t TraceFileRing::sync() {
+    if (!mMapping) {
+        return NO_INIT;
+    }
+    ATRACE_CALL();
+    if (msync(mMapping, mMappingSize, MS_ASYNC) != 0) {
+        const int error = errno;
+        ALOGE("Could not sync %s: %s", mFilename.c_str(), strerror(error));
+        return -error;
+    }
+    return NO_ERROR;
+}
+
+void TraceFileRing::dump(std::string& result) const {
+    base::StringAppendF(&result, "  streaming to %s: %zu records (%.2fMB / %.2fMB)\n",
+                        mFilename.c_str(), recordCount(), float(used()) / (1024.f * 1024.f),
+                        float(size()) / (1024.f * 1024.f));
+}
+
+bool TraceFileRing::isTraceFileRing(const std::string& filename) {
+    base::unique_fd fd(::open(filename.c_str(), O_RDONLY | O_CLOEXEC));
+    uint64_t magicNumber = 0;
+    return fd >= 0 && pread(fd.get(), &magicNumber, sizeof(magicNumber), 0) ==
+            static_cast<ssize_t>(sizeof(magicNumber)) &&
+            magicNumber == MAGIC_NUMBER;
+}
+
+status_t TraceFileRing::read(const std::string& filename, const Visitor& visitor) {
+    base::unique_fd fd(::open(filename.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd < 0) {
+        return -errno;
+    }
+    struct stat st;
+    if (fstat(fd.get(), &st) != 0) {
+        return -errno;
+    }
+    const size_t fileSize = static_cast<size_t>(st.st_size);
+    if (fileSize < DATA_OFFSET) {
+        return BAD_VALUE;
+    }
+
+    void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+    if (mapping == MAP_FAILED) {
+        return -errno;
+    }
+    const uint8_t* const bytes = static_cast<const uint8_t*>(mapping);
+
+    const FileHeader& h = *reinterpret_cast<const FileHeader*>(bytes);
+    const uint64_t capacity = h.capacity;
+    const uint64_t begin = h.begin.load(std::memory_order_acquire);
+    const uint64_t end = h.end.load(std::memory_order_acquire);
+    status_t status = NO_ERROR;
+    if (h.magicNumber != MAGIC_NUMBER || h.version != VERSION) {
+        status = BAD_TYPE;
+    } else if (h.dataOffset != DATA_OFFSET || capacity != fileSize - DATA_OFFSET ||
+               capacity % RECORD_ALIGNMENT != 0 || begin > end || end - begin > capacity ||
+               begin % RECORD_ALIGNMENT != 0) {
+        status = BAD_VALUE;
+    }
+
+    for (uint64_t offset = begin; status == NO_ERROR && offset < end;) {
+        const uint8_t* record = bytes + DATA_OFFSET + offset % capacity;
+        RecordHeader recordHeader;
+        memcpy(&recordHeader, record, sizeof(recordHeader));
+        const uint64_t size = recordSize(recordHeader.size);
+        if (size > end - offset || size > capacity - offset % capacity) {
+            ALOGE("Record at offset %" PRIu64 " of %s is truncated", offset, filename.c_str());
+            status = BAD_VALUE;
+            break;
+        }
+        if (recordHeader.type != RecordType::PADDING) {
+            visitor(recordHeader.type,
+                    std::string_view(reinterpret_cast<const char*>(record + sizeof(RecordHeader)),
+                                     recordHeader.size));
+        }
+        offset += size;
+    }
+
+    munmap(mapping, fileSize);
+    return status;
+}
+
+} // namespace android
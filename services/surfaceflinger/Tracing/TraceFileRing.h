@@ -0,0 +1,99 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utils/Errors.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace android {
+
+/*
+ * Ring of length-delimited records in a preallocated, memory-mapped file.
+ *
+ * Records are appended in place, so the file is always up to date and can be pulled from the
+ * device at any time without serializing anything. When the ring is full, the oldest records
+ * are overwritten. A record never wraps around the end of the ring; the space left at the end
+ * is filled with padding instead.
+ *
+ * The file starts with a page-sized header that holds the logical offsets of the oldest record
+ * and of the end of the newest one. The offsets only grow, and are taken modulo the capacity to
+ * locate records. The oldest offset is advanced before a record is overwritten, and the end
+ * offset after a record is written, so that a file left behind by a crash is still readable.
+ */
+class TraceFileRing {
+public:
+    enum class RecordType : uint32_t {
+        PADDING = 0,
+        ENTRY = 1,
+        SNAPSHOT = 2,
+    };
+
+    // "SFTRRING" in little-endian ASCII.
+    static constexpr uint64_t MAGIC_NUMBER = 0x474E495252544653;
+    static constexpr uint32_t VERSION = 1;
+
+    TraceFileRing() = default;
+    ~TraceFileRing();
+
+    TraceFileRing(const TraceFileRing&) = delete;
+    TraceFileRing& operator=(const TraceFileRing&) = delete;
+
+    // Creates or truncates the file, and allocates room for records of up to sizeInBytes bytes in
+    // total. The size is rounded down to the record alignment.
+    status_t open(const std::string& filename, size_t sizeInBytes);
+    void close();
+    bool isOpen() const { return mMapping != nullptr; }
+
+    size_t size() const { return mCapacity; }
+    size_t used() const;
+    size_t recordCount() const;
+    const std::string& filename() const { return mFilename; }
+
+    // Appends a record, overwriting the oldest records if needed. Returns BAD_VALUE if the record
+    // is larger than the ring.
+    status_t append(RecordType, std::string_view data);
+
+    // Starts writing back the dirty pages of the file. Readers of the file see the records as
+    // soon as they are appended, so this is only needed to persist them.
+    status_t sync();
+
+    void dump(std::string& result) const;
+
+    // Returns whether the file starts with the magic number of a ring.
+    static bool isTraceFileRing(const std::string& filename);
+
+    // Calls the visitor with each record from the oldest to the newest, skipping padding. The
+    // data is only valid for the duration of the call.
+    using Visitor = std::function<void(RecordType, std::string_view data)>;
+    static status_t read(const std::string& filename, const Visitor& visitor);
+
+private:
+    void writeRecord(uint64_t offset, RecordType, uint32_t size, const void* data);
+    void makeRoom(uint64_t sizeInBytes);
+
+    std::string mFilename;
+    uint8_t* mMapping = nullptr;
+    size_t mMappingSize = 0;
+    uint64_t mCapacity = 0;
+};
+
+} // namespace android
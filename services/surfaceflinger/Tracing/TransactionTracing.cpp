@@ -119,6 +119,9 @@ TransactionTracing::~TransactionTracing() {
 
 status_t TransactionTracing::writeToFile(std::string filename) {
     std::scoped_lock lock(mTraceLock);
+    if (mStreamingFile.isOpen()) {
+        return mStreamingFile.sync();
+    }
     proto::TransactionTraceFile fileProto = createTraceFileProto();
     addStartingStateToProtoLocked(fileProto);
     return mBuffer.writeToFile(fileProto, filename);
@@ -130,6 +133,25 @@ void TransactionTracing::setBufferSize(size_t bufferSizeInBytes) {
     mBuffer.setSize(mBufferSizeInBytes);
 }
 
+status_t TransactionTracing::enableStreaming(const std::string& filename, size_t sizeInBytes) {
+    std::scoped_lock lock(mTraceLock);
+    if (status_t status = mStreamingFile.open(filename, sizeInBytes); status != NO_ERROR) {
+        ALOGE("Could not enable transaction trace streaming to %s", filename.c_str());
+        return status;
+    }
+
+    proto::TransactionTraceFile bufferProto;
+    mBuffer.writeToProto(bufferProto);
+    mBuffer.reset();
+    mStreamingStates = std::move(mStartingStates);
+    mStartingStates.clear();
+    for (const proto::TransactionTraceEntry& entry : bufferProto.entry()) {
+        mergeEntryLocked(entry, mStreamingStates);
+    }
+    writeSnapshotLocked(systemTime());
+    return NO_ERROR;
+}
+
 proto::TransactionTraceFile TransactionTracing::createTraceFileProto() const {
     proto::TransactionTraceFile proto;
     proto.set_magic_number(uint64_t(proto::TransactionTraceFile_MagicNumber_MAGIC_NUMBER_H) << 32 |
@@ -143,7 +165,11 @@ void TransactionTracing::dump(std::string& result) const {
                         "  queued transactions=%zu created layers=%zu handles=%zu states=%zu\n",
                         mQueuedTransactions.size(), mCreatedLayers.size(), mLayerHandles.size(),
                         mStartingStates.size());
-    mBuffer.dump(result);
+    if (mStreamingFile.isOpen()) {
+        mStreamingFile.dump(result);
+    } else {
+        mBuffer.dump(result);
+    }
 }
 
 void TransactionTracing::addQueuedTransaction(const TransactionState& transaction) {
@@ -258,11 +284,16 @@ void TransactionTracing::addEntry(const std::vector<CommittedTransactions>& comm
 
         std::string serializedProto;
         entryProto.SerializeToString(&serializedProto);
+        if (mStreamingFile.isOpen()) {
+            streamEntryLocked(entryProto, serializedProto);
+        } else {
+            std::vector<std::string> entries = mBuffer.emplace(std::move(serializedProto));
+            removedEntries.reserve(removedEntries.size() + entries.size());
+            removedEntries.insert(removedEntries.end(), std::make_move_iterator(entries.begin()),
+                                  std::make_move_iterator(entries.end()));
+        }
         entryProto.Clear();
-        std::vector<std::string> entries = mBuffer.emplace(std::move(serializedProto));
-        removedEntries.reserve(removedEntries.size() + entries.size());
-        removedEntries.insert(removedEntries.end(), std::make_move_iterator(entries.begin()),
-                              std::make_move_iterator(entries.end()));
+        mLastVsyncId = entry.vsyncId;
 
         entryProto.mutable_removed_layer_handles()->Reserve(
                 static_cast<int32_t>(mRemovedLayerHandles.size()));
@@ -288,11 +319,7 @@ void TransactionTracing::flush(int64_t vsyncId) {
     std::unique_lock<std::mutex> lock(mTraceLock);
     base::ScopedLockAssertion assumeLocked(mTraceLock);
     mTransactionsAddedToBufferCv.wait(lock, [&]() REQUIRES(mTraceLock) {
-        proto::TransactionTraceEntry entry;
-        if (mBuffer.used() > 0) {
-            entry.ParseFromString(mBuffer.back());
-        }
-        return mBuffer.used() > 0 && entry.vsync_id() >= vsyncId;
+        return mLastVsyncId >= vsyncId;
     });
 }
 
@@ -358,17 +385,22 @@ void TransactionTracing::updateStartingStateLocked(
     mStartingTimestamp = removedEntry.elapsed_realtime_nanos();
     // Keep track of layer starting state so we can reconstruct the layer state as we purge
     // transactions from the buffer.
-    for (const proto::LayerCreationArgs& addedLayer : removedEntry.added_layers()) {
-        TracingLayerState& startingState = mStartingStates[addedLayer.layer_id()];
-        startingState.layerId = addedLayer.layer_id();
-        mProtoParser.fromProto(addedLayer, startingState.args);
+    mergeEntryLocked(removedEntry, mStartingStates);
+}
+
+void TransactionTracing::mergeEntryLocked(const proto::TransactionTraceEntry& entry,
+                                          std::map<int32_t, TracingLayerState>& states) {
+    for (const proto::LayerCreationArgs& addedLayer : entry.added_layers()) {
+        TracingLayerState& state = states[addedLayer.layer_id()];
+        state.layerId = addedLayer.layer_id();
+        mProtoParser.fromProto(addedLayer, state.args);
     }
 
     // Merge layer states to starting transaction state.
-    for (const proto::TransactionState& transaction : removedEntry.transactions()) {
+    for (const proto::TransactionState& transaction : entry.transactions()) {
         for (const proto::LayerState& layerState : transaction.layer_changes()) {
-            auto it = mStartingStates.find((int32_t)layerState.layer_id());
-            if (it == mStartingStates.end()) {
+            auto it = states.find((int32_t)layerState.layer_id());
+            if (it == states.end()) {
                 ALOGW("Could not find layer id %d", (int32_t)layerState.layer_id());
                 continue;
             }
@@ -378,8 +410,8 @@ void TransactionTracing::updateStartingStateLocked(
 
     // Clean up stale starting states since the layer has been removed and the buffer does not
     // contain any references to the layer.
-    for (const int32_t removedLayerId : removedEntry.removed_layers()) {
-        mStartingStates.erase(removedLayerId);
+    for (const int32_t removedLayerId : entry.removed_layers()) {
+        states.erase(removedLayerId);
     }
 }
 
@@ -388,19 +420,52 @@ void TransactionTracing::addStartingStateToProtoLocked(proto::TransactionTraceFi
         return;
     }
 
-    proto::TransactionTraceEntry* entryProto = proto.add_entry();
-    entryProto->set_elapsed_realtime_nanos(mStartingTimestamp);
-    entryProto->set_vsync_id(0);
+    *proto.add_entry() = createStateEntryLocked(mStartingStates, mStartingTimestamp);
+}
+
+proto::TransactionTraceEntry TransactionTracing::createStateEntryLocked(
+        const std::map<int32_t, TracingLayerState>& states, nsecs_t timestamp) {
+    proto::TransactionTraceEntry entryProto;
+    entryProto.set_elapsed_realtime_nanos(timestamp);
+    entryProto.set_vsync_id(0);
 
-    entryProto->mutable_added_layers()->Reserve(static_cast<int32_t>(mStartingStates.size()));
-    for (auto& [layerId, state] : mStartingStates) {
-        entryProto->mutable_added_layers()->Add(mProtoParser.toProto(state.args));
+    entryProto.mutable_added_layers()->Reserve(static_cast<int32_t>(states.size()));
+    for (auto& [layerId, state] : states) {
+        entryProto.mutable_added_layers()->Add(mProtoParser.toProto(state.args));
     }
 
-    proto::TransactionState transactionProto = mProtoParser.toProto(mStartingStates);
+    proto::TransactionState transactionProto = mProtoParser.toProto(states);
     transactionProto.set_vsync_id(0);
-    transactionProto.set_post_time(mStartingTimestamp);
-    entryProto->mutable_transactions()->Add(std::move(transactionProto));
+    transactionProto.set_post_time(timestamp);
+    entryProto.mutable_transactions()->Add(std::move(transactionProto));
+    return entryProto;
+}
+
+void TransactionTracing::streamEntryLocked(const proto::TransactionTraceEntry& entry,
+                                           const std::string& serializedEntry) {
+    if (mBytesSinceSnapshot >= mStreamingFile.size() / STREAMING_SNAPSHOT_FRACTION) {
+        writeSnapshotLocked(entry.elapsed_realtime_nanos());
+    }
+
+    if (status_t status = mStreamingFile.append(TraceFileRing::RecordType::ENTRY, serializedEntry);
+        status != NO_ERROR) {
+        ALOGW("Could not stream transaction trace entry of %zu bytes", serializedEntry.size());
+    }
+    mBytesSinceSnapshot += serializedEntry.size();
+    mergeEntryLocked(entry, mStreamingStates);
+}
+
+void TransactionTracing::writeSnapshotLocked(nsecs_t timestamp) {
+    ATRACE_CALL();
+    std::string serializedSnapshot;
+    createStateEntryLocked(mStreamingStates, timestamp).SerializeToString(&serializedSnapshot);
+    if (status_t status =
+                mStreamingFile.append(TraceFileRing::RecordType::SNAPSHOT, serializedSnapshot);
+        status != NO_ERROR) {
+        ALOGW("Could not stream transaction trace snapshot of %zu bytes",
+              serializedSnapshot.size());
+    }
+    mBytesSinceSnapshot = 0;
 }
 
 proto::TransactionTraceFile TransactionTracing::writeToProto() {
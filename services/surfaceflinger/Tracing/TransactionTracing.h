@@ -27,6 +27,7 @@
 
 #include "RingBuffer.h"
 #include "LocklessStack.h"
+#include "TraceFileRing.h"
 #include "TransactionProtoParser.h"
 
 using namespace android::surfaceflinger;
@@ -48,6 +49,12 @@ class TransactionTracingTest;
  * When generating SF dump state, we will flush the buffer to a file which
  * will then be included in the bugreport.
  *
+ * In streaming mode, entries are appended to a memory-mapped file ring instead
+ * of the buffer, along with periodic snapshots of the layer states. The file is
+ * always up to date, so there is nothing to flush, and the trace can run for
+ * as long as needed in bounded memory. Tracing/tools reconstructs a regular
+ * trace from the file.
+ *
  */
 class TransactionTracing {
 public:
@@ -56,8 +63,12 @@ public:
 
     void addQueuedTransaction(const TransactionState&);
     void addCommittedTransactions(std::vector<TransactionState>& transactions, int64_t vsyncId);
+    // In streaming mode, the filename is ignored and the streaming file is synced instead.
     status_t writeToFile(std::string filename = FILE_NAME);
     void setBufferSize(size_t bufferSizeInBytes);
+    // Switches to streaming mode. The entries in the buffer are folded into the first snapshot.
+    status_t enableStreaming(const std::string& filename = STREAMING_FILE_NAME,
+                             size_t sizeInBytes = STREAMING_FILE_SIZE);
     void onLayerAdded(BBinder* layerHandle, int layerId, const std::string& name, uint32_t flags,
                       int parentId);
     void onMirrorLayerAdded(BBinder* layerHandle, int layerId, const std::string& name,
@@ -67,11 +78,16 @@ public:
     void dump(std::string&) const;
     static constexpr auto CONTINUOUS_TRACING_BUFFER_SIZE = 512 * 1024;
     static constexpr auto ACTIVE_TRACING_BUFFER_SIZE = 100 * 1024 * 1024;
+    static constexpr auto STREAMING_FILE_SIZE = 64 * 1024 * 1024;
 
 private:
     friend class TransactionTracingTest;
 
     static constexpr auto FILE_NAME = "/data/misc/wmtrace/transactions_trace.winscope";
+    static constexpr auto STREAMING_FILE_NAME = "/data/misc/wmtrace/transactions_trace.ring";
+    // A snapshot is written whenever entries filling this fraction of the streaming file have
+    // been written since the last one, so that the file always holds a snapshot to start from.
+    static constexpr size_t STREAMING_SNAPSHOT_FRACTION = 4;
 
     mutable std::mutex mTraceLock;
     RingBuffer<proto::TransactionTraceFile, proto::TransactionTraceEntry> mBuffer
@@ -86,6 +102,12 @@ private:
             GUARDED_BY(mTraceLock);
     std::vector<int32_t /* layerId */> mRemovedLayerHandles GUARDED_BY(mTraceLock);
     std::map<int32_t /* layerId */, TracingLayerState> mStartingStates GUARDED_BY(mTraceLock);
+    int64_t mLastVsyncId GUARDED_BY(mTraceLock) = -1;
+
+    TraceFileRing mStreamingFile GUARDED_BY(mTraceLock);
+    // Layer states after the last entry written to the streaming file.
+    std::map<int32_t /* layerId */, TracingLayerState> mStreamingStates GUARDED_BY(mTraceLock);
+    size_t mBytesSinceSnapshot GUARDED_BY(mTraceLock) = 0;
     TransactionProtoParser mProtoParser GUARDED_BY(mTraceLock);
     // Parses the transaction to proto without holding any tracing locks so we can generate proto
     // in the binder thread without any contention.
@@ -117,6 +139,14 @@ private:
     void tryPushToTracingThread() EXCLUDES(mMainThreadLock);
     void addStartingStateToProtoLocked(proto::TransactionTraceFile& proto) REQUIRES(mTraceLock);
     void updateStartingStateLocked(const proto::TransactionTraceEntry& entry) REQUIRES(mTraceLock);
+    void mergeEntryLocked(const proto::TransactionTraceEntry& entry,
+                          std::map<int32_t, TracingLayerState>& states) REQUIRES(mTraceLock);
+    proto::TransactionTraceEntry createStateEntryLocked(
+            const std::map<int32_t, TracingLayerState>& states, nsecs_t timestamp)
+            REQUIRES(mTraceLock);
+    void streamEntryLocked(const proto::TransactionTraceEntry& entry,
+                           const std::string& serializedEntry) REQUIRES(mTraceLock);
+    void writeSnapshotLocked(nsecs_t timestamp) REQUIRES(mTraceLock);
 
     // TEST
     // Wait until all the committed transactions for the specified vsync id are added to the buffer.
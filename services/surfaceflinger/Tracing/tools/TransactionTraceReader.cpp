@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "TransactionTraceReader"
+
+#include <Tracing/TraceFileRing.h>
+#include <log/log.h>
+
+#include "TransactionTraceReader.h"
+
+namespace android {
+
+bool TransactionTraceReader::read(const char* streamingTracePath,
+                                  proto::TransactionTraceFile& outTraceFile) {
+    outTraceFile.Clear();
+    outTraceFile.set_magic_number(
+            uint64_t(proto::TransactionTraceFile_MagicNumber_MAGIC_NUMBER_H) << 32 |
+            proto::TransactionTraceFile_MagicNumber_MAGIC_NUMBER_L);
+
+    bool foundSnapshot = false;
+    size_t skippedEntries = 0;
+    bool parsed = true;
+    const auto visitor = [&](TraceFileRing::RecordType type, std::string_view record) {
+        if (type == TraceFileRing::RecordType::SNAPSHOT) {
+            // Later snapshots only repeat the state that the entries before them lead to.
+            if (foundSnapshot) {
+                return;
+            }
+            foundSnapshot = true;
+        } else if (!foundSnapshot) {
+            // The state that these entries apply to has been overwritten.
+            skippedEntries++;
+            return;
+        }
+        parsed &= outTraceFile.add_entry()->ParseFromArray(record.data(),
+                                                           static_cast<int>(record.size()));
+    };
+    const status_t status = TraceFileRing::read(streamingTracePath, visitor);
+    if (status != NO_ERROR) {
+        ALOGE("Could not read %s: %d", streamingTracePath, status);
+        return false;
+    }
+    if (!parsed || !foundSnapshot) {
+        ALOGE("%s does not contain a valid snapshot", streamingTracePath);
+        return false;
+    }
+    ALOGD("Read %d entries, skipped %zu entries before the first snapshot",
+          outTraceFile.entry_size(), skippedEntries);
+    return true;
+}
+
+} // namespace android
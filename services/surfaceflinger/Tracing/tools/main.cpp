@@ -21,7 +21,10 @@
 #include <iostream>
 #include <string>
 
+#include <Tracing/TraceFileRing.h>
+
 #include "LayerTraceGenerator.h"
+#include "TransactionTraceReader.h"
 
 using namespace android;
 
@@ -35,16 +38,23 @@ int main(int argc, char** argv) {
     const char* transactionTracePath =
             (argc > 1) ? argv[1] : "/data/misc/wmtrace/transactions_trace.winscope";
     std::cout << "Parsing " << transactionTracePath << "\n";
-    std::fstream input(transactionTracePath, std::ios::in | std::ios::binary);
-    if (!input) {
-        std::cout << "Error: Could not open " << transactionTracePath;
-        return -1;
-    }
-
     proto::TransactionTraceFile transactionTraceFile;
-    if (!transactionTraceFile.ParseFromIstream(&input)) {
-        std::cout << "Error: Failed to parse " << transactionTracePath;
-        return -1;
+    if (TraceFileRing::isTraceFileRing(transactionTracePath)) {
+        if (!TransactionTraceReader().read(transactionTracePath, transactionTraceFile)) {
+            std::cout << "Error: Failed to read streaming trace " << transactionTracePath;
+            return -1;
+        }
+    } else {
+        std::fstream input(transactionTracePath, std::ios::in | std::ios::binary);
+        if (!input) {
+            std::cout << "Error: Could not open " << transactionTracePath;
+            return -1;
+        }
+
+        if (!transactionTraceFile.ParseFromIstream(&input)) {
+            std::cout << "Error: Failed to parse " << transactionTracePath;
+            return -1;
+        }
     }
 
     const char* outputLayersTracePath =
@@ -14,9 +14,14 @@
  * limitations under the License.
  */
 #include <android-base/stringprintf.h>
+#include <google/protobuf/arena.h>
 #include <layerproto/LayerProtoParser.h>
 #include <ui/DebugUtils.h>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 using android::base::StringAppendF;
 using android::base::StringPrintf;
 
@@ -122,6 +127,7 @@ LayerProtoParser::Layer LayerProtoParser::generateLayer(const LayerProto& layerP
 
 LayerProtoParser::Region LayerProtoParser::generateRegion(const RegionProto& regionProto) {
     LayerProtoParser::Region region;
+    region.rects.reserve(static_cast<size_t>(regionProto.rect_size()));
     for (int i = 0; i < regionProto.rect_size(); i++) {
         const RectProto& rectProto = regionProto.rect(i);
         region.rects.push_back(generateRect(rectProto));
@@ -203,19 +209,20 @@ void LayerProtoParser::updateChildrenAndRelative(const LayerProto& layerProto,
 
 std::string LayerProtoParser::layerTreeToString(const LayerTree& layerTree) {
     std::string result;
+    layerTreeToString(layerTree, result);
+    return result;
+}
+
+void LayerProtoParser::layerTreeToString(const LayerTree& layerTree, std::string& result) {
     for (const LayerProtoParser::Layer* layer : layerTree.topLevelLayers) {
         if (layer->zOrderRelativeOf != nullptr) {
             continue;
         }
-        result.append(layerToString(layer));
+        layerToString(layer, result);
     }
-
-    return result;
 }
 
-std::string LayerProtoParser::layerToString(const LayerProtoParser::Layer* layer) {
-    std::string result;
-
+void LayerProtoParser::layerToString(const LayerProtoParser::Layer* layer, std::string& result) {
     std::vector<Layer*> traverse(layer->relatives);
     for (LayerProtoParser::Layer* child : layer->children) {
         if (child->zOrderRelativeOf != nullptr) {
@@ -233,61 +240,220 @@ std::string LayerProtoParser::layerToString(const LayerProtoParser::Layer* layer
         if (relative->z >= 0) {
             break;
         }
-        result.append(layerToString(relative));
+        layerToString(relative, result);
     }
-    result.append(layer->to_string());
+    layer->appendTo(result);
     result.append("\n");
     for (; i < traverse.size(); i++) {
         auto& relative = traverse[i];
-        result.append(layerToString(relative));
+        layerToString(relative, result);
     }
+}
 
-    return result;
+namespace {
+
+bool readVarint(std::string_view data, size_t& offset, uint64_t& outValue) {
+    outValue = 0;
+    for (int shift = 0; shift < 64 && offset < data.size(); shift += 7) {
+        const auto byte = static_cast<uint8_t>(data[offset++]);
+        outValue |= uint64_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Finds the serialized entries of a LayersTraceFileProto by walking its top-level fields, so that
+// the entries can be parsed independently.
+bool splitTraceEntries(std::string_view traceFile, std::vector<std::string_view>& outEntries) {
+    enum WireType { VARINT = 0, FIXED64 = 1, LENGTH_DELIMITED = 2, FIXED32 = 5 };
+
+    size_t offset = 0;
+    while (offset < traceFile.size()) {
+        uint64_t tag;
+        if (!readVarint(traceFile, offset, tag)) {
+            return false;
+        }
+
+        uint64_t length;
+        switch (tag & 0x7) {
+            case VARINT:
+                if (!readVarint(traceFile, offset, length)) {
+                    return false;
+                }
+                length = 0;
+                break;
+            case FIXED64:
+                length = 8;
+                break;
+            case LENGTH_DELIMITED:
+                if (!readVarint(traceFile, offset, length)) {
+                    return false;
+                }
+                break;
+            case FIXED32:
+                length = 4;
+                break;
+            default:
+                return false;
+        }
+        if (length > traceFile.size() - offset) {
+            return false;
+        }
+
+        if ((tag >> 3) == LayersTraceFileProto::kEntryFieldNumber &&
+            (tag & 0x7) == LENGTH_DELIMITED) {
+            outEntries.push_back(traceFile.substr(offset, length));
+        }
+        offset += length;
+    }
+    return true;
+}
+
+} // namespace
+
+bool LayerProtoParser::generateTraceEntries(std::string_view serializedTraceFile,
+                                            std::vector<TraceEntry>& outEntries,
+                                            size_t threadCount) {
+    std::vector<std::string_view> serializedEntries;
+    if (!splitTraceEntries(serializedTraceFile, serializedEntries)) {
+        return false;
+    }
+
+    outEntries.clear();
+    outEntries.resize(serializedEntries.size());
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    threadCount = std::min(threadCount, serializedEntries.size());
+
+    // The entries are handed out one at a time, since their sizes vary a lot.
+    std::atomic<size_t> nextEntry = 0;
+    std::atomic<bool> failed = false;
+    const auto decodeEntries = [&] {
+        // Entries typically fit in the initial block, which is reused for every entry.
+        constexpr size_t kInitialBlockSize = 256 * 1024;
+        std::unique_ptr<char[]> initialBlock(new char[kInitialBlockSize]);
+        google::protobuf::ArenaOptions options;
+        options.initial_block = initialBlock.get();
+        options.initial_block_size = kInitialBlockSize;
+        google::protobuf::Arena arena(options);
+
+        size_t i;
+        while ((i = nextEntry.fetch_add(1, std::memory_order_relaxed)) < serializedEntries.size()) {
+            auto* entryProto = google::protobuf::Arena::CreateMessage<LayersTraceProto>(&arena);
+            const std::string_view serializedEntry = serializedEntries[i];
+            if (!entryProto->ParseFromArray(serializedEntry.data(),
+                                            static_cast<int>(serializedEntry.size()))) {
+                failed = true;
+                return;
+            }
+
+            TraceEntry& entry = outEntries[i];
+            entry.elapsedRealtimeNanos = entryProto->elapsed_realtime_nanos();
+            entry.where = entryProto->where();
+            entry.layerTree = generateLayerTree(entryProto->layers());
+            arena.Reset();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount > 0 ? threadCount - 1 : 0);
+    for (size_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(decodeEntries);
+    }
+    decodeEntries();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    if (failed) {
+        outEntries.clear();
+        return false;
+    }
+    return true;
 }
 
 std::string LayerProtoParser::ActiveBuffer::to_string() const {
-    return StringPrintf("[%4ux%4u:%4u,%s]", width, height, stride,
-                        decodePixelFormat(format).c_str());
+    std::string result;
+    appendTo(result);
+    return result;
+}
+
+void LayerProtoParser::ActiveBuffer::appendTo(std::string& result) const {
+    StringAppendF(&result, "[%4ux%4u:%4u,%s]", width, height, stride,
+                  decodePixelFormat(format).c_str());
 }
 
 std::string LayerProtoParser::Transform::to_string() const {
-    return StringPrintf("[%.2f, %.2f][%.2f, %.2f]", static_cast<double>(dsdx),
-                        static_cast<double>(dtdx), static_cast<double>(dsdy),
-                        static_cast<double>(dtdy));
+    std::string result;
+    appendTo(result);
+    return result;
+}
+
+void LayerProtoParser::Transform::appendTo(std::string& result) const {
+    StringAppendF(&result, "[%.2f, %.2f][%.2f, %.2f]", static_cast<double>(dsdx),
+                  static_cast<double>(dtdx), static_cast<double>(dsdy),
+                  static_cast<double>(dtdy));
 }
 
 std::string LayerProtoParser::Rect::to_string() const {
-    return StringPrintf("[%3d, %3d, %3d, %3d]", left, top, right, bottom);
+    std::string result;
+    appendTo(result);
+    return result;
+}
+
+void LayerProtoParser::Rect::appendTo(std::string& result) const {
+    StringAppendF(&result, "[%3d, %3d, %3d, %3d]", left, top, right, bottom);
 }
 
 std::string LayerProtoParser::FloatRect::to_string() const {
-    return StringPrintf("[%.2f, %.2f, %.2f, %.2f]", left, top, right, bottom);
+    std::string result;
+    appendTo(result);
+    return result;
+}
+
+void LayerProtoParser::FloatRect::appendTo(std::string& result) const {
+    StringAppendF(&result, "[%.2f, %.2f, %.2f, %.2f]", left, top, right, bottom);
 }
 
 std::string LayerProtoParser::Region::to_string(const char* what) const {
-    std::string result =
-            StringPrintf("  Region %s (this=%lx count=%d)\n", what, static_cast<unsigned long>(id),
-                         static_cast<int>(rects.size()));
+    std::string result;
+    appendTo(result, what);
+    return result;
+}
+
+void LayerProtoParser::Region::appendTo(std::string& result, const char* what) const {
+    StringAppendF(&result, "  Region %s (this=%lx count=%d)\n", what,
+                  static_cast<unsigned long>(id), static_cast<int>(rects.size()));
 
     for (auto& rect : rects) {
-        StringAppendF(&result, "    %s\n", rect.to_string().c_str());
+        result.append("    ");
+        rect.appendTo(result);
+        result.append("\n");
     }
-
-    return result;
 }
 
 std::string LayerProtoParser::Layer::to_string() const {
     std::string result;
+    appendTo(result);
+    return result;
+}
+
+void LayerProtoParser::Layer::appendTo(std::string& result) const {
     StringAppendF(&result, "+ %s (%s) uid=%d\n", type.c_str(), name.c_str(), ownerUid);
-    result.append(transparentRegion.to_string("TransparentRegion").c_str());
-    result.append(visibleRegion.to_string("VisibleRegion").c_str());
-    result.append(damageRegion.to_string("SurfaceDamageRegion").c_str());
+    transparentRegion.appendTo(result, "TransparentRegion");
+    visibleRegion.appendTo(result, "VisibleRegion");
+    damageRegion.appendTo(result, "SurfaceDamageRegion");
 
     StringAppendF(&result, "      layerStack=%4d, z=%9d, pos=(%g,%g), size=(%4d,%4d), ", layerStack,
                   z, static_cast<double>(position.x), static_cast<double>(position.y), size.x,
                   size.y);
 
-    StringAppendF(&result, "crop=%s, ", crop.to_string().c_str());
+    result.append("crop=");
+    crop.appendTo(result);
+    result.append(", ");
     StringAppendF(&result, "cornerRadius=%f, ", cornerRadius);
     StringAppendF(&result, "isProtected=%1d, ", isProtected);
     StringAppendF(&result, "isTrustedOverlay=%1d, ", isTrustedOverlay);
@@ -298,15 +464,18 @@ std::string LayerProtoParser::Layer::to_string() const {
     StringAppendF(&result, "color=(%.3f,%.3f,%.3f,%.3f), flags=0x%08x, ",
                   static_cast<double>(color.r), static_cast<double>(color.g),
                   static_cast<double>(color.b), static_cast<double>(color.a), flags);
-    StringAppendF(&result, "tr=%s", transform.to_string().c_str());
+    result.append("tr=");
+    transform.appendTo(result);
     result.append("\n");
     StringAppendF(&result, "      parent=%s\n", parent == nullptr ? "none" : parent->name.c_str());
     StringAppendF(&result, "      zOrderRelativeOf=%s\n",
                   zOrderRelativeOf == nullptr ? "none" : zOrderRelativeOf->name.c_str());
-    StringAppendF(&result, "      activeBuffer=%s,", activeBuffer.to_string().c_str());
-    StringAppendF(&result, " tr=%s", bufferTransform.to_string().c_str());
+    result.append("      activeBuffer=");
+    activeBuffer.appendTo(result);
+    result.append(", tr=");
+    bufferTransform.appendTo(result);
     StringAppendF(&result, " queued-frames=%d", queuedFrames);
-    StringAppendF(&result, " metadata={");
+    result.append(" metadata={");
     bool first = true;
     for (const auto& entry : metadata.mMap) {
         if (!first) result.append(", ");
@@ -314,9 +483,10 @@ std::string LayerProtoParser::Layer::to_string() const {
         result.append(metadata.itemToString(entry.first, ":"));
     }
     result.append("},");
-    StringAppendF(&result, " cornerRadiusCrop=%s, ", cornerRadiusCrop.to_string().c_str());
+    result.append(" cornerRadiusCrop=");
+    cornerRadiusCrop.appendTo(result);
+    result.append(", ");
     StringAppendF(&result, " shadowRadius=%.3f, ", shadowRadius);
-    return result;
 }
 
 } // namespace surfaceflinger
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <layerproto/LayerProtoParser.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace android::surfaceflinger;
+
+namespace {
+
+constexpr int kLayerCount = 150;
+
+// Returns the layers of a busy screen: a few hierarchies of buffer layers with regions, some of
+// them relative to layers of another hierarchy.
+LayersProto makeLayers(int frame) {
+    LayersProto layers;
+    for (int i = 0; i < kLayerCount; i++) {
+        LayerProto* layer = layers.add_layers();
+        layer->set_id(i);
+        layer->set_name("com.example.app/com.example.app.Activity#" + std::to_string(i));
+        layer->set_type(i % 3 ? "BufferStateLayer" : "ContainerLayer");
+        layer->set_parent(i < 4 ? -1 : i / 4 - 1);
+        layer->set_z_order_relative_of(i % 11 == 10 ? (i + 7) % kLayerCount : -1);
+        layer->set_z(i % 5 == 0 ? -i : i);
+        layer->mutable_position()->set_x(static_cast<float>(i % 8 == 0 ? frame : 0));
+        layer->set_dataspace("BT709 sRGB Full range");
+        layer->set_pixel_format("RGBA_8888");
+        for (int j = 0; j < 4; j++) {
+            RectProto* rect = layer->mutable_visible_region()->add_rect();
+            rect->set_left(j * 100);
+            rect->set_top(i * 10);
+            rect->set_right(j * 100 + 50);
+            rect->set_bottom(i * 10 + 50);
+        }
+        (*layer->mutable_metadata())[2] = "1000";
+    }
+    for (LayerProto& layer : *layers.mutable_layers()) {
+        if (layer.parent() != -1) {
+            layers.mutable_layers(layer.parent())->add_children(layer.id());
+        }
+        if (layer.z_order_relative_of() != -1) {
+            layers.mutable_layers(layer.z_order_relative_of())->add_relatives(layer.id());
+        }
+    }
+    return layers;
+}
+
+std::string makeTraceFile(int entryCount) {
+    LayersTraceFileProto fileProto;
+    fileProto.set_magic_number(uint64_t(LayersTraceFileProto_MagicNumber_MAGIC_NUMBER_H) << 32 |
+                               LayersTraceFileProto_MagicNumber_MAGIC_NUMBER_L);
+    for (int i = 0; i < entryCount; i++) {
+        LayersTraceProto* entry = fileProto.add_entry();
+        entry->set_elapsed_realtime_nanos(i * 16'666'667LL);
+        entry->set_where("visibleRegionsDirty");
+        *entry->mutable_layers() = makeLayers(i);
+    }
+    return fileProto.SerializeAsString();
+}
+
+const std::string& traceFile(int entryCount) {
+    static std::unordered_map<int, std::string> sTraceFiles;
+    auto it = sTraceFiles.find(entryCount);
+    if (it == sTraceFiles.end()) {
+        it = sTraceFiles.emplace(entryCount, makeTraceFile(entryCount)).first;
+    }
+    return it->second;
+}
+
+void BM_GenerateLayerTree(benchmark::State& state) {
+    const LayersProto layers = makeLayers(0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(LayerProtoParser::generateLayerTree(layers));
+    }
+}
+BENCHMARK(BM_GenerateLayerTree);
+
+// Returns the string and then appends it to the dump, as dumpsys used to do.
+void BM_LayerTreeToString_Returned(benchmark::State& state) {
+    const auto layerTree = LayerProtoParser::generateLayerTree(makeLayers(0));
+    for (auto _ : state) {
+        std::string result;
+        result.append(LayerProtoParser::layerTreeToString(layerTree));
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_LayerTreeToString_Returned);
+
+void BM_LayerTreeToString_Appended(benchmark::State& state) {
+    const auto layerTree = LayerProtoParser::generateLayerTree(makeLayers(0));
+    for (auto _ : state) {
+        std::string result;
+        LayerProtoParser::layerTreeToString(layerTree, result);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_LayerTreeToString_Appended);
+
+// Baseline: parses the whole trace file, then generates the layer tree of each entry.
+void BM_ParseTrace_Sequential(benchmark::State& state) {
+    const std::string& file = traceFile(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        LayersTraceFileProto fileProto;
+        fileProto.ParseFromString(file);
+        std::vector<LayerProtoParser::LayerTree> layerTrees;
+        layerTrees.reserve(static_cast<size_t>(fileProto.entry_size()));
+        for (const LayersTraceProto& entry : fileProto.entry()) {
+            layerTrees.push_back(LayerProtoParser::generateLayerTree(entry.layers()));
+        }
+        benchmark::DoNotOptimize(layerTrees);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file.size()));
+}
+BENCHMARK(BM_ParseTrace_Sequential)->Arg(2000)->Arg(5000)->Unit(benchmark::kMillisecond);
+
+void BM_ParseTrace_Parallel(benchmark::State& state) {
+    const std::string& file = traceFile(static_cast<int>(state.range(0)));
+    const auto threadCount = static_cast<size_t>(state.range(1));
+    for (auto _ : state) {
+        std::vector<LayerProtoParser::TraceEntry> entries;
+        if (!LayerProtoParser::generateTraceEntries(file, entries, threadCount)) {
+            state.SkipWithError("Could not parse trace");
+            break;
+        }
+        benchmark::DoNotOptimize(entries);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file.size()));
+}
+BENCHMARK(BM_ParseTrace_Parallel)
+        ->ArgsProduct({{2000, 5000}, {1, 2, 4, 8}})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -21,6 +21,7 @@
 #include <math/vec4.h>
 
 #include <memory>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -37,6 +38,7 @@ public:
         int32_t format;
 
         std::string to_string() const;
+        void appendTo(std::string& result) const;
     };
 
     class Transform {
@@ -47,6 +49,7 @@ public:
         float dtdy;
 
         std::string to_string() const;
+        void appendTo(std::string& result) const;
     };
 
     class Rect {
@@ -57,6 +60,7 @@ public:
         int32_t bottom;
 
         std::string to_string() const;
+        void appendTo(std::string& result) const;
     };
 
     class FloatRect {
@@ -67,14 +71,16 @@ public:
         float bottom;
 
         std::string to_string() const;
+        void appendTo(std::string& result) const;
     };
 
     class Region {
     public:
-        uint64_t id;
+        uint64_t id = 0;
         std::vector<Rect> rects;
 
         std::string to_string(const char* what) const;
+        void appendTo(std::string& result, const char* what) const;
     };
 
     class Layer {
@@ -118,6 +124,7 @@ public:
         uid_t ownerUid;
 
         std::string to_string() const;
+        void appendTo(std::string& result) const;
     };
 
     class LayerTree {
@@ -129,8 +136,24 @@ public:
         std::vector<Layer*> topLevelLayers;
     };
 
+    class TraceEntry {
+    public:
+        int64_t elapsedRealtimeNanos;
+        std::string where;
+        LayerTree layerTree;
+    };
+
     static LayerTree generateLayerTree(const LayersProto& layersProto);
     static std::string layerTreeToString(const LayerTree& layerTree);
+    // Appends to the result instead of returning the string of each layer, which avoids copying
+    // the output of every subtree into its parent.
+    static void layerTreeToString(const LayerTree& layerTree, std::string& result);
+
+    // Decodes the entries of a serialized LayersTraceFileProto on up to threadCount threads, or
+    // one thread per core if threadCount is 0. Each thread decodes the entry protos into its own
+    // arena, which is reset after each entry. Returns false if the trace is malformed.
+    static bool generateTraceEntries(std::string_view serializedTraceFile,
+                                     std::vector<TraceEntry>& outEntries, size_t threadCount = 0);
 
 private:
     static std::vector<Layer> generateLayerList(const LayersProto& layersProto);
@@ -144,7 +167,7 @@ private:
     static void updateChildrenAndRelative(const LayerProto& layerProto,
                                           std::unordered_map<int32_t, Layer*>& layerMap);
 
-    static std::string layerToString(const LayerProtoParser::Layer* layer);
+    static void layerToString(const LayerProtoParser::Layer* layer, std::string& result);
 };
 
 } // namespace surfaceflinger
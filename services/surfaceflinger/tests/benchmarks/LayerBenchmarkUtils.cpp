@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LayerBenchmarkUtils.h"
+
+#include <gmock/gmock.h>
+
+// TODO(b/129481165): remove the #pragma below and fix conversion issues
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include "BufferStateLayer.h"
+// TODO(b/129481165): remove the #pragma below and fix conversion issues
+#pragma clang diagnostic pop // ignored "-Wconversion"
+
+#include "mock/MockEventThread.h"
+#include "mock/MockVSyncTracker.h"
+#include "mock/MockVsyncController.h"
+
+namespace android {
+
+using testing::NiceMock;
+
+LayerBenchmarkFlinger::LayerBenchmarkFlinger() {
+    mFlinger.setupScheduler(std::make_unique<NiceMock<mock::VsyncController>>(),
+                            std::make_unique<NiceMock<mock::VSyncTracker>>(),
+                            std::make_unique<NiceMock<mock::EventThread>>(),
+                            std::make_unique<NiceMock<mock::EventThread>>(),
+                            TestableSurfaceFlinger::SchedulerCallbackImpl::kNoOp,
+                            TestableSurfaceFlinger::kOneDisplayMode, /*useNiceMock=*/true);
+}
+
+sp<Layer> LayerBenchmarkFlinger::createBufferStateLayer(const std::string& name) {
+    sp<Client> client;
+    LayerCreationArgs args(mFlinger.flinger(), client, name, /*flags=*/0, LayerMetadata());
+    return new BufferStateLayer(args);
+}
+
+} // namespace android
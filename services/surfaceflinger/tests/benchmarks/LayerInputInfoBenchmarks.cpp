@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <gui/WindowInfo.h>
+
+#include <string>
+#include <vector>
+
+#include "LayerBenchmarkUtils.h"
+
+namespace android {
+namespace {
+
+using gui::DisplayInfo;
+using gui::WindowInfo;
+
+constexpr size_t kRootCount = 10;
+constexpr size_t kLeavesPerRoot = 99;
+
+// Hierarchies of window layers, each a root with leaf children.
+class WindowLayers {
+public:
+    WindowLayers() {
+        for (size_t r = 0; r < kRootCount; r++) {
+            sp<Layer> root = createLayer();
+            mRoots.push_back(root);
+            mFlinger.flinger().mutableDrawingState().layersSortedByZ.add(root);
+            for (size_t i = 0; i < kLeavesPerRoot; i++) {
+                sp<Layer> leaf = createLayer();
+                root->addChild(leaf);
+                mLeaves.push_back(leaf);
+            }
+        }
+        LayerVector::invalidateZOrderCaches();
+        commitTransactions();
+    }
+
+    size_t size() const { return mRoots.size() + mLeaves.size(); }
+
+    // Changes the input info of count leaves. Leaves are picked because the change of a root
+    // would also fill the window infos of all its children again.
+    void changeLeaves(size_t count, size_t generation) {
+        for (size_t j = 0; j < count; j++) {
+            const sp<Layer>& leaf = mLeaves[(j * 97 + generation) % mLeaves.size()];
+            leaf->setInputInfo(makeInputInfo("changed" + std::to_string(generation)));
+        }
+        commitTransactions();
+    }
+
+    void buildWindowInfos() {
+        std::vector<WindowInfo> windowInfos;
+        std::vector<DisplayInfo> displayInfos;
+        mFlinger.flinger().buildWindowInfos(windowInfos, displayInfos);
+        benchmark::DoNotOptimize(windowInfos.data());
+    }
+
+private:
+    static WindowInfo makeInputInfo(const std::string& name) {
+        WindowInfo info;
+        info.name = name;
+        info.inputConfig = WindowInfo::InputConfig::NO_INPUT_CHANNEL;
+        return info;
+    }
+
+    sp<Layer> createLayer() {
+        sp<Layer> layer = mFlinger.createBufferStateLayer("window" + std::to_string(size()));
+        layer->setInputInfo(makeInputInfo(layer->getName()));
+        return layer;
+    }
+
+    // Commits the layer states, as SurfaceFlinger does before building the window infos.
+    void commitTransactions() {
+        for (const std::vector<sp<Layer>>* layers : {&mRoots, &mLeaves}) {
+            for (const sp<Layer>& layer : *layers) {
+                if (layer->clearTransactionFlags(eTransactionNeeded)) {
+                    layer->doTransaction(0);
+                }
+            }
+        }
+        for (const sp<Layer>& root : mRoots) {
+            root->commitChildList();
+        }
+    }
+
+    LayerBenchmarkFlinger mFlinger;
+    std::vector<sp<Layer>> mRoots;
+    std::vector<sp<Layer>> mLeaves;
+};
+
+// Builds the window infos of 1000 layers after the input info of some leaves changed. The argument
+// is the number of changed leaves, which the cost of a build should follow.
+void BM_BuildWindowInfos(benchmark::State& state) {
+    WindowLayers layers;
+    layers.buildWindowInfos();
+    const auto changedCount = static_cast<size_t>(state.range(0));
+    size_t generation = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        layers.changeLeaves(changedCount, generation++);
+        state.ResumeTiming();
+        layers.buildWindowInfos();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(layers.size()));
+}
+BENCHMARK(BM_BuildWindowInfos)
+        ->ArgName("changed")
+        ->Arg(0)
+        ->Arg(10)
+        ->Arg(100)
+        ->Arg(static_cast<int64_t>(kRootCount * kLeavesPerRoot));
+
+} // namespace
+} // namespace android
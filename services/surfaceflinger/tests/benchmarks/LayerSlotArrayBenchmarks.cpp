@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <ui/Fence.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "DisplayHardware/LayerSlotArray.h"
+
+namespace android {
+namespace {
+
+using HWC2::LayerSlotArray;
+
+// The per-frame plumbing of the release fences of a display: filling the results of the HWC, then
+// looking up the fence of each layer. The layer count is the argument.
+
+// In a map keyed by layer, as before the layers had slots.
+void BM_ReleaseFencesInMap(benchmark::State& state) {
+    // Stand-ins for the HWC2::Layer pointers used as keys.
+    std::vector<int> layers(static_cast<size_t>(state.range(0)));
+    const sp<Fence> fence = sp<Fence>::make();
+    for (auto _ : state) {
+        std::unordered_map<const int*, sp<Fence>> fences;
+        fences.reserve(layers.size());
+        for (const int& layer : layers) {
+            fences.emplace(&layer, fence);
+        }
+        for (const int& layer : layers) {
+            benchmark::DoNotOptimize(fences.find(&layer));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(layers.size()));
+}
+BENCHMARK(BM_ReleaseFencesInMap)->Arg(10)->Arg(100);
+
+// In a LayerSlotArray reused from frame to frame.
+void BM_ReleaseFencesInSlotArray(benchmark::State& state) {
+    const auto layerCount = static_cast<uint32_t>(state.range(0));
+    const sp<Fence> fence = sp<Fence>::make();
+    LayerSlotArray<sp<Fence>> fences;
+    for (auto _ : state) {
+        fences.clear();
+        for (uint32_t slot = 0; slot < layerCount; slot++) {
+            fences.set(slot, fence);
+        }
+        for (uint32_t slot = 0; slot < layerCount; slot++) {
+            benchmark::DoNotOptimize(fences.get(slot));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * layerCount);
+}
+BENCHMARK(BM_ReleaseFencesInSlotArray)->Arg(10)->Arg(100);
+
+} // namespace
+} // namespace android
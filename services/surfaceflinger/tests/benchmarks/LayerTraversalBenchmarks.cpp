@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "LayerBenchmarkUtils.h"
+
+namespace android {
+namespace {
+
+using StateSet = LayerVector::StateSet;
+
+constexpr int kRootCount = 10;
+constexpr int kLayersPerRoot = 100;
+
+// 1000 layers in 10 hierarchies, with a tenth of the layers relative to layers of another
+// hierarchy, as with the windows of a busy screen.
+class LayerHierarchies {
+public:
+    LayerHierarchies() {
+        std::vector<sp<Layer>> layers;
+        for (int r = 0; r < kRootCount; r++) {
+            std::vector<sp<Layer>> tree = {createLayer(r)};
+            mRoots.add(tree[0]);
+            for (int i = 1; i < kLayersPerRoot; i++) {
+                sp<Layer> layer = createLayer(i % 3 - 1);
+                tree[static_cast<size_t>((i - 1) / 4)]->addChild(layer);
+                tree.push_back(layer);
+            }
+            layers.insert(layers.end(), tree.begin(), tree.end());
+        }
+        LayerVector::invalidateZOrderCaches();
+        // Layers of the other hierarchies are relative to the leaves of the first one, which
+        // cannot create relative z loops.
+        for (int r = 1; r < kRootCount; r++) {
+            for (int i = 10; i < kLayersPerRoot; i += 10) {
+                const sp<Layer>& layer = layers[static_cast<size_t>(r * kLayersPerRoot + i)];
+                const sp<Layer>& leaf =
+                        layers[static_cast<size_t>(kLayersPerRoot - 1 - (r * 10 + i) % 75)];
+                layer->getParent()->setChildRelativeLayer(layer, getHandle(leaf), i % 3 - 1);
+            }
+        }
+        for (const sp<Layer>& root : mRoots) {
+            root->commitChildList();
+        }
+    }
+
+    // The traversal cached by LayerVector.
+    size_t traverse(bool reverse) const {
+        size_t count = 0;
+        const auto visitor = [&count](Layer*) { count++; };
+        if (reverse) {
+            mRoots.traverseInReverseZOrder(StateSet::Drawing, visitor);
+        } else {
+            mRoots.traverseInZOrder(StateSet::Drawing, visitor);
+        }
+        return count;
+    }
+
+    // The traversal of the layers done by LayerVector before it cached them.
+    size_t traverseRecursively(bool reverse) const {
+        size_t count = 0;
+        const auto visitor = [&count](Layer*) { count++; };
+        for (size_t i = 0; i < mRoots.size(); i++) {
+            const sp<Layer>& layer = mRoots[reverse ? mRoots.size() - 1 - i : i];
+            if (layer->getDrawingState().isRelativeOf) {
+                continue;
+            }
+            if (reverse) {
+                layer->traverseInReverseZOrder(StateSet::Drawing, visitor);
+            } else {
+                layer->traverseInZOrder(StateSet::Drawing, visitor);
+            }
+        }
+        return count;
+    }
+
+private:
+    sp<Layer> createLayer(int32_t z) {
+        sp<Layer> layer = mFlinger.createBufferStateLayer("layer");
+        layer->setLayer(z);
+        return layer;
+    }
+
+    // Layers only create their handle once.
+    const sp<IBinder>& getHandle(const sp<Layer>& layer) {
+        sp<IBinder>& handle = mHandles[layer.get()];
+        if (handle == nullptr) {
+            handle = layer->getHandle();
+        }
+        return handle;
+    }
+
+    LayerBenchmarkFlinger mFlinger;
+    std::unordered_map<Layer*, sp<IBinder>> mHandles;
+    LayerVector mRoots{StateSet::Current};
+};
+
+// Traverses the layers in z-order, from the cache of LayerVector or recursively as before.
+void BM_TraverseLayers(benchmark::State& state) {
+    LayerHierarchies hierarchies;
+    const bool cached = state.range(0);
+    const bool reverse = state.range(1);
+    size_t count = 0;
+    for (auto _ : state) {
+        count = cached ? hierarchies.traverse(reverse) : hierarchies.traverseRecursively(reverse);
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+BENCHMARK(BM_TraverseLayers)
+        ->ArgNames({"cached", "reverse"})
+        ->Args({0, 0})
+        ->Args({0, 1})
+        ->Args({1, 0})
+        ->Args({1, 1});
+
+} // namespace
+} // namespace android
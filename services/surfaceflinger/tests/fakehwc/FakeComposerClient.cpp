@@ -33,6 +33,7 @@
 #include <inttypes.h>
 #include <time.h>
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <iostream>
 #include <mutex>
@@ -59,6 +60,8 @@ public:
     bool mValid = true;
     RenderState mRenderState;
     uint32_t mZ = 0;
+    // Number of layer commands received for this layer.
+    std::atomic<int> mCommandCount = 0;
 };
 
 // Struct for storing per frame rectangle state. Contains the render
@@ -407,15 +410,17 @@ V2_1::Error FakeComposerClient::presentDisplay(Display /*display*/, int32_t* /*o
     return V2_1::Error::NONE;
 }
 
-V2_1::Error FakeComposerClient::setLayerCursorPosition(Display /*display*/, Layer /*layer*/,
+V2_1::Error FakeComposerClient::setLayerCursorPosition(Display /*display*/, Layer layer,
                                                        int32_t /*x*/, int32_t /*y*/) {
     ALOGV("setLayerCursorPosition");
+    countLayerCommand(layer);
     return V2_1::Error::NONE;
 }
 
 V2_1::Error FakeComposerClient::setLayerBuffer(Display /*display*/, Layer layer,
                                                buffer_handle_t buffer, int32_t acquireFence) {
     ALOGV("setLayerBuffer");
+    countLayerCommand(layer);
     LayerImpl& l = getLayerImpl(layer);
     if (buffer != l.mRenderState.mBuffer) {
         l.mRenderState.mSwapCount++; // TODO: Is setting to same value a swap or not?
@@ -426,14 +431,16 @@ V2_1::Error FakeComposerClient::setLayerBuffer(Display /*display*/, Layer layer,
     return V2_1::Error::NONE;
 }
 
-V2_1::Error FakeComposerClient::setLayerSurfaceDamage(Display /*display*/, Layer /*layer*/,
+V2_1::Error FakeComposerClient::setLayerSurfaceDamage(Display /*display*/, Layer layer,
                                                       const std::vector<hwc_rect_t>& /*damage*/) {
     ALOGV("setLayerSurfaceDamage");
+    countLayerCommand(layer);
     return V2_1::Error::NONE;
 }
 
 V2_1::Error FakeComposerClient::setLayerBlendMode(Display /*display*/, Layer layer, int32_t mode) {
     ALOGV("setLayerBlendMode");
+    countLayerCommand(layer);
     getLayerImpl(layer).mRenderState.mBlendMode = static_cast<hwc2_blend_mode_t>(mode);
     return V2_1::Error::NONE;
 }
@@ -441,6 +448,7 @@ V2_1::Error FakeComposerClient::setLayerBlendMode(Display /*display*/, Layer lay
 V2_1::Error FakeComposerClient::setLayerColor(Display /*display*/, Layer layer,
                                               IComposerClient::Color color) {
     ALOGV("setLayerColor");
+    countLayerCommand(layer);
     getLayerImpl(layer).mRenderState.mLayerColor.r = color.r;
     getLayerImpl(layer).mRenderState.mLayerColor.g = color.g;
     getLayerImpl(layer).mRenderState.mLayerColor.b = color.b;
@@ -448,15 +456,17 @@ V2_1::Error FakeComposerClient::setLayerColor(Display /*display*/, Layer layer,
     return V2_1::Error::NONE;
 }
 
-V2_1::Error FakeComposerClient::setLayerCompositionType(Display /*display*/, Layer /*layer*/,
+V2_1::Error FakeComposerClient::setLayerCompositionType(Display /*display*/, Layer layer,
                                                         int32_t /*type*/) {
     ALOGV("setLayerCompositionType");
+    countLayerCommand(layer);
     return V2_1::Error::NONE;
 }
 
-V2_1::Error FakeComposerClient::setLayerDataspace(Display /*display*/, Layer /*layer*/,
+V2_1::Error FakeComposerClient::setLayerDataspace(Display /*display*/, Layer layer,
                                                   int32_t /*dataspace*/) {
     ALOGV("setLayerDataspace");
+    countLayerCommand(layer);
     return V2_1::Error::NONE;
 }
 
@@ -464,25 +474,29 @@ V2_1::Error FakeComposerClient::setLayerDisplayFrame(Display /*display*/, Layer
                                                      const hwc_rect_t& frame) {
     ALOGV("setLayerDisplayFrame (%d, %d, %d, %d)", frame.left, frame.top, frame.right,
           frame.bottom);
+    countLayerCommand(layer);
     getLayerImpl(layer).mRenderState.mDisplayFrame = frame;
     return V2_1::Error::NONE;
 }
 
 V2_1::Error FakeComposerClient::setLayerPlaneAlpha(Display /*display*/, Layer layer, float alpha) {
     ALOGV("setLayerPlaneAlpha");
+    countLayerCommand(layer);
     getLayerImpl(layer).mRenderState.mPlaneAlpha = alpha;
     return V2_1::Error::NONE;
 }
 
-V2_1::Error FakeComposerClient::setLayerSidebandStream(Display /*display*/, Layer /*layer*/,
+V2_1::Error FakeComposerClient::setLayerSidebandStream(Display /*display*/, Layer layer,
                                                        buffer_handle_t /*stream*/) {
     ALOGV("setLayerSidebandStream");
+    countLayerCommand(layer);
     return V2_1::Error::NONE;
 }
 
 V2_1::Error FakeComposerClient::setLayerSourceCrop(Display /*display*/, Layer layer,
                                                    const hwc_frect_t& crop) {
     ALOGV("setLayerSourceCrop");
+    countLayerCommand(layer);
     getLayerImpl(layer).mRenderState.mSourceCrop = crop;
     return V2_1::Error::NONE;
 }
@@ -490,6 +504,7 @@ V2_1::Error FakeComposerClient::setLayerSourceCrop(Display /*display*/, Layer la
 V2_1::Error FakeComposerClient::setLayerTransform(Display /*display*/, Layer layer,
                                                   int32_t transform) {
     ALOGV("setLayerTransform");
+    countLayerCommand(layer);
     getLayerImpl(layer).mRenderState.mTransform = static_cast<hwc_transform_t>(transform);
     return V2_1::Error::NONE;
 }
@@ -497,12 +512,14 @@ V2_1::Error FakeComposerClient::setLayerTransform(Display /*display*/, Layer lay
 V2_1::Error FakeComposerClient::setLayerVisibleRegion(Display /*display*/, Layer layer,
                                                       const std::vector<hwc_rect_t>& visible) {
     ALOGV("setLayerVisibleRegion");
+    countLayerCommand(layer);
     getLayerImpl(layer).mRenderState.mVisibleRegion = visible;
     return V2_1::Error::NONE;
 }
 
 V2_1::Error FakeComposerClient::setLayerZOrder(Display /*display*/, Layer layer, uint32_t z) {
     ALOGV("setLayerZOrder");
+    countLayerCommand(layer);
     getLayerImpl(layer).mZ = z;
     return V2_1::Error::NONE;
 }
@@ -912,6 +929,14 @@ void FakeComposerClient::onSurfaceFlingerStop() {
     mSurfaceComposer.clear();
 }
 
+int FakeComposerClient::getLayerCommandCount(Layer layer) const {
+    return mLayers[layer]->mCommandCount;
+}
+
+void FakeComposerClient::countLayerCommand(Layer layer) {
+    getLayerImpl(layer).mCommandCount++;
+}
+
 // Includes destroyed layers, stored in order of creation.
 int FakeComposerClient::getLayerCount() const {
     return mLayers.size();
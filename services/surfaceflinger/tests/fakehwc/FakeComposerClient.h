@@ -276,12 +276,15 @@ public:
 
     int getLayerCount() const;
     Layer getLayer(size_t index) const;
+    // Number of commands received for a layer, to check that unchanged state is not sent again.
+    int getLayerCommandCount(Layer layer) const;
 
     void hotplugDisplay(Display display, IComposerCallback::Connection state);
     void refreshDisplay(Display display);
 
 private:
     LayerImpl& getLayerImpl(Layer handle);
+    void countLayerCommand(Layer layer);
 
     EventCallback* mEventCallback;
     EventCallback_2_4* mEventCallback_2_4;
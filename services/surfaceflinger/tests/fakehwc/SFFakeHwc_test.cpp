@@ -50,6 +50,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
 #include <limits>
 #include <thread>
 
@@ -1476,6 +1477,50 @@ protected:
         EXPECT_TRUE(framesAreSame(referenceFrame2, sFakeComposer->getLatestFrame()));
     }
 
+    void Test_UnchangedLayerStateIsNotResent() {
+        constexpr int kFrameCount = 30;
+        // Only the buffer and the surface damage of the foreground layer change on these frames.
+        constexpr int kMaxCommandsPerFrame = 2;
+
+        const auto getCommandCount = [] {
+            int count = 0;
+            for (int i = 0; i < sFakeComposer->getLayerCount(); i++) {
+                count += sFakeComposer->getLayerCommandCount(sFakeComposer->getLayer(i));
+            }
+            return count;
+        };
+
+        // Let the damage of the background layer settle after its first buffer.
+        fillSurfaceRGBA8(mFGSurfaceControl, GREEN);
+        sFakeComposer->runVSyncAndWait();
+
+        const int startFrame = sFakeComposer->getFrameCount();
+        const int startCommandCount = getCommandCount();
+        std::chrono::nanoseconds frameTime(0);
+        for (int i = 0; i < kFrameCount; i++) {
+            fillSurfaceRGBA8(mFGSurfaceControl, i % 2 ? GREEN : RED);
+            const auto start = std::chrono::steady_clock::now();
+            sFakeComposer->runVSyncAndWait();
+            frameTime += std::chrono::steady_clock::now() - start;
+        }
+        ASSERT_EQ(startFrame + kFrameCount, sFakeComposer->getFrameCount());
+
+        const int commandCount = getCommandCount() - startCommandCount;
+        const auto frameTimeUs =
+                std::chrono::duration_cast<std::chrono::microseconds>(frameTime).count() /
+                kFrameCount;
+        ALOGD("%d layer commands over %d frames, %lld us per frame", commandCount, kFrameCount,
+              static_cast<long long>(frameTimeUs));
+        ::testing::Test::RecordProperty("layer_commands_per_frame",
+                                        std::to_string(commandCount / kFrameCount));
+        ::testing::Test::RecordProperty("frame_time_us", std::to_string(frameTimeUs));
+        EXPECT_LE(commandCount, kFrameCount * kMaxCommandsPerFrame);
+
+        auto referenceFrame = mBaseFrame;
+        referenceFrame[FG_LAYER].mSwapCount += kFrameCount + 1;
+        EXPECT_TRUE(framesAreSame(referenceFrame, sFakeComposer->getLatestFrame()));
+    }
+
     sp<SurfaceComposerClient> mComposerClient;
     sp<SurfaceControl> mBGSurfaceControl;
     sp<SurfaceControl> mFGSurfaceControl;
@@ -1528,6 +1573,10 @@ TEST_F(TransactionTest_2_1, DISABLED_SetRelativeLayer) {
     Test_SetRelativeLayer();
 }
 
+TEST_F(TransactionTest_2_1, DISABLED_UnchangedLayerStateIsNotResent) {
+    Test_UnchangedLayerStateIsNotResent();
+}
+
 template <typename FakeComposerService>
 class ChildLayerTest : public TransactionTest<FakeComposerService> {
     using Base = TransactionTest<FakeComposerService>;
@@ -32,6 +32,8 @@
 
 #include <gui/LayerMetadata.h>
 #include <log/log.h>
+#include <ui/Fence.h>
+#include <ui/GraphicBuffer.h>
 
 #include "DisplayHardware/DisplayMode.h"
 #include "DisplayHardware/HWComposer.h"
@@ -55,9 +57,12 @@ using Hwc2::Config;
 using ::testing::_;
 using ::testing::DoAll;
 using ::testing::ElementsAreArray;
+using ::testing::InSequence;
+using ::testing::Not;
 using ::testing::Return;
 using ::testing::SetArgPointee;
 using ::testing::StrictMock;
+using ::testing::Truly;
 
 TEST(HWComposerTest, isHeadless) {
     Hwc2::mock::Composer* mHal = new StrictMock<Hwc2::mock::Composer>();
@@ -140,6 +145,7 @@ TEST_F(HWComposerSetCallbackTest, handlesUnsupportedCallToGetLayerGenericMetadat
 struct HWComposerLayerTest : public testing::Test {
     static constexpr hal::HWDisplayId kDisplayId = static_cast<hal::HWDisplayId>(1001);
     static constexpr hal::HWLayerId kLayerId = static_cast<hal::HWLayerId>(1002);
+    static constexpr uint32_t kLayerSlot = 0;
 
     HWComposerLayerTest(const std::unordered_set<aidl::Capability>& capabilities)
           : mCapabilies(capabilities) {
@@ -154,7 +160,7 @@ struct HWComposerLayerTest : public testing::Test {
     std::unique_ptr<Hwc2::mock::Composer> mHal{new StrictMock<Hwc2::mock::Composer>()};
     const std::unordered_set<aidl::Capability> mCapabilies;
     StrictMock<HWC2::mock::Display> mDisplay;
-    HWC2::impl::Layer mLayer{*mHal, mCapabilies, mDisplay, kLayerId};
+    HWC2::impl::Layer mLayer{*mHal, mCapabilies, mDisplay, kLayerId, kLayerSlot};
 };
 
 struct HWComposerLayerGenericMetadataTest : public HWComposerLayerTest {
@@ -203,5 +209,220 @@ TEST_F(HWComposerLayerGenericMetadataTest, forwardsSupportedMetadata) {
     EXPECT_EQ(hal::Error::UNSUPPORTED, result);
 }
 
+struct HWComposerLayerSentStateTest : public HWComposerLayerTest {
+    HWComposerLayerSentStateTest() : HWComposerLayerTest({}) {}
+};
+
+TEST_F(HWComposerLayerSentStateTest, unchangedStateIsNotSentAgain) {
+    EXPECT_CALL(*mHal, setLayerDisplayFrame(kDisplayId, kLayerId, _))
+            .WillOnce(Return(V2_4::Error::NONE));
+    EXPECT_CALL(*mHal, setLayerPlaneAlpha(kDisplayId, kLayerId, 0.5f))
+            .WillOnce(Return(V2_4::Error::NONE));
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(hal::Error::NONE, mLayer.setDisplayFrame(Rect(0, 0, 100, 100)));
+        EXPECT_EQ(hal::Error::NONE, mLayer.setPlaneAlpha(0.5f));
+    }
+}
+
+TEST_F(HWComposerLayerSentStateTest, changedStateIsSent) {
+    EXPECT_CALL(*mHal, setLayerPlaneAlpha(kDisplayId, kLayerId, 0.5f))
+            .Times(2)
+            .WillRepeatedly(Return(V2_4::Error::NONE));
+    EXPECT_CALL(*mHal, setLayerPlaneAlpha(kDisplayId, kLayerId, 1.f))
+            .WillOnce(Return(V2_4::Error::NONE));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setPlaneAlpha(0.5f));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setPlaneAlpha(1.f));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setPlaneAlpha(0.5f));
+}
+
+TEST_F(HWComposerLayerSentStateTest, rejectedStateIsSentAgain) {
+    EXPECT_CALL(*mHal, setLayerColorTransform(kDisplayId, kLayerId, _))
+            .WillOnce(Return(V2_4::Error::UNSUPPORTED))
+            .WillOnce(Return(V2_4::Error::NONE));
+    const mat4 matrix = mat4::scale(vec4(0.5f, 0.5f, 0.5f, 1.f));
+    EXPECT_EQ(hal::Error::UNSUPPORTED, mLayer.setColorTransform(matrix));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setColorTransform(matrix));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setColorTransform(matrix));
+}
+
+TEST_F(HWComposerLayerSentStateTest, identityColorTransformIsNotSentWhenUnsupported) {
+    // Composers before 2.3 reject all layer color transforms.
+    const auto isIdentity = [](const float* array) { return mat4(array) == mat4(); };
+    EXPECT_CALL(*mHal, setLayerColorTransform(kDisplayId, kLayerId, Truly(isIdentity))).Times(0);
+    EXPECT_CALL(*mHal, setLayerColorTransform(kDisplayId, kLayerId, Not(Truly(isIdentity))))
+            .Times(2)
+            .WillRepeatedly(Return(V2_4::Error::UNSUPPORTED));
+
+    const mat4 matrix = mat4::scale(vec4(0.5f, 0.5f, 0.5f, 1.f));
+
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(hal::Error::NONE, mLayer.setColorTransform(mat4()));
+    }
+    EXPECT_EQ(hal::Error::UNSUPPORTED, mLayer.setColorTransform(matrix));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setColorTransform(mat4()));
+    EXPECT_EQ(hal::Error::UNSUPPORTED, mLayer.setColorTransform(matrix));
+}
+
+TEST_F(HWComposerLayerSentStateTest, defaultDataspaceAndMetadataAreNotSent) {
+    EXPECT_CALL(*mHal, setLayerDataspace(kDisplayId, kLayerId, _)).Times(0);
+    EXPECT_CALL(*mHal, setLayerPerFrameMetadata(kDisplayId, kLayerId, _)).Times(0);
+    EXPECT_EQ(hal::Error::NONE, mLayer.setDataspace(hal::Dataspace::UNKNOWN));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setPerFrameMetadata(0, HdrMetadata{}));
+}
+
+TEST_F(HWComposerLayerSentStateTest, stateIsSentAgainAfterReset) {
+    EXPECT_CALL(*mHal, setLayerPlaneAlpha(kDisplayId, kLayerId, 0.5f))
+            .Times(2)
+            .WillRepeatedly(Return(V2_4::Error::NONE));
+    EXPECT_CALL(*mHal, setLayerDataspace(kDisplayId, kLayerId, hal::Dataspace::UNKNOWN))
+            .WillOnce(Return(V2_4::Error::NONE));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setPlaneAlpha(0.5f));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setDataspace(hal::Dataspace::UNKNOWN));
+
+    mLayer.resetSentState();
+    EXPECT_EQ(hal::Error::NONE, mLayer.setPlaneAlpha(0.5f));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setDataspace(hal::Dataspace::UNKNOWN));
+}
+
+TEST_F(HWComposerLayerSentStateTest, clearBufferSlotsSetsPlaceholderAndRestoresCurrentBuffer) {
+    const auto buffer = sp<GraphicBuffer>::make();
+    const auto isPlaceholder = [&buffer](const sp<GraphicBuffer>& b) {
+        return b != nullptr && b != buffer;
+    };
+
+    InSequence seq;
+    EXPECT_CALL(*mHal, setLayerBuffer(kDisplayId, kLayerId, 1u, buffer, _))
+            .WillOnce(Return(V2_4::Error::NONE));
+    EXPECT_CALL(*mHal, setLayerBuffer(kDisplayId, kLayerId, 2u, Truly(isPlaceholder), -1))
+            .WillOnce(Return(V2_4::Error::NONE));
+    EXPECT_CALL(*mHal, setLayerBuffer(kDisplayId, kLayerId, 3u, Truly(isPlaceholder), -1))
+            .WillOnce(Return(V2_4::Error::NONE));
+    EXPECT_CALL(*mHal, setLayerBuffer(kDisplayId, kLayerId, 1u, sp<GraphicBuffer>(), -1))
+            .WillOnce(Return(V2_4::Error::NONE));
+
+    EXPECT_EQ(hal::Error::NONE, mLayer.setBuffer(1, buffer, Fence::NO_FENCE));
+    EXPECT_EQ(hal::Error::NONE, mLayer.clearBufferSlots({2, 3}));
+    // The current buffer was set again, so it is not sent.
+    EXPECT_EQ(hal::Error::NONE, mLayer.setBuffer(1, nullptr, Fence::NO_FENCE));
+}
+
+TEST_F(HWComposerLayerSentStateTest, clearBufferSlotsDefersSlotOfCurrentBuffer) {
+    const auto buffer1 = sp<GraphicBuffer>::make();
+    const auto buffer2 = sp<GraphicBuffer>::make();
+    const auto isPlaceholder = [&](const sp<GraphicBuffer>& b) {
+        return b != nullptr && b != buffer1 && b != buffer2;
+    };
+
+    InSequence seq;
+    EXPECT_CALL(*mHal, setLayerBuffer(kDisplayId, kLayerId, 1u, buffer1, _))
+            .WillOnce(Return(V2_4::Error::NONE));
+    EXPECT_CALL(*mHal, setLayerBuffer(kDisplayId, kLayerId, 2u, buffer2, _))
+            .WillOnce(Return(V2_4::Error::NONE));
+    EXPECT_CALL(*mHal, setLayerBuffer(kDisplayId, kLayerId, 1u, Truly(isPlaceholder), -1))
+            .WillOnce(Return(V2_4::Error::NONE));
+    EXPECT_CALL(*mHal, setLayerBuffer(kDisplayId, kLayerId, 2u, sp<GraphicBuffer>(), -1))
+            .WillOnce(Return(V2_4::Error::NONE));
+
+    EXPECT_EQ(hal::Error::NONE, mLayer.setBuffer(1, buffer1, Fence::NO_FENCE));
+    // The HWC still shows the buffer, so the slot is only cleared once another one is set.
+    EXPECT_EQ(hal::Error::NONE, mLayer.clearBufferSlots({1}));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setBuffer(2, buffer2, Fence::NO_FENCE));
+}
+
+struct HWComposerDisplayLayerSlotTest : public testing::Test {
+    static constexpr hal::HWDisplayId kDisplayId = static_cast<hal::HWDisplayId>(1001);
+
+    std::shared_ptr<HWC2::Layer> createLayer(hal::HWLayerId layerId) {
+        EXPECT_CALL(*mHal, createLayer(kDisplayId, _))
+                .WillOnce(DoAll(SetArgPointee<1>(layerId), Return(V2_4::Error::NONE)));
+        EXPECT_CALL(*mHal, destroyLayer(kDisplayId, layerId))
+                .WillOnce(Return(V2_4::Error::NONE));
+        auto layer = mDisplay.createLayer();
+        EXPECT_TRUE(layer.has_value());
+        return layer.value_or(nullptr);
+    }
+
+    std::unique_ptr<Hwc2::mock::Composer> mHal{new StrictMock<Hwc2::mock::Composer>()};
+    const std::unordered_set<aidl::Capability> mCapabilities;
+    HWC2::impl::Display mDisplay{*mHal, mCapabilities, kDisplayId, hal::DisplayType::INVALID};
+};
+
+TEST_F(HWComposerDisplayLayerSlotTest, slotsAreDenseAndReused) {
+    auto layer1 = createLayer(11);
+    auto layer2 = createLayer(12);
+    auto layer3 = createLayer(13);
+    ASSERT_TRUE(layer1 && layer2 && layer3);
+    EXPECT_EQ(0u, layer1->getDisplaySlot());
+    EXPECT_EQ(1u, layer2->getDisplaySlot());
+    EXPECT_EQ(2u, layer3->getDisplaySlot());
+
+    layer2.reset();
+    auto layer4 = createLayer(14);
+    ASSERT_TRUE(layer4);
+    EXPECT_EQ(1u, layer4->getDisplaySlot());
+}
+
+TEST_F(HWComposerDisplayLayerSlotTest, releaseFencesAreIndexedBySlot) {
+    auto layer1 = createLayer(11);
+    auto layer2 = createLayer(12);
+    ASSERT_TRUE(layer1 && layer2);
+
+    const std::vector<Hwc2::Layer> layerIds = {12};
+    const std::vector<int> fenceFds = {-1};
+    EXPECT_CALL(*mHal, getReleaseFences(kDisplayId, _, _))
+            .WillOnce(DoAll(SetArgPointee<1>(layerIds), SetArgPointee<2>(fenceFds),
+                            Return(V2_4::Error::NONE)));
+
+    HWC2::LayerSlotArray<sp<Fence>> releaseFences;
+    releaseFences.set(layer1->getDisplaySlot(), sp<Fence>::make());
+    EXPECT_EQ(hal::Error::NONE, mDisplay.getReleaseFences(&releaseFences));
+
+    // The fences of the previous frame are cleared.
+    EXPECT_EQ(1u, releaseFences.size());
+    EXPECT_EQ(nullptr, releaseFences.get(layer1->getDisplaySlot()));
+    ASSERT_NE(nullptr, releaseFences.get(layer2->getDisplaySlot()));
+    EXPECT_FALSE((*releaseFences.get(layer2->getDisplaySlot()))->isValid());
+}
+
+TEST_F(HWComposerDisplayLayerSlotTest, failedValidateResetsLayersSentState) {
+    auto layer = createLayer(11);
+    ASSERT_TRUE(layer);
+
+    EXPECT_CALL(*mHal, setLayerPlaneAlpha(kDisplayId, 11, 0.5f))
+            .Times(2)
+            .WillRepeatedly(Return(V2_4::Error::NONE));
+    EXPECT_CALL(*mHal, validateDisplay(kDisplayId, _, _, _))
+            .WillOnce(Return(V2_4::Error::NO_RESOURCES));
+
+    EXPECT_EQ(hal::Error::NONE, layer->setPlaneAlpha(0.5f));
+    uint32_t numTypes = 0;
+    uint32_t numRequests = 0;
+    EXPECT_EQ(hal::Error::NO_RESOURCES, mDisplay.validate(0, &numTypes, &numRequests));
+    // The HWC may have dropped the command along with the validate.
+    EXPECT_EQ(hal::Error::NONE, layer->setPlaneAlpha(0.5f));
+}
+
+TEST_F(HWComposerDisplayLayerSlotTest, changedCompositionTypesAreIndexedBySlot) {
+    auto layer1 = createLayer(11);
+    auto layer2 = createLayer(12);
+    ASSERT_TRUE(layer1 && layer2);
+
+    const std::vector<Hwc2::Layer> layerIds = {11, 42};
+    const std::vector<aidl::Composition> types = {aidl::Composition::CLIENT,
+                                                  aidl::Composition::DEVICE};
+    EXPECT_CALL(*mHal, getChangedCompositionTypes(kDisplayId, _, _))
+            .WillOnce(DoAll(SetArgPointee<1>(layerIds), SetArgPointee<2>(types),
+                            Return(V2_4::Error::NONE)));
+
+    HWC2::LayerSlotArray<aidl::Composition> changedTypes;
+    EXPECT_EQ(hal::Error::NONE, mDisplay.getChangedCompositionTypes(&changedTypes));
+
+    // The unknown layer 42 is ignored.
+    EXPECT_EQ(1u, changedTypes.size());
+    ASSERT_NE(nullptr, changedTypes.get(layer1->getDisplaySlot()));
+    EXPECT_EQ(aidl::Composition::CLIENT, *changedTypes.get(layer1->getDisplaySlot()));
+    EXPECT_EQ(nullptr, changedTypes.get(layer2->getDisplaySlot()));
+}
+
 } // namespace
 } // namespace android
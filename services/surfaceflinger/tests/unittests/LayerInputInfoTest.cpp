@@ -0,0 +1,175 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "LibSurfaceFlingerUnittests"
+
+#include <gtest/gtest.h>
+#include <gui/WindowInfo.h>
+
+#include <string>
+#include <vector>
+
+#include "LayerTestUtils.h"
+#include "TestableSurfaceFlinger.h"
+
+namespace android {
+namespace {
+
+using gui::DisplayInfo;
+using gui::WindowInfo;
+
+/**
+ * Checks that SurfaceFlinger::buildWindowInfos only fills the window info of the layers which
+ * changed since the last build.
+ */
+class LayerInputInfoTest : public BaseLayerTest {
+protected:
+    sp<Layer> createLayer(const sp<Layer>& parent = nullptr) {
+        sp<Layer> layer = GetParam()->createLayer(mFlinger);
+        layer->setInputInfo(makeInputInfo("window" + std::to_string(mLayers.size())));
+        if (parent != nullptr) {
+            parent->addChild(layer);
+        } else {
+            mRoots.push_back(layer);
+            mFlinger.mutableDrawingState().layersSortedByZ.add(layer);
+            LayerVector::invalidateZOrderCaches();
+        }
+        mLayers.push_back(layer);
+        return layer;
+    }
+
+    static WindowInfo makeInputInfo(const std::string& name) {
+        WindowInfo info;
+        info.name = name;
+        info.inputConfig = WindowInfo::InputConfig::NO_INPUT_CHANNEL;
+        return info;
+    }
+
+    // Commits the layer states, as SurfaceFlinger does before building the window infos.
+    void commitTransactions() {
+        for (const sp<Layer>& layer : mLayers) {
+            if (layer->clearTransactionFlags(eTransactionNeeded)) {
+                layer->doTransaction(0);
+            }
+        }
+        for (const sp<Layer>& root : mRoots) {
+            root->commitChildList();
+        }
+    }
+
+    std::vector<WindowInfo> buildWindowInfos() {
+        std::vector<WindowInfo> windowInfos;
+        std::vector<DisplayInfo> displayInfos;
+        mFlinger.buildWindowInfos(windowInfos, displayInfos);
+        return windowInfos;
+    }
+
+    static const WindowInfo* findWindowInfo(const std::vector<WindowInfo>& windowInfos,
+                                            const sp<Layer>& layer) {
+        for (const WindowInfo& info : windowInfos) {
+            if (info.id == layer->sequence) {
+                return &info;
+            }
+        }
+        return nullptr;
+    }
+
+    void expectFilledWindowInfos(const std::vector<WindowInfo>& windowInfos) {
+        ASSERT_EQ(mLayers.size(), windowInfos.size());
+        for (const sp<Layer>& layer : mLayers) {
+            SCOPED_TRACE(layer->getName());
+            const WindowInfo* info = findWindowInfo(windowInfos, layer);
+            ASSERT_NE(nullptr, info);
+            EXPECT_EQ(layer->fillInputInfo({}), *info);
+        }
+    }
+
+    std::vector<sp<Layer>> mRoots;
+    std::vector<sp<Layer>> mLayers;
+};
+
+INSTANTIATE_TEST_SUITE_P(PerLayerType, LayerInputInfoTest,
+                         testing::Values(std::make_shared<BufferStateLayerFactory>(),
+                                         std::make_shared<EffectLayerFactory>()),
+                         PrintToStringParamName);
+
+TEST_P(LayerInputInfoTest, windowInfosMatchFilledInputInfo) {
+    sp<Layer> root = createLayer();
+    sp<Layer> child = createLayer(root);
+    createLayer(child);
+    createLayer();
+    commitTransactions();
+
+    expectFilledWindowInfos(buildWindowInfos());
+    // The second build uses the cached window infos.
+    expectFilledWindowInfos(buildWindowInfos());
+}
+
+TEST_P(LayerInputInfoTest, unchangedLayersAreNotFilledAgain) {
+    sp<Layer> root = createLayer();
+    sp<Layer> child = createLayer(root);
+    commitTransactions();
+    buildWindowInfos();
+
+    // Changing the drawing state without a transaction does not invalidate the window info.
+    TestableSurfaceFlinger::mutableLayerDrawingState(child).inputInfo.name = "unchanged";
+    std::vector<WindowInfo> windowInfos = buildWindowInfos();
+    ASSERT_NE(nullptr, findWindowInfo(windowInfos, child));
+    EXPECT_EQ("window1", findWindowInfo(windowInfos, child)->name);
+
+    child->setInputInfo(makeInputInfo("changed"));
+    commitTransactions();
+    windowInfos = buildWindowInfos();
+    ASSERT_NE(nullptr, findWindowInfo(windowInfos, child));
+    EXPECT_EQ("changed", findWindowInfo(windowInfos, child)->name);
+    expectFilledWindowInfos(windowInfos);
+}
+
+TEST_P(LayerInputInfoTest, parentChangeFillsChildrenAgain) {
+    sp<Layer> root = createLayer();
+    sp<Layer> child = createLayer(root);
+    sp<Layer> grandChild = createLayer(child);
+    commitTransactions();
+    buildWindowInfos();
+
+    ASSERT_TRUE(root->setAlpha(0.5f));
+    commitTransactions();
+    const std::vector<WindowInfo> windowInfos = buildWindowInfos();
+    ASSERT_NE(nullptr, findWindowInfo(windowInfos, grandChild));
+    EXPECT_EQ(0.5f, findWindowInfo(windowInfos, grandChild)->alpha);
+    expectFilledWindowInfos(windowInfos);
+}
+
+TEST_P(LayerInputInfoTest, geometryChangeFillsInfoAgain) {
+    sp<Layer> layer = createLayer();
+    WindowInfo info = makeInputInfo("window");
+    info.replaceTouchableRegionWithCrop = true;
+    layer->setInputInfo(info);
+    commitTransactions();
+    layer->computeBounds(FloatRect(0, 0, 100, 100), ui::Transform(), 0.f);
+    buildWindowInfos();
+
+    // Bounds are computed again on composition, without a transaction on the layer.
+    layer->computeBounds(FloatRect(0, 0, 50, 50), ui::Transform(), 0.f);
+    const std::vector<WindowInfo> windowInfos = buildWindowInfos();
+    ASSERT_NE(nullptr, findWindowInfo(windowInfos, layer));
+    EXPECT_EQ(Rect(0, 0, 50, 50), findWindowInfo(windowInfos, layer)->touchableRegion.getBounds());
+    expectFilledWindowInfos(windowInfos);
+}
+
+} // namespace
+} // namespace android
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <layerproto/LayerProtoParser.h>
+
+#include <string>
+#include <vector>
+
+using namespace android::surfaceflinger;
+
+namespace android {
+
+class LayerProtoParserTest : public testing::Test {
+protected:
+    static constexpr int LAYER_COUNT = 40;
+
+    // Returns a hierarchy of layers in which some are relative to layers in another subtree and
+    // some are behind their parents.
+    static LayersProto makeLayers(int seed) {
+        LayersProto layers;
+        for (int i = 0; i < LAYER_COUNT; i++) {
+            LayerProto* layer = layers.add_layers();
+            layer->set_id(i);
+            layer->set_name("Layer " + std::to_string(i) + "#" + std::to_string(seed));
+            layer->set_type(i % 3 ? "BufferStateLayer" : "ContainerLayer");
+            layer->set_parent(i < 4 ? -1 : i / 4 - 1);
+            layer->set_z_order_relative_of(i % 7 == 6 ? (i + 5) % LAYER_COUNT : -1);
+            layer->set_z(i % 5 == 0 ? -i : i + seed);
+            layer->set_layer_stack(static_cast<uint32_t>(i % 2));
+            layer->mutable_position()->set_x(static_cast<float>(i * seed));
+            RectProto* rect = layer->mutable_visible_region()->add_rect();
+            rect->set_right(i * 10);
+            rect->set_bottom(seed);
+            (*layer->mutable_metadata())[static_cast<uint32_t>(i % 4)] = "metadata";
+        }
+        for (LayerProto& layer : *layers.mutable_layers()) {
+            if (layer.parent() != -1) {
+                layers.mutable_layers(layer.parent())->add_children(layer.id());
+            }
+            if (layer.z_order_relative_of() != -1) {
+                layers.mutable_layers(layer.z_order_relative_of())->add_relatives(layer.id());
+            }
+        }
+        return layers;
+    }
+
+    static std::string makeTraceFile(int entryCount) {
+        LayersTraceFileProto fileProto;
+        fileProto.set_magic_number(
+                uint64_t(LayersTraceFileProto_MagicNumber_MAGIC_NUMBER_H) << 32 |
+                LayersTraceFileProto_MagicNumber_MAGIC_NUMBER_L);
+        for (int i = 0; i < entryCount; i++) {
+            LayersTraceProto* entry = fileProto.add_entry();
+            entry->set_elapsed_realtime_nanos(i * 1000);
+            entry->set_where(i % 2 ? "visibleRegionsDirty" : "bufferLatched");
+            *entry->mutable_layers() = makeLayers(i);
+        }
+        return fileProto.SerializeAsString();
+    }
+};
+
+TEST_F(LayerProtoParserTest, appendsSameStringAsToString) {
+    const LayersProto layers = makeLayers(1);
+    const auto layerTree = LayerProtoParser::generateLayerTree(layers);
+
+    std::string result = "prefix\n";
+    LayerProtoParser::layerTreeToString(layerTree, result);
+    EXPECT_EQ("prefix\n" + LayerProtoParser::layerTreeToString(layerTree), result);
+    for (const LayerProtoParser::Layer& layer : layerTree.allLayers) {
+        EXPECT_NE(std::string::npos, result.find(layer.to_string() + "\n")) << layer.name;
+    }
+}
+
+TEST_F(LayerProtoParserTest, generatesTraceEntriesInParallel) {
+    constexpr int ENTRY_COUNT = 100;
+    const std::string traceFile = makeTraceFile(ENTRY_COUNT);
+    LayersTraceFileProto fileProto;
+    ASSERT_TRUE(fileProto.ParseFromString(traceFile));
+
+    for (size_t threadCount : {1u, 4u, 0u}) {
+        std::vector<LayerProtoParser::TraceEntry> entries;
+        ASSERT_TRUE(LayerProtoParser::generateTraceEntries(traceFile, entries, threadCount));
+        ASSERT_EQ(static_cast<size_t>(ENTRY_COUNT), entries.size());
+
+        for (int i = 0; i < ENTRY_COUNT; i++) {
+            const LayersTraceProto& entryProto = fileProto.entry(i);
+            const LayerProtoParser::TraceEntry& entry = entries[static_cast<size_t>(i)];
+            EXPECT_EQ(entryProto.elapsed_realtime_nanos(), entry.elapsedRealtimeNanos);
+            EXPECT_EQ(entryProto.where(), entry.where);
+            EXPECT_EQ(LayerProtoParser::layerTreeToString(
+                              LayerProtoParser::generateLayerTree(entryProto.layers())),
+                      LayerProtoParser::layerTreeToString(entry.layerTree));
+        }
+    }
+}
+
+TEST_F(LayerProtoParserTest, rejectsMalformedTrace) {
+    std::string traceFile = makeTraceFile(3);
+    traceFile.resize(traceFile.size() - 1);
+
+    std::vector<LayerProtoParser::TraceEntry> entries;
+    EXPECT_FALSE(LayerProtoParser::generateTraceEntries(traceFile, entries));
+    EXPECT_TRUE(entries.empty());
+
+    EXPECT_TRUE(LayerProtoParser::generateTraceEntries("", entries));
+    EXPECT_TRUE(entries.empty());
+}
+
+} // namespace android
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "LibSurfaceFlingerUnittests"
+
+#include <gtest/gtest.h>
+#include <ui/Fence.h>
+
+#include "DisplayHardware/LayerSlotArray.h"
+
+namespace android {
+namespace {
+
+using HWC2::LayerSlotArray;
+
+TEST(LayerSlotArrayTest, setAndGet) {
+    LayerSlotArray<int> values;
+    EXPECT_TRUE(values.empty());
+    EXPECT_EQ(nullptr, values.get(0));
+
+    values.set(3, 30);
+    values.set(1, 10);
+    EXPECT_EQ(2u, values.size());
+    ASSERT_NE(nullptr, values.get(3));
+    EXPECT_EQ(30, *values.get(3));
+    ASSERT_NE(nullptr, values.get(1));
+    EXPECT_EQ(10, *values.get(1));
+    EXPECT_EQ(nullptr, values.get(0));
+    EXPECT_EQ(nullptr, values.get(2));
+    EXPECT_EQ(nullptr, values.get(100));
+
+    values.set(3, 31);
+    EXPECT_EQ(2u, values.size());
+    EXPECT_EQ(31, *values.get(3));
+}
+
+TEST(LayerSlotArrayTest, clearUnsetsAllValues) {
+    LayerSlotArray<sp<Fence>> fences{{0, sp<Fence>::make()}, {4, sp<Fence>::make()}};
+    EXPECT_EQ(2u, fences.size());
+
+    fences.clear();
+    EXPECT_TRUE(fences.empty());
+    EXPECT_EQ(nullptr, fences.get(0));
+    EXPECT_EQ(nullptr, fences.get(4));
+
+    fences.set(4, Fence::NO_FENCE);
+    EXPECT_EQ(1u, fences.size());
+    ASSERT_NE(nullptr, fences.get(4));
+    EXPECT_EQ(Fence::NO_FENCE, *fences.get(4));
+}
+
+TEST(LayerSlotArrayTest, equalityIgnoresOrderAndCapacity) {
+    LayerSlotArray<int> values{{1, 10}, {2, 20}};
+    LayerSlotArray<int> other{{2, 20}, {1, 10}};
+    EXPECT_EQ(values, other);
+
+    // A cleared slot does not count, even though the storage was grown for it.
+    other.set(9, 90);
+    EXPECT_NE(values, other);
+    other.clear();
+    other.set(1, 10);
+    other.set(2, 20);
+    EXPECT_EQ(values, other);
+
+    other.set(2, 21);
+    EXPECT_NE(values, other);
+}
+
+} // namespace
+} // namespace android
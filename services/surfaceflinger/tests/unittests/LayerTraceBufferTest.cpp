@@ -0,0 +1,147 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "Tracing/LayerTraceBuffer.h"
+
+using namespace android::surfaceflinger;
+
+namespace android {
+
+class LayerTraceBufferTest : public testing::Test {
+protected:
+    static constexpr size_t LARGE_BUFFER_SIZE = 20 * 1024 * 1024;
+    static constexpr int LAYER_COUNT = 50;
+
+    LayerTraceBufferTest() { mBuffer.setSize(LARGE_BUFFER_SIZE); }
+
+    // Returns an entry in which a few layers moved since the entry of the previous frame, and one
+    // layer is replaced by a new one every tenth frame.
+    static LayersTraceProto makeEntry(int frame) {
+        LayersTraceProto entry;
+        entry.set_elapsed_realtime_nanos(int64_t{frame} * 16'666'667);
+        entry.set_where(frame % 2 ? "visibleRegionsDirty" : "bufferLatched");
+        for (int i = 0; i < LAYER_COUNT; i++) {
+            LayerProto* layer = entry.mutable_layers()->add_layers();
+            const int generation = i == 7 ? frame / 10 : 0;
+            layer->set_id(i + generation * LAYER_COUNT);
+            layer->set_name("com.example.app/com.example.app.MainActivity#" +
+                            std::to_string(layer->id()));
+            layer->set_z(i);
+            layer->mutable_position()->set_x(i % 10 == 0 ? static_cast<float>(frame) : 0.f);
+            for (int j = 0; j < 4; j++) {
+                RectProto* rect = layer->mutable_visible_region()->add_rect();
+                rect->set_left(j * 100);
+                rect->set_top(i * 10);
+                rect->set_right(j * 100 + 50);
+                rect->set_bottom(i * 10 + 50);
+            }
+        }
+        return entry;
+    }
+
+    void addEntries(int begin, int end) {
+        for (int frame = begin; frame < end; frame++) {
+            LayersTraceProto entry = makeEntry(frame);
+            mBuffer.emplace(std::move(entry));
+        }
+    }
+
+    void verifyEntries(int begin, int end) {
+        LayersTraceFileProto fileProto;
+        mBuffer.writeToProto(fileProto);
+        ASSERT_EQ(end - begin, fileProto.entry_size());
+        for (int frame = begin; frame < end; frame++) {
+            EXPECT_EQ(makeEntry(frame).SerializeAsString(),
+                      fileProto.entry(frame - begin).SerializeAsString())
+                    << "frame " << frame;
+        }
+    }
+
+    LayerTraceBuffer mBuffer;
+};
+
+TEST_F(LayerTraceBufferTest, reconstructsEntries) {
+    addEntries(0, 200);
+    verifyEntries(0, 200);
+}
+
+TEST_F(LayerTraceBufferTest, storesDiffs) {
+    addEntries(0, 200);
+
+    size_t fullSize = 0;
+    for (int frame = 0; frame < 200; frame++) {
+        fullSize += makeEntry(frame).ByteSizeLong();
+    }
+    EXPECT_LT(mBuffer.used() * 4, fullSize);
+}
+
+TEST_F(LayerTraceBufferTest, evictsWholeKeyframeIntervals) {
+    const size_t entrySize = makeEntry(0).ByteSizeLong();
+    mBuffer.setSize(entrySize * 8);
+    addEntries(0, 500);
+
+    LayersTraceFileProto fileProto;
+    mBuffer.writeToProto(fileProto);
+    ASSERT_GT(fileProto.entry_size(), 0);
+    EXPECT_LE(mBuffer.used(), mBuffer.size());
+
+    // The oldest entries are the ones that were evicted, and the rest can still be reconstructed.
+    const int begin = 500 - fileProto.entry_size();
+    verifyEntries(begin, 500);
+}
+
+TEST_F(LayerTraceBufferTest, keyframeReplacesEvictedBase) {
+    // Only one entry fits at a time, so every entry becomes a keyframe once the one that it was
+    // diffed against is evicted.
+    mBuffer.setSize(makeEntry(0).ByteSizeLong() + 64);
+    addEntries(0, 10);
+    EXPECT_EQ(1u, mBuffer.frameCount());
+    verifyEntries(9, 10);
+}
+
+TEST_F(LayerTraceBufferTest, storesEntriesWithDuplicateIdsInFull) {
+    LayersTraceProto entry = makeEntry(1);
+    entry.mutable_layers()->add_layers()->CopyFrom(entry.layers().layers(3));
+    const std::string expected = entry.SerializeAsString();
+
+    addEntries(0, 1);
+    mBuffer.emplace(std::move(entry));
+    addEntries(2, 3);
+
+    LayersTraceFileProto fileProto;
+    mBuffer.writeToProto(fileProto);
+    ASSERT_EQ(3, fileProto.entry_size());
+    EXPECT_EQ(expected, fileProto.entry(1).SerializeAsString());
+    EXPECT_EQ(makeEntry(2).SerializeAsString(), fileProto.entry(2).SerializeAsString());
+}
+
+TEST_F(LayerTraceBufferTest, dropsEntryLargerThanBuffer) {
+    addEntries(0, 10);
+    mBuffer.setSize(16);
+    addEntries(10, 11);
+    EXPECT_EQ(0u, mBuffer.frameCount());
+    EXPECT_EQ(0u, mBuffer.used());
+
+    mBuffer.setSize(LARGE_BUFFER_SIZE);
+    addEntries(11, 20);
+    verifyEntries(11, 20);
+}
+
+} // namespace android
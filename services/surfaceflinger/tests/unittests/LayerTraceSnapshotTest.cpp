@@ -0,0 +1,107 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "Tracing/LayerTraceSnapshot.h"
+
+using namespace android::surfaceflinger;
+
+namespace android {
+
+using ::testing::ElementsAre;
+
+static LayerTraceSnapshot makeSnapshot(int32_t id, int32_t parent) {
+    LayerTraceSnapshot snapshot;
+    snapshot.id = id;
+    snapshot.name = "layer#" + std::to_string(id);
+    snapshot.parent = parent;
+    return snapshot;
+}
+
+TEST(LayerTraceSnapshotTest, writesLayerState) {
+    LayerTraceSnapshot snapshot = makeSnapshot(1, -1);
+    snapshot.children = {2, 3};
+    snapshot.z = 5;
+    snapshot.layerStack = ui::LayerStack::fromValue(4);
+    snapshot.crop = Rect(10, 20, 30, 40);
+    snapshot.damageRegion = Region(Rect(0, 0, 5, 5));
+    snapshot.activeBuffer = LayerTraceSnapshot::ActiveBuffer{.width = 100,
+                                                             .height = 200,
+                                                             .format = PIXEL_FORMAT_RGBA_8888};
+    snapshot.metadata.emplace();
+    snapshot.metadata->setInt32(7, 42);
+
+    LayersProto layersProto;
+    snapshot.writeToProto(layersProto.add_layers());
+
+    ASSERT_EQ(1, layersProto.layers_size());
+    const LayerProto& layer = layersProto.layers(0);
+    EXPECT_EQ(1, layer.id());
+    EXPECT_EQ("layer#1", layer.name());
+    EXPECT_EQ(-1, layer.parent());
+    EXPECT_THAT(layer.children(), ElementsAre(2, 3));
+    EXPECT_EQ(5, layer.z());
+    EXPECT_EQ(4u, layer.layer_stack());
+    EXPECT_EQ(10, layer.crop().left());
+    EXPECT_EQ(40, layer.crop().bottom());
+    ASSERT_EQ(1, layer.damage_region().rect_size());
+    EXPECT_EQ(5, layer.damage_region().rect(0).right());
+    EXPECT_EQ(100u, layer.active_buffer().width());
+    EXPECT_EQ(200u, layer.active_buffer().height());
+    EXPECT_EQ(PIXEL_FORMAT_RGBA_8888, layer.active_buffer().format());
+    EXPECT_EQ(1u, layer.metadata().count(7));
+    EXPECT_FALSE(layer.has_input_window_info());
+    EXPECT_FALSE(layer.has_visible_region());
+}
+
+TEST(LayerTraceSnapshotTest, parentsOffscreenLayersToFakeRoot) {
+    LayersTraceSnapshot snapshot;
+    snapshot.layers.push_back(makeSnapshot(1, -1));
+    snapshot.hasOffscreenLayers = true;
+    snapshot.offscreenLayers.push_back(
+            makeSnapshot(2, LayersTraceSnapshot::OFFSCREEN_ROOT_LAYER_ID));
+    snapshot.offscreenLayers.push_back(makeSnapshot(3, 2));
+    snapshot.offscreenLayers.push_back(
+            makeSnapshot(4, LayersTraceSnapshot::OFFSCREEN_ROOT_LAYER_ID));
+
+    LayersProto layersProto;
+    snapshot.writeToProto(layersProto);
+
+    ASSERT_EQ(5, layersProto.layers_size());
+    EXPECT_EQ(1, layersProto.layers(0).id());
+    const LayerProto& root = layersProto.layers(1);
+    EXPECT_EQ(LayersTraceSnapshot::OFFSCREEN_ROOT_LAYER_ID, root.id());
+    EXPECT_EQ("Offscreen Root", root.name());
+    EXPECT_EQ(-1, root.parent());
+    EXPECT_THAT(root.children(), ElementsAre(2, 4));
+    EXPECT_EQ(3, layersProto.layers(3).id());
+    EXPECT_EQ(2, layersProto.layers(3).parent());
+}
+
+TEST(LayerTraceSnapshotTest, skipsOffscreenRootWithoutOffscreenLayers) {
+    LayersTraceSnapshot snapshot;
+    snapshot.layers.push_back(makeSnapshot(1, -1));
+
+    LayersProto layersProto;
+    snapshot.writeToProto(layersProto);
+
+    ASSERT_EQ(1, layersProto.layers_size());
+    EXPECT_EQ(1, layersProto.layers(0).id());
+}
+
+} // namespace android
@@ -0,0 +1,264 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "LibSurfaceFlingerUnittests"
+
+#include <gtest/gtest.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "LayerTestUtils.h"
+#include "TestableSurfaceFlinger.h"
+
+namespace android {
+namespace {
+
+using StateSet = LayerVector::StateSet;
+
+/**
+ * Checks that the cached z-order traversals of LayerVector visit the layers in the order of the
+ * recursive traversal of the layers, as the hierarchy and the z-order change.
+ */
+class LayerTraversalTest : public BaseLayerTest {
+protected:
+    sp<Layer> createLayer(int32_t z) {
+        sp<Layer> layer = GetParam()->createLayer(mFlinger);
+        layer->setLayer(z);
+        return layer;
+    }
+
+    sp<Layer> createRootLayer(int32_t z) {
+        sp<Layer> layer = createLayer(z);
+        addRootLayer(layer);
+        return layer;
+    }
+
+    void addRootLayer(const sp<Layer>& layer) {
+        mRoots.add(layer);
+        LayerVector::invalidateZOrderCaches();
+    }
+
+    sp<Layer> createChildLayer(const sp<Layer>& parent, int32_t z) {
+        sp<Layer> layer = createLayer(z);
+        parent->addChild(layer);
+        return layer;
+    }
+
+    // Sets the relative layer of a child or of a layer which is not a root yet, since roots
+    // would have to be sorted again.
+    void setRelativeLayer(const sp<Layer>& layer, const sp<Layer>& relative, int32_t z) {
+        const sp<Layer> parent = layer->getParent();
+        if (parent != nullptr) {
+            ASSERT_TRUE(parent->setChildRelativeLayer(layer, getHandle(relative), z));
+        } else {
+            ASSERT_TRUE(layer->setRelativeLayer(getHandle(relative), z));
+        }
+    }
+
+    // Layers only create their handle once.
+    const sp<IBinder>& getHandle(const sp<Layer>& layer) {
+        sp<IBinder>& handle = mHandles[layer.get()];
+        if (handle == nullptr) {
+            handle = layer->getHandle();
+        }
+        return handle;
+    }
+
+    void commitChildList() {
+        for (const sp<Layer>& root : mRoots) {
+            root->commitChildList();
+        }
+    }
+
+    std::vector<Layer*> traverse(StateSet stateSet, bool reverse) const {
+        std::vector<Layer*> layers;
+        const auto visitor = [&layers](Layer* layer) { layers.push_back(layer); };
+        if (reverse) {
+            mRoots.traverseInReverseZOrder(stateSet, visitor);
+        } else {
+            mRoots.traverseInZOrder(stateSet, visitor);
+        }
+        return layers;
+    }
+
+    // The traversal of the layers done by LayerVector before it cached them.
+    std::vector<Layer*> traverseRecursively(StateSet stateSet, bool reverse) const {
+        std::vector<Layer*> layers;
+        const auto visitor = [&layers](Layer* layer) { layers.push_back(layer); };
+        for (size_t i = 0; i < mRoots.size(); i++) {
+            const sp<Layer>& layer = mRoots[reverse ? mRoots.size() - 1 - i : i];
+            if (layer->getDrawingState().isRelativeOf) {
+                continue;
+            }
+            if (reverse) {
+                layer->traverseInReverseZOrder(stateSet, visitor);
+            } else {
+                layer->traverseInZOrder(stateSet, visitor);
+            }
+        }
+        return layers;
+    }
+
+    void expectSameTraversals(StateSet stateSet) {
+        for (bool reverse : {false, true}) {
+            SCOPED_TRACE(reverse ? "reverse" : "forward");
+            const std::vector<Layer*> expected = traverseRecursively(stateSet, reverse);
+            EXPECT_EQ(expected, traverse(stateSet, reverse));
+            // The second traversal uses the cached list.
+            EXPECT_EQ(expected, traverse(stateSet, reverse));
+        }
+    }
+
+    void expectSameTraversals() {
+        commitChildList();
+        expectSameTraversals(StateSet::Current);
+        expectSameTraversals(StateSet::Drawing);
+    }
+
+    // Layers are held by the handles, so they are destroyed before mFlinger.
+    std::unordered_map<Layer*, sp<IBinder>> mHandles;
+    LayerVector mRoots{StateSet::Current};
+};
+
+INSTANTIATE_TEST_SUITE_P(PerLayerType, LayerTraversalTest,
+                         testing::Values(std::make_shared<BufferStateLayerFactory>(),
+                                         std::make_shared<EffectLayerFactory>()),
+                         PrintToStringParamName);
+
+TEST_P(LayerTraversalTest, traversesChildrenInZOrder) {
+    sp<Layer> root = createRootLayer(0);
+    sp<Layer> below = createChildLayer(root, -1);
+    sp<Layer> above = createChildLayer(root, 2);
+    sp<Layer> middle = createChildLayer(root, 1);
+    sp<Layer> grandChild = createChildLayer(below, -3);
+
+    commitChildList();
+    const std::vector<Layer*> expected = {grandChild.get(), below.get(), root.get(), middle.get(),
+                                          above.get()};
+    EXPECT_EQ(expected, traverse(StateSet::Current, /*reverse=*/false));
+    EXPECT_EQ(std::vector<Layer*>(expected.rbegin(), expected.rend()),
+              traverse(StateSet::Current, /*reverse=*/true));
+    expectSameTraversals();
+}
+
+TEST_P(LayerTraversalTest, traversesRelativesUnderTheirRelative) {
+    sp<Layer> root1 = createRootLayer(1);
+    sp<Layer> root2 = createRootLayer(2);
+    sp<Layer> child1 = createChildLayer(root1, 1);
+    sp<Layer> child2 = createChildLayer(root2, 1);
+    sp<Layer> relativeRoot = createLayer(3);
+    setRelativeLayer(relativeRoot, child1, -1);
+    addRootLayer(relativeRoot);
+    setRelativeLayer(child2, root1, 2);
+
+    commitChildList();
+    const std::vector<Layer*> expected = {root1.get(), relativeRoot.get(), child1.get(),
+                                          child2.get(), root2.get()};
+    EXPECT_EQ(expected, traverse(StateSet::Current, /*reverse=*/false));
+    expectSameTraversals();
+}
+
+TEST_P(LayerTraversalTest, updatesAfterZChange) {
+    sp<Layer> root = createRootLayer(0);
+    sp<Layer> child1 = createChildLayer(root, 1);
+    sp<Layer> child2 = createChildLayer(root, 2);
+    expectSameTraversals();
+
+    ASSERT_TRUE(root->setChildLayer(child1, 3));
+    expectSameTraversals();
+    EXPECT_EQ(child1.get(), traverse(StateSet::Current, /*reverse=*/false).back());
+
+    ASSERT_TRUE(root->setChildLayer(child2, -1));
+    expectSameTraversals();
+    EXPECT_EQ(child2.get(), traverse(StateSet::Current, /*reverse=*/false).front());
+}
+
+TEST_P(LayerTraversalTest, updatesAfterRelativeZChange) {
+    sp<Layer> root1 = createRootLayer(1);
+    sp<Layer> root2 = createRootLayer(2);
+    sp<Layer> child = createChildLayer(root1, 1);
+    sp<Layer> relative = createChildLayer(root2, 1);
+    expectSameTraversals();
+
+    setRelativeLayer(relative, child, 1);
+    expectSameTraversals();
+    EXPECT_EQ(root2.get(), traverse(StateSet::Current, /*reverse=*/false).back());
+
+    setRelativeLayer(relative, root1, -1);
+    expectSameTraversals();
+    EXPECT_EQ(relative.get(), traverse(StateSet::Current, /*reverse=*/false).front());
+
+    // Setting the layer discards the relative z.
+    ASSERT_TRUE(root2->setChildLayer(relative, -1));
+    expectSameTraversals();
+    EXPECT_EQ(relative.get(), traverse(StateSet::Current, /*reverse=*/false)[2]);
+}
+
+TEST_P(LayerTraversalTest, updatesAfterHierarchyChange) {
+    sp<Layer> root = createRootLayer(0);
+    sp<Layer> child = createChildLayer(root, 1);
+    expectSameTraversals();
+
+    sp<Layer> grandChild = createChildLayer(child, 1);
+    expectSameTraversals();
+    EXPECT_EQ(3u, traverse(StateSet::Current, /*reverse=*/false).size());
+
+    root->removeChild(child);
+    expectSameTraversals();
+    EXPECT_EQ(std::vector<Layer*>{root.get()}, traverse(StateSet::Current, /*reverse=*/false));
+
+    sp<Layer> root2 = createRootLayer(-1);
+    root2->addChild(child);
+    expectSameTraversals();
+    EXPECT_EQ(4u, traverse(StateSet::Current, /*reverse=*/false).size());
+}
+
+TEST_P(LayerTraversalTest, drawingStateUpdatesOnCommit) {
+    sp<Layer> root = createRootLayer(0);
+    sp<Layer> child1 = createChildLayer(root, 1);
+    commitChildList();
+    EXPECT_EQ(2u, traverse(StateSet::Drawing, /*reverse=*/false).size());
+
+    sp<Layer> child2 = createChildLayer(root, 2);
+    EXPECT_EQ(3u, traverse(StateSet::Current, /*reverse=*/false).size());
+    EXPECT_EQ(2u, traverse(StateSet::Drawing, /*reverse=*/false).size());
+
+    commitChildList();
+    EXPECT_EQ(3u, traverse(StateSet::Drawing, /*reverse=*/false).size());
+    expectSameTraversals();
+}
+
+TEST_P(LayerTraversalTest, drawingStateCopyUpdatesTraversal) {
+    sp<Layer> root1 = createRootLayer(0);
+    LayerVector drawingRoots(StateSet::Drawing);
+    drawingRoots = mRoots;
+    EXPECT_EQ(1u, drawingRoots.size());
+
+    size_t count = 0;
+    drawingRoots.traverseInZOrder(StateSet::Drawing, [&count](Layer*) { count++; });
+    EXPECT_EQ(1u, count);
+
+    sp<Layer> root2 = createRootLayer(1);
+    drawingRoots = mRoots;
+    count = 0;
+    drawingRoots.traverseInZOrder(StateSet::Drawing, [&count](Layer*) { count++; });
+    EXPECT_EQ(2u, count);
+}
+
+} // namespace
+} // namespace android
@@ -391,6 +391,11 @@ public:
         return mFlinger->commitTransactionsLocked(transactionFlags);
     }
 
+    void buildWindowInfos(std::vector<gui::WindowInfo>& outWindowInfos,
+                          std::vector<gui::DisplayInfo>& outDisplayInfos) {
+        mFlinger->buildWindowInfos(outWindowInfos, outDisplayInfos);
+    }
+
     void onComposerHalHotplug(hal::HWDisplayId hwcDisplayId, hal::Connection connection) {
         mFlinger->onComposerHalHotplug(hwcDisplayId, connection);
     }
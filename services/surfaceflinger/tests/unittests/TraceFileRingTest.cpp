@@ -0,0 +1,115 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "Tracing/TraceFileRing.h"
+
+namespace android {
+
+using RecordType = TraceFileRing::RecordType;
+
+class TraceFileRingTest : public testing::Test {
+protected:
+    static constexpr size_t RING_SIZE = 1024;
+
+    void SetUp() override { ASSERT_EQ(NO_ERROR, mRing.open(mFile.path, RING_SIZE)); }
+
+    std::vector<std::pair<RecordType, std::string>> readRecords() {
+        std::vector<std::pair<RecordType, std::string>> records;
+        EXPECT_EQ(NO_ERROR,
+                  TraceFileRing::read(mFile.path, [&](RecordType type, std::string_view data) {
+                      records.emplace_back(type, data);
+                  }));
+        return records;
+    }
+
+    static std::string makeRecord(size_t index, size_t size) {
+        std::string record = std::to_string(index);
+        record.resize(size, '.');
+        return record;
+    }
+
+    TemporaryFile mFile;
+    TraceFileRing mRing;
+};
+
+TEST_F(TraceFileRingTest, readsRecordsInOrder) {
+    ASSERT_EQ(NO_ERROR, mRing.append(RecordType::SNAPSHOT, "state"));
+    ASSERT_EQ(NO_ERROR, mRing.append(RecordType::ENTRY, "first"));
+    ASSERT_EQ(NO_ERROR, mRing.append(RecordType::ENTRY, ""));
+    EXPECT_EQ(3u, mRing.recordCount());
+    EXPECT_TRUE(TraceFileRing::isTraceFileRing(mFile.path));
+
+    const auto records = readRecords();
+    ASSERT_EQ(3u, records.size());
+    EXPECT_EQ(RecordType::SNAPSHOT, records[0].first);
+    EXPECT_EQ("state", records[0].second);
+    EXPECT_EQ(RecordType::ENTRY, records[1].first);
+    EXPECT_EQ("first", records[1].second);
+    EXPECT_EQ("", records[2].second);
+}
+
+TEST_F(TraceFileRingTest, overwritesOldestRecords) {
+    // Record sizes that do not divide the ring exercise the padding at its end.
+    constexpr size_t RECORD_SIZE = 100;
+    constexpr size_t RECORD_COUNT = 100;
+    for (size_t i = 0; i < RECORD_COUNT; i++) {
+        ASSERT_EQ(NO_ERROR, mRing.append(RecordType::ENTRY, makeRecord(i, RECORD_SIZE)));
+        ASSERT_LE(mRing.used(), mRing.size());
+    }
+
+    const auto records = readRecords();
+    ASSERT_FALSE(records.empty());
+    EXPECT_EQ(mRing.recordCount(), records.size());
+    EXPECT_LT(records.size(), RECORD_COUNT);
+    EXPECT_GE(records.size(), RING_SIZE / (RECORD_SIZE + 8) - 2);
+
+    const size_t first = RECORD_COUNT - records.size();
+    for (size_t i = 0; i < records.size(); i++) {
+        EXPECT_EQ(RecordType::ENTRY, records[i].first);
+        EXPECT_EQ(makeRecord(first + i, RECORD_SIZE), records[i].second);
+    }
+}
+
+TEST_F(TraceFileRingTest, rejectsRecordLargerThanRing) {
+    ASSERT_EQ(NO_ERROR, mRing.append(RecordType::ENTRY, "kept"));
+    EXPECT_EQ(BAD_VALUE, mRing.append(RecordType::ENTRY, std::string(RING_SIZE, 'x')));
+
+    const auto records = readRecords();
+    ASSERT_EQ(1u, records.size());
+    EXPECT_EQ("kept", records[0].second);
+}
+
+TEST_F(TraceFileRingTest, rejectsOtherFiles) {
+    TemporaryFile other;
+    ASSERT_TRUE(base::WriteStringToFile(std::string(8192, 'x'), other.path));
+    EXPECT_FALSE(TraceFileRing::isTraceFileRing(other.path));
+    EXPECT_EQ(BAD_TYPE, TraceFileRing::read(other.path, [](RecordType, std::string_view) {}));
+}
+
+TEST_F(TraceFileRingTest, reopeningTruncates) {
+    ASSERT_EQ(NO_ERROR, mRing.append(RecordType::ENTRY, "old"));
+    ASSERT_EQ(NO_ERROR, mRing.open(mFile.path, RING_SIZE));
+    EXPECT_EQ(0u, mRing.recordCount());
+    EXPECT_TRUE(readRecords().empty());
+}
+
+} // namespace android
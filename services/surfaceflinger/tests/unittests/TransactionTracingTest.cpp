@@ -14,12 +14,14 @@
  * limitations under the License.
  */
 
+#include <android-base/file.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include <gui/SurfaceComposerClient.h>
 
 #include "Tracing/RingBuffer.h"
+#include "Tracing/TraceFileRing.h"
 #include "Tracing/TransactionTracing.h"
 
 using namespace android::surfaceflinger;
@@ -282,4 +284,93 @@ TEST_F(TransactionTracingMirrorLayerTest, canAddMirrorLayers) {
     EXPECT_EQ(proto.entry(0).transactions(0).layer_changes().size(), 2);
     EXPECT_EQ(proto.entry(0).transactions(0).layer_changes(1).z(), 43);
 }
+
+class TransactionTracingStreamingTest : public TransactionTracingTest {
+protected:
+    static constexpr size_t STREAMING_FILE_SIZE = 4096;
+
+    void SetUp() override {
+        ASSERT_EQ(NO_ERROR, mTracing.enableStreaming(mFile.path, STREAMING_FILE_SIZE));
+    }
+
+    std::vector<std::pair<TraceFileRing::RecordType, proto::TransactionTraceEntry>> readRecords() {
+        std::vector<std::pair<TraceFileRing::RecordType, proto::TransactionTraceEntry>> records;
+        const auto visitor = [&](TraceFileRing::RecordType type, std::string_view data) {
+            proto::TransactionTraceEntry entry;
+            EXPECT_TRUE(entry.ParseFromArray(data.data(), static_cast<int>(data.size())));
+            records.emplace_back(type, std::move(entry));
+        };
+        EXPECT_EQ(NO_ERROR, TraceFileRing::read(mFile.path, visitor));
+        return records;
+    }
+
+    TemporaryFile mFile;
+    int64_t mVsyncId = 0;
+};
+
+TEST_F(TransactionTracingStreamingTest, streamsEntriesAfterSnapshot) {
+    for (int i = 0; i < 10; i++) {
+        queueAndCommitTransaction(++mVsyncId);
+    }
+    EXPECT_EQ(NO_ERROR, mTracing.writeToFile());
+
+    const auto records = readRecords();
+    ASSERT_EQ(11u, records.size());
+    EXPECT_EQ(TraceFileRing::RecordType::SNAPSHOT, records[0].first);
+    for (size_t i = 1; i < records.size(); i++) {
+        EXPECT_EQ(TraceFileRing::RecordType::ENTRY, records[i].first);
+        EXPECT_EQ(static_cast<int64_t>(i), records[i].second.vsync_id());
+    }
+}
+
+TEST_F(TransactionTracingStreamingTest, snapshotsReplaceOverwrittenEntries) {
+    const sp<IBinder> fakeLayerHandle = new BBinder();
+    mTracing.onLayerAdded(fakeLayerHandle->localBinder(), 1 /* layerId */, "layer",
+                          123 /* flags */, -1 /* parentId */);
+    {
+        TransactionState transaction;
+        transaction.id = 1;
+        ComposerState layerState;
+        layerState.state.surface = fakeLayerHandle;
+        layerState.state.what = layer_state_t::eLayerChanged;
+        layerState.state.z = 42;
+        transaction.states.add(layerState);
+        mTracing.addQueuedTransaction(transaction);
+
+        std::vector<TransactionState> transactions;
+        transactions.emplace_back(transaction);
+        mTracing.addCommittedTransactions(transactions, ++mVsyncId);
+        flush(mVsyncId);
+    }
+
+    // Keep going until the entry that changed the layer has been overwritten.
+    const int64_t layerChangeVsyncId = mVsyncId;
+    while (true) {
+        queueAndCommitTransaction(++mVsyncId);
+        const auto records = readRecords();
+        ASSERT_FALSE(records.empty());
+        if (records.front().second.vsync_id() > layerChangeVsyncId) break;
+    }
+
+    const auto records = readRecords();
+    const auto snapshot = std::find_if(records.begin(), records.end(), [](const auto& record) {
+        return record.first == TraceFileRing::RecordType::SNAPSHOT;
+    });
+    ASSERT_NE(snapshot, records.end());
+    const proto::TransactionTraceEntry& state = snapshot->second;
+    EXPECT_EQ(state.added_layers().size(), 1);
+    EXPECT_EQ(state.added_layers(0).layer_id(), 1);
+    ASSERT_EQ(state.transactions().size(), 1);
+    ASSERT_EQ(state.transactions(0).layer_changes().size(), 1);
+    EXPECT_EQ(state.transactions(0).layer_changes(0).z(), 42);
+
+    // The entries after the snapshot pick up where it left off.
+    int64_t vsyncId = 0;
+    for (auto it = snapshot + 1; it != records.end(); ++it) {
+        if (it->first != TraceFileRing::RecordType::ENTRY) continue;
+        EXPECT_TRUE(vsyncId == 0 || it->second.vsync_id() == vsyncId + 1);
+        vsyncId = it->second.vsync_id();
+    }
+    EXPECT_EQ(mVsyncId, vsyncId);
+}
 } // namespace android
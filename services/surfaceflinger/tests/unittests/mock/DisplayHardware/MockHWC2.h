@@ -35,13 +35,13 @@ public:
                 (const, override));
     MOCK_METHOD(bool, isVsyncPeriodSwitchSupported, (), (const, override));
     MOCK_METHOD(void, onLayerDestroyed, (hal::HWLayerId), (override));
+    MOCK_METHOD(void, resetLayersSentState, (), (override));
 
     MOCK_METHOD(hal::Error, acceptChanges, (), (override));
     MOCK_METHOD((base::expected<std::shared_ptr<HWC2::Layer>, hal::Error>), createLayer, (),
                 (override));
     MOCK_METHOD(hal::Error, getChangedCompositionTypes,
-                ((std::unordered_map<Layer *,
-                                     aidl::android::hardware::graphics::composer3::Composition> *)),
+                (HWC2::LayerSlotArray<aidl::android::hardware::graphics::composer3::Composition> *),
                 (override));
     MOCK_METHOD(hal::Error, getColorModes, (std::vector<hal::ColorMode> *), (const, override));
     MOCK_METHOD(int32_t, getSupportedPerFrameMetadata, (), (const, override));
@@ -51,8 +51,7 @@ public:
                 (override));
     MOCK_METHOD(hal::Error, getName, (std::string *), (const, override));
     MOCK_METHOD(hal::Error, getRequests,
-                (hal::DisplayRequest *, (std::unordered_map<Layer *, hal::LayerRequest> *)),
-                (override));
+                (hal::DisplayRequest *, HWC2::LayerSlotArray<hal::LayerRequest> *), (override));
     MOCK_METHOD(hal::Error, getConnectionType, (ui::DisplayConnectionType *), (const, override));
     MOCK_METHOD(hal::Error, supportsDoze, (bool *), (const, override));
     MOCK_METHOD(hal::Error, getHdrCapabilities, (android::HdrCapabilities *), (const, override));
@@ -63,7 +62,7 @@ public:
     MOCK_METHOD(hal::Error, getDisplayedContentSample,
                 (uint64_t, uint64_t, android::DisplayedFrameStats *), (const, override));
     MOCK_METHOD(hal::Error, getReleaseFences,
-                ((std::unordered_map<Layer *, android::sp<android::Fence>> *)), (const, override));
+                (HWC2::LayerSlotArray<android::sp<android::Fence>> *), (const, override));
     MOCK_METHOD(hal::Error, present, (android::sp<android::Fence> *), (override));
     MOCK_METHOD(hal::Error, setClientTarget,
                 (uint32_t, const android::sp<android::GraphicBuffer> &,
@@ -113,11 +112,13 @@ public:
     ~Layer() override;
 
     MOCK_METHOD(hal::HWLayerId, getId, (), (const, override));
+    MOCK_METHOD(uint32_t, getDisplaySlot, (), (const, override));
     MOCK_METHOD(hal::Error, setCursorPosition, (int32_t, int32_t), (override));
     MOCK_METHOD(hal::Error, setBuffer,
                 (uint32_t, const android::sp<android::GraphicBuffer> &,
                  const android::sp<android::Fence> &),
                 (override));
+    MOCK_METHOD(hal::Error, clearBufferSlots, (const std::vector<uint32_t> &), (override));
     MOCK_METHOD(hal::Error, setSurfaceDamage, (const android::Region &), (override));
     MOCK_METHOD(hal::Error, setBlendMode, (hal::BlendMode), (override));
     MOCK_METHOD(hal::Error, setColor, (aidl::android::hardware::graphics::composer3::Color),
@@ -29,20 +29,29 @@ bool DelayedCallback::isExpired() const {
     return mExpiration <= std::chrono::steady_clock::now();
 }
 
+CallbackId DelayedCallback::getId() const {
+    return mId;
+}
+
 DelayedCallback::Timestamp DelayedCallback::getExpiration() const {
     return mExpiration;
 }
 
+void DelayedCallback::setDelay(std::chrono::milliseconds delay) {
+    mExpiration = std::chrono::steady_clock::now() + delay;
+}
+
 void DelayedCallback::run() const {
     mCallback();
 }
 
 bool DelayedCallback::operator<(const DelayedCallback& other) const {
-    return mExpiration < other.mExpiration;
+    return mExpiration < other.mExpiration ||
+            (mExpiration == other.mExpiration && mId < other.mId);
 }
 
 bool DelayedCallback::operator>(const DelayedCallback& other) const {
-    return mExpiration > other.mExpiration;
+    return other < *this;
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -59,36 +68,141 @@ CallbackScheduler::~CallbackScheduler() {
 }
 
 void CallbackScheduler::schedule(std::function<void()> callback, std::chrono::milliseconds delay) {
+    scheduleCancellable(std::move(callback), delay);
+}
+
+CallbackId CallbackScheduler::scheduleCancellable(std::function<void()> callback,
+                                                  std::chrono::milliseconds delay) {
+    CallbackId id;
+    bool expiresFirst;
     {
         std::lock_guard<std::mutex> lock(mMutex);
         if (mCallbackThread == nullptr) {
             mCallbackThread = std::make_unique<std::thread>(&CallbackScheduler::loop, this);
         }
-        mQueue.emplace(DelayedCallback(callback, delay));
+        id = mNextId++;
+        expiresFirst = push(DelayedCallback(id, std::move(callback), delay));
     }
-    mCondition.notify_all();
+    // The callback thread only needs to wake up earlier if this is the next callback to expire.
+    if (expiresFirst) {
+        mCondition.notify_all();
+    }
+    return id;
+}
+
+bool CallbackScheduler::cancel(CallbackId id) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mHeapPositions.find(id);
+    if (it == mHeapPositions.end()) {
+        return false;
+    }
+    // The callback thread will wake up at the old expiration and go back to sleep, which is
+    // cheaper than waking it up now.
+    pop(it->second);
+    return true;
+}
+
+bool CallbackScheduler::reschedule(CallbackId id, std::chrono::milliseconds delay) {
+    bool expiresFirst;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mHeapPositions.find(id);
+        if (it == mHeapPositions.end()) {
+            return false;
+        }
+        size_t position = it->second;
+        mHeap[position].setDelay(delay);
+        expiresFirst = siftDown(siftUp(position)) == 0;
+    }
+    if (expiresFirst) {
+        mCondition.notify_all();
+    }
+    return true;
+}
+
+bool CallbackScheduler::push(DelayedCallback callback) {
+    mHeapPositions[callback.getId()] = mHeap.size();
+    mHeap.push_back(std::move(callback));
+    return siftUp(mHeap.size() - 1) == 0;
+}
+
+DelayedCallback CallbackScheduler::pop(size_t position) {
+    size_t last = mHeap.size() - 1;
+    if (position != last) {
+        swap(position, last);
+    }
+    DelayedCallback callback = std::move(mHeap.back());
+    mHeap.pop_back();
+    mHeapPositions.erase(callback.getId());
+    if (position != last) {
+        siftDown(siftUp(position));
+    }
+    return callback;
+}
+
+size_t CallbackScheduler::siftUp(size_t position) {
+    while (position > 0) {
+        size_t parent = (position - 1) / 2;
+        if (!(mHeap[position] < mHeap[parent])) {
+            break;
+        }
+        swap(position, parent);
+        position = parent;
+    }
+    return position;
+}
+
+size_t CallbackScheduler::siftDown(size_t position) {
+    while (true) {
+        size_t first = position;
+        size_t left = 2 * position + 1;
+        size_t right = left + 1;
+        if (left < mHeap.size() && mHeap[left] < mHeap[first]) {
+            first = left;
+        }
+        if (right < mHeap.size() && mHeap[right] < mHeap[first]) {
+            first = right;
+        }
+        if (first == position) {
+            return position;
+        }
+        swap(position, first);
+        position = first;
+    }
+}
+
+void CallbackScheduler::swap(size_t a, size_t b) {
+    std::swap(mHeap[a], mHeap[b]);
+    mHeapPositions[mHeap[a].getId()] = a;
+    mHeapPositions[mHeap[b].getId()] = b;
 }
 
 void CallbackScheduler::loop() {
+    std::unique_lock<std::mutex> lock(mMutex);
     while (true) {
-        std::unique_lock<std::mutex> lock(mMutex);
         if (mFinished) {
             // Destructor was called, so let the callback thread die.
             break;
         }
-        while (!mQueue.empty() && mQueue.top().isExpired()) {
-            DelayedCallback callback = mQueue.top();
-            mQueue.pop();
+        // Take all the expired callbacks at once, then run them without holding the lock.
+        while (!mHeap.empty() && mHeap.front().isExpired()) {
+            mExpiredCallbacks.push_back(pop(0));
+        }
+        if (!mExpiredCallbacks.empty()) {
             lock.unlock();
-            callback.run();
+            for (const DelayedCallback& callback : mExpiredCallbacks) {
+                callback.run();
+            }
+            mExpiredCallbacks.clear();
             lock.lock();
+            continue;
         }
-        if (mQueue.empty()) {
+        if (mHeap.empty()) {
             // Wait until a new callback is scheduled.
-            mCondition.wait(mMutex);
+            mCondition.wait(lock);
         } else {
-            // Wait until next callback expires, or a new one is scheduled.
-            mCondition.wait_until(mMutex, mQueue.top().getExpiration());
+            // Wait until next callback expires, or an earlier one is scheduled.
+            mCondition.wait_until(lock, mHeap.front().getExpiration());
         }
     }
 }
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "VibratorCallbackSchedulerBenchmarks"
+
+#include <benchmark/benchmark.h>
+#include <vibratorservice/VibratorCallbackScheduler.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+using ::benchmark::State;
+
+using namespace android;
+using namespace std::chrono_literals;
+
+// Delay long enough for the callbacks to never run during a benchmark.
+static constexpr std::chrono::milliseconds PENDING_DELAY = 1h;
+
+// Schedules state.range(0) callbacks that stay pending during the benchmark.
+static std::vector<vibrator::CallbackId> schedulePending(vibrator::CallbackScheduler& scheduler,
+                                                        const State& state) {
+    std::vector<vibrator::CallbackId> ids;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        ids.push_back(scheduler.scheduleCancellable([]() {}, PENDING_DELAY + i * 1ms));
+    }
+    return ids;
+}
+
+static void BM_CallbackScheduler_scheduleAndCancel(State& state) {
+    vibrator::CallbackScheduler scheduler;
+    schedulePending(scheduler, state);
+    std::chrono::milliseconds delay = 0ms;
+    for (auto _ : state) {
+        // Spread the delays over the pending ones, so the heap is walked at different depths.
+        delay = (delay + 7ms) % (state.range(0) + 1);
+        vibrator::CallbackId id = scheduler.scheduleCancellable([]() {}, PENDING_DELAY + delay);
+        scheduler.cancel(id);
+    }
+}
+
+static void BM_CallbackScheduler_reschedule(State& state) {
+    vibrator::CallbackScheduler scheduler;
+    std::vector<vibrator::CallbackId> ids = schedulePending(scheduler, state);
+    size_t index = 0;
+    std::chrono::milliseconds delay = 0ms;
+    for (auto _ : state) {
+        index = (index + 1) % ids.size();
+        delay = (delay + 7ms) % (state.range(0) + 1);
+        scheduler.reschedule(ids[index], PENDING_DELAY + delay);
+    }
+}
+
+// Time until a burst of state.range(0) callbacks expiring together have all run.
+static void BM_CallbackScheduler_runExpiredBurst(State& state) {
+    vibrator::CallbackScheduler scheduler;
+    std::mutex mutex;
+    std::condition_variable condition;
+    int64_t remaining = 0;
+    auto callback = [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--remaining == 0) {
+            condition.notify_one();
+        }
+    };
+    for (auto _ : state) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            remaining = state.range(0);
+        }
+        for (int64_t i = 0; i < state.range(0); i++) {
+            scheduler.schedule(callback, 0ms);
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&]() { return remaining == 0; });
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_CallbackScheduler_scheduleAndCancel)->Arg(1)->Arg(64)->Arg(1024);
+BENCHMARK(BM_CallbackScheduler_reschedule)->Arg(1)->Arg(64)->Arg(1024);
+BENCHMARK(BM_CallbackScheduler_runExpiredBurst)->Arg(1)->Arg(16)->Arg(256);
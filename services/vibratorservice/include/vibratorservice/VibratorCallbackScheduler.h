@@ -20,31 +20,42 @@
 #include <android-base/thread_annotations.h>
 #include <chrono>
 #include <condition_variable>
-#include <queue>
+#include <functional>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace android {
 
 namespace vibrator {
 
+// Handle to a callback scheduled with CallbackScheduler::scheduleCancellable.
+using CallbackId = int64_t;
+
 // Wrapper for a callback to be executed after a delay.
 class DelayedCallback {
 public:
     using Timestamp = std::chrono::time_point<std::chrono::steady_clock>;
 
-    DelayedCallback(std::function<void()> callback, std::chrono::milliseconds delay)
-          : mCallback(callback), mExpiration(std::chrono::steady_clock::now() + delay) {}
+    DelayedCallback(CallbackId id, std::function<void()> callback, std::chrono::milliseconds delay)
+          : mId(id),
+            mCallback(std::move(callback)),
+            mExpiration(std::chrono::steady_clock::now() + delay) {}
     ~DelayedCallback() = default;
 
     void run() const;
     bool isExpired() const;
+    CallbackId getId() const;
     Timestamp getExpiration() const;
+    void setDelay(std::chrono::milliseconds delay);
 
-    // Compare by expiration time, where A < B when A expires first.
+    // Compare by expiration time, where A < B when A expires first. Callbacks with the same
+    // expiration are ordered by id, so they run in the order they were scheduled.
     bool operator<(const DelayedCallback& other) const;
     bool operator>(const DelayedCallback& other) const;
 
 private:
+    CallbackId mId;
     std::function<void()> mCallback;
     Timestamp mExpiration;
 };
@@ -52,11 +63,23 @@ private:
 // Schedules callbacks to be executed after a delay.
 class CallbackScheduler {
 public:
-    CallbackScheduler() : mCallbackThread(nullptr), mFinished(false) {}
+    CallbackScheduler() : mCallbackThread(nullptr), mFinished(false), mNextId(0) {}
     virtual ~CallbackScheduler();
 
     virtual void schedule(std::function<void()> callback, std::chrono::milliseconds delay);
 
+    // Same as schedule, returning an id that can be used to cancel or reschedule the callback
+    // while it is still pending.
+    CallbackId scheduleCancellable(std::function<void()> callback,
+                                   std::chrono::milliseconds delay);
+
+    // Removes a pending callback. Returns false if the callback has already started running.
+    bool cancel(CallbackId id);
+
+    // Moves a pending callback to run after the new delay from now. Returns false if the callback
+    // has already started running.
+    bool reschedule(CallbackId id, std::chrono::milliseconds delay);
+
 private:
     std::condition_variable_any mCondition;
     std::mutex mMutex;
@@ -67,10 +90,23 @@ private:
     // Used to quit the callback thread when this instance is being destroyed.
     bool mFinished GUARDED_BY(mMutex);
 
-    // Priority queue with reverse comparator, so tasks that expire first will be on top.
-    std::priority_queue<DelayedCallback, std::vector<DelayedCallback>,
-                        std::greater<DelayedCallback>>
-            mQueue GUARDED_BY(mMutex);
+    CallbackId mNextId GUARDED_BY(mMutex);
+
+    // Binary min-heap, so the callback that expires first is at the front. Its position index
+    // allows pending callbacks to be cancelled or rescheduled in O(log n).
+    std::vector<DelayedCallback> mHeap GUARDED_BY(mMutex);
+    std::unordered_map<CallbackId, size_t> mHeapPositions GUARDED_BY(mMutex);
+
+    // Callbacks expired together, run by the callback thread after a single wakeup.
+    std::vector<DelayedCallback> mExpiredCallbacks;
+
+    // Adds a callback to the heap and returns true if it is now the first one to expire.
+    bool push(DelayedCallback callback) REQUIRES(mMutex);
+    DelayedCallback pop(size_t position) REQUIRES(mMutex);
+    // Moves the callback at position to its place in the heap and returns its new position.
+    size_t siftUp(size_t position) REQUIRES(mMutex);
+    size_t siftDown(size_t position) REQUIRES(mMutex);
+    void swap(size_t a, size_t b) REQUIRES(mMutex);
 
     void loop();
 };
@@ -122,3 +122,63 @@ TEST_F(VibratorCallbackSchedulerTest, TestDestructorDropsPendingCallbacksAndKill
     ASSERT_FALSE(waitForCallbacks(1, 10ms));
     ASSERT_TRUE(getExpiredCallbacks().empty());
 }
+
+TEST_F(VibratorCallbackSchedulerTest, TestDestructorWhileCallbackRunsKillsThread) {
+    mScheduler->schedule(
+            [this]() {
+                createCallback(1)();
+                std::this_thread::sleep_for(5ms);
+            },
+            0ms);
+    ASSERT_TRUE(waitForCallbacks(1, 10ms));
+
+    // Destroyed while the callback is still running, should not wait for new callbacks.
+    mScheduler.reset(nullptr);
+    ASSERT_THAT(getExpiredCallbacks(), ElementsAre(1));
+}
+
+TEST_F(VibratorCallbackSchedulerTest, TestCancelDropsPendingCallback) {
+    vibrator::CallbackId id = mScheduler->scheduleCancellable(createCallback(1), 5ms);
+    mScheduler->schedule(createCallback(2), 10ms);
+    ASSERT_TRUE(mScheduler->cancel(id));
+
+    ASSERT_TRUE(waitForCallbacks(1, 15ms));
+    ASSERT_THAT(getExpiredCallbacks(), ElementsAre(2));
+}
+
+TEST_F(VibratorCallbackSchedulerTest, TestCancelAfterRunReturnsFalse) {
+    vibrator::CallbackId id = mScheduler->scheduleCancellable(createCallback(1), 1ms);
+
+    ASSERT_TRUE(waitForCallbacks(1, 10ms));
+    ASSERT_FALSE(mScheduler->cancel(id));
+    ASSERT_FALSE(mScheduler->reschedule(id, 1ms));
+    ASSERT_THAT(getExpiredCallbacks(), ElementsAre(1));
+}
+
+TEST_F(VibratorCallbackSchedulerTest, TestRescheduleChangesDelay) {
+    vibrator::CallbackId first = mScheduler->scheduleCancellable(createCallback(1), 10ms);
+    vibrator::CallbackId second = mScheduler->scheduleCancellable(createCallback(2), 20ms);
+    ASSERT_TRUE(mScheduler->reschedule(first, 15ms));
+    ASSERT_TRUE(mScheduler->reschedule(second, 5ms));
+
+    ASSERT_TRUE(waitForCallbacks(2, 25ms));
+    ASSERT_THAT(getExpiredCallbacks(), ElementsAre(2, 1));
+}
+
+TEST_F(VibratorCallbackSchedulerTest, TestManyCallbacksWithSameDelayRunInScheduleOrder) {
+    std::vector<int32_t> expected;
+    for (int32_t i = 0; i < 100; i++) {
+        expected.push_back(i);
+    }
+    std::vector<vibrator::CallbackId> cancelled;
+    for (int32_t i = 0; i < 100; i++) {
+        mScheduler->schedule(createCallback(i), 5ms);
+        cancelled.push_back(mScheduler->scheduleCancellable(createCallback(-1), 5ms));
+    }
+    for (vibrator::CallbackId id : cancelled) {
+        ASSERT_TRUE(mScheduler->cancel(id));
+    }
+
+    ASSERT_TRUE(waitForCallbacks(100, 20ms));
+    ASSERT_THAT(getExpiredCallbacks(), ElementsAreArray(expected));
+}